@@ -8,6 +8,7 @@
 #undef  DAEDALUS_ENABLE_DYNAREC					// Define this is dynarec is supported on the platform
 #undef  DAEDALUS_ENABLE_OS_HOOKS				// Define this to enable OS HLE
 #undef  DAEDALUS_BREAKPOINTS_ENABLED			// Define this to enable breakpoint support
+#undef  DAEDALUS_THREADED_INTERPRETER			// Define this if the compiler supports computed gotos (GCC/Clang)
 #undef	DAEDALUS_ENDIAN_MODE					// Define this to specify whether the platform is big or little endian
 
 // DAEDALUS_ENDIAN_MODE should be defined as one of:
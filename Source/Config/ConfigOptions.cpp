@@ -30,17 +30,36 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 u32		gSpeedSyncEnabled			= 0;		// Enable to limit frame rate.
 bool	gDynarecEnabled				= true;		// Use dynamic recompilation
+bool	gCachedInterpreterEnabled	= true;		// Use the cached interpreter when the dynarec isn't in use
 bool	gDynarecLoopOptimisation	= false;	// Enable the dynarec loop optmisation
 bool	gDynarecDoublesOptimisation	= false;	// Enable the dynarec Doubles optmisation
+bool	gDynarecTraceOptimisation	= true;		// Fold constants and remove dead ops before assembling traces
+#ifdef DAEDALUS_ENABLE_DYNAREC_THREAD
+bool	gDynarecThreadEnabled		= true;		// Compile traces on a worker thread
+#endif
+#ifdef DAEDALUS_ENABLE_TRACE_CACHE
+bool	gDynarecTraceCacheEnabled	= false;		// Save traces when the rom is closed and reuse them next time
+#endif
 bool	gOSHooksEnabled				= true;		// Apply os-hooks
 u32		gCheckTextureHashFrequency	= 0;		// How often to check textures for updates (every N frames, 0 to disable)
+#ifdef DAEDALUS_PSP
+u32		gTextureCacheBudget			= 4 * 1024 * 1024;	// Bytes of texels to keep cached
+#else
+u32		gTextureCacheBudget			= 128 * 1024 * 1024;	// Bytes of texels to keep cached
+#endif
 bool	gDoubleDisplayEnabled		= true;		// Workaround for games that have shaking issues
 bool	gCleanSceneEnabled			= false;	// Clean our Scenes, it gets rid of many glitches
 bool	gClearDepthFrameBuffer		= false;	// Clears depth frame buffer, fixes shaky camera in DK64 and sun/flame glare in Zelda
 bool	gAudioRateMatch				= false;	// Matches audio rate with framerate, only works if 50-100% sync rate
 bool	gVideoRateMatch				= false;	// Matches VI rate with framerate
 bool	gFogEnabled					= false;	// Enable fog
+#ifdef DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+bool	gDisplayListThreadEnabled	= false;	// Process display lists on a worker thread
+#endif
 bool    gMemoryAccessOptimisation   = false;    // Enable the memory access optmisation
+#ifdef DAEDALUS_ENABLE_FASTMEM
+bool	gFastmemEnabled				= true;		// Map RDRAM into a reserved host range
+#endif
 bool	gCheatsEnabled				= false;	// Enable cheat codes
 u32		gControllerIndex			= 0;		// Which controller config to set
 
@@ -37,20 +37,35 @@ extern DaedalusConfig	g_DaedalusConfig;
 
 // Per-ROM config
 extern bool gDynarecEnabled;			// Use dynamic recompilation
+extern bool gCachedInterpreterEnabled;	// Use the cached interpreter when the dynarec isn't in use
 extern bool gDynarecLoopOptimisation;	// Enable the dynarec loop optmisation
 extern bool gDynarecDoublesOptimisation;	// Enable the dynarec loop optmisation
+extern bool gDynarecTraceOptimisation;	// Fold constants and remove dead ops before assembling traces
+#ifdef DAEDALUS_ENABLE_DYNAREC_THREAD
+extern bool gDynarecThreadEnabled;		// Compile traces on a worker thread
+#endif
+#ifdef DAEDALUS_ENABLE_TRACE_CACHE
+extern bool gDynarecTraceCacheEnabled;	// Save traces when the rom is closed and reuse them next time
+#endif
 extern bool gOSHooksEnabled;			// Apply os-hooks
 extern u32	gSpeedSyncEnabled;
 extern bool gDoubleDisplayEnabled;
 extern bool gAudioRateMatch;
 extern bool gVideoRateMatch;
 extern bool gFogEnabled;
+#ifdef DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+extern bool gDisplayListThreadEnabled;	// Process display lists on a worker thread
+#endif
 extern bool gMemoryAccessOptimisation;
+#ifdef DAEDALUS_ENABLE_FASTMEM
+extern bool gFastmemEnabled;			// Map RDRAM into a reserved host range (only read by Memory_Init)
+#endif
 extern bool gCheatsEnabled;
 //ToDo: Needs moving to Graphics plugin config
 extern bool	gCleanSceneEnabled;
 extern bool	gClearDepthFrameBuffer;
 extern u32	gCheckTextureHashFrequency;
+extern u32	gTextureCacheBudget;		// Bytes of texels to keep cached before discarding the least recently used textures
 //ToDo: Needs moving to Input plugin config
 extern u32	gControllerIndex;
 
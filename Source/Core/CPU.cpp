@@ -26,8 +26,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <string>
 #include <vector>
 
+#include "CachedInterpret.h"
 #include "Cheats.h"
 #include "Dynamo.h"
+#include "IdleLoop.h"
 #include "Interpret.h"
 #include "Interrupt.h"
 #include "Memory.h"
@@ -42,7 +44,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Config/ConfigOptions.h"
 #include "Debug/DBGConsole.h"
 #include "Debug/DebugLog.h"
+#include "HLEAudio/AudioTaskQueue.h"
 #include "OSHLE/ultra_R4300.h"
+#include "Plugins/GraphicsPlugin.h"
 #include "System/System.h"
 #include "Utility/AtomicPrimitives.h"
 #include "Utility/FramerateLimiter.h"
@@ -130,94 +134,192 @@ void CPU_UnregisterVblCallback(VblCallbackFn fn, void * arg)
 	}
 }
 
+//*****************************************************************************
+//	Event scheduler
+//
+//	Pending events are kept in a binary min-heap (gCPUState.Events) ordered
+//	by the time they fire, so adding, removing or rescheduling an event is
+//	O(log n). Times are absolute and wrap at 32 bits, so they're only ever
+//	compared relative to each other (events are never more than 2^31 cycles
+//	apart).
+//
+//	The cores only ever look at gCPUState.EventCounter, the number of cycles
+//	until the event at the top of the heap. The current time is implied by
+//	this (Events[0].mTime - EventCounter), so whenever the top of the heap
+//	changes EventCounter is reloaded relative to the time before the change.
+//	When the last event is popped Events[0] is left as it was so this still
+//	holds until the next event is added.
+//
+//	VBL and COMPARE only ever have one event queued. Their heap positions are
+//	kept in gCPUState.EventIndex so they can be found without a search.
+//*****************************************************************************
+static const u8 INVALID_EVENT_INDEX( 0xff );
+
+static inline bool CPU_IsEventBefore( const CPUEvent & a, const CPUEvent & b )
+{
+	return s32( a.mTime - b.mTime ) < 0;
+}
+
+static inline u32 CPU_GetEventTime()
+{
+	return gCPUState.Events[ 0 ].mTime - gCPUState.EventCounter;
+}
+
+static inline void CPU_ReloadEventCounter( u32 now )
+{
+	gCPUState.EventCounter = s32( gCPUState.Events[ 0 ].mTime - now );
+}
+
+// EventIndex is only meaningful for VBL and COMPARE, but it's cheaper to always write it
+static inline void CPU_PlaceEvent( u32 idx, const CPUEvent & event )
+{
+	gCPUState.Events[ idx ] = event;
+	gCPUState.EventIndex[ event.mEventType ] = u8( idx );
+}
+
+static void CPU_SiftEventUp( u32 idx )
+{
+	CPUEvent event = gCPUState.Events[ idx ];
+
+	while( idx > 0 )
+	{
+		u32 parent = (idx - 1) / 2;
+		if( !CPU_IsEventBefore( event, gCPUState.Events[ parent ] ) )
+			break;
+
+		CPU_PlaceEvent( idx, gCPUState.Events[ parent ] );
+		idx = parent;
+	}
+
+	CPU_PlaceEvent( idx, event );
+}
+
+static void CPU_SiftEventDown( u32 idx )
+{
+	CPUEvent event = gCPUState.Events[ idx ];
+
+	while( true )
+	{
+		u32 child = idx * 2 + 1;
+		if( child >= gCPUState.NumEvents )
+			break;
+
+		if( child + 1 < gCPUState.NumEvents && CPU_IsEventBefore( gCPUState.Events[ child + 1 ], gCPUState.Events[ child ] ) )
+			child++;
+
+		if( !CPU_IsEventBefore( gCPUState.Events[ child ], event ) )
+			break;
+
+		CPU_PlaceEvent( idx, gCPUState.Events[ child ] );
+		idx = child;
+	}
+
+	CPU_PlaceEvent( idx, event );
+}
+
+//
+//	(Re)schedule event_type to fire count cycles from now, in heap slot idx.
+//	idx is either a new slot at the end of the heap or the event's existing slot.
+//
+static void CPU_ScheduleEvent( u32 idx, s32 count, ECPUEventType event_type )
+{
+	u32 now = CPU_GetEventTime();
+
+	CPUEvent event;
+	event.mTime = now + count;
+	event.mEventType = event_type;
+	CPU_PlaceEvent( idx, event );
+
+	if( idx > 0 && CPU_IsEventBefore( event, gCPUState.Events[ (idx - 1) / 2 ] ) )
+	{
+		CPU_SiftEventUp( idx );
+	}
+	else
+	{
+		CPU_SiftEventDown( idx );
+	}
+
+	CPU_ReloadEventCounter( now );
+}
+
+//*****************************************************************************
+//	The interpreter only brings COUNT and EventCounter up to date when it
+//	leaves a straight-line run of ops, or when an event fires. While an op
+//	which might look at them is executing, the cycles it hasn't accounted
+//	for yet are left in PendingCycles. Anything which reads COUNT or touches
+//	the event list from an op handler needs to call this first.
+//*****************************************************************************
+void CPU_SyncCounter()
+{
+	u32 cycles( gCPUState.PendingCycles );
+	if( cycles != 0 )
+	{
+		gCPUState.PendingCycles = 0;
+		gCPUState.CPUControl[C0_COUNT]._u32 += cycles;
+
+		// Never enough to fire an event - the interpreter stops short of that
+		bool ready( CPU_ProcessEventCycles( cycles ) );
+		DAEDALUS_ASSERT( !ready, "Pending cycles should never reach the next event" );
+		DAEDALUS_USE( ready );
+	}
+}
+
 void CPU_SkipToNextEvent()
 {
+	CPU_SyncCounter();
+
 	LOCK_EVENT_QUEUE();
 
 	DAEDALUS_ASSERT( gCPUState.NumEvents > 0, "There are no events" );
-	gCPUState.CPUControl[C0_COUNT]._u32 += (gCPUState.Events[ 0 ].mCount - 1);
-	gCPUState.Events[ 0 ].mCount = 1;
+	gCPUState.CPUControl[C0_COUNT]._u32 += (gCPUState.EventCounter - 1);
+	gCPUState.EventCounter = 1;
 }
 
 static void CPU_ResetEventList()
 {
-	gCPUState.Events[ 0 ].mCount     = kInitialVIInterruptCycles;
+	memset( gCPUState.EventIndex, INVALID_EVENT_INDEX, sizeof( gCPUState.EventIndex ) );
+
+	gCPUState.Events[ 0 ].mTime      = kInitialVIInterruptCycles;
 	gCPUState.Events[ 0 ].mEventType = CPU_EVENT_VBL;
+	gCPUState.EventIndex[ CPU_EVENT_VBL ] = 0;
+	gCPUState.EventCounter = kInitialVIInterruptCycles;
 	gCPUState.NumEvents = 1;
+	gCPUState.PendingCycles = 0;
 
 	RESET_EVENT_QUEUE_LOCK();
 }
 
 void CPU_AddEvent( s32 count, ECPUEventType event_type )
 {
+	CPU_SyncCounter();
+
 	LOCK_EVENT_QUEUE();
 
 	DAEDALUS_ASSERT( count > 0, "Count is invalid" );
 	DAEDALUS_ASSERT( gCPUState.NumEvents < MAX_CPU_EVENTS, "Too many events" );
+	DAEDALUS_ASSERT( (event_type != CPU_EVENT_VBL && event_type != CPU_EVENT_COMPARE) ||
+					 gCPUState.EventIndex[ event_type ] == INVALID_EVENT_INDEX, "Event is already queued" );
 
-	u32 event_idx;
-	for( event_idx = 0; event_idx < gCPUState.NumEvents; ++event_idx )
-	{
-		CPUEvent & event = gCPUState.Events[ event_idx ];
-
-		if( count <= event.mCount )
-		{
-			//
-			//	This event belongs before the subsequent one so insert a space for it here and break out
-			//	Don't forget to decrement the counter for the subsequent event
-			//
-			event.mCount -= count;
-
-			u32 num_to_copy = gCPUState.NumEvents - event_idx;
-			if( num_to_copy > 0 )
-			{
-				memmove( &gCPUState.Events[ event_idx+1 ], &gCPUState.Events[ event_idx ], num_to_copy * sizeof( CPUEvent ) );
-			}
-			break;
-		}
-
-		//
-		//	Decrease counter by that for this event
-		//
-		count -= event.mCount;
-	}
-
-	DAEDALUS_ASSERT( event_idx <= gCPUState.NumEvents, "Invalid idx" );
-	gCPUState.Events[ event_idx ].mCount = count;
-	gCPUState.Events[ event_idx ].mEventType = event_type;
-	gCPUState.NumEvents++;
+	CPU_ScheduleEvent( gCPUState.NumEvents++, count, event_type );
 }
 
 static void CPU_SetCompareEvent( s32 count )
 {
-	{
-		LOCK_EVENT_QUEUE();
+	LOCK_EVENT_QUEUE();
 
-		DAEDALUS_ASSERT( count > 0, "Count is invalid" );
+	DAEDALUS_ASSERT( count > 0, "Count is invalid" );
 
-		//
-		//	Remove any existing compare events. Need to adjust any subsequent timer's count.
-		//
-		for( u32 i = 0; i < gCPUState.NumEvents; ++i )
-		{
-			if( gCPUState.Events[ i ].mEventType == CPU_EVENT_COMPARE )
-			{
-				//
-				//	Check for a following event, and remove
-				//
-				if( i+1 < gCPUState.NumEvents )
-				{
-					gCPUState.Events[ i+1 ].mCount += gCPUState.Events[ i ].mCount;
-					u32 num_to_copy = gCPUState.NumEvents - (i+1);
-					memmove( &gCPUState.Events[ i ], &gCPUState.Events[ i+1 ], num_to_copy * sizeof( CPUEvent ) );
-				}
-				gCPUState.NumEvents--;
-				break;
-			}
-		}
+	//
+	//	Reschedule any existing compare event in place
+	//
+	u32 idx = gCPUState.EventIndex[ CPU_EVENT_COMPARE ];
+	if( idx == INVALID_EVENT_INDEX )
+	{
+		DAEDALUS_ASSERT( gCPUState.NumEvents < MAX_CPU_EVENTS, "Too many events" );
+		idx = gCPUState.NumEvents++;
 	}
 
-	CPU_AddEvent( count, CPU_EVENT_COMPARE );
+	CPU_ScheduleEvent( idx, count, CPU_EVENT_COMPARE );
 }
 
 static ECPUEventType CPU_PopEvent()
@@ -225,46 +327,52 @@ static ECPUEventType CPU_PopEvent()
 	LOCK_EVENT_QUEUE();
 
 	DAEDALUS_ASSERT( gCPUState.NumEvents > 0, "Event queue empty" );
-	DAEDALUS_ASSERT( gCPUState.Events[ 0 ].mCount <= 0, "Popping event when cycles remain" );
-	//DAEDALUS_ASSERT( gCPUState.Events[ 0 ].mCount == 0, "Popping event with a bit of underflow" );
+	DAEDALUS_ASSERT( gCPUState.EventCounter <= 0, "Popping event when cycles remain" );
+	//DAEDALUS_ASSERT( gCPUState.EventCounter == 0, "Popping event with a bit of underflow" );
 
+	u32 now = CPU_GetEventTime();
 	ECPUEventType event_type = gCPUState.Events[ 0 ].mEventType;
 
-	u32	num_to_copy = gCPUState.NumEvents - 1;
-	if( num_to_copy > 0 )
+	gCPUState.EventIndex[ event_type ] = INVALID_EVENT_INDEX;
+
+	u32 last = --gCPUState.NumEvents;
+	if( last > 0 )
 	{
-		memmove( &gCPUState.Events[ 0 ], &gCPUState.Events[ 1 ], num_to_copy * sizeof( CPUEvent ) );
+		CPU_PlaceEvent( 0, gCPUState.Events[ last ] );
+		CPU_SiftEventDown( 0 );
+		CPU_ReloadEventCounter( now );
 	}
-	gCPUState.NumEvents--;
 
 	return event_type;
 }
 
-// XXXX This is for savestate. Looks very suspicious to me
+// This is for savestate - the number of cycles until the next VBL
 u32 CPU_GetVideoInterruptEventCount()
 {
-	for( u32 i = 0; i < gCPUState.NumEvents; ++i )
-	{
-		if(gCPUState.Events[ i ].mEventType == CPU_EVENT_VBL)
-		{
-			return gCPUState.Events[ i ].mCount;
-		}
-	}
+	CPU_SyncCounter();
+
+	u32 idx = gCPUState.EventIndex[ CPU_EVENT_VBL ];
+	if( idx == INVALID_EVENT_INDEX )
+		return 0;
 
-	return 0;
+	return gCPUState.Events[ idx ].mTime - CPU_GetEventTime();
 }
 
-// XXXX This is for savestate. Looks very suspicious to me
+// This is for savestate
 void CPU_SetVideoInterruptEventCount( u32 count )
 {
-	for( u32 i = 0; i < gCPUState.NumEvents; ++i )
+	CPU_SyncCounter();
+
+	LOCK_EVENT_QUEUE();
+
+	u32 idx = gCPUState.EventIndex[ CPU_EVENT_VBL ];
+	if( idx == INVALID_EVENT_INDEX )
 	{
-		if(gCPUState.Events[ i ].mEventType == CPU_EVENT_VBL)
-		{
-			gCPUState.Events[ i ].mCount = count;
-			return;
-		}
+		DAEDALUS_ASSERT( gCPUState.NumEvents < MAX_CPU_EVENTS, "Too many events" );
+		idx = gCPUState.NumEvents++;
 	}
+
+	CPU_ScheduleEvent( idx, count, CPU_EVENT_VBL );
 }
 
 void SCPUState::ClearStuffToDo()
@@ -345,6 +453,7 @@ bool CPU_RomOpen()
 	}
 
 	// Init TLBs:
+	TLB_InvalidatePageTable();
 	for (u32 i = 0; i < 32; i++)
 	{
 		g_TLBs[i].Reset();
@@ -378,6 +487,9 @@ bool CPU_RomOpen()
 #endif
 
 	Dynamo_Reset();
+	Dynamo_RomOpen();
+	CachedInterp_Reset();
+	IdleLoop_Reset();
 
 	CPU_SelectCore();
 	return true;
@@ -385,6 +497,8 @@ bool CPU_RomOpen()
 
 void CPU_RomClose()
 {
+	Dynamo_RomClose();
+
 #ifdef DAEDALUS_ENABLE_DYNAREC
 	#ifdef DAEDALUS_DEBUG_DYNAREC
 		//This will dump the fragment cache on exit to ROMs menu
@@ -407,6 +521,9 @@ void CPU_SelectCore()
 		Dynamo_SelectCore();
 	else
 #endif
+	if (gCachedInterpreterEnabled)
+		CachedInterp_SelectCore();
+	else
 		Inter_SelectCore();
 
 	if( gCPUStopOnSimpleState && CPU_IsStateSimple() )
@@ -468,6 +585,15 @@ static void HandleSaveStateOperationOnVerticalBlank()
 
 	MutexLock lock( &gSaveStateMutex );
 
+	// A display list running on another thread may still be using RDRAM
+	if( gGraphicsPlugin != NULL )
+	{
+		gGraphicsPlugin->SyncDList();
+	}
+#ifdef DAEDALUS_ENABLE_AUDIO_TASK_THREAD
+	AudioTask_Sync();
+#endif
+
 	//
 	// Handle the save state
 	//
@@ -492,6 +618,8 @@ static void HandleSaveStateOperationOnVerticalBlank()
 		if (SaveState_LoadFromFile( gSaveStateFilename.c_str() ))
 		{
 			CPU_ResetFragmentCache();
+			CachedInterp_Reset();
+			IdleLoop_Reset();
 			gSaveStateOperation = SSO_NONE;
 		}
 		else
@@ -696,6 +824,10 @@ void CPU_HANDLE_COUNT_INTERRUPT()
 		break;
 	case CPU_EVENT_AUDIO:
 		{
+#ifdef DAEDALUS_ENABLE_AUDIO_TASK_THREAD
+			// The task may still be running on the audio task thread
+			AudioTask_Sync();
+#endif
 			u32 status = Memory_SP_SetRegisterBits(SP_STATUS_REG, SP_STATUS_TASKDONE|SP_STATUS_YIELDED|SP_STATUS_BROKE|SP_STATUS_HALT);
 			if( status & SP_STATUS_INTR_BREAK )
 				CPU_AddEvent(4000, CPU_EVENT_SPINT);
@@ -717,6 +849,8 @@ void CPU_SetCompare(u32 value)
 {
 	gCPUState.CPUControl[C0_CAUSE]._u32 &= ~CAUSE_IP8;
 
+	CPU_SyncCounter();
+
 	DPF( DEBUG_REGS, "COMPARE set to 0x%08x.", value );
 	//DBGConsole_Msg(0, "COMPARE set to 0x%08x Count is 0x%08x.", value, gCPUState.CPUControl[C0_COUNT]._u32);
 
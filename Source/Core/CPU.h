@@ -73,14 +73,16 @@ enum	ECPUEventType
 	CPU_EVENT_COMPARE,
 	CPU_EVENT_AUDIO,
 	CPU_EVENT_SPINT,
+
+	NUM_CPU_EVENT_TYPES
 };
 
-// In practice there should only ever be 2
-#define MAX_CPU_EVENTS 4
+// One each of VBL and COMPARE, plus any outstanding RSP events
+#define MAX_CPU_EVENTS 8
 
 struct CPUEvent
 {
-	s32						mCount;
+	u32						mTime;			// Scheduler time at which the event fires (wraps, see CPU.cpp)
 	ECPUEventType			mEventType;
 };
 DAEDALUS_STATIC_ASSERT( sizeof( CPUEvent ) == 8 );
@@ -128,8 +130,11 @@ ALIGNED_TYPE(struct, SCPUState, CACHE_ALIGN)
 	REG32			Temp3;				// 0x2A8	Temp storage Dynarec
 	REG32			Temp4;				// 0x2AC	Temp storage Dynarec
 
-	CPUEvent		Events[ MAX_CPU_EVENTS ];	// 0x2B0 //In practice there should only ever be 2 CPU_EVENTS
-	u32				NumEvents;
+	s32				EventCounter;		// 0x2B0	Cycles until Events[0] fires. This is all the cores need to test
+	u32				NumEvents;			// 0x2B4
+	CPUEvent		Events[ MAX_CPU_EVENTS ];	// 0x2B8	Binary min-heap of pending events, ordered by mTime
+	u8				EventIndex[ NUM_CPU_EVENT_TYPES ];	// Heap index of the (unique) VBL and COMPARE events
+	u32				PendingCycles;		// Cycles run but not yet added to COUNT and EventCounter. See CPU_SyncCounter()
 
 	void			AddJob( u32 job );
 	void			ClearJob( u32 job );
@@ -174,6 +179,7 @@ void	CPU_EnableBreakPoint( u32 address, bool enable );		// Enable/Disable the br
 bool	CPU_IsRunning();
 void	CPU_AddEvent( s32 count, ECPUEventType event_type );
 void	CPU_SkipToNextEvent();
+void	CPU_SyncCounter();				// Call before reading COUNT from an op handler. See CPU.cpp
 bool	CPU_CheckStuffToDo();
 
 typedef void (*VblCallbackFn)(void * arg);
@@ -251,8 +257,8 @@ inline bool CPU_ProcessEventCycles( u32 cycles )
 	LOCK_EVENT_QUEUE();
 
 	DAEDALUS_ASSERT( gCPUState.NumEvents > 0, "There are no events" );
-	gCPUState.Events[ 0 ].mCount -= cycles;
-	return gCPUState.Events[ 0 ].mCount <= 0;
+	gCPUState.EventCounter -= cycles;
+	return gCPUState.EventCounter <= 0;
 }
 
 #ifdef DAEDALUS_PROFILE_EXECUTION
@@ -0,0 +1,441 @@
+/*
+Copyright (C) 2007 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+//
+//	Cached interpreter core.
+//
+//	Rather than fetching and decoding every op as it's executed (as
+//	CPU_EXECUTE_OP in Interpret.cpp does), each basic block is decoded once
+//	into an array of { handler, op } pairs. The handlers are the same R4300
+//	handlers the interpreter uses, so the behaviour is identical.
+//
+//	Only code running from RDRAM through KSEG0/KSEG1 is cached, anything else
+//	(TLB mapped code, SP memory) is stepped through one op at a time.
+//	Blocks never cross a 4KB page, and each page has a generation count which
+//	is bumped by CPU_InvalidateICacheRange. A block is only run if the
+//	generation it was decoded with is still current.
+//
+//	COUNT is updated lazily, as in the threaded interpreter: the cycles run
+//	are counted in a local and only added to COUNT when a jump is taken, the
+//	next event is due, or an op which might look at COUNT is executed.
+//
+
+#include "stdafx.h"
+#include "CachedInterpret.h"
+
+#include <string.h>
+
+#include "CPU.h"
+#include "Interpret.h"
+#include "Registers.h"					// For REG_?? defines
+#include "Memory.h"
+#include "R4300.h"
+
+#include "Debug/DBGConsole.h"
+#include "DynaRec/StaticAnalysis.h"
+#include "OSHLE/ultra_R4300.h"
+#include "Utility/Macros.h"
+#include "Utility/Profiler.h"
+
+namespace
+{
+
+struct SCachedOp
+{
+	CPU_Instruction		Handler;
+	u32					OpBits;
+	bool				NeedsCount;		// See R4300_OpNeedsCount()
+};
+
+struct SCachedBlock
+{
+	u32					Address;		// PC of the first op, or INVALID_ADDRESS
+	u32					Generation;		// Block is stale unless this matches gPageGenerations[ Page ]
+	u16					Page;
+	u16					NumOps;
+	u32					FirstOp;		// Index into gCachedOps
+	u8 *				pHost;			// Host address of the first op (for gLastAddress)
+};
+
+const u32			INVALID_ADDRESS( ~0 );		// Never a valid (aligned) PC
+
+#ifdef DAEDALUS_PSP
+const u32			BLOCK_TABLE_BITS( 12 );
+const u32			MAX_CACHED_OPS( 32 * 1024 );
+#else
+const u32			BLOCK_TABLE_BITS( 14 );
+const u32			MAX_CACHED_OPS( 128 * 1024 );
+#endif
+const u32			BLOCK_TABLE_SIZE( 1 << BLOCK_TABLE_BITS );
+const u32			MAX_BLOCK_OPS( 64 );
+
+const u32			PAGE_SHIFT( 12 );
+const u32			PAGE_SIZE( 1 << PAGE_SHIFT );
+const u32			NUM_PAGES( MAX_RAM_ADDRESS >> PAGE_SHIFT );
+
+SCachedBlock		gBlockTable[ BLOCK_TABLE_SIZE ];
+SCachedOp			gCachedOps[ MAX_CACHED_OPS ];
+u32					gNumCachedOps( 0 );
+u32					gPageGenerations[ NUM_PAGES ];
+
+}
+
+//*****************************************************************************
+//	R4300_SetSR swaps the top level COP1 handlers depending on SR_CU1, so
+//	these have to go through the top level table when they're executed.
+//*****************************************************************************
+static void R4300_CALL_TYPE CachedInterp_ExecuteTopLevel( u32 op_code_bits )
+{
+	R4300Instruction[ op_code_bits >> 26 ]( op_code_bits );
+}
+
+static CPU_Instruction CachedInterp_GetHandler( OpCode op_code )
+{
+	switch( op_code.op )
+	{
+	case OP_COPRO1:
+	case OP_LWC1:
+	case OP_LDC1:
+	case OP_SWC1:
+	case OP_SDC1:
+		return CachedInterp_ExecuteTopLevel;
+	default:
+		return R4300_GetInstructionHandler( op_code );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void CachedInterp_Reset()
+{
+	for( u32 i = 0; i < BLOCK_TABLE_SIZE; ++i )
+	{
+		gBlockTable[ i ].Address = INVALID_ADDRESS;
+	}
+	gNumCachedOps = 0;
+	memset( gPageGenerations, 0, sizeof( gPageGenerations ) );
+}
+
+//*****************************************************************************
+//	Only KSEG0/KSEG1 code is ever cached, so other addresses can be ignored
+//	(this matches the dynarec's fragment cache coverage)
+//*****************************************************************************
+void CachedInterp_InvalidateRange( u32 address, u32 length )
+{
+	if( (address >> 30) != 2 || length == 0 )
+		return;
+
+	u32 first_page( (address & 0x1FFFFFFF) >> PAGE_SHIFT );
+	u32 last_page( ((address & 0x1FFFFFFF) + length - 1) >> PAGE_SHIFT );
+
+	for( u32 i = first_page; i <= last_page && i < NUM_PAGES; ++i )
+	{
+		gPageGenerations[ i ]++;
+	}
+}
+
+//*****************************************************************************
+//	Unlike CachedInterp_Reset this is safe to call while a block is running
+//	(e.g. from the osInvalICache patch), as the running block sees its
+//	generation change and stops.
+//*****************************************************************************
+void CachedInterp_InvalidateAll()
+{
+	for( u32 i = 0; i < NUM_PAGES; ++i )
+	{
+		gPageGenerations[ i ]++;
+	}
+}
+
+//*****************************************************************************
+//	Decode the block starting at pc into the given slot.
+//	Returns NULL if the code at pc can't be cached.
+//*****************************************************************************
+static SCachedBlock * CachedInterp_DecodeBlock( u32 pc, SCachedBlock & block )
+{
+	const MemFuncRead & m( g_MemoryLookupTableRead[ pc >> 18 ] );
+	if( m.pRead == NULL )
+		return NULL;
+
+	u8 *	p_host( m.pRead + pc );
+	if( p_host < g_pu8RamBase || p_host >= g_pu8RamBase + gRamSize )
+		return NULL;
+
+	if( gNumCachedOps + MAX_BLOCK_OPS > MAX_CACHED_OPS )
+	{
+		DBGConsole_Msg( 0, "Cached interpreter is full - flushing" );
+		CachedInterp_Reset();
+	}
+
+	u32		physical( p_host - g_pu8RamBase );
+	u32		page( physical >> PAGE_SHIFT );
+	u32		max_ops( (PAGE_SIZE - (physical & (PAGE_SIZE-1))) / 4 );
+	if( max_ops > MAX_BLOCK_OPS )
+		max_ops = MAX_BLOCK_OPS;
+
+	SCachedOp *	p_ops( &gCachedOps[ gNumCachedOps ] );
+	u32			num_ops( 0 );
+	bool		in_delay_slot( false );
+
+	// Stop after the delay slot of the first branch
+	while( num_ops < max_ops )
+	{
+		OpCode	op_code( *reinterpret_cast< const OpCode * >( p_host + num_ops * 4 ) );
+
+		p_ops[ num_ops ].Handler = CachedInterp_GetHandler( op_code );
+		p_ops[ num_ops ].OpBits = op_code._u32;
+		p_ops[ num_ops ].NeedsCount = R4300_OpNeedsCount( op_code.op );
+		num_ops++;
+
+		if( in_delay_slot )
+			break;
+
+		StaticAnalysis::RegisterUsage	usage;
+		StaticAnalysis::Analyse( op_code, usage );
+
+		if( usage.BranchType == BT_ERET )
+			break;
+
+		in_delay_slot = usage.BranchType != BT_NOT_BRANCH;
+	}
+
+	block.Address = pc;
+	block.Generation = gPageGenerations[ page ];
+	block.Page = u16( page );
+	block.NumOps = u16( num_ops );
+	block.FirstOp = gNumCachedOps;
+	block.pHost = p_host;
+
+	gNumCachedOps += num_ops;
+
+	return &block;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+static DAEDALUS_FORCEINLINE SCachedBlock * CachedInterp_LookupBlock( u32 pc )
+{
+	SCachedBlock & block( gBlockTable[ (pc >> 2) & (BLOCK_TABLE_SIZE-1) ] );
+
+	if( block.Address == pc && block.Generation == gPageGenerations[ block.Page ] )
+	{
+		return &block;
+	}
+
+	return CachedInterp_DecodeBlock( pc, block );
+}
+
+//*****************************************************************************
+//	Everything CPU_EXECUTE_OP does after the instruction handler
+//*****************************************************************************
+static DAEDALUS_FORCEINLINE void CachedInterp_CompleteOp()
+{
+	gGPR[0]._u64 = 0;	//Ensure r0 is zero
+
+#ifdef DAEDALUS_PROFILE_EXECUTION
+	gTotalInstructionsEmulated++;
+#endif
+
+	// Increment count register
+	gCPUState.CPUControl[C0_COUNT]._u32 = gCPUState.CPUControl[C0_COUNT]._u32 + COUNTER_INCREMENT_PER_OP;
+
+	if (CPU_ProcessEventCycles( COUNTER_INCREMENT_PER_OP ) )
+	{
+		CPU_HANDLE_COUNT_INTERRUPT();
+	}
+
+	switch (gCPUState.Delay)
+	{
+	case DO_DELAY:
+		// We've got a delayed instruction to execute. Increment
+		// PC as normal, so that subsequent instruction is executed
+		INCREMENT_PC();
+		gCPUState.Delay = EXEC_DELAY;
+		break;
+	case EXEC_DELAY:
+		// We've just executed the delayed instr. Now carry out jump as stored in gCPUState.TargetPC;
+		CPU_SetPC(gCPUState.TargetPC);
+		gCPUState.Delay = NO_DELAY;
+		break;
+	case NO_DELAY:
+		// Normal operation - just increment the PC
+		INCREMENT_PC();
+		break;
+	default:
+		NODEFAULT;
+	}
+}
+
+//*****************************************************************************
+//	As CachedInterp_CompleteOp, but COUNT is only brought up to date at the
+//	end of a straight line run of ops, or when the next event is due
+//*****************************************************************************
+static DAEDALUS_FORCEINLINE void CachedInterp_CompleteLazyOp( u32 & cycles, u32 & budget )
+{
+	gGPR[0]._u64 = 0;	//Ensure r0 is zero
+
+#ifdef DAEDALUS_PROFILE_EXECUTION
+	gTotalInstructionsEmulated++;
+#endif
+
+	cycles += COUNTER_INCREMENT_PER_OP;
+
+	if( cycles >= budget || gCPUState.Delay == EXEC_DELAY )
+	{
+		CPU_FLUSH_CYCLES( cycles, budget );
+	}
+
+	switch (gCPUState.Delay)
+	{
+	case DO_DELAY:
+		INCREMENT_PC();
+		gCPUState.Delay = EXEC_DELAY;
+		break;
+	case EXEC_DELAY:
+		CPU_SetPC(gCPUState.TargetPC);
+		gCPUState.Delay = NO_DELAY;
+		break;
+	case NO_DELAY:
+		INCREMENT_PC();
+		break;
+	default:
+		NODEFAULT;
+	}
+}
+
+//*****************************************************************************
+//	Uncached path, for code we can't cache
+//*****************************************************************************
+static void CachedInterp_StepOp()
+{
+	u8 * p_Instruction;
+
+	CPU_FETCH_INSTRUCTION( p_Instruction, gCPUState.CurrentPC );
+	OpCode op_code = *(OpCode*)p_Instruction;
+
+	// Cache instruction base pointer (used for SpeedHack() @ R4300.0)
+	gLastAddress = p_Instruction;
+
+	R4300_ExecuteInstruction(op_code);
+
+	CachedInterp_CompleteOp();
+}
+
+//*****************************************************************************
+//	Run ops from the block for as long as execution stays in it.
+//	Any branch, exception or likely branch skipping its delay slot moves the
+//	PC somewhere else, so we just compare against the expected PC.
+//	An op can also invalidate the block it's in (e.g. by starting a PI DMA).
+//*****************************************************************************
+static DAEDALUS_FORCEINLINE void CachedInterp_ExecuteBlock( const SCachedBlock & block, u32 & cycles, u32 & budget )
+{
+	const SCachedOp *	p_op( &gCachedOps[ block.FirstOp ] );
+	const SCachedOp *	p_end( p_op + block.NumOps );
+	u32					pc( block.Address );
+	u8 *				p_host( block.pHost );
+
+	do
+	{
+		gLastAddress = p_host;
+
+		if( p_op->NeedsCount )
+		{
+			gCPUState.PendingCycles = cycles;
+
+			p_op->Handler( p_op->OpBits );
+
+			// The op may have synced COUNT, or scheduled a new event
+			cycles = gCPUState.PendingCycles;
+			gCPUState.PendingCycles = 0;
+			budget = CPU_GET_CYCLE_BUDGET();
+		}
+		else
+		{
+			p_op->Handler( p_op->OpBits );
+		}
+
+		CachedInterp_CompleteLazyOp( cycles, budget );
+
+		if( gCPUState.GetStuffToDo() )
+			break;
+
+		++p_op;
+		pc += 4;
+		p_host += 4;
+	}
+	while( p_op < p_end && gCPUState.CurrentPC == pc && block.Generation == gPageGenerations[ block.Page ] );
+}
+
+//*****************************************************************************
+// Keep executing blocks until there are other tasks to do (i.e. gCPUState.GetStuffToDo() is set)
+// Process these tasks and loop
+//*****************************************************************************
+static void CPU_GoCached()
+{
+	DAEDALUS_PROFILE( __FUNCTION__ );
+
+	u32		cycles( 0 );		// Cycles run since COUNT was last updated
+	u32		budget;				// Cycles that can run before the next event fires
+
+	while (CPU_KeepRunning())
+	{
+		budget = CPU_GET_CYCLE_BUDGET();
+
+		//
+		// Keep executing ops as long as there's nothing to do
+		//
+		while( gCPUState.GetStuffToDo() == 0 )
+		{
+			const SCachedBlock * p_block( CachedInterp_LookupBlock( gCPUState.CurrentPC ) );
+
+			if( p_block != NULL )
+			{
+				CachedInterp_ExecuteBlock( *p_block, cycles, budget );
+			}
+			else
+			{
+				if( cycles != 0 )
+				{
+					CPU_FLUSH_CYCLES( cycles, budget );
+				}
+
+				CachedInterp_StepOp();
+			}
+		}
+
+		// Interrupts, exceptions and core changes all expect COUNT to be current
+		if( cycles != 0 )
+		{
+			CPU_FLUSH_CYCLES( cycles, budget );
+		}
+
+		if (CPU_CheckStuffToDo())
+			break;
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void CachedInterp_SelectCore()
+{
+	g_pCPUCore = CPU_GoCached;
+}
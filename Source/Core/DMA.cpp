@@ -121,6 +121,9 @@ void DMA_SP_CopyToRDRAM()
 			break;
 		}
 		fast_memcpy_swizzle( &g_pu8RamBase[rdram_address], &g_pu8SpMemBase[spmem_address], length );
+#ifdef DAEDALUS_ENABLE_DIRTY_PAGES
+		DirtyPages_MarkRange( rdram_address, length );
+#endif
 		rdram_address += length + skip;
 		spmem_address += length;
 	}
@@ -175,6 +178,9 @@ void DMA_SI_CopyToDRAM( )
 		p_dst[i] = BSWAP32(p_src[i]);
 	}
 
+#ifdef DAEDALUS_ENABLE_DIRTY_PAGES
+	DirtyPages_MarkRange( mem, 64 );
+#endif
 
 	Memory_SI_SetRegisterBits(SI_STATUS_REG, SI_STATUS_INTERRUPT);
 	Memory_MI_SetRegisterBits(MI_INTR_REG, MI_INTR_SI);
@@ -226,6 +232,11 @@ static void OnCopiedRom()
 	{
 		gDMAUsed = true;
 
+#ifdef DAEDALUS_ENABLE_DIRTY_PAGES
+		// The patches and the hacks below write all over RDRAM
+		DirtyPages_MarkAll();
+#endif
+
 #ifdef DAEDALUS_ENABLE_OS_HOOKS
 		// Note the rom is only scanned when the ROM jumps to the game boot address
 		// ToDO: try to reapply patches - certain roms load in more of the OS after a number of transfers ?
@@ -253,6 +264,10 @@ void DMA_PI_CopyToRDRAM()
 	//DAEDALUS_ASSERT(!IsDom1Addr1(cart_address), "The code below doesn't handle dom1/addr1 correctly");
 	//DAEDALUS_ASSERT(!IsDom1Addr3(cart_address), "The code below doesn't handle dom1/addr3 correctly");
 
+#ifdef DAEDALUS_ENABLE_DIRTY_PAGES
+	DirtyPages_MarkRange( mem_address, pi_length_reg );
+#endif
+
 	if (cart_address < 0x10000000)
     {
 		if (IsFlashDomAddr(cart_address))
@@ -0,0 +1,135 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "DirtyPages.h"
+
+#ifdef DAEDALUS_ENABLE_DIRTY_PAGES
+
+#include <string.h>
+
+u8					gDirtyPages[ kNumDirtyPages ];
+
+namespace
+{
+	u32				gPageStamps[ kNumDirtyPages ];
+	u32				gEpoch( 0 );
+
+	// Returns true as soon as fn( page ) does for a page overlapping [address, address + length)
+	template< typename Fn >
+	bool	AnyPageInRange( u32 address, u32 length, Fn fn )
+	{
+		if( length == 0 )
+			return false;
+
+		u32		first_page( address >> kDirtyPageShift );
+		u32		last_page( (address + length - 1) >> kDirtyPageShift );
+
+		// Anything this big (or wrapping) covers everything
+		if( last_page - first_page >= kNumDirtyPages )
+		{
+			first_page = 0;
+			last_page = kNumDirtyPages - 1;
+		}
+
+		for( u32 page = first_page; page <= last_page; ++page )
+		{
+			if( fn( page & (kNumDirtyPages - 1) ) )
+				return true;
+		}
+
+		return false;
+	}
+
+	struct SMarkPage
+	{
+		bool	operator()( u32 page ) const		{ gDirtyPages[ page ] = 1; return false; }
+	};
+
+	struct SPageChanged
+	{
+		explicit SPageChanged( u32 epoch ) : Epoch( epoch ) {}
+
+		// Marks which haven't been swept yet count too
+		bool	operator()( u32 page ) const		{ return gDirtyPages[ page ] != 0 || gPageStamps[ page ] > Epoch; }
+
+		u32		Epoch;
+	};
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void DirtyPages_MarkRange( u32 address, u32 length )
+{
+	AnyPageInRange( address, length, SMarkPage() );
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void DirtyPages_MarkAll()
+{
+	memset( gDirtyPages, 1, sizeof( gDirtyPages ) );
+}
+
+//*************************************************************************************
+//	Most of the time only a handful of pages have been written, so this skips
+//	through the marks a word at a time.
+//*************************************************************************************
+void DirtyPages_Sweep()
+{
+	u32		epoch( ++gEpoch );
+
+	for( u32 i = 0; i < kNumDirtyPages; i += 4 )
+	{
+		u32		marks;
+		memcpy( &marks, &gDirtyPages[ i ], sizeof( marks ) );
+
+		if( marks == 0 )
+			continue;
+
+		for( u32 page = i; page < i + 4; ++page )
+		{
+			if( gDirtyPages[ page ] )
+			{
+				gDirtyPages[ page ] = 0;
+				gPageStamps[ page ] = epoch;
+			}
+		}
+	}
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+u32 DirtyPages_GetEpoch()
+{
+	return gEpoch;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+bool DirtyPages_HasChanged( u32 address, u32 length, u32 epoch )
+{
+	return AnyPageInRange( address, length, SPageChanged( epoch ) );
+}
+
+#endif // DAEDALUS_ENABLE_DIRTY_PAGES
@@ -0,0 +1,72 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef CORE_DIRTYPAGES_H_
+#define CORE_DIRTYPAGES_H_
+
+//
+//	Keeps track of which 4KB pages of RDRAM have been written to, so the
+//	texture cache can tell that a texture's source data hasn't changed
+//	without having to hash it.
+//
+//	Writers just set a byte in gDirtyPages. Unlike setting a bit, a byte
+//	store can't undo a mark made by another thread at the same time, and
+//	it's a single instruction for the dynarec to emit. Once per display list
+//	DirtyPages_Sweep() moves the marks into a per-page stamp, so any number
+//	of clients can each ask whether a range has been written since the
+//	epoch they last looked at it.
+//
+//	Everything which writes to RDRAM has to mark it: Write*Bits (and so the
+//	interpreter and the dynarec's memory handlers), the x64 dynarec's direct
+//	stores, the DMA and HLE tasks and the OS patches which copy memory
+//	about. Anything unusual (resets, savestates) should use
+//	DirtyPages_MarkAll().
+//
+//	Addresses can be either physical or KSEG0/KSEG1, as only the page
+//	number within the largest possible RDRAM is used.
+//
+#ifdef DAEDALUS_ENABLE_DIRTY_PAGES
+
+#include "Utility/DaedalusTypes.h"
+
+static const u32	kDirtyPageShift = 12;
+static const u32	kNumDirtyPages = (8 * 1024 * 1024) >> kDirtyPageShift;
+
+extern u8			gDirtyPages[ kNumDirtyPages ];
+
+inline void DirtyPages_Mark( u32 address )
+{
+	gDirtyPages[ (address >> kDirtyPageShift) & (kNumDirtyPages - 1) ] = 1;
+}
+
+void	DirtyPages_MarkRange( u32 address, u32 length );
+void	DirtyPages_MarkAll();
+
+// Called once per display list, before any textures are checked
+void	DirtyPages_Sweep();
+u32		DirtyPages_GetEpoch();
+
+// Has anything in the range been written since DirtyPages_GetEpoch() returned epoch?
+bool	DirtyPages_HasChanged( u32 address, u32 length, u32 epoch );
+
+#endif // DAEDALUS_ENABLE_DIRTY_PAGES
+
+#endif // CORE_DIRTYPAGES_H_
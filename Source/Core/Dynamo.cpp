@@ -24,7 +24,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include <algorithm>
 
+#include "CachedInterpret.h"
 #include "CPU.h"
+#include "IdleLoop.h"
 #include "Registers.h"					// For REG_?? defines
 #include "Memory.h"
 #include "Interrupt.h"
@@ -36,6 +38,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "DynaRec/DynaRecProfile.h"
 #include "DynaRec/Fragment.h"
 #include "DynaRec/FragmentCache.h"
+#include "DynaRec/HotTraceTable.h"
+#include "DynaRec/TraceCache.h"
+#include "DynaRec/TraceCompiler.h"
 #include "DynaRec/TraceRecorder.h"
 #include "OSHLE/patch.h"				// GetCorrectOp
 #include "OSHLE/ultra_R4300.h"
@@ -59,16 +64,30 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #endif
 
 static const u32					gMaxFragmentCacheSize = (8192 + 1024); //Maximum amount of fragments in the cache
-static const u32					gMaxHotTraceMapSize = (2048 + TRACE_SIZE);
+static const u32					gMaxHotTraceMapSize = (2048 + TRACE_SIZE);	//Must be no more than CHotTraceTable::MAX_ENTRIES
 static const u32					gHotTraceThreshold = 10;	//How many times interpreter has to loop a trace before it becomes hot and sent to dynarec
 
-//typedef CMemoryPoolAllocator< std::pair< const u32, u32 > > MyAllocator;
-//std::map< u32, u32, std::less<u32>, MyAllocator >				gHotTraceCountMap;
-//std::map< u32, u32, std::less<u32>, boost::pool_allocator<std::pair< const u32, u32 > > >				gHotTraceCountMap;
-std::map< u32, u32 >				gHotTraceCountMap;
+// Past gMaxFragmentCacheSize, the least recently used fragments are evicted (down to 3/4 of the limit) rather than
+// clearing the whole cache. Evicted fragments leave their code behind, so the cache is still cleared once the code
+// buffer fills up. The PSP's code buffers are too small for that to be worth it, so it keeps clearing everything.
+#ifdef DAEDALUS_PSP
+static const bool					gEvictColdFragments = false;
+#else
+static const bool					gEvictColdFragments = true;
+#endif
+static const u32					gMaxFragmentCodeSize = 128 * 1024 * 1024;	//Within the first code buffer, which is the first 192MB of the 256MB reserved on x86/x64
+
+CHotTraceTable						gHotTraceCounts;
 CFragmentCache						gFragmentCache;
 static bool							gResetFragmentCache = false;
 
+struct SInvalidatedRange
+{
+	u32		Address;
+	u32		Length;
+};
+static std::vector< SInvalidatedRange >	gInvalidatedRanges;		// Processed at the next safe point
+
 #ifdef DAEDALUS_DEBUG_DYNAREC
 std::map< u32, u32 >				gAbortedTraceReasons;
 
@@ -78,6 +97,7 @@ void								CPU_DumpFragmentCache();
 static void							CPU_HandleDynaRecOnBranch( bool backwards, bool trace_already_enabled );
 static void							CPU_UpdateTrace( u32 address, OpCode op_code, bool branch_delay_slot, bool branch_taken );
 static void							CPU_CreateAndAddFragment();
+static void							CPU_CompileTrace( SRecordedTrace & trace );
 
 
 #ifdef DAEDALUS_PROFILE_EXECUTION
@@ -85,16 +105,6 @@ u32 gFragmentLookupFailure;
 u32 gFragmentLookupSuccess;
 #endif
 
-//*****************************************************************************
-//	Indicate that the instruction cache is invalid
-//	(we have to dump the dynarec contents and start over, but this is
-//	better than crashing :) )
-//*****************************************************************************
-void R4300_CALL_TYPE CPU_InvalidateICache()
-{
-	CPU_ResetFragmentCache();
-}
-
 //*****************************************************************************
 //
 //*****************************************************************************
@@ -105,17 +115,62 @@ void CPU_DynarecEnable()
 }
 
 //*****************************************************************************
-// If fragments overlap dynarec has to start all over which is very costly
+// Only the fragments built from the pages that were written are discarded.
+// This can be called from inside a fragment (e.g. a store which starts a
+// PI DMA), so the fragments are removed at the next safe point.
 //*****************************************************************************
 void R4300_CALL_TYPE CPU_InvalidateICacheRange( u32 address, u32 length )
 {
-	if( gFragmentCache.ShouldInvalidateOnWrite( address, length ) )
+	CachedInterp_InvalidateRange( address, length );
+	IdleLoop_InvalidateRange( address, length );
+
+	bool	invalidate( gFragmentCache.ShouldInvalidateOnWrite( address, length ) );
+#ifdef DAEDALUS_ENABLE_DYNAREC_THREAD
+	// Traces which haven't been added to the cache yet may have come from this range too
+	invalidate |= gTraceCompiler.HasOutstandingTraces();
+#endif
+
+	if( invalidate )
 	{
-#ifndef DAEDALUS_SILENT
-		printf( "Write to %08x (%d bytes) overlaps fragment cache entries\n", address, length );
+		DAED_LOG( DEBUG_DYNAREC_CACHE, "Write to %08x (%d bytes) overlaps fragment cache entries", address, length );
+
+		SInvalidatedRange	range = { address, length };
+		gInvalidatedRanges.push_back( range );
+	}
+}
+
+//*****************************************************************************
+//	Remove the fragments for any ranges written to since the last call.
+//	Must be called when no fragment is executing.
+//*****************************************************************************
+static void CPU_ProcessInvalidatedRanges()
+{
+	for( u32 i = 0; i < gInvalidatedRanges.size(); ++i )
+	{
+		u32		address( gInvalidatedRanges[ i ].Address );
+		u32		length( gInvalidatedRanges[ i ].Length );
+
+		gFragmentCache.InvalidateRange( address, length );
+
+#ifdef DAEDALUS_ENABLE_DYNAREC_THREAD
+		std::vector< u32 >	discarded;
+		gTraceCompiler.FlushRange( address, length, discarded );
+		for( u32 d = 0; d < discarded.size(); ++d )
+		{
+			gHotTraceCounts.Erase( discarded[ d ] );
+		}
 #endif
-		CPU_ResetFragmentCache();
+
+		// Any counts for the old code are meaningless now. Code may have been run through either KSEG
+		u32		physical( address & 0x1FFFFFFF );
+		u32		kseg_bases[] = { 0x80000000, 0xA0000000 };
+		for( u32 k = 0; k < ARRAYSIZE( kseg_bases ); ++k )
+		{
+			gHotTraceCounts.EraseRange( kseg_bases[ k ] + physical, length );
+		}
 	}
+
+	gInvalidatedRanges.clear();
 }
 
 
@@ -309,11 +364,15 @@ void	CPU_DumpFragmentCache()
 	{
 		std::vector< SAddressHitCount >	hit_counts;
 
-		hit_counts.reserve( gHotTraceCountMap.size() );
+		hit_counts.reserve( gHotTraceCounts.GetSize() );
 
-		for(std::map<u32,u32>::const_iterator it = gHotTraceCountMap.begin(); it != gHotTraceCountMap.end(); ++it )
+		for( u32 i = 0; i < CHotTraceTable::GetCapacity(); ++i )
 		{
-			hit_counts.push_back( SAddressHitCount( it->first, it->second ) );
+			u32		address, count;
+			if( gHotTraceCounts.GetEntry( i, &address, &count ) )
+			{
+				hit_counts.push_back( SAddressHitCount( address, count ) );
+			}
 		}
 
 		std::sort( hit_counts.begin(), hit_counts.end(), SortByHitCount );
@@ -354,20 +413,123 @@ void	CPU_DumpFragmentCache()
 }
 #endif
 
+//*****************************************************************************
+//
+//*****************************************************************************
+static void CPU_AddFragment( CFragment * p_fragment )
+{
+	gHotTraceCounts.Erase( p_fragment->GetEntryAddress() );
+	gFragmentCache.InsertFragment( p_fragment );
+
+	//DBGConsole_Msg( 0, "Inserted hot trace at [R%08x]! (size is %d. %dKB)", p_fragment->GetEntryAddress(), gFragmentCache.GetCacheSize(), gFragmentCache.GetMemoryUsage() / 1024 );
+}
+
 //*****************************************************************************
 //
 //*****************************************************************************
 void CPU_CreateAndAddFragment()
 {
-	CFragment * p_fragment( gTraceRecorder.CreateFragment( gFragmentCache.GetCodeBufferManager() ) );
+	SRecordedTrace	trace;
+	gTraceRecorder.TakeTrace( trace );
+
+#ifdef DAEDALUS_ENABLE_TRACE_CACHE
+	if( gDynarecTraceCacheEnabled )
+	{
+		gTraceCache.AddTrace( trace );
+	}
+#endif
+
+	CPU_CompileTrace( trace );
+}
+
+//*****************************************************************************
+//	Compiles the trace (or hands it to the compile thread) and adds it
+//*****************************************************************************
+static void CPU_CompileTrace( SRecordedTrace & trace )
+{
+#ifdef DAEDALUS_ENABLE_DYNAREC_THREAD
+	if( gDynarecThreadEnabled && gTraceCompiler.Start( gFragmentCache.GetCodeBufferManager() ) )
+	{
+		// The hot trace count is left alone until the fragment is added, so the trace isn't recorded again meanwhile
+		if( !gTraceCompiler.Submit( trace ) )
+		{
+			// Let the trace become hot again once the queue has drained
+			gHotTraceCounts.Erase( trace.StartAddress );
+		}
+		return;
+	}
+#endif
+
+	CFragment * p_fragment( CTraceRecorder::CompileTrace( gFragmentCache.GetCodeBufferManager(), trace ) );
 
 	if( p_fragment != NULL )
 	{
-		gHotTraceCountMap.erase( p_fragment->GetEntryAddress() );
-		gFragmentCache.InsertFragment( p_fragment );
+		CPU_AddFragment( p_fragment );
+	}
+}
+
+#ifdef DAEDALUS_ENABLE_TRACE_CACHE
+//*****************************************************************************
+//	Compile the trace saved from a previous run (if the code is still the
+//	same), rather than waiting for it to become hot again.
+//	Returns false if there's no usable trace starting at address.
+//*****************************************************************************
+static bool CPU_AddCachedTrace( u32 address )
+{
+	if( !gDynarecTraceCacheEnabled )
+		return false;
+
+	SRecordedTrace	trace;
+	if( !gTraceCache.FindTrace( address, trace ) )
+		return false;
 
-		//DBGConsole_Msg( 0, "Inserted hot trace at [R%08x]! (size is %d. %dKB)", p_fragment->GetEntryAddress(), gFragmentCache.GetCacheSize(), gFragmentCache.GetMemoryUsage() / 1024 );
+	// Stops the trace being recorded again while it's on the compile thread
+	gHotTraceCounts.Set( address, gHotTraceThreshold );
+
+	CPU_CompileTrace( trace );
+	return true;
+}
+#endif
+
+#ifdef DAEDALUS_ENABLE_DYNAREC_THREAD
+//*****************************************************************************
+//	Add the fragments the compile thread has finished since the last call.
+//	Must be called when no fragment is executing.
+//*****************************************************************************
+static void CPU_AddCompiledFragments()
+{
+	while( CFragment * p_fragment = gTraceCompiler.TakeCompiledFragment() )
+	{
+		// Only possible if the hot trace counts were reset while this was being compiled
+		if( gFragmentCache.LookupFragmentQ( p_fragment->GetEntryAddress() ) != NULL )
+		{
+			delete p_fragment;
+			continue;
+		}
+
+		CPU_AddFragment( p_fragment );
+	}
+}
+#endif
+
+//*****************************************************************************
+//	Throw away any traces which are queued or compiled but not yet added.
+//	Must be called before the fragment cache is cleared (as that resets the
+//	code buffer the compile thread writes to), and before anything else
+//	assembles into the code buffer on this thread (e.g. the os hooks).
+//*****************************************************************************
+void CPU_FlushTraceCompiler()
+{
+#ifdef DAEDALUS_ENABLE_DYNAREC_THREAD
+	std::vector< u32 >	discarded;
+	gTraceCompiler.Flush( discarded );
+
+	// Let these become hot again, so they're recompiled
+	for( u32 i = 0; i < discarded.size(); ++i )
+	{
+		gHotTraceCounts.Erase( discarded[ i ] );
 	}
+#endif
 }
 
 //*****************************************************************************
@@ -422,6 +584,18 @@ void CPU_HandleDynaRecOnBranch( bool backwards, bool trace_already_enabled )
 #ifdef DAEDALUS_ENABLE_DYNAREC_PROFILE
 		u32			entry_count( gCPUState.CPUControl[C0_COUNT]._u32 ); // Just used DYNAREC_PROFILE_ENTEREXIT
 #endif
+		if( !gInvalidatedRanges.empty() )
+		{
+			// The trace may have been recorded from the code that was overwritten
+			if( gTraceRecorder.IsTraceActive() )
+			{
+				gTraceRecorder.AbortTrace();
+				change_core = true;
+			}
+
+			CPU_ProcessInvalidatedRanges();
+		}
+
 		u32			entry_address( gCPUState.CurrentPC );
 #ifdef DAEDALUS_DEBUG_DYNAREC
 		CFragment * p_fragment( gFragmentCache.LookupFragment( entry_address ) );
@@ -444,6 +618,7 @@ void CPU_HandleDynaRecOnBranch( bool backwards, bool trace_already_enabled )
 				change_core = true;
 			}
 
+			gFragmentCache.MarkUsed( p_fragment );
 			p_fragment->Execute();
 
 			DYNAREC_PROFILE_ENTEREXIT( entry_address, gCPUState.CurrentPC, gCPUState.CPUControl[C0_COUNT]._u32 - entry_count );
@@ -470,8 +645,9 @@ void CPU_HandleDynaRecOnBranch( bool backwards, bool trace_already_enabled )
 						if(true)
 #endif
 						{
+							CPU_FlushTraceCompiler();
 							gFragmentCache.Clear();
-							gHotTraceCountMap.clear();		// Makes sense to clear this now, to get accurate usage stats
+							gHotTraceCounts.Clear();		// Makes sense to clear this now, to get accurate usage stats
 #ifdef DAEDALUS_ENABLE_OS_HOOKS
 							Patch_PatchAll();
 #endif
@@ -485,30 +661,48 @@ void CPU_HandleDynaRecOnBranch( bool backwards, bool trace_already_enabled )
 						gResetFragmentCache = false;
 					}
 
-					if( gFragmentCache.GetCacheSize() > gMaxFragmentCacheSize)
+					// Invalidated and evicted fragments still take up space in the code buffer until it's cleared
+					bool	code_buffer_full( gEvictColdFragments ? gFragmentCache.GetCodeSize() > gMaxFragmentCodeSize
+																  : gFragmentCache.GetCacheSize() + gFragmentCache.GetRetiredCount() > gMaxFragmentCacheSize );
+					if( code_buffer_full )
 					{
+						CPU_FlushTraceCompiler();
 						gFragmentCache.Clear();
-						gHotTraceCountMap.clear();		// Makes sense to clear this now, to get accurate usage stats
+						gHotTraceCounts.Clear();		// Makes sense to clear this now, to get accurate usage stats
 #ifdef DAEDALUS_ENABLE_OS_HOOKS
 						Patch_PatchAll();
 #endif
 					}
-
-					// If there is no fragment for this target, start tracing
-					u32 trace_count( ++gHotTraceCountMap[ gCPUState.CurrentPC ] );
-					if( gHotTraceCountMap.size() >= gMaxHotTraceMapSize )
+					else if( gEvictColdFragments && gFragmentCache.GetCacheSize() > gMaxFragmentCacheSize )
 					{
+						gFragmentCache.EvictColdFragments( gMaxFragmentCacheSize * 3 / 4 );
+					}
 
-						DBGConsole_Msg( 0, "Hot trace cache hit %d, dumping", gHotTraceCountMap.size() );
-						gHotTraceCountMap.clear();
-						gFragmentCache.Clear();
-#ifdef DAEDALUS_ENABLE_OS_HOOKS
-						Patch_PatchAll();
+#ifdef DAEDALUS_ENABLE_DYNAREC_THREAD
+					if( gTraceCompiler.HasCompiledFragments() )
+					{
+						CPU_AddCompiledFragments();
+					}
 #endif
+
+					// If there is no fragment for this target, start tracing
+					u32 trace_count( gHotTraceCounts.Increment( gCPUState.CurrentPC ) );
+					if( gHotTraceCounts.GetSize() >= gMaxHotTraceMapSize )
+					{
+						// Most of these will be cold. Traces which are queued or being compiled get recorded again
+						// if they become hot before they're added, but that's harmless.
+						DBGConsole_Msg( 0, "Hot trace map hit %d, resetting counts", gHotTraceCounts.GetSize() );
+						gHotTraceCounts.Clear();
+					}
+#ifdef DAEDALUS_ENABLE_TRACE_CACHE
+					else if( trace_count == 1 && CPU_AddCachedTrace( gCPUState.CurrentPC ) )
+					{
+						DAED_LOG( DEBUG_DYNAREC_CACHE, "Using cached trace for %08x", gCPUState.CurrentPC );
 					}
+#endif
 					else if( trace_count == gHotTraceThreshold )
 					{
-						//DBGConsole_Msg( 0, "Identified hot trace at [R%08x]! (size is %d)", gCPUState.CurrentPC, gHotTraceCountMap.size() );
+						//DBGConsole_Msg( 0, "Identified hot trace at [R%08x]! (size is %d)", gCPUState.CurrentPC, gHotTraceCounts.GetSize() );
 						gTraceRecorder.StartTrace( gCPUState.CurrentPC );
 
 						if(!trace_already_enabled)
@@ -524,8 +718,8 @@ void CPU_HandleDynaRecOnBranch( bool backwards, bool trace_already_enabled )
 						{
 							u32 reason( gAbortedTraceReasons[ gCPUState.CurrentPC ] );
 							use( reason );
-							//DBGConsole_Msg( 0, "Hot trace at [R%08x] has count of %d! (reason is %x) size %d", gCPUState.CurrentPC, trace_count, reason, gHotTraceCountMap.size( ) );
-							DAED_LOG( DEBUG_DYNAREC_CACHE, "Hot trace at %08x has count of %d! (reason is %x) size %d", gCPUState.CurrentPC, trace_count, reason, gHotTraceCountMap.size( ) );
+							//DBGConsole_Msg( 0, "Hot trace at [R%08x] has count of %d! (reason is %x) size %d", gCPUState.CurrentPC, trace_count, reason, gHotTraceCounts.GetSize() );
+							DAED_LOG( DEBUG_DYNAREC_CACHE, "Hot trace at %08x has count of %d! (reason is %x) size %d", gCPUState.CurrentPC, trace_count, reason, gHotTraceCounts.GetSize() );
 						}
 						else
 						{
@@ -551,15 +745,38 @@ void CPU_HandleDynaRecOnBranch( bool backwards, bool trace_already_enabled )
 
 void Dynamo_Reset()
 {
-	gHotTraceCountMap.clear();
+	CPU_FlushTraceCompiler();
+	gHotTraceCounts.Clear();
 	gFragmentCache.Clear();
 	gResetFragmentCache = false;
+	gInvalidatedRanges.clear();
 	gTraceRecorder.AbortTrace();
 #ifdef DAEDALUS_DEBUG_DYNAREC
 	gAbortedTraceReasons.clear();
 #endif
 }
 
+void Dynamo_RomOpen()
+{
+#ifdef DAEDALUS_ENABLE_TRACE_CACHE
+	if( gDynarecTraceCacheEnabled )
+	{
+		gTraceCache.Load();
+	}
+#endif
+}
+
+void Dynamo_RomClose()
+{
+#ifdef DAEDALUS_ENABLE_TRACE_CACHE
+	if( gDynarecTraceCacheEnabled )
+	{
+		gTraceCache.Save();
+	}
+	gTraceCache.Clear();
+#endif
+}
+
 void Dynamo_SelectCore()
 {
 	bool trace_enabled = gTraceRecorder.IsTraceActive();
@@ -577,8 +794,27 @@ void Dynamo_SelectCore()
 #else
 
 void CPU_ResetFragmentCache() {}
+void CPU_FlushTraceCompiler() {}
 void Dynamo_Reset() {}
-void R4300_CALL_TYPE CPU_InvalidateICacheRange( u32 address, u32 length ) {}
+void Dynamo_RomOpen() {}
+void Dynamo_RomClose() {}
+void R4300_CALL_TYPE CPU_InvalidateICacheRange( u32 address, u32 length )
+{
+	CachedInterp_InvalidateRange( address, length );
+	IdleLoop_InvalidateRange( address, length );
+}
 
 #endif //DAEDALUS_ENABLE_DYNAREC
 
+//*****************************************************************************
+//	Indicate that the instruction cache is invalid
+//	(we have to dump the dynarec contents and start over, but this is
+//	better than crashing :) )
+//*****************************************************************************
+void R4300_CALL_TYPE CPU_InvalidateICache()
+{
+	CachedInterp_InvalidateAll();
+	IdleLoop_Reset();
+	CPU_ResetFragmentCache();
+}
+
@@ -21,6 +21,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 void Dynamo_SelectCore();
 void Dynamo_Reset();
+void Dynamo_RomOpen();
+void Dynamo_RomClose();
 
 #ifdef DAEDALUS_DEBUG_DYNAREC
 	void			CPU_DumpFragmentCache();
@@ -29,3 +31,4 @@ void Dynarec_ClearedCPUStuffToDo();
 void Dynarec_SetCPUStuffToDo();
 
 void CPU_ResetFragmentCache();
+void CPU_FlushTraceCompiler();
@@ -0,0 +1,114 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef CORE_FASTMEM_H_
+#define CORE_FASTMEM_H_
+
+//
+//	"Fastmem" maps the N64 address space onto a reserved range of host
+//	address space, so that a load or store is just gFastmemBase + address.
+//	RDRAM and SP memory are mapped in, everything else is left inaccessible.
+//	Touching an inaccessible page faults, and the fault handler performs the
+//	access through g_MemoryLookupTableRead/Write instead.
+//
+//	Only KSEG0 accesses take the fast path (see Fastmem_IsFastAddress).
+//	The RCP registers are always accessed through KSEG1, and TLB mapped
+//	addresses would fault on every access.
+//
+//	Each load/store is a small block of inline asm which records the
+//	address of the instruction in the daedalus_fastmem section, so the
+//	fault handler knows the access size and where to resume. The value is
+//	always in rax, which is where the handler reads or writes it.
+//
+#ifdef DAEDALUS_ENABLE_FASTMEM
+
+#include "Utility/DaedalusTypes.h"
+
+enum EFastmemAccess
+{
+	FASTMEM_LOAD8 = 0,
+	FASTMEM_LOAD16,
+	FASTMEM_LOAD32,
+	FASTMEM_LOAD64,
+	FASTMEM_STORE8,
+	FASTMEM_STORE16,
+	FASTMEM_STORE32,
+	FASTMEM_STORE64,
+};
+
+// One of these is emitted for each access. Offsets are relative to the field.
+struct SFastmemSite
+{
+	s32		InstructionOffset;
+	s32		ResumeOffset;
+	u32		Access;
+};
+
+extern u8 *		gFastmemBase;		// Host address of N64 address 0, or NULL
+extern u32		gFastmemRange;		// Size of the directly accessed range at 0x80000000, or 0 if fastmem is off
+
+bool	Fastmem_Init();
+void	Fastmem_Fini();
+void *	Fastmem_GetBuffer( u32 bank );			// The backing store for MEM_RD_RAM/MEM_SP_MEM, NULL otherwise
+void	Fastmem_SetRamSize( u32 ram_size );
+void	Fastmem_SetWatched( u32 address, u32 length, bool watched );	// Watched RDRAM faults, so it goes through the tables
+
+inline bool Fastmem_IsFastAddress( u32 address )
+{
+	return address - 0x80000000 < gFastmemRange;
+}
+
+#define FASTMEM_SITE																\
+	"2:\n"																			\
+	".pushsection daedalus_fastmem, \"a\"\n"										\
+	".balign 4\n"																	\
+	".long 1b - ., 2b - ., %c[access]\n"											\
+	".popsection\n"
+
+#define FASTMEM_LOAD( type, insn, access_type )										\
+	type value;																		\
+	asm volatile( "1:\t" insn " %[mem], %[value]\n" FASTMEM_SITE					\
+		: [value] "=a" (value)														\
+		: [mem] "m" (*(const type *)(gFastmemBase + address)), [access] "i" (access_type) );	\
+	return value;
+
+#define FASTMEM_STORE( type, insn, access_type )									\
+	asm volatile( "1:\t" insn " %[value], %[mem]\n" FASTMEM_SITE					\
+		: [mem] "=m" (*(type *)(gFastmemBase + address))							\
+		: [value] "a" (value), [access] "i" (access_type) );
+
+inline u8  Fastmem_Load8( u32 address )					{ FASTMEM_LOAD( u8,  "movb", FASTMEM_LOAD8 ) }
+inline u16 Fastmem_Load16( u32 address )				{ FASTMEM_LOAD( u16, "movw", FASTMEM_LOAD16 ) }
+inline u32 Fastmem_Load32( u32 address )				{ FASTMEM_LOAD( u32, "movl", FASTMEM_LOAD32 ) }
+inline u64 Fastmem_Load64( u32 address )				{ FASTMEM_LOAD( u64, "movq", FASTMEM_LOAD64 ) }
+
+inline void Fastmem_Store8( u32 address, u8 value )		{ FASTMEM_STORE( u8,  "movb", FASTMEM_STORE8 ) }
+inline void Fastmem_Store16( u32 address, u16 value )	{ FASTMEM_STORE( u16, "movw", FASTMEM_STORE16 ) }
+inline void Fastmem_Store32( u32 address, u32 value )	{ FASTMEM_STORE( u32, "movl", FASTMEM_STORE32 ) }
+inline void Fastmem_Store64( u32 address, u64 value )	{ FASTMEM_STORE( u64, "movq", FASTMEM_STORE64 ) }
+
+#undef FASTMEM_STORE
+#undef FASTMEM_LOAD
+#undef FASTMEM_SITE
+
+#endif // DAEDALUS_ENABLE_FASTMEM
+
+#endif // CORE_FASTMEM_H_
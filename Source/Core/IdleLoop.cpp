@@ -0,0 +1,326 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+//
+//	Idle loop detection.
+//
+//	Besides the branch-to-self SpeedHack() already catches, games spend a
+//	lot of each frame in short loops polling a flag in RDRAM (often an
+//	OSMesgQueue's validCount) or an MI register, e.g.
+//
+//		0x80001000: LW        t6 = [a0+0x0008]
+//		0x80001004: BEQ       t6 == r0 --> 0x80001000
+//		0x80001008: NOP
+//
+//	Nothing the loop reads can change until an interrupt fires, so both
+//	cores skip straight to the next event. A loop is only treated as idle if:
+//	- it's no more than MAX_LOOP_OPS long and runs from RDRAM through KSEG0/KSEG1
+//	- the branch closing it is the only branch, and doesn't link
+//	- it only contains loads and simple ALU ops (no stores, COP0 or FPU ops)
+//	- nothing read in one iteration was written by the previous one, so every
+//	  iteration computes exactly the same thing
+//	- every load goes to RDRAM or the MI registers. The base registers can
+//	  differ between calls, so this is checked each time the branch is taken.
+//
+//	The verdict is worked out the first time a branch is seen, and cached by
+//	branch address until the code is overwritten.
+//
+
+#include "stdafx.h"
+#include "IdleLoop.h"
+
+#include "CPU.h"
+#include "Memory.h"
+#include "R4300OpCode.h"
+
+#include "OSHLE/ultra_rcp.h"
+
+namespace
+{
+
+const u32			MAX_LOOP_OPS( 16 );				// Including the delay slot
+const u32			MAX_LOOP_LOADS( 4 );
+
+struct SLoopLoad
+{
+	u32					Base;
+	s32					Offset;
+};
+
+struct SIdleLoop
+{
+	u32					BranchAddress;				// INVALID_ADDRESS if unused
+	u32					TargetAddress;
+	bool				IsIdle;						// From the ops alone, the loads still need checking
+	u32					NumLoads;
+	SLoopLoad			Loads[ MAX_LOOP_LOADS ];
+};
+
+const u32			INVALID_ADDRESS( ~0 );			// Never a valid (aligned) PC
+const u32			LOOP_TABLE_BITS( 8 );
+const u32			LOOP_TABLE_SIZE( 1 << LOOP_TABLE_BITS );
+
+SIdleLoop			gLoopTable[ LOOP_TABLE_SIZE ];
+
+inline bool IsDirectMapped( u32 address )
+{
+	return (address >> 30) == 2;					// KSEG0 or KSEG1
+}
+
+bool ReadRamOp( u32 address, OpCode * p_op )
+{
+	if( !IsDirectMapped( address ) )
+		return false;
+
+	u32		physical( address & 0x1FFFFFFF );
+	if( physical + 4 > gRamSize )
+		return false;
+
+	p_op->_u32 = *reinterpret_cast< const u32 * >( g_pu8RamBase + physical );
+	return true;
+}
+
+//*****************************************************************************
+//	Returns false for anything which could have a side effect
+//*****************************************************************************
+bool GetOpRegisters( OpCode op, u32 * p_reads, u32 * p_writes, bool * p_load )
+{
+	*p_reads = 0;
+	*p_writes = 0;
+	*p_load = false;
+
+	switch( op.op )
+	{
+	case OP_SPECOP:
+		switch( op.spec_op )
+		{
+		case SpecOp_SLL:	case SpecOp_SRL:	case SpecOp_SRA:
+			*p_reads = 1 << op.rt;
+			*p_writes = 1 << op.rd;
+			return true;
+
+		case SpecOp_SLLV:	case SpecOp_SRLV:	case SpecOp_SRAV:
+		case SpecOp_ADDU:	case SpecOp_SUBU:	case SpecOp_DADDU:	case SpecOp_DSUBU:
+		case SpecOp_AND:	case SpecOp_OR:		case SpecOp_XOR:	case SpecOp_NOR:
+		case SpecOp_SLT:	case SpecOp_SLTU:
+			*p_reads = (1 << op.rs) | (1 << op.rt);
+			*p_writes = 1 << op.rd;
+			return true;
+
+		default:
+			return false;
+		}
+
+	case OP_ADDIU:	case OP_DADDIU:	case OP_SLTI:	case OP_SLTIU:
+	case OP_ANDI:	case OP_ORI:	case OP_XORI:
+		*p_reads = 1 << op.rs;
+		*p_writes = 1 << op.rt;
+		return true;
+
+	case OP_LUI:
+		*p_writes = 1 << op.rt;
+		return true;
+
+	case OP_LB:		case OP_LBU:	case OP_LH:		case OP_LHU:
+	case OP_LW:		case OP_LWU:	case OP_LD:
+		*p_reads = 1 << op.base;
+		*p_writes = 1 << op.rt;
+		*p_load = true;
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+bool GetBranchRegisters( OpCode op, u32 * p_reads )
+{
+	switch( op.op )
+	{
+	case OP_BEQ:	case OP_BNE:	case OP_BEQL:	case OP_BNEL:
+		*p_reads = (1 << op.rs) | (1 << op.rt);
+		return true;
+
+	case OP_BLEZ:	case OP_BGTZ:	case OP_BLEZL:	case OP_BGTZL:
+		*p_reads = 1 << op.rs;
+		return true;
+
+	case OP_REGIMM:
+		switch( op.regimm_op )
+		{
+		case RegImmOp_BLTZ:	case RegImmOp_BGEZ:	case RegImmOp_BLTZL:	case RegImmOp_BGEZL:
+			*p_reads = 1 << op.rs;
+			return true;
+
+		default:
+			return false;
+		}
+
+	default:
+		return false;
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+bool AnalyseLoop( SIdleLoop & loop )
+{
+	loop.NumLoads = 0;
+
+	u32		num_ops( ((loop.BranchAddress - loop.TargetAddress) >> 2) + 2 );
+	u32		written( 0 );				// Written so far in this iteration
+	u32		carried( 0 );				// Read before being written in this iteration
+
+	for( u32 i = 0; i < num_ops; ++i )
+	{
+		u32		address( loop.TargetAddress + i * 4 );
+		OpCode	op;
+		u32		reads( 0 );
+		u32		writes( 0 );
+		bool	load( false );
+
+		if( !ReadRamOp( address, &op ) )
+			return false;
+
+		if( address == loop.BranchAddress )
+		{
+			if( !GetBranchRegisters( op, &reads ) )
+				return false;
+		}
+		else if( !GetOpRegisters( op, &reads, &writes, &load ) )
+		{
+			return false;
+		}
+
+		if( load )
+		{
+			if( loop.NumLoads >= MAX_LOOP_LOADS )
+				return false;
+
+			loop.Loads[ loop.NumLoads ].Base = op.base;
+			loop.Loads[ loop.NumLoads ].Offset = s16( op.immediate );
+			loop.NumLoads++;
+		}
+
+		carried |= reads & ~written;
+		written |= writes;
+	}
+
+	// r0 never changes
+	carried &= ~1;
+	written &= ~1;
+
+	if( carried & written )
+		return false;
+
+	// This also means the load addresses are the same every iteration
+	for( u32 i = 0; i < loop.NumLoads; ++i )
+	{
+		if( written & (1 << loop.Loads[ i ].Base) )
+			return false;
+	}
+
+	return true;
+}
+
+//*****************************************************************************
+//	RDRAM (written by interrupt handlers and DMA) or the MI registers.
+//	Anything else may have side effects when it's read.
+//*****************************************************************************
+bool IsPolledAddress( u32 address )
+{
+	if( !IsDirectMapped( address ) )
+		return false;
+
+	u32		physical( address & 0x1FFFFFFF );
+	return physical < gRamSize ||
+		   (physical >= MI_BASE_REG && physical < MI_BASE_REG + 0x00100000);
+}
+
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void IdleLoop_Reset()
+{
+	for( u32 i = 0; i < LOOP_TABLE_SIZE; ++i )
+	{
+		gLoopTable[ i ].BranchAddress = INVALID_ADDRESS;
+	}
+}
+
+//*****************************************************************************
+//	Compares physical addresses, as the same code can run through KSEG0 or KSEG1
+//*****************************************************************************
+void IdleLoop_InvalidateRange( u32 address, u32 length )
+{
+	u32		start( address & 0x1FFFFFFF );
+	u32		end( start + length );
+
+	for( u32 i = 0; i < LOOP_TABLE_SIZE; ++i )
+	{
+		SIdleLoop &	loop( gLoopTable[ i ] );
+		if( loop.BranchAddress == INVALID_ADDRESS )
+			continue;
+
+		u32		loop_start( loop.TargetAddress & 0x1FFFFFFF );
+		u32		loop_end( (loop.BranchAddress & 0x1FFFFFFF) + 8 );
+
+		if( loop_start < end && start < loop_end )
+		{
+			loop.BranchAddress = INVALID_ADDRESS;
+		}
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+bool IdleLoop_IsIdleLoop( u32 branch_address, u32 target_address )
+{
+	if( target_address > branch_address || branch_address - target_address > (MAX_LOOP_OPS - 2) * 4 )
+		return false;
+
+	SIdleLoop &	loop( gLoopTable[ (branch_address >> 2) & (LOOP_TABLE_SIZE - 1) ] );
+
+	if( loop.BranchAddress != branch_address || loop.TargetAddress != target_address )
+	{
+		loop.BranchAddress = branch_address;
+		loop.TargetAddress = target_address;
+		loop.IsIdle = AnalyseLoop( loop );
+	}
+
+	if( !loop.IsIdle )
+		return false;
+
+	for( u32 i = 0; i < loop.NumLoads; ++i )
+	{
+		const SLoopLoad &	load( loop.Loads[ i ] );
+
+		if( !IsPolledAddress( gGPR[ load.Base ]._u32_0 + load.Offset ) )
+			return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,33 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef CORE_IDLELOOP_H_
+#define CORE_IDLELOOP_H_
+
+void IdleLoop_Reset();
+void IdleLoop_InvalidateRange( u32 address, u32 length );
+
+// True if the taken branch at branch_address back to target_address closes a
+// loop which can't make any progress until the next event fires.
+// Must be called on the CPU thread, as the loads are checked against gGPR.
+bool IdleLoop_IsIdleLoop( u32 branch_address, u32 target_address );
+
+#endif // CORE_IDLELOOP_H_
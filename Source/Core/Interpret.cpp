@@ -37,6 +37,56 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Utility/Profiler.h"
 #include "Utility/Synchroniser.h"
 
+//*****************************************************************************
+//	Everything which needs doing after an op has been executed - update COUNT,
+//	fire any events and move on to the next PC.
+//*****************************************************************************
+DAEDALUS_FORCEINLINE void CPU_COMPLETE_OP()
+{
+	gGPR[0]._u64 = 0;	//Ensure r0 is zero
+
+#ifdef DAEDALUS_PROFILE_EXECUTION
+		gTotalInstructionsEmulated++;
+#endif
+
+	SYNCH_POINT( DAED_SYNC_REGS, CPU_ProduceRegisterHash(), "Registers don't match" );
+
+	// Increment count register
+	gCPUState.CPUControl[C0_COUNT]._u32 = gCPUState.CPUControl[C0_COUNT]._u32 + COUNTER_INCREMENT_PER_OP;
+
+	if (CPU_ProcessEventCycles( COUNTER_INCREMENT_PER_OP ) )
+	{
+		CPU_HANDLE_COUNT_INTERRUPT();
+	}
+
+	switch (gCPUState.Delay)
+	{
+	case DO_DELAY:
+		// We've got a delayed instruction to execute. Increment
+		// PC as normal, so that subsequent instruction is executed
+		INCREMENT_PC();
+		gCPUState.Delay = EXEC_DELAY;
+
+		break;
+	case EXEC_DELAY:
+		{
+			//bool	backwards( gCPUState.TargetPC <= gCPUState.CurrentPC );
+
+			// We've just executed the delayed instr. Now carry out jump as stored in gCPUState.TargetPC;
+			CPU_SetPC(gCPUState.TargetPC);
+			gCPUState.Delay = NO_DELAY;
+
+		}
+		break;
+	case NO_DELAY:
+		// Normal operation - just increment the PC
+		INCREMENT_PC();
+		break;
+	default:
+		NODEFAULT;
+	}
+}
+
 //*****************************************************************************
 //	Execute a single MIPS op. The conditionals for the templated arguments
 //	are completely optimised away by the compiler.
@@ -85,22 +135,89 @@ template< bool TranslateOp > DAEDALUS_FORCEINLINE void CPU_EXECUTE_OP()
 	SYNCH_POINT( DAED_SYNC_REG_PC, gCPUState.CPUControl[C0_COUNT]._u32, "Count doesn't match" );
 
 	R4300_ExecuteInstruction(op_code);
+
+	CPU_COMPLETE_OP();
+}
+
+#ifdef DAEDALUS_THREADED_INTERPRETER
+
+//*****************************************************************************
+//	Fetch the op at the current PC. p_Instruction is left as NULL if the fetch
+//	raised an exception.
+//*****************************************************************************
+DAEDALUS_FORCEINLINE void CPU_FETCH_OP( u8 *& p_Instruction, u32 cycles )
+{
+	p_Instruction = NULL;
+
+	CPU_FETCH_INSTRUCTION( p_Instruction, gCPUState.CurrentPC );
+
+	// Cache instruction base pointer (used for SpeedHack() @ R4300.0)
+	gLastAddress = p_Instruction;
+
+	SYNCH_POINT( DAED_SYNC_REG_PC, gCPUState.CurrentPC, "Program Counter doesn't match" );
+	SYNCH_POINT( DAED_SYNC_FRAGMENT_PC, gCPUState.CurrentPC + gCPUState.Delay, "Program Counter/Delay doesn't match while interpreting" );
+
+	SYNCH_POINT( DAED_SYNC_REG_PC, gCPUState.CPUControl[C0_COUNT]._u32 + cycles, "Count doesn't match" );
+	DAEDALUS_USE( cycles );
+}
+
+//*****************************************************************************
+//	Only the primary opcodes which have sub tables need to look at the rest of
+//	the op to find their handler.
+//*****************************************************************************
+template< u32 Op > DAEDALUS_FORCEINLINE u32 CPU_GET_FLAT_INDEX( OpCode op_code )
+{
+	if( Op == OP_SPECOP || Op == OP_REGIMM || Op == OP_COPRO0 || Op == OP_COPRO1 )
+	{
+		return R4300_GetFlatIndex( op_code );
+	}
+	return Op;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+template< u32 Op > DAEDALUS_FORCEINLINE bool CPU_OP_NEEDS_COUNT()
+{
+	return R4300_OpNeedsCount( Op );
+}
+
+//*****************************************************************************
+//	As CPU_EXECUTE_OP, but COUNT is only updated at the end of each straight
+//	line run of ops (i.e. after a jump has been taken) or when the next event
+//	is due, rather than after every op.
+//*****************************************************************************
+template< u32 Op > DAEDALUS_FORCEINLINE void CPU_EXECUTE_LAZY_OP( OpCode op_code, u32 & cycles, u32 & budget )
+{
+	if( CPU_OP_NEEDS_COUNT< Op >() )
+	{
+		gCPUState.PendingCycles = cycles;
+	}
+
+	R4300FlatInstruction[ CPU_GET_FLAT_INDEX< Op >( op_code ) ]( op_code._u32 );
 	gGPR[0]._u64 = 0;	//Ensure r0 is zero
 
+	if( CPU_OP_NEEDS_COUNT< Op >() )
+	{
+		// The op may have synced COUNT, or scheduled a new event
+		cycles = gCPUState.PendingCycles;
+		gCPUState.PendingCycles = 0;
+		budget = CPU_GET_CYCLE_BUDGET();
+	}
+
 #ifdef DAEDALUS_PROFILE_EXECUTION
 		gTotalInstructionsEmulated++;
 #endif
 
-	SYNCH_POINT( DAED_SYNC_REGS, CPU_ProduceRegisterHash(), "Registers don't match" );
+	cycles += COUNTER_INCREMENT_PER_OP;
 
-	// Increment count register
-	gCPUState.CPUControl[C0_COUNT]._u32 = gCPUState.CPUControl[C0_COUNT]._u32 + COUNTER_INCREMENT_PER_OP;
-
-	if (CPU_ProcessEventCycles( COUNTER_INCREMENT_PER_OP ) )
+	if( cycles >= budget || gCPUState.Delay == EXEC_DELAY )
 	{
-		CPU_HANDLE_COUNT_INTERRUPT();
+		CPU_FLUSH_CYCLES( cycles, budget );
 	}
 
+	SYNCH_POINT( DAED_SYNC_REGS, CPU_ProduceRegisterHash(), "Registers don't match" );
+
 	switch (gCPUState.Delay)
 	{
 	case DO_DELAY:
@@ -108,17 +225,11 @@ template< bool TranslateOp > DAEDALUS_FORCEINLINE void CPU_EXECUTE_OP()
 		// PC as normal, so that subsequent instruction is executed
 		INCREMENT_PC();
 		gCPUState.Delay = EXEC_DELAY;
-
 		break;
 	case EXEC_DELAY:
-		{
-			//bool	backwards( gCPUState.TargetPC <= gCPUState.CurrentPC );
-
-			// We've just executed the delayed instr. Now carry out jump as stored in gCPUState.TargetPC;
-			CPU_SetPC(gCPUState.TargetPC);
-			gCPUState.Delay = NO_DELAY;
-
-		}
+		// We've just executed the delayed instr. Now carry out jump as stored in gCPUState.TargetPC;
+		CPU_SetPC(gCPUState.TargetPC);
+		gCPUState.Delay = NO_DELAY;
 		break;
 	case NO_DELAY:
 		// Normal operation - just increment the PC
@@ -129,6 +240,80 @@ template< bool TranslateOp > DAEDALUS_FORCEINLINE void CPU_EXECUTE_OP()
 	}
 }
 
+//*****************************************************************************
+//	Each primary opcode gets its own copy of the dispatch code, so each indirect
+//	jump to the next op has its own entry in the branch predictor.
+//*****************************************************************************
+#define CPU_OP_LIST( X )																\
+	X(0)  X(1)  X(2)  X(3)  X(4)  X(5)  X(6)  X(7)  X(8)  X(9)  X(10) X(11) X(12) X(13) X(14) X(15)	\
+	X(16) X(17) X(18) X(19) X(20) X(21) X(22) X(23) X(24) X(25) X(26) X(27) X(28) X(29) X(30) X(31)	\
+	X(32) X(33) X(34) X(35) X(36) X(37) X(38) X(39) X(40) X(41) X(42) X(43) X(44) X(45) X(46) X(47)	\
+	X(48) X(49) X(50) X(51) X(52) X(53) X(54) X(55) X(56) X(57) X(58) X(59) X(60) X(61) X(62) X(63)
+
+#define CPU_OP_LABEL( n )		&&op_##n,
+
+#define CPU_OP_DISPATCH( n )															\
+	op_##n:																				\
+		CPU_EXECUTE_LAZY_OP< n >( op_code, cycles, budget );							\
+		if( gCPUState.GetStuffToDo() != 0 )												\
+			goto stuff_to_do;															\
+		CPU_FETCH_OP( p_Instruction, cycles );											\
+		if( DAEDALUS_EXPECT_UNLIKELY( p_Instruction == NULL ) )							\
+			goto stuff_to_do;															\
+		op_code = *(OpCode*)p_Instruction;												\
+		goto *op_labels[ op_code.op ];
+
+//*****************************************************************************
+// Keep executing instructions until there are other tasks to do (i.e. gCPUState.GetStuffToDo() is set)
+// Process these tasks and loop
+//*****************************************************************************
+void CPU_Go()
+{
+	DAEDALUS_PROFILE( __FUNCTION__ );
+
+	static void * const op_labels[ 64 ] = { CPU_OP_LIST( CPU_OP_LABEL ) };
+
+	u8 *	p_Instruction;
+	OpCode	op_code;
+	u32		cycles( 0 );		// Cycles run since COUNT was last updated
+	u32		budget;				// Cycles that can run before the next event fires
+
+	while (CPU_KeepRunning())
+	{
+		budget = CPU_GET_CYCLE_BUDGET();
+
+		if( gCPUState.GetStuffToDo() == 0 )
+		{
+			CPU_FETCH_OP( p_Instruction, cycles );
+			if( p_Instruction != NULL )
+			{
+				op_code = *(OpCode*)p_Instruction;
+				goto *op_labels[ op_code.op ];
+			}
+		}
+
+stuff_to_do:
+		// Interrupts, exceptions and core changes all expect COUNT to be current
+		if( cycles != 0 )
+		{
+			CPU_FLUSH_CYCLES( cycles, budget );
+		}
+
+		if (CPU_CheckStuffToDo())
+			break;
+
+		continue;
+
+		CPU_OP_LIST( CPU_OP_DISPATCH )
+	}
+}
+
+#undef CPU_OP_DISPATCH
+#undef CPU_OP_LABEL
+#undef CPU_OP_LIST
+
+#else // DAEDALUS_THREADED_INTERPRETER
+
 
 //*****************************************************************************
 // Keep executing instructions until there are other tasks to do (i.e. gCPUState.GetStuffToDo() is set)
@@ -156,6 +341,8 @@ void CPU_Go()
 	}
 }
 
+#endif // DAEDALUS_THREADED_INTERPRETER
+
 
 void Inter_SelectCore()
 {
@@ -19,5 +19,43 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #pragma once
 
+#include "CPU.h"
+
+#include "OSHLE/ultra_R4300.h"
+
 void Inter_Reset();
 void Inter_SelectCore();
+
+//*****************************************************************************
+//	The interpreters don't update COUNT after every op. They count the cycles
+//	run in a local, and only add them to COUNT when the budget (the number of
+//	cycles until the next event) runs out, when a jump is taken, or before
+//	anything which needs COUNT to be current. See CPU_SyncCounter().
+//*****************************************************************************
+inline u32 CPU_GET_CYCLE_BUDGET()
+{
+#ifdef DAEDALUS_ENABLE_SYNCHRONISATION
+	// Keep COUNT up to date after every op, so the registers can be compared
+	return COUNTER_INCREMENT_PER_OP;
+#else
+	s32 event_counter( gCPUState.EventCounter );
+
+	return event_counter > 0 ? u32( event_counter ) : COUNTER_INCREMENT_PER_OP;
+#endif
+}
+
+// Add the cycles that have been run to COUNT and fire any event that's due
+inline void CPU_FLUSH_CYCLES( u32 & cycles, u32 & budget )
+{
+	gCPUState.CPUControl[C0_COUNT]._u32 += cycles;
+
+	bool ready( CPU_ProcessEventCycles( cycles ) );
+	cycles = 0;
+
+	if( ready )
+	{
+		CPU_HANDLE_COUNT_INTERRUPT();
+	}
+
+	budget = CPU_GET_CYCLE_BUDGET();
+}
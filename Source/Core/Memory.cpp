@@ -37,6 +37,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Plugins/AudioPlugin.h"
 #include "Plugins/GraphicsPlugin.h"
 
+#include <vector>
+
 static const u32	kMaximumMemSize = MEMORY_8_MEG;
 
 #undef min
@@ -155,6 +157,14 @@ bool Memory_Init()
 	g_pMemoryBuffers[ MEM_UNUSED    ] = new u8[ MemoryRegionSizes[MEM_UNUSED] ];
 
 #else
+#ifdef DAEDALUS_ENABLE_FASTMEM
+	// RDRAM and SP memory come from the fastmem mapping if it's available
+	if (gFastmemEnabled)
+	{
+		Fastmem_Init();
+	}
+#endif
+
 	//u32 count = 0;
 	for (u32 m = 0; m < NUM_MEM_BUFFERS; m++)
 	{
@@ -163,6 +173,10 @@ bool Memory_Init()
 		if (region_size > 0)
 		{
 			//count+=region_size;
+#ifdef DAEDALUS_ENABLE_FASTMEM
+			g_pMemoryBuffers[m] = Fastmem_GetBuffer(m);
+			if (g_pMemoryBuffers[m] == NULL)
+#endif
 			g_pMemoryBuffers[m] = new u8[region_size];
 			//g_pMemoryBuffers[m] = Memory_AllocRegion(region_size);
 
@@ -215,12 +229,21 @@ void Memory_Fini(void)
 #else
 	for (u32 m = 0; m < NUM_MEM_BUFFERS; m++)
 	{
+#ifdef DAEDALUS_ENABLE_FASTMEM
+		if (g_pMemoryBuffers[m] != NULL && g_pMemoryBuffers[m] == Fastmem_GetBuffer(m))
+		{
+			g_pMemoryBuffers[m] = NULL;
+		}
+#endif
 		if (g_pMemoryBuffers[m] != NULL)
 		{
 			delete [] (u8*)(g_pMemoryBuffers[m]);
 			g_pMemoryBuffers[m] = NULL;
 		}
 	}
+#ifdef DAEDALUS_ENABLE_FASTMEM
+	Fastmem_Fini();
+#endif
 #endif
 
 	g_pu8RamBase_8000 = NULL;
@@ -259,6 +282,10 @@ bool Memory_Reset()
 	}
 
 	gDMAUsed = false;
+
+#ifdef DAEDALUS_ENABLE_DIRTY_PAGES
+	DirtyPages_MarkAll();
+#endif
 	return true;
 }
 
@@ -327,8 +354,128 @@ static void Memory_InitFunc(u32 start, u32 size, const u32 ReadRegion, const u32
 	}
 }
 
+#ifdef DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+//*****************************************************************************
+//	A watched bank has its pointers cleared, so every access calls the
+//	Watched handlers. These put the original entries back before calling
+//	the callback and doing the access.
+//*****************************************************************************
+struct SWatchedBank
+{
+	u32				Index;
+	MemFuncRead		Read;
+	MemFuncWrite	Write;
+};
+
+struct SWatchedRange
+{
+	u32				Address;
+	u32				Length;
+};
+
+static std::vector< SWatchedBank >	gWatchedBanks;
+static std::vector< SWatchedRange >	gWatchedRanges;
+static MemWatchCallback				gWatchCallback = NULL;
+
+static void Memory_FireWatch()
+{
+	MemWatchCallback	callback( gWatchCallback );
+
+	Memory_UnwatchRanges();
+
+	if( callback != NULL )
+	{
+		callback();
+	}
+}
+
+static void * ReadWatched( u32 address )
+{
+	Memory_FireWatch();
+	return ReadAddress( address );
+}
+
+static void WriteValueWatched( u32 address, u32 value )
+{
+	Memory_FireWatch();
+	WriteAddress( address, value );
+}
+
+static void Memory_WatchBank( u32 index )
+{
+	for( u32 i = 0; i < gWatchedBanks.size(); ++i )
+	{
+		if( gWatchedBanks[ i ].Index == index )
+			return;
+	}
+
+	SWatchedBank	bank = { index, g_MemoryLookupTableRead[ index ], g_MemoryLookupTableWrite[ index ] };
+	gWatchedBanks.push_back( bank );
+
+	g_MemoryLookupTableRead[ index ].pRead = NULL;
+	g_MemoryLookupTableRead[ index ].ReadFunc = ReadWatched;
+	g_MemoryLookupTableWrite[ index ].pWrite = NULL;
+	g_MemoryLookupTableWrite[ index ].WriteFunc = WriteValueWatched;
+}
+
+void Memory_WatchRange( u32 address, u32 length, MemWatchCallback callback )
+{
+	address &= 0x1FFFFFFF;
+	if( length == 0 || address >= gRamSize )
+		return;
+
+	if( length > gRamSize - address )
+	{
+		length = gRamSize - address;
+	}
+
+	u32	end_bank( (address + length - 1) >> 18 );
+	for( u32 bank = address >> 18; bank <= end_bank; ++bank )
+	{
+		Memory_WatchBank( bank | (0x8000>>2) );
+		Memory_WatchBank( bank | (0xA000>>2) );
+	}
+
+#ifdef DAEDALUS_ENABLE_FASTMEM
+	Fastmem_SetWatched( address, length, true );
+#endif
+
+	SWatchedRange	range = { address, length };
+	gWatchedRanges.push_back( range );
+
+	gWatchCallback = callback;
+}
+
+void Memory_UnwatchRanges()
+{
+	for( u32 i = 0; i < gWatchedBanks.size(); ++i )
+	{
+		const SWatchedBank &	bank( gWatchedBanks[ i ] );
+
+		g_MemoryLookupTableRead[ bank.Index ] = bank.Read;
+		g_MemoryLookupTableWrite[ bank.Index ] = bank.Write;
+	}
+	gWatchedBanks.clear();
+
+#ifdef DAEDALUS_ENABLE_FASTMEM
+	for( u32 i = 0; i < gWatchedRanges.size(); ++i )
+	{
+		Fastmem_SetWatched( gWatchedRanges[ i ].Address, gWatchedRanges[ i ].Length, false );
+	}
+#endif
+	gWatchedRanges.clear();
+
+	gWatchCallback = NULL;
+}
+#endif // DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+
 void Memory_InitTables()
 {
+#ifdef DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+	// The entries are about to be rebuilt
+	Memory_UnwatchRanges();
+#endif
+
 	memset(g_MemoryLookupTableRead, 0, sizeof(MemFuncRead) * 0x4000);
 	memset(g_MemoryLookupTableWrite, 0, sizeof(MemFuncWrite) * 0x4000);
 
@@ -377,6 +524,10 @@ void Memory_InitTables()
 		WriteValue_8000_807F
 	);
 
+#ifdef DAEDALUS_ENABLE_FASTMEM
+	Fastmem_SetRamSize(ram_size);
+#endif
+
 	// Need to turn off the EPAK
 	if (ram_size != MEMORY_8_MEG)
 	{
@@ -22,6 +22,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #ifndef CORE_MEMORY_H_
 #define CORE_MEMORY_H_
 
+#include "Core/DirtyPages.h"
+#include "Core/Fastmem.h"
 #include "OSHLE/ultra_rcp.h"
 #include "Utility/AtomicPrimitives.h"
 #include "Utility/Endian.h"
@@ -81,11 +83,48 @@ extern u32		gTLBWriteHit;
 extern void *	g_pMemoryBuffers[NUM_MEM_BUFFERS];
 extern const u32 MemoryRegionSizes[NUM_MEM_BUFFERS];
 
+#ifdef DAEDALUS_ENABLE_DIRTY_PAGES
+// See DirtyPages.h. Stores through a host pointer only count if they land in RDRAM.
+inline void Memory_MarkDirtyHost( const void * p_host )
+{
+	uintptr_t	offset( reinterpret_cast< const u8 * >( p_host ) - reinterpret_cast< const u8 * >( g_pMemoryBuffers[MEM_RD_RAM] ) );
+	if( offset < gRamSize )
+	{
+		DirtyPages_Mark( u32( offset ) );
+	}
+}
+inline void Memory_MarkDirtyHostRange( const void * p_host, u32 length )
+{
+	uintptr_t	offset( reinterpret_cast< const u8 * >( p_host ) - reinterpret_cast< const u8 * >( g_pMemoryBuffers[MEM_RD_RAM] ) );
+	if( offset < gRamSize )
+	{
+		DirtyPages_MarkRange( u32( offset ), length );
+	}
+}
+#define MEMORY_MARK_DIRTY( address )						DirtyPages_Mark( address )
+#define MEMORY_MARK_DIRTY_HOST( p_host )					Memory_MarkDirtyHost( p_host )
+#define MEMORY_MARK_DIRTY_HOST_RANGE( p_host, length )	Memory_MarkDirtyHostRange( p_host, length )
+#else
+#define MEMORY_MARK_DIRTY( address )
+#define MEMORY_MARK_DIRTY_HOST( p_host )
+#define MEMORY_MARK_DIRTY_HOST_RANGE( p_host, length )
+#endif
+
 bool			Memory_Init();
 void			Memory_Fini();
 bool			Memory_Reset();
 void			Memory_Cleanup();
 
+#ifdef DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+// Calls callback before the next CPU access to any watched range of RDRAM, then
+// drops all the watches. Whole 256KB banks of KSEG0/KSEG1 are watched; TLB
+// mapped accesses aren't. Only call these from the emulation thread. The callback
+// can be run from the fastmem fault handler, so it should do little more than wait.
+typedef void (*MemWatchCallback)();
+void			Memory_WatchRange( u32 address, u32 length, MemWatchCallback callback );
+void			Memory_UnwatchRanges();
+#endif
+
 
 typedef void * (*MemFastFunction )( u32 address );
 typedef void (*MemWriteValueFunction )( u32 address, u32 value );
@@ -117,7 +156,9 @@ inline void WriteAddress( u32 address, u32 value )
 	// Access through pointer with no function calls at all (Fast)
 	if( m.pWrite )
 	{
-		*(u32*)( m.pWrite + address ) = value;
+		u32 * p_host( (u32*)( m.pWrite + address ) );
+		*p_host = value;
+		MEMORY_MARK_DIRTY_HOST( p_host );
 		return;
 	}
 	// Need to go through the HW access handlers or TLB (Slow)
@@ -151,23 +192,28 @@ inline u16 QuickRead16Bits( u8 *p_base, u32 offset )
 
 inline void QuickWrite16Bits( u8 *p_base, u32 offset, u16 value)
 {
-	*(u16 *)((uintptr_t)(p_base + offset) ^ U16_TWIDDLE) = value;
+	u16 * p( (u16 *)((uintptr_t)(p_base + offset) ^ U16_TWIDDLE) );
+	*p = value;
+	MEMORY_MARK_DIRTY_HOST( p );
 }
 
 inline void QuickWrite64Bits( u8 *p_base, u32 offset, u64 value )
 {
 	u64 data = (value>>32) + (value<<32);
 	*(u64 *)(p_base + offset) = data;
+	MEMORY_MARK_DIRTY_HOST( p_base + offset );
 }
 
 inline void QuickWrite32Bits( u8 *p_base, u32 offset, u32 value )
 {
 	*(u32 *)(p_base + offset) = value;
+	MEMORY_MARK_DIRTY_HOST( p_base + offset );
 }
 
 inline void QuickWrite32Bits( u8 *p_base, u32 value )
 {
 	*(u32 *)(p_base) = value;
+	MEMORY_MARK_DIRTY_HOST( p_base );
 }
 
 // Useful defines for making code look nicer:
@@ -251,22 +297,44 @@ inline u32 Read32Bits( u32 address )				{ MEMORY_CHECK_ALIGN( address, 4 ); retu
 inline u16 Read16Bits( u32 address )				{ MEMORY_CHECK_ALIGN( address, 2 ); return *(u16 *)ReadAddress( address ); }
 inline u8 Read8Bits( u32 address )					{                                   return *(u8  *)ReadAddress( address ); }
 
-inline void Write64Bits( u32 address, u64 data )	{ MEMORY_CHECK_ALIGN( address, 8 ); *(u64 *)ReadAddress( address ) = data; }
+inline void Write64Bits( u32 address, u64 data )	{ MEMORY_CHECK_ALIGN( address, 8 ); u64 * p( (u64 *)ReadAddress( address ) ); *p = data; MEMORY_MARK_DIRTY_HOST( p ); }
 inline void Write32Bits( u32 address, u32 data )	{ MEMORY_CHECK_ALIGN( address, 4 ); WriteAddress(address, data); }
-inline void Write16Bits( u32 address, u16 data )	{ MEMORY_CHECK_ALIGN( address, 2 ); *(u16 *)ReadAddress(address) = data; }
-inline void Write8Bits( u32 address, u8 data )		{                                   *(u8 *)ReadAddress(address) = data;}
+inline void Write16Bits( u32 address, u16 data )	{ MEMORY_CHECK_ALIGN( address, 2 ); u16 * p( (u16 *)ReadAddress(address) ); *p = data; MEMORY_MARK_DIRTY_HOST( p ); }
+inline void Write8Bits( u32 address, u8 data )		{                                   u8 * p( (u8 *)ReadAddress(address) ); *p = data; MEMORY_MARK_DIRTY_HOST( p ); }
 
 #elif (DAEDALUS_ENDIAN_MODE == DAEDALUS_ENDIAN_LITTLE)
 
+#ifdef DAEDALUS_ENABLE_FASTMEM
+
+// See Fastmem.h. Twiddling only flips the low bits, so it's fine to test the untwiddled address.
+// Fast stores can also hit SP memory, which just marks a page of RDRAM which wasn't written.
+#define FASTMEM_OR( address, fast, slow )		if( Fastmem_IsFastAddress( address ) ) { fast; } else { slow; }
+
+inline u64 Read64Bits( u32 address )				{ MEMORY_CHECK_ALIGN( address, 8 ); u64 data; FASTMEM_OR( address, data = Fastmem_Load64( address ), data = *(u64 *)ReadAddress( address ) ) data = (data>>32) + (data<<32); return data; }
+inline u32 Read32Bits( u32 address )				{ MEMORY_CHECK_ALIGN( address, 4 ); FASTMEM_OR( address, return Fastmem_Load32( address ), return *(u32 *)ReadAddress( address ) ) }
+inline u16 Read16Bits( u32 address )				{ MEMORY_CHECK_ALIGN( address, 2 ); FASTMEM_OR( address, return Fastmem_Load16( address ^ U16_TWIDDLE ), return *(u16 *)ReadAddress( address ^ U16_TWIDDLE ) ) }
+inline u8 Read8Bits( u32 address )					{                                   FASTMEM_OR( address, return Fastmem_Load8( address ^ U8_TWIDDLE ), return *(u8  *)ReadAddress( address ^ U8_TWIDDLE ) ) }
+
+inline void Write64Bits( u32 address, u64 data )	{ MEMORY_CHECK_ALIGN( address, 8 ); data = (data>>32) + (data<<32); FASTMEM_OR( address, Fastmem_Store64( address, data ); MEMORY_MARK_DIRTY( address ), u64 * p( (u64 *)ReadAddress( address ) ); *p = data; MEMORY_MARK_DIRTY_HOST( p ) ) }
+inline void Write32Bits( u32 address, u32 data )	{ MEMORY_CHECK_ALIGN( address, 4 ); FASTMEM_OR( address, Fastmem_Store32( address, data ); MEMORY_MARK_DIRTY( address ), WriteAddress(address, data) ) }
+inline void Write16Bits( u32 address, u16 data )	{ MEMORY_CHECK_ALIGN( address, 2 ); FASTMEM_OR( address, Fastmem_Store16( address ^ U16_TWIDDLE, data ); MEMORY_MARK_DIRTY( address ), u16 * p( (u16 *)ReadAddress(address ^ U16_TWIDDLE) ); *p = data; MEMORY_MARK_DIRTY_HOST( p ) ) }
+inline void Write8Bits( u32 address, u8 data )		{                                   FASTMEM_OR( address, Fastmem_Store8( address ^ U8_TWIDDLE, data ); MEMORY_MARK_DIRTY( address ), u8 * p( (u8 *)ReadAddress(address ^ U8_TWIDDLE) ); *p = data; MEMORY_MARK_DIRTY_HOST( p ) ) }
+
+#undef FASTMEM_OR
+
+#else
+
 inline u64 Read64Bits( u32 address )				{ MEMORY_CHECK_ALIGN( address, 8 ); u64 data = *(u64 *)ReadAddress( address ); data = (data>>32) + (data<<32); return data; }
 inline u32 Read32Bits( u32 address )				{ MEMORY_CHECK_ALIGN( address, 4 ); return *(u32 *)ReadAddress( address ); }
 inline u16 Read16Bits( u32 address )				{ MEMORY_CHECK_ALIGN( address, 2 ); return *(u16 *)ReadAddress( address ^ U16_TWIDDLE ); }
 inline u8 Read8Bits( u32 address )					{                                   return *(u8  *)ReadAddress( address ^ U8_TWIDDLE ); }
 
-inline void Write64Bits( u32 address, u64 data )	{ MEMORY_CHECK_ALIGN( address, 8 ); *(u64 *)ReadAddress( address ) = (data>>32) + (data<<32); }
+inline void Write64Bits( u32 address, u64 data )	{ MEMORY_CHECK_ALIGN( address, 8 ); u64 * p( (u64 *)ReadAddress( address ) ); *p = (data>>32) + (data<<32); MEMORY_MARK_DIRTY_HOST( p ); }
 inline void Write32Bits( u32 address, u32 data )	{ MEMORY_CHECK_ALIGN( address, 4 ); WriteAddress(address, data); }
-inline void Write16Bits( u32 address, u16 data )	{ MEMORY_CHECK_ALIGN( address, 2 ); *(u16 *)ReadAddress(address ^ U16_TWIDDLE) = data; }
-inline void Write8Bits( u32 address, u8 data )		{                                   *(u8 *)ReadAddress(address ^ U8_TWIDDLE) = data;}
+inline void Write16Bits( u32 address, u16 data )	{ MEMORY_CHECK_ALIGN( address, 2 ); u16 * p( (u16 *)ReadAddress(address ^ U16_TWIDDLE) ); *p = data; MEMORY_MARK_DIRTY_HOST( p ); }
+inline void Write8Bits( u32 address, u8 data )		{                                   u8 * p( (u8 *)ReadAddress(address ^ U8_TWIDDLE) ); *p = data; MEMORY_MARK_DIRTY_HOST( p ); }
+
+#endif // DAEDALUS_ENABLE_FASTMEM
 
 #else
 #error No DAEDALUS_ENDIAN_MODE specified
@@ -274,8 +342,8 @@ inline void Write8Bits( u32 address, u8 data )		{
 
 //inline void Write64Bits_NoSwizzle( u32 address, u64 data ){ MEMORY_CHECK_ALIGN( address, 8 ); *(u64 *)WriteAddress( address ) = (data>>32) + (data<<32); }
 inline void Write32Bits_NoSwizzle( u32 address, u32 data )	{ MEMORY_CHECK_ALIGN( address, 4 ); WriteAddress(address, data); }
-inline void Write16Bits_NoSwizzle( u32 address, u16 data )	{ MEMORY_CHECK_ALIGN( address, 2 ); *(u16 *)ReadAddress(address) = data; }
-inline void Write8Bits_NoSwizzle( u32 address, u8 data )	{                                   *(u8 *)ReadAddress(address) = data;}
+inline void Write16Bits_NoSwizzle( u32 address, u16 data )	{ MEMORY_CHECK_ALIGN( address, 2 ); u16 * p( (u16 *)ReadAddress(address) ); *p = data; MEMORY_MARK_DIRTY_HOST( p ); }
+inline void Write8Bits_NoSwizzle( u32 address, u8 data )	{                                   u8 * p( (u8 *)ReadAddress(address) ); *p = data; MEMORY_MARK_DIRTY_HOST( p ); }
 
 /////////////////////////////////////////////////////
 /////////////////////////////////////////////////////
@@ -37,10 +37,10 @@ static void * ReadMapped( u32 address )
 	gTLBReadHit++;
 #endif
 
-	u32 physical_addr = TLBEntry::Translate(address, missing);
-	if (physical_addr != 0)
+	u8 * p_host = TLBEntry::TranslateToHost(address, missing);
+	if (p_host != NULL)
 	{
-		return g_pu8RamBase + (physical_addr & 0x007FFFFF);
+		return p_host;
 	}
 	else
 	{
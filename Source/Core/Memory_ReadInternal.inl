@@ -36,10 +36,10 @@ static bool InternalReadMapped( u32 address, void ** translated )
 {
 	bool missing;
 
-	u32 physical_addr = TLBEntry::Translate(address, missing);
-	if (physical_addr != 0)
+	u8 * p_host = TLBEntry::TranslateToHost(address, missing);
+	if (p_host != NULL)
 	{
-		*translated = g_pu8RamBase + (physical_addr & 0x007FFFFF);
+		*translated = p_host;
 
 		return true;
 	}
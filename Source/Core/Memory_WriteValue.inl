@@ -31,10 +31,11 @@ static void WriteValueMapped( u32 address, u32 value )
 	gTLBWriteHit++;
 #endif
 
-	u32 physical_addr = TLBEntry::Translate(address, missing);
-	if (physical_addr != 0)
+	u8 * p_host = TLBEntry::TranslateToHost(address, missing);
+	if (p_host != NULL)
 	{
-		*(u32*)(g_pu8RamBase + (physical_addr & 0x007FFFFF)) = value;
+		*(u32*)p_host = value;
+		MEMORY_MARK_DIRTY_HOST( p_host );
 	}
 	else
 	{
@@ -46,6 +47,7 @@ static void WriteValue_8000_807F( u32 address, u32 value )
 {
 	// Note: Mask is slighty different when EPAK isn't used 0x003FFFFF
 	*(u32 *)((u8 *)g_pMemoryBuffers[MEM_RD_RAM] + (address & 0x007FFFFF)) = value;
+	MEMORY_MARK_DIRTY( address );
 }
 
 // 0x03F0 0000 to 0x03FF FFFF  RDRAM registers
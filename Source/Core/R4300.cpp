@@ -21,6 +21,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "R4300.h"
 
 #include "CPU.h"
+#include "IdleLoop.h"
 #include "Interrupt.h"
 #include "ROM.h"
 
@@ -45,6 +46,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <fenv.h>
 #endif
 
+#ifdef __SSE4_1__
+#include <smmintrin.h>
+#endif
+
 #ifdef DAEDALUS_W32
 #define isnan _isnan
 #endif
@@ -233,6 +238,18 @@ DAEDALUS_FORCEINLINE void SpeedHack(u32 pc, u32 new_pc)
 			}
 		}*/
 	}
+	// Otherwise it might be a longer loop polling memory
+	else if (new_pc < pc)
+	{
+#ifdef DAEDALUS_ENABLE_DYNAREC
+		if (gTraceRecorder.IsTraceActive())
+			return;
+#endif
+		if (IdleLoop_IsIdleLoop(pc, new_pc))
+		{
+			CPU_SkipToNextEvent();
+		}
+	}
 #endif
 }
 
@@ -418,86 +435,94 @@ inline s64 d64_to_s64( d64 x )						{ pspFpuSetRoundmode( gNativeRoundingModes[
 
 #else
 
-DAEDALUS_FORCEINLINE s32 f32_to_s32_trunc( f32 x )	{ SET_ROUND_MODE( RM_TRUNC ); return (s32)truncf(x); }
-DAEDALUS_FORCEINLINE s32 f32_to_s32_round( f32 x )	{ SET_ROUND_MODE( RM_ROUND ); return (s32)roundf(x); }
-DAEDALUS_FORCEINLINE s32 f32_to_s32_ceil( f32 x )	{ SET_ROUND_MODE( RM_CEIL ); return (s32)ceilf(x); }
-DAEDALUS_FORCEINLINE s32 f32_to_s32_floor( f32 x )	{ SET_ROUND_MODE( RM_FLOOR ); return (s32)floorf(x); }
-DAEDALUS_FORCEINLINE s32 f32_to_s32( f32 x )	
-{ 
-#ifdef ACCURATE_CVT
-	switch ( gCPUState.FPUControl[31]._u32 & FPCSR_RM_MASK )
-	{
-	case FPCSR_RM_RN:		return f32_to_s32_round( x );
-	case FPCSR_RM_RZ:		return f32_to_s32_trunc( x );
-	case FPCSR_RM_RP:		return f32_to_s32_ceil( x );
-	case FPCSR_RM_RM:		return f32_to_s32_floor( x );
-	default:				return (s32)x;
-	}
-#else
-	SET_ROUND_MODE( gRoundingMode ); 
-	return (s32)x;
-#endif
-}
-DAEDALUS_FORCEINLINE s64 f32_to_s64_trunc( f32 x )	{ SET_ROUND_MODE( RM_TRUNC ); return (s64)truncf(x); }
-DAEDALUS_FORCEINLINE s64 f32_to_s64_round( f32 x )	{ SET_ROUND_MODE( RM_ROUND ); return (s64)roundf(x); }
-DAEDALUS_FORCEINLINE s64 f32_to_s64_ceil( f32 x )	{ SET_ROUND_MODE( RM_CEIL ); return (s64)ceilf(x); }
-DAEDALUS_FORCEINLINE s64 f32_to_s64_floor( f32 x )	{ SET_ROUND_MODE( RM_FLOOR ); return (s64)floorf(x); }
-DAEDALUS_FORCEINLINE s64 f32_to_s64( f32 x ) 
-{ 
-#ifdef ACCURATE_CVT
-	switch ( gCPUState.FPUControl[31]._u32 & FPCSR_RM_MASK )
-	{
-	case FPCSR_RM_RN:		return f32_to_s64_round( x );
-	case FPCSR_RM_RZ:		return f32_to_s64_trunc( x );
-	case FPCSR_RM_RP:		return f32_to_s64_ceil( x );
-	case FPCSR_RM_RM:		return f32_to_s64_floor( x );
-	default:				return (s64)x;
-	}
-#else
-	SET_ROUND_MODE( gRoundingMode ); 
-	return (s64)x; 
-#endif
+//
+//	None of these touch the host rounding mode - changing it stalls the FPU,
+//	and was costing more than the conversions themselves. The fractional part
+//	is rounded off explicitly, and the result converted with truncation.
+//	ROUND rounds halfway cases to even, as the N64 does.
+//
+#ifdef __SSE4_1__
+
+template< int Mode > DAEDALUS_FORCEINLINE f32 RoundF32( f32 x )
+{
+	return _mm_cvtss_f32( _mm_round_ss( _mm_setzero_ps(), _mm_set_ss( x ), Mode | _MM_FROUND_NO_EXC ) );
 }
-DAEDALUS_FORCEINLINE s32 d64_to_s32_trunc( d64 x )	{ SET_ROUND_MODE( RM_TRUNC ); return (s32)trunc(x); }
-DAEDALUS_FORCEINLINE s32 d64_to_s32_round( d64 x )	{ SET_ROUND_MODE( RM_ROUND ); return (s32)round(x); }
-DAEDALUS_FORCEINLINE s32 d64_to_s32_ceil( d64 x )	{ SET_ROUND_MODE( RM_CEIL ); return (s32)ceil(x); }
-DAEDALUS_FORCEINLINE s32 d64_to_s32_floor( d64 x )	{ SET_ROUND_MODE( RM_FLOOR ); return (s32)floor(x); }
-DAEDALUS_FORCEINLINE s32 d64_to_s32( d64 x )
+template< int Mode > DAEDALUS_FORCEINLINE f64 RoundF64( f64 x )
 {
-#ifdef ACCURATE_CVT
-	switch ( gCPUState.FPUControl[31]._u32 & FPCSR_RM_MASK )
-	{
-	case FPCSR_RM_RN:		return d64_to_s32_round( x );
-	case FPCSR_RM_RZ:		return d64_to_s32_trunc( x );
-	case FPCSR_RM_RP:		return d64_to_s32_ceil( x );
-	case FPCSR_RM_RM:		return d64_to_s32_floor( x );
-	default:				return (s32)x;
-	}
+	return _mm_cvtsd_f64( _mm_round_sd( _mm_setzero_pd(), _mm_set_sd( x ), Mode | _MM_FROUND_NO_EXC ) );
+}
+
+DAEDALUS_FORCEINLINE f32 RoundNearest( f32 x )		{ return RoundF32< _MM_FROUND_TO_NEAREST_INT >( x ); }
+DAEDALUS_FORCEINLINE f32 RoundUp( f32 x )			{ return RoundF32< _MM_FROUND_TO_POS_INF >( x ); }
+DAEDALUS_FORCEINLINE f32 RoundDown( f32 x )			{ return RoundF32< _MM_FROUND_TO_NEG_INF >( x ); }
+DAEDALUS_FORCEINLINE f64 RoundNearest( f64 x )		{ return RoundF64< _MM_FROUND_TO_NEAREST_INT >( x ); }
+DAEDALUS_FORCEINLINE f64 RoundUp( f64 x )			{ return RoundF64< _MM_FROUND_TO_POS_INF >( x ); }
+DAEDALUS_FORCEINLINE f64 RoundDown( f64 x )			{ return RoundF64< _MM_FROUND_TO_NEG_INF >( x ); }
+
+template< typename I, typename F > DAEDALUS_FORCEINLINE I ConvertTrunc( F x )	{ return I( x ); }
+template< typename I, typename F > DAEDALUS_FORCEINLINE I ConvertRound( F x )	{ return I( RoundNearest( x ) ); }
+template< typename I, typename F > DAEDALUS_FORCEINLINE I ConvertCeil( F x )	{ return I( RoundUp( x ) ); }
+template< typename I, typename F > DAEDALUS_FORCEINLINE I ConvertFloor( F x )	{ return I( RoundDown( x ) ); }
+
 #else
-	SET_ROUND_MODE( gRoundingMode ); 
-	return (s32)x; 
-#endif
+
+// Truncate, then correct by one. x - t is exact, as t is either 0 or within a factor of two of x
+template< typename I, typename F > DAEDALUS_FORCEINLINE I ConvertTrunc( F x )	{ return I( x ); }
+template< typename I, typename F > DAEDALUS_FORCEINLINE I ConvertCeil( F x )	{ I t( x ); return F( t ) < x ? t + 1 : t; }
+template< typename I, typename F > DAEDALUS_FORCEINLINE I ConvertFloor( F x )	{ I t( x ); return F( t ) > x ? t - 1 : t; }
+template< typename I, typename F > DAEDALUS_FORCEINLINE I ConvertRound( F x )
+{
+	I t( x );
+	F frac( x - F( t ) );
+
+	if( frac > F( 0.5 ) )			return t + 1;
+	if( frac < F( -0.5 ) )			return t - 1;
+	if( frac == F( 0.5 ) )			return t + (t & 1);
+	if( frac == F( -0.5 ) )			return t - (t & 1);
+	return t;
 }
-DAEDALUS_FORCEINLINE s64 d64_to_s64_trunc( d64 x ) { SET_ROUND_MODE( RM_TRUNC ); return (s64)trunc(x); }
-DAEDALUS_FORCEINLINE s64 d64_to_s64_round( d64 x ) { SET_ROUND_MODE( RM_ROUND ); return (s64)round(x); }
-DAEDALUS_FORCEINLINE s64 d64_to_s64_ceil( d64 x )  { SET_ROUND_MODE( RM_CEIL ); return (s64)ceil(x); }
-DAEDALUS_FORCEINLINE s64 d64_to_s64_floor( d64 x ) { SET_ROUND_MODE( RM_FLOOR ); return (s64)floor(x); }
-DAEDALUS_FORCEINLINE s64 d64_to_s64( d64 x )
-{ 
+
+#endif
+
+template< typename I, typename F > DAEDALUS_FORCEINLINE I ConvertCurrent( F x )
+{
 #ifdef ACCURATE_CVT
 	switch ( gCPUState.FPUControl[31]._u32 & FPCSR_RM_MASK )
 	{
-	case FPCSR_RM_RN:		return d64_to_s64_round( x );
-	case FPCSR_RM_RZ:		return d64_to_s64_trunc( x );
-	case FPCSR_RM_RP:		return d64_to_s64_ceil( x );
-	case FPCSR_RM_RM:		return d64_to_s64_floor( x );
-	default:				return (s64)x;
+	case FPCSR_RM_RN:		return ConvertRound< I >( x );
+	case FPCSR_RM_RZ:		return ConvertTrunc< I >( x );
+	case FPCSR_RM_RP:		return ConvertCeil< I >( x );
+	case FPCSR_RM_RM:		return ConvertFloor< I >( x );
+	default:				return I( x );
 	}
 #else
-	SET_ROUND_MODE( gRoundingMode );
-	return (s64)x; 
+	return I( x );
 #endif
 }
+
+DAEDALUS_FORCEINLINE s32 f32_to_s32_trunc( f32 x )	{ return ConvertTrunc< s32 >( x ); }
+DAEDALUS_FORCEINLINE s32 f32_to_s32_round( f32 x )	{ return ConvertRound< s32 >( x ); }
+DAEDALUS_FORCEINLINE s32 f32_to_s32_ceil( f32 x )	{ return ConvertCeil< s32 >( x ); }
+DAEDALUS_FORCEINLINE s32 f32_to_s32_floor( f32 x )	{ return ConvertFloor< s32 >( x ); }
+DAEDALUS_FORCEINLINE s32 f32_to_s32( f32 x )		{ return ConvertCurrent< s32 >( x ); }
+
+DAEDALUS_FORCEINLINE s64 f32_to_s64_trunc( f32 x )	{ return ConvertTrunc< s64 >( x ); }
+DAEDALUS_FORCEINLINE s64 f32_to_s64_round( f32 x )	{ return ConvertRound< s64 >( x ); }
+DAEDALUS_FORCEINLINE s64 f32_to_s64_ceil( f32 x )	{ return ConvertCeil< s64 >( x ); }
+DAEDALUS_FORCEINLINE s64 f32_to_s64_floor( f32 x )	{ return ConvertFloor< s64 >( x ); }
+DAEDALUS_FORCEINLINE s64 f32_to_s64( f32 x )		{ return ConvertCurrent< s64 >( x ); }
+
+DAEDALUS_FORCEINLINE s32 d64_to_s32_trunc( d64 x )	{ return ConvertTrunc< s32 >( x ); }
+DAEDALUS_FORCEINLINE s32 d64_to_s32_round( d64 x )	{ return ConvertRound< s32 >( x ); }
+DAEDALUS_FORCEINLINE s32 d64_to_s32_ceil( d64 x )	{ return ConvertCeil< s32 >( x ); }
+DAEDALUS_FORCEINLINE s32 d64_to_s32_floor( d64 x )	{ return ConvertFloor< s32 >( x ); }
+DAEDALUS_FORCEINLINE s32 d64_to_s32( d64 x )		{ return ConvertCurrent< s32 >( x ); }
+
+DAEDALUS_FORCEINLINE s64 d64_to_s64_trunc( d64 x )	{ return ConvertTrunc< s64 >( x ); }
+DAEDALUS_FORCEINLINE s64 d64_to_s64_round( d64 x )	{ return ConvertRound< s64 >( x ); }
+DAEDALUS_FORCEINLINE s64 d64_to_s64_ceil( d64 x )	{ return ConvertCeil< s64 >( x ); }
+DAEDALUS_FORCEINLINE s64 d64_to_s64_floor( d64 x )	{ return ConvertFloor< s64 >( x ); }
+DAEDALUS_FORCEINLINE s64 d64_to_s64( d64 x )		{ return ConvertCurrent< s64 >( x ); }
 #endif
 
 static void R4300_CALL_TYPE R4300_Cop1_BCInstr( R4300_CALL_SIGNATURE );
@@ -512,6 +537,8 @@ static void R4300_CALL_TYPE R4300_Special( R4300_CALL_SIGNATURE );
 static void R4300_CALL_TYPE R4300_RegImm( R4300_CALL_SIGNATURE );
 static void R4300_CALL_TYPE R4300_Cop0_TLB( R4300_CALL_SIGNATURE );
 
+static void R4300_UpdateFlatCop1();
+
 
 static void R4300_CALL_TYPE R4300_LWC1( R4300_CALL_SIGNATURE );
 static void R4300_CALL_TYPE R4300_LDC1( R4300_CALL_SIGNATURE );
@@ -670,6 +697,8 @@ void R4300_CALL_TYPE R4300_SetSR( u32 new_value )
 		R4300Instruction[OP_SDC1] = R4300_SDC1;
 	}
 
+	R4300_UpdateFlatCop1();
+
 	// Serve any pending interrupts
 	if ( !interrupts_enabled_before && interrupts_enabled_after )
 	{
@@ -680,6 +709,18 @@ void R4300_CALL_TYPE R4300_SetSR( u32 new_value )
 	}
 }
 
+//*****************************************************************************
+//	The host rounding mode is only changed here, so the COP1 arithmetic ops
+//	don't need to set it every time they're executed.
+//*****************************************************************************
+void R4300_SetFPCSR( u32 new_value )
+{
+	gCPUState.FPUControl[ 31 ]._u32 = new_value;
+
+	gRoundingMode = (ERoundingMode)( new_value & FPCSR_RM_MASK );
+	SET_ROUND_MODE( gRoundingMode );
+}
+
 /////////////////////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -1365,7 +1406,6 @@ static void R4300_CALL_TYPE R4300_CACHE( R4300_CALL_SIGNATURE )
 
 //	return;
 
-#ifdef DAEDALUS_ENABLE_DYNAREC
 	u32 cache_op  = op_code.rt;
 
 	u32 address = (u32)( gGPR[op_code.base]._s32_0 + (s32)(s16)op_code.immediate );
@@ -1381,7 +1421,6 @@ static void R4300_CALL_TYPE R4300_CACHE( R4300_CALL_SIGNATURE )
 	}
 
 	//DBGConsole_Msg(0, "CACHE %s/%d, 0x%08x", gCacheNames[dwCache], dwAction, address);
-#endif
 }
 
 static void R4300_CALL_TYPE R4300_LWC1( R4300_CALL_SIGNATURE ) 				// Load Word to Copro 1 (FPU)
@@ -2195,6 +2234,11 @@ static void R4300_CALL_TYPE R4300_Cop0_MFC0( R4300_CALL_SIGNATURE )
 	}
 	else*/
 	{
+		if( op_code.fs == C0_COUNT )
+		{
+			CPU_SyncCounter();
+		}
+
 		// No specific handling needs for reads to these registers.
 		gGPR[ op_code.rt ]._s64 = (s64)gCPUState.CPUControl[ op_code.fs ]._s32;
 	}
@@ -2274,6 +2318,7 @@ static void R4300_CALL_TYPE R4300_Cop0_MTC0( R4300_CALL_SIGNATURE )
 				// See comments below for COMPARE.
 				// When this register is set, we need to check whether the next timed interrupt will
 				//  be due to vertical blank or COMPARE
+				CPU_SyncCounter();
 				gCPUState.CPUControl[C0_COUNT]._u32 = new_value;
 				DBGConsole_Msg(0, "Count set - setting int");
 				// XXXX Do we need to update any existing events?
@@ -2287,6 +2332,15 @@ static void R4300_CALL_TYPE R4300_Cop0_MTC0( R4300_CALL_SIGNATURE )
 			}
 			break;
 
+		case C0_ENTRYHI:
+			// Cached translations for non-global pages are only valid for the current ASID
+			if ((new_value ^ gCPUState.CPUControl[C0_ENTRYHI]._u32) & TLBHI_PIDMASK)
+			{
+				TLB_InvalidatePageTable();
+			}
+			gCPUState.CPUControl[C0_ENTRYHI]._u32 = new_value;
+			break;
+
 
 		// Need to check CONFIG register writes - not all fields are writable.
 		// This also sets Endianness mode.
@@ -2315,6 +2369,11 @@ static void R4300_CALL_TYPE R4300_TLB_TLBR( R4300_CALL_SIGNATURE ) 				// TLB Re
 
 	u32 index = gCPUState.CPUControl[C0_INX]._u32 & 0x1F;
 
+	if ((g_TLBs[index].hi ^ gCPUState.CPUControl[C0_ENTRYHI]._u32) & TLBHI_PIDMASK)
+	{
+		TLB_InvalidatePageTable();
+	}
+
 	gCPUState.CPUControl[C0_PAGEMASK]._u32 = g_TLBs[index].mask;
 	gCPUState.CPUControl[C0_ENTRYHI ]._u32 = g_TLBs[index].hi   & (~g_TLBs[index].pagemask);
 	gCPUState.CPUControl[C0_ENTRYLO0]._u32 = g_TLBs[index].pfne | g_TLBs[index].g;
@@ -2484,11 +2543,7 @@ static void R4300_CALL_TYPE R4300_Cop1_CTC1( R4300_CALL_SIGNATURE ) 		// move Co
 	}*/
 	if ( op_code.fs == 31 )
 	{
-		gCPUState.FPUControl[ 31 ]._u32 = gGPR[ op_code.rt ]._u32_0;
-
-		u32		fpcr( gCPUState.FPUControl[ 31 ]._u32 );
-		gRoundingMode = (ERoundingMode)( fpcr & FPCSR_RM_MASK );
-		SET_ROUND_MODE(gRoundingMode);
+		R4300_SetFPCSR( gGPR[ op_code.rt ]._u32_0 );
 	}
 	else
 	{
@@ -2596,8 +2651,6 @@ static void R4300_CALL_TYPE R4300_Cop1_W_CVT_S( R4300_CALL_SIGNATURE )
 {
 	R4300_CALL_MAKE_OP( op_code );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
-
 	s32 nTemp = LoadFPR_Word( op_code.fs );
 
 	StoreFPR_Single( op_code.fd, s32_to_f32( nTemp ) );
@@ -2607,8 +2660,6 @@ static void R4300_CALL_TYPE R4300_Cop1_W_CVT_D( R4300_CALL_SIGNATURE )
 {
 	R4300_CALL_MAKE_OP( op_code );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
-
 	s32 nTemp = LoadFPR_Word( op_code.fs );
 
 	// Convert using current rounding mode?
@@ -2632,7 +2683,6 @@ static void R4300_CALL_TYPE R4300_Cop1_L_CVT_S( R4300_CALL_SIGNATURE )
 
 	s64 nTemp = LoadFPR_Long( op_code.fs );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
 	StoreFPR_Single( op_code.fd, s64_to_f32( nTemp ));
 }
 
@@ -2642,7 +2692,6 @@ static void R4300_CALL_TYPE R4300_Cop1_L_CVT_D( R4300_CALL_SIGNATURE )
 
 	s64 nTemp = LoadFPR_Long( op_code.fs );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
 	StoreFPR_Double( op_code.fd, s64_to_d64( nTemp ) );
 }
 
@@ -2668,7 +2717,6 @@ static void R4300_CALL_TYPE R4300_Cop1_S_ADD( R4300_CALL_SIGNATURE )
 	f32 fX = LoadFPR_Single( op_code.fs );
 	f32 fY = LoadFPR_Single( op_code.ft );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
 	StoreFPR_Single( op_code.fd, fX + fY );
 }
 
@@ -2680,7 +2728,6 @@ static void R4300_CALL_TYPE R4300_Cop1_S_SUB( R4300_CALL_SIGNATURE )
 	f32 fX = LoadFPR_Single( op_code.fs );
 	f32 fY = LoadFPR_Single( op_code.ft );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
 	StoreFPR_Single( op_code.fd, fX - fY );
 }
 
@@ -2692,7 +2739,6 @@ static void R4300_CALL_TYPE R4300_Cop1_S_MUL( R4300_CALL_SIGNATURE )
 	f32 fX = LoadFPR_Single( op_code.fs );
 	f32 fY = LoadFPR_Single( op_code.ft );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
 	StoreFPR_Single( op_code.fd, fX * fY );
 }
 
@@ -2704,8 +2750,6 @@ static void R4300_CALL_TYPE R4300_Cop1_S_DIV( R4300_CALL_SIGNATURE )
 	f32 fDividend = LoadFPR_Single( op_code.fs );
 	f32 fDivisor  = LoadFPR_Single( op_code.ft );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
-
 	// Should we handle if /0? GoldenEye007 and Exitebike does this.
 	// Not sure if is worth to handle this, I have yet to see a game that fails due this..
 	DAEDALUS_ASSERT(fDivisor != 0.0f, "Float divide by zero");
@@ -2735,7 +2779,6 @@ static void R4300_CALL_TYPE R4300_Cop1_S_SQRT( R4300_CALL_SIGNATURE )
 	// fd = sqrt(fs)
 	f32 fX = LoadFPR_Single( op_code.fs );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
 	StoreFPR_Single( op_code.fd, R4300_Sqrt(fX) );
 }
 
@@ -2747,7 +2790,6 @@ static void R4300_CALL_TYPE R4300_Cop1_S_NEG( R4300_CALL_SIGNATURE )
 	// fd = -(fs)
 	f32 fX = LoadFPR_Single( op_code.fs );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
 	StoreFPR_Single( op_code.fd, -fX );
 }
 
@@ -2758,7 +2800,6 @@ static void R4300_CALL_TYPE R4300_Cop1_S_MOV( R4300_CALL_SIGNATURE )
 	// fd = fs
 	f32 fValue = LoadFPR_Single( op_code.fs );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
 	StoreFPR_Single( op_code.fd, fValue );// Just copy bits directly?
 }
 
@@ -2768,7 +2809,6 @@ static void R4300_CALL_TYPE R4300_Cop1_S_ABS( R4300_CALL_SIGNATURE )
 
 	f32 fX = LoadFPR_Single( op_code.fs );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
 	StoreFPR_Single( op_code.fd, R4300_AbsS(fX) );
 }
 
@@ -2874,8 +2914,6 @@ static void R4300_CALL_TYPE R4300_Cop1_S_CVT_D( R4300_CALL_SIGNATURE )
 {
 	R4300_CALL_MAKE_OP( op_code );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
-
 	f32 fX = LoadFPR_Single( op_code.fs );
 
 	StoreFPR_Double( op_code.fd, f32_to_d64( fX ) );
@@ -2888,8 +2926,6 @@ static void R4300_CALL_TYPE R4300_Cop1_S_CVT_D_2( R4300_CALL_SIGNATURE )
 {
 	R4300_CALL_MAKE_OP( op_code );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
-
 	f32 fX = LoadFPR_Single( op_code.fs );
 
 	REG64 r;
@@ -3159,8 +3195,6 @@ static void R4300_CALL_TYPE R4300_Cop1_D_ABS( R4300_CALL_SIGNATURE )
 
 	d64 fX = LoadFPR_Double( op_code.fs );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
-
 	StoreFPR_Double( op_code.fd, R4300_AbsD(fX) );
 }
 
@@ -3174,8 +3208,6 @@ static void R4300_CALL_TYPE R4300_Cop1_D_ADD_2( R4300_CALL_SIGNATURE )
 	d64 fX = LoadFPR_Double( op_code.fs );
 	d64 fY = LoadFPR_Double( op_code.ft );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
-
 	REG64	r;
 
 	// Use double, float won't work for buck bumble
@@ -3194,8 +3226,6 @@ static void R4300_CALL_TYPE R4300_Cop1_D_ADD( R4300_CALL_SIGNATURE )
 	d64 fX = LoadFPR_Double( op_code.fs );
 	d64 fY = LoadFPR_Double( op_code.ft );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
-
 	StoreFPR_Double( op_code.fd, fX + fY );
 
 }
@@ -3208,8 +3238,6 @@ static void R4300_CALL_TYPE R4300_Cop1_D_SUB( R4300_CALL_SIGNATURE )
 	d64 fX = LoadFPR_Double( op_code.fs );
 	d64 fY = LoadFPR_Double( op_code.ft );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
-
 	StoreFPR_Double( op_code.fd, fX - fY );
 }
 
@@ -3221,8 +3249,6 @@ static void R4300_CALL_TYPE R4300_Cop1_D_MUL( R4300_CALL_SIGNATURE )
 	d64 fX = LoadFPR_Double( op_code.fs );
 	d64 fY = LoadFPR_Double( op_code.ft );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
-
 	StoreFPR_Double( op_code.fd, fX * fY );
 }
 
@@ -3236,8 +3262,6 @@ static void R4300_CALL_TYPE R4300_Cop1_D_DIV( R4300_CALL_SIGNATURE )
 
 	DAEDALUS_ASSERT(fDivisor != 0, "Double divide by zero");
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
-
 	StoreFPR_Double( op_code.fd,  fDividend / fDivisor );
 }
 
@@ -3248,8 +3272,6 @@ static void R4300_CALL_TYPE R4300_Cop1_D_SQRT( R4300_CALL_SIGNATURE )
 	// fd = sqrt(fs)
 	d64 fX = LoadFPR_Double( op_code.fs );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
-
 	StoreFPR_Double( op_code.fd, R4300_SqrtD(fX) );
 }
 
@@ -3261,8 +3283,6 @@ static void R4300_CALL_TYPE R4300_Cop1_D_NEG( R4300_CALL_SIGNATURE )
 	// fd = -(fs)
 	d64 fX = LoadFPR_Double( op_code.fs );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
-
 	StoreFPR_Double( op_code.fd, -fX );
 }
 
@@ -3270,8 +3290,6 @@ static void R4300_CALL_TYPE R4300_Cop1_D_MOV( R4300_CALL_SIGNATURE )
 {
 	R4300_CALL_MAKE_OP( op_code );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
-
 #if 1
 	//Fast way, just copy registers //Corn
 	gCPUState.FPU[op_code.fd+0]._u32 = gCPUState.FPU[op_code.fs+0]._u32;
@@ -3363,8 +3381,6 @@ static void R4300_CALL_TYPE R4300_Cop1_D_CVT_S( R4300_CALL_SIGNATURE )
 
 	d64 fX = LoadFPR_Double( op_code.fs );
 
-	SET_ROUND_MODE( gRoundingMode );		//XXXX Is this needed?
-
 	StoreFPR_Single( op_code.fd, (f32)fX );
 }
 
@@ -3620,6 +3636,103 @@ static void R4300_CALL_TYPE R4300_Cop1_D_NGT( R4300_CALL_SIGNATURE )
 
 #include "R4300_Jump.inl"		// Jump table
 
+SR4300Decode	R4300Decode[64];
+CPU_Instruction	R4300FlatInstruction[R4300_NUM_FLAT_HANDLERS];
+
+static void R4300_SetDecode( u32 op, u32 base, u32 shift, u32 mask, u32 funct_mask )
+{
+	SR4300Decode & decode( R4300Decode[ op ] );
+
+	decode.Base = base;
+	decode.Shift = shift;
+	decode.Mask = mask;
+	decode.FunctMask = funct_mask;
+}
+
+//*****************************************************************************
+//	Mirrors the COP1 usable swaps made to R4300Instruction. While COP1 is
+//	disabled every COP1 op goes straight to R4300_CoPro1_Disabled.
+//*****************************************************************************
+static void R4300_UpdateFlatCop1()
+{
+	static const u32 cop1_ops[] = { OP_COPRO1, OP_LWC1, OP_LDC1, OP_SWC1, OP_SDC1 };
+
+	for( u32 i = 0; i < ARRAYSIZE( cop1_ops ); ++i )
+	{
+		R4300FlatInstruction[ cop1_ops[ i ] ] = R4300Instruction[ cop1_ops[ i ] ];
+	}
+
+	if( gCPUState.CPUControl[C0_SR]._u32 & SR_CU1 )
+	{
+		R4300_SetDecode( OP_COPRO1, R4300_FLAT_COP1_BASE, 21 - 6, 0x1f << 6, 0x3f );
+	}
+	else
+	{
+		R4300_SetDecode( OP_COPRO1, OP_COPRO1, 0, 0, 0 );
+	}
+}
+
+//*****************************************************************************
+//	The COP0 TLB ops and the COP1 BC ops are rare enough that they are still
+//	dispatched through R4300_Cop0_TLB and R4300_Cop1_BCInstr.
+//*****************************************************************************
+static void R4300_BuildFlatInstructionTable()
+{
+	for( u32 op = 0; op < 64; ++op )
+	{
+		R4300_SetDecode( op, op, 0, 0, 0 );
+		R4300FlatInstruction[ op ] = R4300Instruction[ op ];
+	}
+
+	R4300_SetDecode( OP_SPECOP, R4300_FLAT_SPECIAL_BASE, 0, 0, 0x3f );
+	for( u32 i = 0; i < 64; ++i )
+	{
+		R4300FlatInstruction[ R4300_FLAT_SPECIAL_BASE + i ] = R4300SpecialInstruction[ i ];
+	}
+
+	R4300_SetDecode( OP_REGIMM, R4300_FLAT_REGIMM_BASE, 16, 0x1f, 0 );
+	for( u32 i = 0; i < 32; ++i )
+	{
+		R4300FlatInstruction[ R4300_FLAT_REGIMM_BASE + i ] = R4300RegImmInstruction[ i ];
+	}
+
+	R4300_SetDecode( OP_COPRO0, R4300_FLAT_COP0_BASE, 21, 0x1f, 0 );
+	for( u32 i = 0; i < 32; ++i )
+	{
+		R4300FlatInstruction[ R4300_FLAT_COP0_BASE + i ] = R4300Cop0Instruction[ i ];
+	}
+
+	for( u32 fmt = 0; fmt < 32; ++fmt )
+	{
+		for( u32 funct = 0; funct < 64; ++funct )
+		{
+			CPU_Instruction	handler( R4300Cop1Instruction[ fmt ] );
+
+			switch( fmt )
+			{
+			case Cop1Op_SInstr:
+				handler = R4300Cop1SInstruction[ funct ];
+				break;
+			case Cop1Op_DInstr:
+				handler = R4300Cop1DInstruction[ funct ];
+				break;
+			case Cop1Op_WInstr:
+				if( funct == Cop1OpFunc_CVT_S )			handler = R4300_Cop1_W_CVT_S;
+				else if( funct == Cop1OpFunc_CVT_D )	handler = R4300_Cop1_W_CVT_D;
+				break;
+			case Cop1Op_LInstr:
+				if( funct == Cop1OpFunc_CVT_S )			handler = R4300_Cop1_L_CVT_S;
+				else if( funct == Cop1OpFunc_CVT_D )	handler = R4300_Cop1_L_CVT_D;
+				break;
+			}
+
+			R4300FlatInstruction[ R4300_FLAT_COP1_BASE + (fmt << 6) + funct ] = handler;
+		}
+	}
+
+	R4300_UpdateFlatCop1();
+}
+
 CPU_Instruction	R4300_GetInstructionHandler( OpCode op_code )
 {
 	switch( op_code.op )
@@ -3692,4 +3805,7 @@ void R4300_Init()
 		R4300Cop1Instruction[Cop1Op_CTC1]	= R4300_Cop1_CTC1;
 	}
 #endif
+
+	// Pick up any of the swaps above
+	R4300_BuildFlatInstructionTable();
 }
@@ -24,20 +24,71 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "R4300Instruction.h"
 
 void R4300_CALL_TYPE R4300_SetSR( u32 new_value );
+void R4300_SetFPCSR( u32 new_value );
 
 extern CPU_Instruction R4300Instruction[64];
 extern CPU_Instruction R4300Cop1DInstruction[64];
 
+//
+//	All the nested jump tables flattened into one, so any op can be dispatched
+//	with a single indirect call. R4300Decode says how to build the index from
+//	the bits of an op with the given primary opcode:
+//
+//		Base + ((op >> Shift) & Mask) + (op & FunctMask)
+//
+//	Both tables are rebuilt by R4300_Init, and kept in step with the COP1
+//	usable flag by R4300_SetSR.
+//
+struct SR4300Decode
+{
+	u32		Base;
+	u32		Shift;
+	u32		Mask;
+	u32		FunctMask;
+};
+
+enum
+{
+	R4300_FLAT_SPECIAL_BASE = 64,										// Indexed by funct
+	R4300_FLAT_REGIMM_BASE  = R4300_FLAT_SPECIAL_BASE + 64,				// Indexed by rt
+	R4300_FLAT_COP0_BASE    = R4300_FLAT_REGIMM_BASE + 32,				// Indexed by fmt
+	R4300_FLAT_COP1_BASE    = R4300_FLAT_COP0_BASE + 32,				// Indexed by fmt:funct
+	R4300_NUM_FLAT_HANDLERS = R4300_FLAT_COP1_BASE + 32 * 64,
+};
+
+extern SR4300Decode		R4300Decode[64];
+extern CPU_Instruction	R4300FlatInstruction[R4300_NUM_FLAT_HANDLERS];
+
+inline u32				R4300_GetFlatIndex( OpCode op_code )
+{
+	const SR4300Decode & decode( R4300Decode[ op_code.op ] );
+
+	return decode.Base + ((op_code._u32 >> decode.Shift) & decode.Mask) + (op_code._u32 & decode.FunctMask);
+}
+
 inline CPU_Instruction	R4300_GetDInstructionHandler( OpCode op_code )
 {
 	return R4300Cop1DInstruction[ op_code.cop1_funct ];
 }
 
+// The ops which might read COUNT or change the event list: COP0, the
+// branches which can call CPU_SkipToNextEvent(), the OS patches and anything
+// which can touch the memory mapped registers. Everything else is known not
+// to need COUNT to be up to date. See CPU_SyncCounter().
+inline bool				R4300_OpNeedsCount( u32 op )
+{
+	return op == OP_REGIMM ||
+		   (op >= OP_BEQ && op <= OP_BGTZ) ||
+		   op == OP_COPRO0 ||
+		   (op >= OP_BEQL && op <= OP_BGTZL) ||
+		   op >= OP_PATCH;
+}
+
 CPU_Instruction	R4300_GetInstructionHandler( OpCode op_code );
 bool			R4300_InstructionHandlerNeedsPC( OpCode op_code );
 inline void			R4300_ExecuteInstruction( OpCode op_code )
 {
-	R4300Instruction[ op_code.op ]( op_code._u32 );
+	R4300FlatInstruction[ R4300_GetFlatIndex( op_code ) ]( op_code._u32 );
 }
 
 #endif // CORE_R4300_H_
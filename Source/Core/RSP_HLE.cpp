@@ -222,6 +222,11 @@ void jpeg_decode_OB(OSTask *task);
 		break;
 	}
 
+#ifdef DAEDALUS_ENABLE_DIRTY_PAGES
+	// The decoded images are usually drawn as textures. Rare enough not to bother working out where they went.
+	DirtyPages_MarkAll();
+#endif
+
 	return PR_COMPLETED;
 }
 
@@ -253,6 +258,10 @@ EProcessResult RSP_HLE_CICX105(OSTask * task)
 					src += 0x8;
 
 				}
+
+#ifdef DAEDALUS_ENABLE_DIRTY_PAGES
+				DirtyPages_MarkRange( 0x2fb1f0, 24 * 0xff0 );
+#endif
 			}
 			break;
 
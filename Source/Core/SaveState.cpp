@@ -325,6 +325,7 @@ bool SaveState_LoadFromFile( const char * filename )
 		stream >> value;
 		gCPUState.FPUControl[i]._u32 = value;
 	}
+	R4300_SetFPCSR(gCPUState.FPUControl[31]._u32);
 	stream >> gCPUState.MultHi._u64;
 	stream >> gCPUState.MultLo._u64;
 	stream.read_memory_buffer(MEM_RD_REG0, 0x28); //, 0x84040000);
@@ -381,6 +382,8 @@ bool SaveState_LoadFromFile( const char * filename )
 			gCPUState.CPUControl[i]._u32 = g_dwNewCPR0[i];
 		}
 	}
+	// ENTRYHI (and so the ASID) was written directly above
+	TLB_InvalidatePageTable();
 	//stream.skip(0x40);
 
 	stream.read(g_pMemoryBuffers[MEM_PIF_RAM], 0x40);
@@ -389,6 +392,10 @@ bool SaveState_LoadFromFile( const char * filename )
 	stream.read(g_pMemoryBuffers[MEM_RD_RAM], gRamSize);
 	stream.read_memory_buffer(MEM_SP_MEM); //, 0x84000000);
 
+#ifdef DAEDALUS_ENABLE_DIRTY_PAGES
+	DirtyPages_MarkAll();
+#endif
+
 #ifdef DAEDALUS_ENABLE_OS_HOOKS
 	Patch_PatchAll();
 #endif
@@ -21,12 +21,16 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "TLB.h"
 #include "CPU.h"
+#include "Memory.h"
 #include "Debug/DebugLog.h"
 #include "Debug/DBGConsole.h"
 
 #include "OSHLE/ultra_R4300.h"
 
 ALIGNED_GLOBAL(TLBEntry, g_TLBs[32], CACHE_ALIGN);
+ALIGNED_GLOBAL(TLBPageEntry, gTLBPageTable[TLB_PAGE_TABLE_SIZE], CACHE_ALIGN);
+
+static const u32 INVALID_VPAGE( ~0 );
 
 void TLBEntry::UpdateValue(u32 _pagemask, u32 _hi, u32 _pfno, u32 _pfne)
 {
@@ -37,6 +41,9 @@ void TLBEntry::UpdateValue(u32 _pagemask, u32 _hi, u32 _pfno, u32 _pfne)
 	// TLB[INDEX] <- PageMask || (EntryHi AND NOT PageMask) || EntryLo1 || EntryLo0
 	DPF( DEBUG_TLB, "PAGEMASK: 0x%08x ENTRYHI: 0x%08x. ENTRYLO1: 0x%08x. ENTRYLO0: 0x%08x", _pagemask, _hi, _pfno, _pfne);
 
+	// Drop any cached translations for the pages this entry used to map
+	InvalidatePages();
+
 	pagemask = _pagemask;
 	hi = _hi;
 	pfne = _pfne;
@@ -90,6 +97,45 @@ void TLBEntry::UpdateValue(u32 _pagemask, u32 _hi, u32 _pfno, u32 _pfne)
 		checkbit = 0;
 		break;
 	}
+
+	// ..and for the pages it maps now, which may have been cached from another entry
+	InvalidatePages();
+}
+
+//*****************************************************************************
+//	Invalidate the page table entries for the even/odd pages mapped by this entry
+//*****************************************************************************
+void TLBEntry::InvalidatePages() const
+{
+	u32 first_vpage = addrcheck >> 12;
+	u32 num_vpages  = (mask >> 12) + 1;
+
+	if (num_vpages >= TLB_PAGE_TABLE_SIZE)
+	{
+		TLB_InvalidatePageTable();
+		return;
+	}
+
+	for (u32 i = 0; i < num_vpages; i++)
+	{
+		u32 vpage = first_vpage + i;
+		TLBPageEntry & entry = gTLBPageTable[vpage & (TLB_PAGE_TABLE_SIZE-1)];
+		if (entry.VPage == vpage)
+		{
+			entry.VPage = INVALID_VPAGE;
+		}
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void TLB_InvalidatePageTable()
+{
+	for (u32 i = 0; i < TLB_PAGE_TABLE_SIZE; i++)
+	{
+		gTLBPageTable[i].VPage = INVALID_VPAGE;
+	}
 }
 
 void TLBEntry::Reset()
@@ -170,3 +216,21 @@ u32 TLBEntry::Translate(u32 address, bool& missing)
 		return 0;
 	}
 }
+
+//*****************************************************************************
+//	Page table miss. Translate the address and cache the page's host address
+//*****************************************************************************
+u8 * TLBEntry::TranslatePageToHost(u32 address, bool& missing)
+{
+	u32 physical_addr = Translate(address, missing);
+	if (physical_addr == 0)
+		return NULL;
+
+	u8 * p_host = g_pu8RamBase + (physical_addr & 0x007FFFFF);
+
+	TLBPageEntry & entry = gTLBPageTable[(address >> 12) & (TLB_PAGE_TABLE_SIZE-1)];
+	entry.VPage = address >> 12;
+	entry.pHost = p_host - (address & 0xFFF);
+
+	return p_host;
+}
@@ -43,6 +43,49 @@ public:
 	void UpdateValue(u32 _pagemask, u32 _hi, u32 _pfne, u32 _pfno);
 	void Reset();
 	static u32 Translate(u32 address, bool& missing);
+	static inline u8 * TranslateToHost(u32 address, bool& missing);
+
+private:
+	static u8 * TranslatePageToHost(u32 address, bool& missing);
+	void InvalidatePages() const;
 };
 
 ALIGNED_EXTERN(TLBEntry, g_TLBs[32], CACHE_ALIGN);
+
+//
+//	Direct-mapped cache of 4KB virtual page -> host pointer translations for
+//	mapped memory. It's filled in lazily as pages are translated, and entries
+//	are invalidated whenever the TLB entry covering them is written.
+//	Anything that changes the current ASID must call TLB_InvalidatePageTable.
+//
+struct TLBPageEntry
+{
+	u32		VPage;			// Virtual address >> 12, or ~0 if invalid
+	u8 *	pHost;			// Host address of the start of the page
+};
+
+#ifdef DAEDALUS_PSP
+#define TLB_PAGE_TABLE_BITS		10
+#else
+#define TLB_PAGE_TABLE_BITS		12
+#endif
+#define TLB_PAGE_TABLE_SIZE		(1 << TLB_PAGE_TABLE_BITS)
+
+ALIGNED_EXTERN(TLBPageEntry, gTLBPageTable[TLB_PAGE_TABLE_SIZE], CACHE_ALIGN);
+
+void TLB_InvalidatePageTable();
+
+//*****************************************************************************
+//	Returns NULL if the address can't be translated, with missing set as for
+//	Translate() (i.e. a refill rather than an invalid exception is needed)
+//*****************************************************************************
+inline u8 * TLBEntry::TranslateToHost(u32 address, bool& missing)
+{
+	const TLBPageEntry & entry = gTLBPageTable[(address >> 12) & (TLB_PAGE_TABLE_SIZE-1)];
+	if (entry.VPage == (address >> 12))
+	{
+		return entry.pHost + (address & 0xFFF);
+	}
+
+	return TranslatePageToHost(address, missing);
+}
@@ -27,7 +27,8 @@
 
 // Ideas for the ignored assert taken from Game Programming Gems I
 
-#if defined(__clang__) && __has_feature(cxx_static_assert)
+// The typedef fallback trips -Wunused-local-typedefs at function scope, so use static_assert wherever it exists
+#if (defined(__clang__) && __has_feature(cxx_static_assert)) || __cplusplus >= 201103L
 
 #define DAEDALUS_STATIC_ASSERT( x ) static_assert((x), "Static Assert")
 
@@ -46,9 +46,12 @@ class CCodeGenerator
 	public:
 		typedef void (*ExceptionHandlerFn)();
 
-									CCodeGenerator() {}
+									CCodeGenerator() : mpIndirectExitMap( NULL ) {}
 		virtual						~CCodeGenerator() {}
 
+		// The map of the fragment being generated, if it has one. Backends can keep inline caches in it.
+		void						SetIndirectExitMap( CIndirectExitMap * p_map )	{ mpIndirectExitMap = p_map; }
+
 		virtual void				Initialise( u32 entry_address, u32 exit_address, u32 * hit_counter, const void * p_base, const SRegisterUsageInfo & register_usage ) = 0;
 		virtual void				Finalise( ExceptionHandlerFn p_exception_handler_fn, const std::vector< CJumpLocation > & exception_handler_jumps ) = 0;
 
@@ -63,12 +66,15 @@ class CCodeGenerator
 
 		virtual	CJumpLocation		GenerateExitCode( u32 exit_address, u32 jump_address, u32 num_instructions, CCodeLabel next_fragment ) = 0;
 		virtual void				GenerateEretExitCode( u32 num_instructions, CIndirectExitMap * p_map ) = 0;
-		virtual void				GenerateIndirectExitCode( u32 num_instructions, CIndirectExitMap * p_map ) = 0;
+		virtual void				GenerateIndirectExitCode( u32 num_instructions, CIndirectExitMap * p_map, bool is_return ) = 0;
 
 		virtual void				GenerateBranchHandler( CJumpLocation branch_handler_jump, RegisterSnapshotHandle snapshot ) = 0;
 
 		virtual CJumpLocation		GenerateOpCode(const STraceEntry& ti, bool branch_delay_slot, const SBranchDetails * p_branch, CJumpLocation * p_branch_jump) = 0;
 		virtual CJumpLocation		ExecuteNativeFunction( CCodeLabel speed_hack, bool check_return = false ) = 0;
+
+	protected:
+		CIndirectExitMap *			mpIndirectExitMap;
 };
 
 extern "C"
@@ -88,7 +88,13 @@ CFragment::CFragment( CCodeBufferManager * p_manager,
 ,	mInputLength( trace.size() * sizeof( OpCode ) )
 ,	mOutputLength( 0 )
 ,	mFragmentFunctionLength( 0 )
+#ifdef DAEDALUS_PSP
 ,	mpIndirectExitMap( need_indirect_exit_map ? new CIndirectExitMap : NULL )
+#else
+	// Backends can keep the return address caches for JAL sites here too
+,	mpIndirectExitMap( new CIndirectExitMap )
+#endif
+,	mLastUsed( 0 )
 #ifdef FRAGMENT_RETAIN_ADDITIONAL_INFO
 ,	mHitCount( 0 )
 ,	mTraceBuffer( trace )
@@ -103,6 +109,8 @@ CFragment::CFragment( CCodeBufferManager * p_manager,
 	mRegisterUsage = register_usage;
 #endif
 
+	CollectCodePages( trace );
+
 	Assemble( p_manager, exit_address, trace, branch_details, register_usage );
 }
 
@@ -117,6 +125,7 @@ CFragment::CFragment(CCodeBufferManager * p_manager, u32 entry_address,
 	,	mOutputLength( 0 )
 	,	mFragmentFunctionLength( 0 )
 	,	mpIndirectExitMap( new CIndirectExitMap )
+	,	mLastUsed( 0 )
 #ifdef FRAGMENT_RETAIN_ADDITIONAL_INFO
 	,	mHitCount( 0 )
 	,	mTraceBuffer( NULL )
@@ -508,7 +517,19 @@ u32	CFragment::GetMemoryUsage() const
 	// Ignore the 'additional info' when computing this
 
 	return sizeof( CFragment ) +
-		   mPatchList.size() * sizeof( SFragmentPatchDetails );
+		   mPatchList.size() * sizeof( SFragmentPatchDetails ) +
+		   mCodePages.size() * sizeof( u32 );
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void	CFragment::ResetIndirectExitCaches()
+{
+	if( mpIndirectExitMap != NULL )
+	{
+		mpIndirectExitMap->ResetCaches();
+	}
 }
 
 //*************************************************************************************
@@ -531,6 +552,25 @@ namespace
 	};
 }
 
+//*************************************************************************************
+//	Traces can branch all over memory, so record every page an op came from
+//	rather than assuming the trace is contiguous
+//*************************************************************************************
+void	CFragment::CollectCodePages( const std::vector< STraceEntry > & trace )
+{
+	for( u32 i = 0; i < trace.size(); ++i )
+	{
+		u32		page;
+		if( CFragmentPageIndex::AddressToPage( trace[ i ].Address, &page ) )
+		{
+			mCodePages.push_back( page );
+		}
+	}
+
+	std::sort( mCodePages.begin(), mCodePages.end() );
+	mCodePages.erase( std::unique( mCodePages.begin(), mCodePages.end() ), mCodePages.end() );
+}
+
 //*************************************************************************************
 //
 //*************************************************************************************
@@ -564,6 +604,7 @@ void CFragment::Assemble( CCodeBufferManager * p_manager,
 	CCodeGenerator *		p_generator( p_manager->StartNewBlock() );
 
 	mEntryPoint = p_generator->GetEntryPoint();
+	p_generator->SetIndirectExitMap( mpIndirectExitMap );
 
 #ifdef FRAGMENT_RETAIN_ADDITIONAL_INFO
 	p_generator->Initialise( mEntryAddress, exit_address, &mHitCount, &gCPUState, register_usage );
@@ -703,6 +744,13 @@ void CFragment::Assemble( CCodeBufferManager * p_manager,
 		mInstructionStartLocations.push_back( p_generator->GetCurrentLocation().GetTargetU8P() );
 #endif
 
+	// Only reached when the branch closing an idle loop is taken. Unlike the interpreter,
+	// the load addresses are only checked when the trace is recorded.
+	if( !branch_details.empty() && branch_details.back().SpeedHack == SHACK_IDLELOOP && exit_address == mEntryAddress )
+	{
+		p_generator->ExecuteNativeFunction( CCodeLabel( reinterpret_cast< const void * >( CPU_SkipToNextEvent ) ) );
+	}
+
 	CCodeLabel		no_next_fragment( NULL );
 	CJumpLocation	exit_jump( p_generator->GenerateExitCode( exit_address, NO_JUMP_ADDRESS, trace.size(), no_next_fragment ) );
 
@@ -801,7 +849,10 @@ void CFragment::Assemble( CCodeBufferManager * p_manager,
 			}
 			else
 			{
-				p_generator->GenerateIndirectExitCode( num_instructions_executed, mpIndirectExitMap );
+				OpCode	op_code( trace[ instruction_idx ].OpCode );
+				bool	is_return( op_code.op == OP_SPECOP && op_code.spec_op == SpecOp_JR && op_code.rs == N64Reg_RA );
+
+				p_generator->GenerateIndirectExitCode( num_instructions_executed, mpIndirectExitMap, is_return );
 			}
 		}
 	}
@@ -825,6 +876,7 @@ void CFragment::Assemble( CCodeBufferManager * p_manager, CCodeLabel function_pt
 
 	CCodeGenerator *p_generator = p_manager->StartNewBlock();
 	mEntryPoint = p_generator->GetEntryPoint();
+	p_generator->SetIndirectExitMap( mpIndirectExitMap );
 
 
 #ifdef FRAGMENT_RETAIN_ADDITIONAL_INFO
@@ -834,7 +886,7 @@ void CFragment::Assemble( CCodeBufferManager * p_manager, CCodeLabel function_pt
 #endif
 
 	CJumpLocation jump = p_generator->ExecuteNativeFunction(function_ptr, true);
-	p_generator->GenerateIndirectExitCode(100, mpIndirectExitMap);
+	p_generator->GenerateIndirectExitCode(100, mpIndirectExitMap, false);
 	AssemblyUtils::PatchJumpLong(jump, p_generator->GetCurrentLocation());
 	p_generator->GenerateEretExitCode(100, mpIndirectExitMap);
 
@@ -930,6 +982,22 @@ void DisassembleBuffer( const u8 * buf, int buf_size, FILE * fh )
 	}
 }
 
+#else
+
+// No disassembler for this target, just dump the bytes
+void DisassembleBuffer( const u8 * buf, int buf_size, FILE * fh )
+{
+	for( int pos = 0; pos < buf_size; pos += 16 )
+	{
+		fprintf( fh, "%p:", buf + pos );
+		for( int i = pos; i < pos + 16 && i < buf_size; ++i )
+		{
+			fprintf( fh, " %02x", buf[i] );
+		}
+		fprintf( fh, "\n" );
+	}
+}
+
 #endif
 
 #endif // defined( DAEDALUS_DEBUG_DYNAREC )
@@ -87,8 +87,18 @@ public:
 
 		void		SetCache( const CFragmentCache * p_cache );
 
+		// The patch list is kept for the lifetime of the fragment, so the cache can unlink its exits if it's invalidated
 		const FragmentPatchList &	GetPatchList() const		{ return mPatchList; }
-		void		DiscardPatchList()							{ mPatchList.clear(); }
+
+		// Sorted list of the 4KB RDRAM pages the trace was recorded from (empty for OS hooks)
+		const std::vector< u32 > &	GetCodePages() const		{ return mCodePages; }
+
+		// Must be called when any other fragment is deleted, as the caches may point to it
+		void		ResetIndirectExitCaches();
+
+		// The fragment cache's generation when this was last entered (see CFragmentCache::EvictColdFragments)
+		u32			GetLastUsed() const							{ return mLastUsed; }
+		void		SetLastUsed( u32 generation )				{ mLastUsed = generation; }
 
 #ifdef FRAGMENT_RETAIN_ADDITIONAL_INFO
 		u32			GetHitCount() const							{ return mHitCount; }
@@ -102,6 +112,7 @@ private:
 		void		Assemble( CCodeBufferManager * p_manager, u32 exit_address, const std::vector< STraceEntry > & trace, const std::vector<SBranchDetails> & branch_details, const SRegisterUsageInfo & register_usage );
 
 		void		AddPatch( u32 address, CJumpLocation jump_location );
+		void		CollectCodePages( const std::vector< STraceEntry > & trace );
 
 #ifdef FRAGMENT_SIMULATE_EXECUTION
 		CFragment *	Simulate();
@@ -111,6 +122,7 @@ private:
 		u32								mEntryAddress;
 
 		std::vector< SFragmentPatchDetails >	mPatchList;
+		std::vector< u32 >						mCodePages;
 
 		CCodeLabel						mEntryPoint;
 		u32								mInputLength;
@@ -119,6 +131,8 @@ private:
 
 		CIndirectExitMap *				mpIndirectExitMap;
 
+		u32								mLastUsed;
+
 #ifdef FRAGMENT_RETAIN_ADDITIONAL_INFO
 		u32								mHitCount;
 		TraceBuffer						mTraceBuffer;
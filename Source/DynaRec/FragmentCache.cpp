@@ -26,12 +26,15 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "Fragment.h"
 #include "CodeBufferManager.h"
+#include "IndirectExitMap.h"
 #include "DynaRecProfile.h"
 
 #include "Debug/DBGConsole.h"
+#include "Debug/DebugLog.h"
 
-#include "Utility/Profiler.h"
 #include "Utility/IO.h"
+#include "Utility/Macros.h"
+#include "Utility/Profiler.h"
 
 #include "AssemblyUtils.h"
 
@@ -48,6 +51,9 @@ CFragmentCache::CFragmentCache()
 :	mMemoryUsage( 0 )
 ,	mInputLength( 0 )
 ,	mOutputLength( 0 )
+,	mRetiredCount( 0 )
+,	mRetiredOutputLength( 0 )
+,	mGeneration( 0 )
 ,	mCachedFragmentAddress( 0 )
 ,	mpCachedFragment( NULL )
 {
@@ -103,11 +109,11 @@ CFragment * CFragmentCache::LookupFragment( u32 address ) const
 
 			// put in hash table
 			mpCacheHashTable[ix].addr = address;
-			mpCacheHashTable[ix].ptr = reinterpret_cast< u32 >( mpCachedFragment );
+			mpCacheHashTable[ix].ptr = mpCachedFragment;
 		}
 		else
 		{
-			mpCachedFragment = reinterpret_cast< CFragment * >( mpCacheHashTable[ix].ptr );
+			mpCachedFragment = mpCacheHashTable[ix].ptr;
 		}
 	}
 
@@ -152,14 +158,14 @@ CFragment * CFragmentCache::LookupFragmentQ( u32 address ) const
 
 			// put in hash table
 			mpCacheHashTable[ix].addr = address;
-			mpCacheHashTable[ix].ptr = reinterpret_cast< u32 >( mpCachedFragment );
+			mpCacheHashTable[ix].ptr = mpCachedFragment;
 		}
 		else
 		{
 #ifdef HASH_TABLE_STATS
 			hit++;
 #endif
-			mpCachedFragment = reinterpret_cast< CFragment * >( mpCacheHashTable[ix].ptr );
+			mpCachedFragment = mpCacheHashTable[ix].ptr;
 		}
 
 #ifdef HASH_TABLE_STATS
@@ -181,7 +187,7 @@ void CFragmentCache::InsertFragment( CFragment * p_fragment )
 {
 	u32		fragment_address( p_fragment->GetEntryAddress() );
 
-	mCacheCoverage.ExtendCoverage( fragment_address, p_fragment->GetInputLength() );
+	mPageIndex.AddFragment( p_fragment );
 
 	SFragmentEntry				entry( fragment_address, NULL );
 	FragmentVec::iterator		it( std::lower_bound( mFragments.begin(), mFragments.end(), entry ) );
@@ -192,17 +198,19 @@ void CFragmentCache::InsertFragment( CFragment * p_fragment )
 	// Update the hash table (it stores failed lookups now, so we need to be sure to purge any stale entries in there
 	u32 ix = MakeHashIdx( fragment_address );
 	mpCacheHashTable[ix].addr = fragment_address;
-	mpCacheHashTable[ix].ptr = reinterpret_cast< u32 >( p_fragment );
+	mpCacheHashTable[ix].ptr = p_fragment;
 
 	// Process any jumps for this before inserting new ones
 	JumpMap::iterator	jump_it( mJumpMap.find( fragment_address ) );
 	if( jump_it != mJumpMap.end() )
 	{
 		const JumpList &		jumps( jump_it->second );
+		JumpList &				links( mLinkMap[ fragment_address ] );
 		for( JumpList::const_iterator it = jumps.begin(); it != jumps.end(); ++it )
 		{
 			//DBGConsole_Msg( 0, "Inserting [R%08x], patching jump at %08x ", address, (*it) );
-			PatchJumpLongAndFlush( (*it), p_fragment->GetEntryTarget() );
+			PatchJumpLongAndFlush( it->Jump, p_fragment->GetEntryTarget() );
+			links.push_back( *it );
 		}
 
 		// All patched - clear
@@ -214,9 +222,12 @@ void CFragmentCache::InsertFragment( CFragment * p_fragment )
 	for( FragmentPatchList::const_iterator it = patch_list.begin(); it != patch_list.end(); ++it )
 	{
 		u32				target_address( it->Address );
-		CJumpLocation	jump( it->Jump );
+		SFragmentLink	link;
+
+		link.Jump = it->Jump;
+		link.Unlinked = GetJumpTarget( it->Jump );
 
-		DAEDALUS_ASSERT( jump.IsSet(), "No exit jump?" );
+		DAEDALUS_ASSERT( link.Jump.IsSet(), "No exit jump?" );
 
 #ifdef DAEDALUS_DEBUG_DYNAREC
 		CFragment * p_fragment( LookupFragment( target_address ) );
@@ -225,24 +236,25 @@ void CFragmentCache::InsertFragment( CFragment * p_fragment )
 #endif
 		if( p_fragment != NULL )
 		{
-			PatchJumpLongAndFlush( jump, p_fragment->GetEntryTarget() );
+			PatchJumpLongAndFlush( link.Jump, p_fragment->GetEntryTarget() );
+			mLinkMap[ target_address ].push_back( link );
 
 			DAEDALUS_ASSERT( mJumpMap.find( target_address ) == mJumpMap.end(), "Jump map still contains an entry for this" );
 		}
 		else if( target_address != u32(~0) )
 		{
 			// Store the address for later processing
-			mJumpMap[ target_address ].push_back( jump );
+			mJumpMap[ target_address ].push_back( link );
 		}
 	}
 
-	// Free memoire
-	p_fragment->DiscardPatchList();
-
 	// For simulation only
 	p_fragment->SetCache( this );
 
-	// Update memory usage etc after discarding patch list
+	// Don't let it be evicted before it's had a chance to run
+	MarkUsed( p_fragment );
+
+	// Update memory usage etc
 	mMemoryUsage += p_fragment->GetMemoryUsage();
 	mInputLength += p_fragment->GetInputLength();
 	mOutputLength += p_fragment->GetOutputLength();
@@ -286,8 +298,13 @@ void CFragmentCache::Clear()
 	mpCachedFragment = NULL;
 	memset( mpCacheHashTable, 0, sizeof(mpCacheHashTable) );
 	mJumpMap.clear();
+	mLinkMap.clear();
+	mRetiredCount = 0;
+	mRetiredOutputLength = 0;
+	mInvalidationStats.Flushes++;
 
-	mCacheCoverage.Reset();
+	mPageIndex.Reset();
+	IndirectExitMap_ResetReturnAddressStack();
 
 	mpCodeBufferManager->Reset();
 }
@@ -297,7 +314,250 @@ void CFragmentCache::Clear()
 //*************************************************************************************
 bool CFragmentCache::ShouldInvalidateOnWrite( u32 address, u32 length ) const
 {
-	return mCacheCoverage.IsCovered( address, length );
+	return mPageIndex.IsCovered( address, length );
+}
+
+//*************************************************************************************
+//	Remove a fragment's exits from whichever map they're registered in
+//*************************************************************************************
+void CFragmentCache::UnregisterExits( const CFragment * p_fragment )
+{
+	const FragmentPatchList &	patch_list( p_fragment->GetPatchList() );
+	for( FragmentPatchList::const_iterator it = patch_list.begin(); it != patch_list.end(); ++it )
+	{
+		JumpMap * maps[] = { &mJumpMap, &mLinkMap };
+
+		for( u32 m = 0; m < ARRAYSIZE( maps ); ++m )
+		{
+			JumpMap::iterator	map_it( maps[ m ]->find( it->Address ) );
+			if( map_it == maps[ m ]->end() )
+				continue;
+
+			JumpList &		jumps( map_it->second );
+			for( u32 i = 0; i < jumps.size(); ++i )
+			{
+				if( jumps[ i ].Jump.GetTargetU8P() == it->Jump.GetTargetU8P() )
+				{
+					jumps[ i ] = jumps.back();
+					jumps.pop_back();
+					break;
+				}
+			}
+
+			if( jumps.empty() )
+			{
+				maps[ m ]->erase( map_it );
+			}
+		}
+	}
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+CFragment * CFragmentCache::FindFragment( u32 address ) const
+{
+	SFragmentEntry				entry( address, NULL );
+	FragmentVec::const_iterator	it( std::lower_bound( mFragments.begin(), mFragments.end(), entry ) );
+	if( it != mFragments.end() && it->Address == address )
+	{
+		return it->Fragment;
+	}
+
+	return NULL;
+}
+
+//*************************************************************************************
+//	Remove the fragments from the cache and delete them.
+//	Any fragments that were linked to them are pointed back at their original
+//	exit code, and relinked when the code is recompiled.
+//	Must only be called when no fragment is executing.
+//	Returns the number of links that were unpatched.
+//*************************************************************************************
+u32 CFragmentCache::RemoveFragments( const std::vector< CFragment * > & fragments )
+{
+	// Remove everything first, so links between the discarded fragments are dropped rather than restored
+	for( u32 i = 0; i < fragments.size(); ++i )
+	{
+		CFragment *		p_fragment( fragments[ i ] );
+		u32				fragment_address( p_fragment->GetEntryAddress() );
+
+		mPageIndex.RemoveFragment( p_fragment );
+
+		SFragmentEntry				entry( fragment_address, NULL );
+		FragmentVec::iterator		it( std::lower_bound( mFragments.begin(), mFragments.end(), entry ) );
+		DAEDALUS_ASSERT( it != mFragments.end() && it->Fragment == p_fragment, "Fragment is not in the cache" );
+		mFragments.erase( it );
+
+		UnregisterExits( p_fragment );
+
+		// The hash table stores failed lookups, so just clear the pointer
+		u32 ix = MakeHashIdx( fragment_address );
+		if( mpCacheHashTable[ix].addr == fragment_address )
+		{
+			mpCacheHashTable[ix].ptr = NULL;
+		}
+
+		mMemoryUsage -= p_fragment->GetMemoryUsage();
+		mInputLength -= p_fragment->GetInputLength();
+		mOutputLength -= p_fragment->GetOutputLength();
+		mRetiredOutputLength += p_fragment->GetOutputLength();
+	}
+
+	mCachedFragmentAddress = 0;
+	mpCachedFragment = NULL;
+
+	// Whatever is left in the link map for these addresses comes from fragments we're keeping
+	u32		links_unpatched( 0 );
+	for( u32 i = 0; i < fragments.size(); ++i )
+	{
+		u32					fragment_address( fragments[ i ]->GetEntryAddress() );
+		JumpMap::iterator	link_it( mLinkMap.find( fragment_address ) );
+		if( link_it == mLinkMap.end() )
+			continue;
+
+		const JumpList &	links( link_it->second );
+		JumpList &			pending( mJumpMap[ fragment_address ] );
+		for( JumpList::const_iterator it = links.begin(); it != links.end(); ++it )
+		{
+			PatchJumpLongAndFlush( it->Jump, it->Unlinked );
+			pending.push_back( *it );
+		}
+		links_unpatched += links.size();
+
+		mLinkMap.erase( link_it );
+	}
+
+	for( u32 i = 0; i < fragments.size(); ++i )
+	{
+		delete fragments[ i ];
+	}
+
+	// Indirect exits don't go through the link map, so forget every cached target
+	for( FragmentVec::iterator it = mFragments.begin(); it != mFragments.end(); ++it )
+	{
+		it->Fragment->ResetIndirectExitCaches();
+	}
+	IndirectExitMap_ResetReturnAddressStack();
+
+	mRetiredCount += fragments.size();
+	mInvalidationStats.LinksUnpatched += links_unpatched;
+
+	return links_unpatched;
+}
+
+//*************************************************************************************
+//	Discard all the fragments built from code in the specified range.
+//	Must only be called when no fragment is executing.
+//	Returns the number of fragments that were discarded.
+//*************************************************************************************
+u32 CFragmentCache::InvalidateRange( u32 address, u32 length )
+{
+	DAEDALUS_PROFILE( "CFragmentCache::InvalidateRange" );
+
+	std::vector< CFragment * >	fragments;
+	u32							num_pages( mPageIndex.GetFragments( address, length, fragments ) );
+
+	if( fragments.empty() )
+		return 0;
+
+	RemoveFragments( fragments );
+
+	mInvalidationStats.Requests++;
+	mInvalidationStats.Pages += num_pages;
+	mInvalidationStats.Fragments += fragments.size();
+
+	return fragments.size();
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void CFragmentCache::MarkUsed( CFragment * p_fragment ) const
+{
+	p_fragment->SetLastUsed( mGeneration );
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+namespace
+{
+	struct SLeastRecentlyUsedSort
+	{
+		bool operator()( const CFragment * a, const CFragment * b ) const
+		{
+			return a->GetLastUsed() < b->GetLastUsed();
+		}
+	};
+}
+
+//*************************************************************************************
+//	Fragments are marked with the current generation when they're entered from
+//	the dispatcher. A fragment which is only ever reached through a link from
+//	another fragment is never marked itself, so before choosing what to evict
+//	everything reachable through links from a fragment used this generation is
+//	marked as well.
+//	Fragments with no code pages (OS hooks and TLB mapped code) are never evicted.
+//	Must only be called when no fragment is executing.
+//	Returns the number of fragments that were evicted.
+//*************************************************************************************
+u32 CFragmentCache::EvictColdFragments( u32 max_fragments )
+{
+	DAEDALUS_PROFILE( "CFragmentCache::EvictColdFragments" );
+
+	if( mFragments.size() <= max_fragments )
+		return 0;
+
+	std::vector< CFragment * >	pending;
+	for( FragmentVec::const_iterator it = mFragments.begin(); it != mFragments.end(); ++it )
+	{
+		if( it->Fragment->GetLastUsed() == mGeneration )
+		{
+			pending.push_back( it->Fragment );
+		}
+	}
+
+	while( !pending.empty() )
+	{
+		const CFragment *	p_fragment( pending.back() );
+		pending.pop_back();
+
+		const FragmentPatchList &	patch_list( p_fragment->GetPatchList() );
+		for( FragmentPatchList::const_iterator it = patch_list.begin(); it != patch_list.end(); ++it )
+		{
+			CFragment *		p_target( FindFragment( it->Address ) );
+			if( p_target != NULL && p_target->GetLastUsed() != mGeneration )
+			{
+				MarkUsed( p_target );
+				pending.push_back( p_target );
+			}
+		}
+	}
+
+	std::vector< CFragment * >	candidates;
+	candidates.reserve( mFragments.size() );
+	for( FragmentVec::const_iterator it = mFragments.begin(); it != mFragments.end(); ++it )
+	{
+		if( !it->Fragment->GetCodePages().empty() )
+		{
+			candidates.push_back( it->Fragment );
+		}
+	}
+
+	u32		num_to_evict( std::min< u32 >( mFragments.size() - max_fragments, candidates.size() ) );
+
+	std::nth_element( candidates.begin(), candidates.begin() + num_to_evict, candidates.end(), SLeastRecentlyUsedSort() );
+	candidates.resize( num_to_evict );
+
+	RemoveFragments( candidates );
+
+	mInvalidationStats.Evicted += num_to_evict;
+	mGeneration++;
+
+	DAED_LOG( DEBUG_DYNAREC_CACHE, "Evicted %d cold fragments, %d left", num_to_evict, mFragments.size() );
+
+	return num_to_evict;
 }
 
 #ifdef DAEDALUS_DEBUG_DYNAREC
@@ -397,44 +657,105 @@ void CFragmentCache::DumpStats( const char * outputdir ) const
 #endif // DAEDALUS_DEBUG_DYNAREC
 
 
+//*************************************************************************************
+//	Only RDRAM accessed through KSEG0/KSEG1 is tracked
+//*************************************************************************************
+bool CFragmentPageIndex::AddressToPage( u32 address, u32 * p_page )
+{
+	if( (address >> 30) != 2 )
+		return false;
+
+	u32 page( (address & 0x1FFFFFFF) >> PAGE_SHIFT );
+	if( page >= NUM_PAGES )
+		return false;
+
+	*p_page = page;
+	return true;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+bool CFragmentPageIndex::GetPageRange( u32 address, u32 len, u32 * p_first, u32 * p_last )
+{
+	if( len == 0 || !AddressToPage( address, p_first ) )
+		return false;
+
+	u32 last( ((address & 0x1FFFFFFF) + len - 1) >> PAGE_SHIFT );
+	*p_last = last < NUM_PAGES ? last : NUM_PAGES - 1;
+	return true;
+}
+
 //*************************************************************************************
 //
 //*************************************************************************************
-#define AddressToIndex( addr ) ((addr - BASE_ADDRESS) >> MEM_USAGE_SHIFT)
+void CFragmentPageIndex::AddFragment( CFragment * p_fragment )
+{
+	const std::vector< u32 > &	pages( p_fragment->GetCodePages() );
+
+	for( u32 i = 0; i < pages.size(); ++i )
+	{
+		mPages[ pages[ i ] ].push_back( p_fragment );
+	}
+}
 
 //*************************************************************************************
 //
 //*************************************************************************************
-void CFragmentCacheCoverage::ExtendCoverage( u32 address, u32 len )
+void CFragmentPageIndex::RemoveFragment( CFragment * p_fragment )
 {
-	u32 first_entry( AddressToIndex( address ) );
-	u32 last_entry( AddressToIndex( address + len ) );
+	const std::vector< u32 > &	pages( p_fragment->GetCodePages() );
 
-	// Mark all entries as true
-	for( u32 i = first_entry; i <= last_entry && i < NUM_MEM_USAGE_ENTRIES; ++i )
+	for( u32 i = 0; i < pages.size(); ++i )
 	{
-		mCacheCoverage[ i ] = true;
+		FragmentList &			fragments( mPages[ pages[ i ] ] );
+		FragmentList::iterator	it( std::find( fragments.begin(), fragments.end(), p_fragment ) );
+
+		DAEDALUS_ASSERT( it != fragments.end(), "Fragment is missing from the page index" );
+		*it = fragments.back();
+		fragments.pop_back();
 	}
 }
 
 //*************************************************************************************
 //
 //*************************************************************************************
-bool CFragmentCacheCoverage::IsCovered( u32 address, u32 len ) const
+u32 CFragmentPageIndex::GetFragments( u32 address, u32 len, std::vector< CFragment * > & fragments ) const
 {
-	if((address - BASE_ADDRESS) == 0)
+	u32 first_page;
+	u32 last_page;
+
+	if( !GetPageRange( address, len, &first_page, &last_page ) )
+		return 0;
+
+	size_t	first_new( fragments.size() );
+
+	for( u32 i = first_page; i <= last_page; ++i )
 	{
-		DBGConsole_Msg( 0, "Cache coverage address is overlapping" );
-		return true;
+		fragments.insert( fragments.end(), mPages[ i ].begin(), mPages[ i ].end() );
 	}
 
-	u32 first_entry( AddressToIndex( address ) );
-	u32 last_entry( AddressToIndex( address + len ) );
+	// Fragments which span several pages will be listed more than once
+	std::sort( fragments.begin() + first_new, fragments.end() );
+	fragments.erase( std::unique( fragments.begin() + first_new, fragments.end() ), fragments.end() );
 
-	// Mark all entries as true
-	for( u32 i = first_entry; i <= last_entry && i < NUM_MEM_USAGE_ENTRIES; ++i )
+	return last_page - first_page + 1;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+bool CFragmentPageIndex::IsCovered( u32 address, u32 len ) const
+{
+	u32 first_page;
+	u32 last_page;
+
+	if( !GetPageRange( address, len, &first_page, &last_page ) )
+		return false;
+
+	for( u32 i = first_page; i <= last_page; ++i )
 	{
-		if( mCacheCoverage[ i ] )
+		if( !mPages[ i ].empty() )
 			return true;
 	}
 
@@ -444,7 +765,10 @@ bool CFragmentCacheCoverage::IsCovered( u32 address, u32 len ) const
 //*************************************************************************************
 //
 //*************************************************************************************
-void CFragmentCacheCoverage::Reset( )
+void CFragmentPageIndex::Reset()
 {
-	memset( mCacheCoverage, 0, sizeof( mCacheCoverage ) );
+	for( u32 i = 0; i < NUM_PAGES; ++i )
+	{
+		mPages[ i ].clear();
+	}
 }
@@ -22,8 +22,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "Utility/DaedalusTypes.h"
 
+#include "AssemblyUtils.h"
+
 class	CFragment;
-class	CJumpLocation;
 class	CCodeBufferManager;
 
 #include <map>
@@ -31,34 +32,58 @@ class	CCodeBufferManager;
 
 struct FHashT
 {
-	u32	addr;
-	u32 ptr;
+	u32			addr;
+	CFragment *	ptr;
 };
 
 //*************************************************************************************
-//
+//	Records which fragments were compiled from each 4KB page of RDRAM, so a
+//	write or DMA only has to throw away the fragments built from the pages it
+//	touched. Pages are physical, so KSEG0 and KSEG1 views of the same code
+//	share an entry. Code outside RDRAM (or TLB mapped) isn't tracked.
 //*************************************************************************************
-class CFragmentCacheCoverage
+class CFragmentPageIndex
 {
 public:
-	CFragmentCacheCoverage() { Reset(); }
+	CFragmentPageIndex() {}
+
+	void			AddFragment( CFragment * p_fragment );
+	void			RemoveFragment( CFragment * p_fragment );
 
-	void			ExtendCoverage( u32 address, u32 len );
+	// Appends each fragment built from [address, address+len) exactly once. Returns the number of pages checked
+	u32				GetFragments( u32 address, u32 len, std::vector< CFragment * > & fragments ) const;
 	bool			IsCovered( u32 address, u32 len ) const;
 
 	void			Reset();
 
-private:
-	static u32		AddressToIndex( u32 address );
+	static bool		AddressToPage( u32 address, u32 * p_page );
+	static bool		GetPageRange( u32 address, u32 len, u32 * p_first, u32 * p_last );
 
 private:
-	static const u32 BASE_ADDRESS = 0x80000000;
-
 	static const u32 MEMORY_8_MEG = 8*1024*1024;
-	static const u32 MEM_USAGE_SHIFT = 12;		// 4k
-	static const u32 NUM_MEM_USAGE_ENTRIES = MEMORY_8_MEG >> MEM_USAGE_SHIFT;
+	static const u32 PAGE_SHIFT = 12;		// 4k
+	static const u32 NUM_PAGES = MEMORY_8_MEG >> PAGE_SHIFT;
 
-	bool			mCacheCoverage[ NUM_MEM_USAGE_ENTRIES ];
+	typedef std::vector< CFragment * >	FragmentList;
+	FragmentList	mPages[ NUM_PAGES ];
+};
+
+//*************************************************************************************
+//	Counters for CFragmentCache::InvalidateRange, reset by the caller
+//	(once per frame)
+//*************************************************************************************
+struct SFragmentInvalidationStats
+{
+	SFragmentInvalidationStats() { Reset(); }
+
+	void			Reset()		{ Requests = 0; Pages = 0; Fragments = 0; LinksUnpatched = 0; Evicted = 0; Flushes = 0; }
+
+	u32				Requests;			// Calls to InvalidateRange which hit at least one fragment
+	u32				Pages;				// 4KB pages written to by those calls
+	u32				Fragments;			// Fragments discarded
+	u32				LinksUnpatched;		// Jumps from surviving fragments which were unlinked (including for evictions)
+	u32				Evicted;			// Cold fragments discarded by EvictColdFragments
+	u32				Flushes;			// Calls to Clear
 };
 
 //*************************************************************************************
@@ -88,6 +113,20 @@ public:
 	CCodeBufferManager *	GetCodeBufferManager() const			{ return mpCodeBufferManager; }
 
 	bool					ShouldInvalidateOnWrite( u32 address, u32 length ) const;
+	u32						InvalidateRange( u32 address, u32 length );
+
+	// Invalidated and evicted fragments leave their code behind in the code buffer until the next Clear
+	u32						GetRetiredCount() const					{ return mRetiredCount; }
+	u32						GetCodeSize() const						{ return mOutputLength + mRetiredOutputLength; }
+
+	// Called whenever a fragment is entered from outside the cache
+	void					MarkUsed( CFragment * p_fragment ) const;
+
+	// Discard the least recently used fragments until there are no more than max_fragments left
+	u32						EvictColdFragments( u32 max_fragments );
+
+	const SFragmentInvalidationStats &	GetInvalidationStats() const	{ return mInvalidationStats; }
+	void					ResetInvalidationStats()				{ mInvalidationStats.Reset(); }
 
 private:
 	struct SFragmentEntry
@@ -114,9 +153,26 @@ private:
 	u32						mInputLength;
 	u32						mOutputLength;
 
-	typedef std::vector< CJumpLocation >	JumpList;
+	CFragment *				FindFragment( u32 address ) const;
+	void					UnregisterExits( const CFragment * p_fragment );
+	u32						RemoveFragments( const std::vector< CFragment * > & fragments );
+
+	// An exit jump, along with the exit handler it jumped to before it was linked
+	struct SFragmentLink
+	{
+		CJumpLocation		Jump;
+		CCodeLabel			Unlinked;
+	};
+
+	typedef std::vector< SFragmentLink >	JumpList;
 	typedef std::map< u32, JumpList >		JumpMap;
-	JumpMap					mJumpMap;
+	JumpMap					mJumpMap;			// Exits waiting for a fragment at the target address
+	JumpMap					mLinkMap;			// Exits which have been patched to jump to the fragment at the target address
+
+	u32						mRetiredCount;
+	u32						mRetiredOutputLength;
+	u32						mGeneration;		// Bumped by each EvictColdFragments
+	SFragmentInvalidationStats	mInvalidationStats;
 
 	mutable u32				mCachedFragmentAddress;
 	mutable CFragment *		mpCachedFragment;
@@ -132,7 +188,7 @@ private:
 
 	CCodeBufferManager *	mpCodeBufferManager;
 
-	CFragmentCacheCoverage	mCacheCoverage;
+	CFragmentPageIndex		mPageIndex;
 };
 
 extern CFragmentCache				gFragmentCache;
@@ -0,0 +1,166 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "HotTraceTable.h"
+
+#include <vector>
+
+const u32 CHotTraceTable::MAX_ENTRIES = CHotTraceTable::TABLE_SIZE / 2;
+
+//*************************************************************************************
+//
+//*************************************************************************************
+CHotTraceTable::CHotTraceTable()
+{
+	Clear();
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void CHotTraceTable::Clear()
+{
+	for( u32 i = 0; i < TABLE_SIZE; ++i )
+	{
+		mEntries[ i ].Address = EMPTY_ADDRESS;
+		mEntries[ i ].Count = 0;
+	}
+	mSize = 0;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+u32 CHotTraceTable::FindSlot( u32 address ) const
+{
+	u32		slot( GetHomeSlot( address ) );
+
+	while( mEntries[ slot ].Address != address && mEntries[ slot ].Address != EMPTY_ADDRESS )
+	{
+		slot = (slot + 1) & TABLE_MASK;
+	}
+
+	return slot;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+u32 CHotTraceTable::Increment( u32 address )
+{
+	SEntry &	entry( mEntries[ FindSlot( address ) ] );
+
+	if( entry.Address == EMPTY_ADDRESS )
+	{
+		DAEDALUS_ASSERT( mSize < MAX_ENTRIES, "Hot trace table is too full" );
+		entry.Address = address;
+		entry.Count = 0;
+		mSize++;
+	}
+
+	return ++entry.Count;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void CHotTraceTable::Set( u32 address, u32 count )
+{
+	SEntry &	entry( mEntries[ FindSlot( address ) ] );
+
+	if( entry.Address == EMPTY_ADDRESS )
+	{
+		DAEDALUS_ASSERT( mSize < MAX_ENTRIES, "Hot trace table is too full" );
+		entry.Address = address;
+		mSize++;
+	}
+
+	entry.Count = count;
+}
+
+//*************************************************************************************
+//	Any entries after the hole which can no longer be reached from their home
+//	slot are moved back into it, so lookups never need tombstones.
+//*************************************************************************************
+void CHotTraceTable::Erase( u32 address )
+{
+	u32		hole( FindSlot( address ) );
+
+	if( mEntries[ hole ].Address == EMPTY_ADDRESS )
+		return;
+
+	u32		slot( hole );
+	while( true )
+	{
+		slot = (slot + 1) & TABLE_MASK;
+
+		if( mEntries[ slot ].Address == EMPTY_ADDRESS )
+			break;
+
+		// Can move if the hole is between the entry's home slot and where it is now
+		u32		home( GetHomeSlot( mEntries[ slot ].Address ) );
+		if( ((slot - home) & TABLE_MASK) >= ((slot - hole) & TABLE_MASK) )
+		{
+			mEntries[ hole ] = mEntries[ slot ];
+			hole = slot;
+		}
+	}
+
+	mEntries[ hole ].Address = EMPTY_ADDRESS;
+	mEntries[ hole ].Count = 0;
+	mSize--;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void CHotTraceTable::EraseRange( u32 address, u32 length )
+{
+	// Erasing moves entries around, so find them all first
+	std::vector< u32 >	addresses;
+
+	for( u32 i = 0; i < TABLE_SIZE; ++i )
+	{
+		u32		entry_address( mEntries[ i ].Address );
+
+		if( entry_address != EMPTY_ADDRESS && entry_address - address < length )
+		{
+			addresses.push_back( entry_address );
+		}
+	}
+
+	for( u32 i = 0; i < addresses.size(); ++i )
+	{
+		Erase( addresses[ i ] );
+	}
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+bool CHotTraceTable::GetEntry( u32 idx, u32 * p_address, u32 * p_count ) const
+{
+	if( mEntries[ idx ].Address == EMPTY_ADDRESS )
+		return false;
+
+	*p_address = mEntries[ idx ].Address;
+	*p_count = mEntries[ idx ].Count;
+	return true;
+}
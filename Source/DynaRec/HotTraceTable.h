@@ -0,0 +1,74 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef DYNAREC_HOTTRACETABLE_H_
+#define DYNAREC_HOTTRACETABLE_H_
+
+//
+//	Counts how many times each address has been branched to without a
+//	fragment, to spot the start of hot traces. This is looked up every time
+//	the interpreter takes a branch, so it's a fixed size open addressed
+//	table (linear probing, with backward shift deletion) rather than a map.
+//
+//	Callers have to keep it no more than half full (by calling Clear) so the
+//	probe sequences stay short.
+//
+
+class CHotTraceTable
+{
+public:
+	CHotTraceTable();
+
+	u32				Increment( u32 address );				// Returns the new count
+	void			Set( u32 address, u32 count );
+	void			Erase( u32 address );
+	void			EraseRange( u32 address, u32 length );	// Removes [address, address+length)
+	void			Clear();
+
+	u32				GetSize() const							{ return mSize; }
+
+	// For walking over the table (debug dumps etc)
+	static u32		GetCapacity()							{ return TABLE_SIZE; }
+	bool			GetEntry( u32 idx, u32 * p_address, u32 * p_count ) const;
+
+	static const u32	MAX_ENTRIES;
+
+private:
+	u32				FindSlot( u32 address ) const;			// Slot holding address, or the free slot it would go in
+	static u32		GetHomeSlot( u32 address )				{ return ((address >> 2) * 2654435761U) >> (32 - TABLE_BITS); }
+
+private:
+	static const u32	TABLE_BITS = 13;
+	static const u32	TABLE_SIZE = 1 << TABLE_BITS;
+	static const u32	TABLE_MASK = TABLE_SIZE - 1;
+	static const u32	EMPTY_ADDRESS = u32( ~0 );				// Never a valid (aligned) PC
+
+	struct SEntry
+	{
+		u32			Address;
+		u32			Count;
+	};
+
+	SEntry			mEntries[ TABLE_SIZE ];
+	u32				mSize;
+};
+
+#endif // DYNAREC_HOTTRACETABLE_H_
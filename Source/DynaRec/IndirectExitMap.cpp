@@ -26,6 +26,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "Debug/DBGConsole.h"
 
+SReturnAddressStack		gReturnAddressStack;
+SIndirectExitStats		gIndirectExitStats;
+
 //*************************************************************************************
 //
 //*************************************************************************************
@@ -39,6 +42,71 @@ CIndirectExitMap::CIndirectExitMap()
 //*************************************************************************************
 CIndirectExitMap::~CIndirectExitMap()
 {
+	for( u32 i = 0; i < mExitCaches.size(); ++i )
+	{
+		delete mExitCaches[ i ];
+	}
+
+	for( u32 i = 0; i < mReturnCaches.size(); ++i )
+	{
+		delete mReturnCaches[ i ];
+	}
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+SIndirectExitCache * CIndirectExitMap::AddExitCache()
+{
+	SIndirectExitCache *	p_cache( new SIndirectExitCache );
+	p_cache->TargetPC = INVALID_TARGET_PC;
+	p_cache->Target = NULL;
+
+	mExitCaches.push_back( p_cache );
+	return p_cache;
+}
+
+//*************************************************************************************
+//	The address never changes, the target is filled in by the first return to it
+//*************************************************************************************
+SIndirectExitCache * CIndirectExitMap::AddReturnCache( u32 return_address )
+{
+	SIndirectExitCache *	p_cache( new SIndirectExitCache );
+	p_cache->TargetPC = return_address;
+	p_cache->Target = NULL;
+
+	mReturnCaches.push_back( p_cache );
+	return p_cache;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void CIndirectExitMap::ResetCaches()
+{
+	for( u32 i = 0; i < mExitCaches.size(); ++i )
+	{
+		mExitCaches[ i ]->TargetPC = INVALID_TARGET_PC;
+		mExitCaches[ i ]->Target = NULL;
+	}
+
+	for( u32 i = 0; i < mReturnCaches.size(); ++i )
+	{
+		mReturnCaches[ i ]->Target = NULL;
+	}
+}
+
+//*************************************************************************************
+//	The entries may point at caches belonging to fragments which are about to go
+//*************************************************************************************
+void IndirectExitMap_ResetReturnAddressStack()
+{
+	gReturnAddressStack.Top = 0;
+
+	for( u32 i = 0; i < SReturnAddressStack::NUM_ENTRIES; ++i )
+	{
+		gReturnAddressStack.Entries[ i ] = NULL;
+	}
 }
 
 //*************************************************************************************
@@ -62,13 +130,33 @@ extern "C"
 
 const void *	R4300_CALL_TYPE IndirectExitMap_Lookup( CIndirectExitMap * p_map, u32 exit_address )
 {
+	gIndirectExitStats.Lookups++;
+
 	CFragment *	p_fragment( p_map->LookupIndirectExit( exit_address ) );
 	if( p_fragment != NULL )
 	{
 		return p_fragment->GetEntryTarget().GetTarget();
 	}
 
+	gIndirectExitStats.Failures++;
 	return NULL;
 }
 
+const void *	R4300_CALL_TYPE IndirectExitMap_LookupAndCache( CIndirectExitMap * p_map, u32 exit_address, SIndirectExitCache * p_return_cache, SIndirectExitCache * p_exit_cache )
+{
+	const void *	p_target( IndirectExitMap_Lookup( p_map, exit_address ) );
+	if( p_target != NULL )
+	{
+		p_exit_cache->TargetPC = exit_address;
+		p_exit_cache->Target = p_target;
+
+		if( p_return_cache != NULL && p_return_cache->TargetPC == exit_address )
+		{
+			p_return_cache->Target = p_target;
+		}
+	}
+
+	return p_target;
+}
+
 }
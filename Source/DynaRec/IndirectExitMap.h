@@ -20,11 +20,51 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #ifndef DYNAREC_INDIRECTEXITMAP_H_
 #define DYNAREC_INDIRECTEXITMAP_H_
 
+#include <vector>
+
 #include "Utility/DaedalusTypes.h"
 
 class CFragment;
 class CFragmentCache;
 
+//
+//	Backends can avoid calling IndirectExitMap_Lookup for most indirect exits:
+//
+//	Each exit site gets an inline cache, which remembers the last target it
+//	jumped to. The generated code compares gCPUState.TargetPC against it and
+//	jumps straight to the fragment if it matches.
+//
+//	Returns (JR ra) usually go somewhere different each time, so each JAL also
+//	gets a cache for its return address, which it pushes on the return address
+//	stack. A return pops the stack and uses that cache if the address matches.
+//
+//	The caches point into other fragments, so they're all reset whenever any
+//	fragment is thrown away.
+//
+struct SIndirectExitCache
+{
+	u32						TargetPC;			// INVALID_TARGET_PC if empty
+	const void *			Target;
+};
+
+struct SReturnAddressStack
+{
+	static const u32		NUM_ENTRIES = 16;	// Must be a power of 2
+
+	u32						Top;
+	SIndirectExitCache *	Entries[ NUM_ENTRIES ];
+};
+
+struct SIndirectExitStats
+{
+	u32		InlineHits;			// Taken from an exit site's cache
+	u32		ReturnHits;			// Taken from the return address stack
+	u32		Lookups;			// Had to call IndirectExitMap_Lookup
+	u32		Failures;			// ...and there was no fragment
+
+	void	Reset()				{ InlineHits = ReturnHits = Lookups = Failures = 0; }
+};
+
 class CIndirectExitMap
 {
 	public:
@@ -34,13 +74,30 @@ class CIndirectExitMap
 		CFragment *				LookupIndirectExit( u32 exit_address );
 		void					SetCache( const CFragmentCache * p_cache )				{ mpCache = p_cache; }
 
+		// The caches live as long as the map (i.e. the fragment)
+		SIndirectExitCache *	AddExitCache();
+		SIndirectExitCache *	AddReturnCache( u32 return_address );
+		void					ResetCaches();
+
+		static const u32		INVALID_TARGET_PC = u32( ~0 );
+
 	private:
-		const CFragmentCache *	mpCache;
+		const CFragmentCache *				mpCache;
+		std::vector< SIndirectExitCache * >	mExitCaches;
+		std::vector< SIndirectExitCache * >	mReturnCaches;
 };
 
+extern SReturnAddressStack		gReturnAddressStack;
+extern SIndirectExitStats		gIndirectExitStats;
+
+void	IndirectExitMap_ResetReturnAddressStack();
+
 //
-//	C-stub to allow easy access from dynarec code
+//	C-stubs to allow easy access from dynarec code
 //
 extern "C" { const void *	R4300_CALL_TYPE IndirectExitMap_Lookup( CIndirectExitMap * p_map, u32 exit_address ); }
 
+// As above, but fills in the caches. p_return_cache (the entry popped from the return address stack) may be NULL
+extern "C" { const void *	R4300_CALL_TYPE IndirectExitMap_LookupAndCache( CIndirectExitMap * p_map, u32 exit_address, SIndirectExitCache * p_return_cache, SIndirectExitCache * p_exit_cache ); }
+
 #endif // DYNAREC_INDIRECTEXITMAP_H_
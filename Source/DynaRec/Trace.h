@@ -23,6 +23,13 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Core/R4300OpCode.h"
 #include "StaticAnalysis.h"
 
+// Set by TraceOptimiser::Optimise()
+enum ETraceEntryFlags
+{
+	TEF_CONSTANT_RESULT	= 1 << 0,		// The op always writes Constant to rt
+	TEF_RAM_ADDRESS		= 1 << 1,		// The load/store is always to an aligned address in KSEG0 RDRAM
+};
+
 struct STraceEntry
 {
 	u32					Address;
@@ -30,6 +37,8 @@ struct STraceEntry
 	StaticAnalysis::RegisterUsage		Usage;
 	u32					BranchIdx;
 	bool				BranchDelaySlot;
+	u32					Flags;			// ETraceEntryFlags
+	s64					Constant;
 };
 
 enum SpeedHackProbe
@@ -37,7 +46,8 @@ enum SpeedHackProbe
 	SHACK_NONE,
 	SHACK_POSSIBLE,
 	SHACK_SKIPTOEVENT,
-	SHACK_COPYREG
+	SHACK_COPYREG,
+	SHACK_IDLELOOP		// The whole trace is an idle loop (see Core/IdleLoop.cpp)
 };
 
 struct SBranchDetails
@@ -0,0 +1,358 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "TraceCache.h"
+
+#ifdef DAEDALUS_ENABLE_TRACE_CACHE
+
+#include <stdio.h>
+
+#include "Core/Memory.h"
+#include "Core/ROM.h"
+#include "Debug/DBGConsole.h"
+#include "Debug/Dump.h"
+#include "Utility/Hash.h"
+#include "Utility/IO.h"
+
+CTraceCache					gTraceCache;
+
+namespace
+{
+	const u32	MAGIC_HEADER = 0x54524331;		// 'TRC1'
+	const u32	VERSION = 1;					// Bump this whenever STraceEntry or SBranchDetails change
+	const u32	MAX_TRACE_ENTRIES = 4096;		// Anything bigger than this has come from a corrupt file
+	const u32	INVALID_IDX = u32( ~0 );
+
+	bool	ReadRamOp( u32 address, u32 * p_op )
+	{
+		if( (address >> 30) != 2 )
+			return false;
+
+		u32		physical( address & 0x1FFFFFFF );
+		if( physical + 4 > gRamSize )
+			return false;
+
+		*p_op = *reinterpret_cast< const u32 * >( g_pu8RamBase + physical );
+		return true;
+	}
+
+	void	WriteU32( FILE * fp, u32 data )
+	{
+		fwrite( &data, 1, sizeof( data ), fp );
+	}
+
+	bool	ReadU32( FILE * fp, u32 * p_data )
+	{
+		return fread( p_data, 1, sizeof( *p_data ), fp ) == sizeof( *p_data );
+	}
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+CTraceCache::CTraceCache()
+:	mNumTraces( 0 )
+,	mDirty( false )
+{
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void CTraceCache::Clear()
+{
+	mTraces.clear();
+	mNumTraces = 0;
+	mDirty = false;
+}
+
+//*************************************************************************************
+//	The ops and the addresses they were recorded from. Used to tell apart traces
+//	recorded at the same address, and to spot corrupt files.
+//*************************************************************************************
+u32 CTraceCache::HashTrace( const SRecordedTrace & trace )
+{
+	u32		hash( trace.StartAddress );
+
+	for( u32 i = 0; i < trace.TraceBuffer.size(); ++i )
+	{
+		const STraceEntry &	entry( trace.TraceBuffer[ i ] );
+		u32					data[ 2 ] = { entry.Address, entry.OpCode._u32 };
+
+		hash = murmur2_hash( data, sizeof( data ), hash );
+	}
+
+	return hash;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+bool CTraceCache::IsTraceInRam( const SRecordedTrace & trace )
+{
+	for( u32 i = 0; i < trace.TraceBuffer.size(); ++i )
+	{
+		const STraceEntry &	entry( trace.TraceBuffer[ i ] );
+		u32					op;
+
+		if( !ReadRamOp( entry.Address, &op ) || op != entry.OpCode._u32 )
+			return false;
+	}
+
+	return !trace.TraceBuffer.empty();
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void CTraceCache::AddTrace( const SRecordedTrace & trace )
+{
+	if( mNumTraces >= MAX_TRACES || !IsTraceInRam( trace ) )
+		return;
+
+	SCachedTrace	cached_trace;
+	cached_trace.Hash = HashTrace( trace );
+	cached_trace.Trace = trace;
+
+	InsertTrace( cached_trace );
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void CTraceCache::InsertTrace( const SCachedTrace & cached_trace )
+{
+	TraceList &		traces( mTraces[ cached_trace.Trace.StartAddress ] );
+
+	for( u32 i = 0; i < traces.size(); ++i )
+	{
+		if( traces[ i ].Hash == cached_trace.Hash &&
+			traces[ i ].Trace.TraceBuffer.size() == cached_trace.Trace.TraceBuffer.size() )
+		{
+			return;
+		}
+	}
+
+	if( traces.size() >= MAX_TRACES_PER_ADDRESS )
+	{
+		traces.erase( traces.begin() );
+		mNumTraces--;
+	}
+
+	traces.push_back( cached_trace );
+	mNumTraces++;
+	mDirty = true;
+}
+
+//*************************************************************************************
+//	Prefers the most recently recorded trace
+//*************************************************************************************
+bool CTraceCache::FindTrace( u32 address, SRecordedTrace & trace ) const
+{
+	TraceMap::const_iterator	it( mTraces.find( address ) );
+	if( it == mTraces.end() )
+		return false;
+
+	const TraceList &	traces( it->second );
+	for( u32 i = traces.size(); i > 0; --i )
+	{
+		if( IsTraceInRam( traces[ i-1 ].Trace ) )
+		{
+			trace = traces[ i-1 ].Trace;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void CTraceCache::Save()
+{
+	if( !mDirty )
+		return;
+
+	IO::Filename name;
+
+	Dump_GetSaveDirectory(name, g_ROM.mFileName, ".trc");
+	DBGConsole_Msg(0, "Write trace cache: %s (%d traces)", name, mNumTraces);
+
+	FILE *fp = fopen(name, "wb");
+
+	if (fp == NULL)
+		return;
+
+	WriteU32( fp, MAGIC_HEADER );
+	WriteU32( fp, VERSION );
+	WriteU32( fp, g_ROM.mRomID.CRC[0] );
+	WriteU32( fp, g_ROM.mRomID.CRC[1] );
+	WriteU32( fp, g_ROM.mRomID.CountryID );
+	WriteU32( fp, mNumTraces );
+
+	for( TraceMap::const_iterator it = mTraces.begin(); it != mTraces.end(); ++it )
+	{
+		const TraceList &	traces( it->second );
+
+		for( u32 i = 0; i < traces.size(); ++i )
+		{
+			const SRecordedTrace &	trace( traces[ i ].Trace );
+
+			WriteU32( fp, traces[ i ].Hash );
+			WriteU32( fp, trace.StartAddress );
+			WriteU32( fp, trace.ExitAddress );
+			WriteU32( fp, trace.NeedIndirectExitMap );
+			WriteU32( fp, trace.TraceBuffer.size() );
+			WriteU32( fp, trace.BranchDetails.size() );
+
+			for( u32 e = 0; e < trace.TraceBuffer.size(); ++e )
+			{
+				const STraceEntry &	entry( trace.TraceBuffer[ e ] );
+
+				WriteU32( fp, entry.Address );
+				WriteU32( fp, entry.OpCode._u32 );
+				WriteU32( fp, entry.BranchIdx );
+				WriteU32( fp, entry.BranchDelaySlot );
+			}
+
+			for( u32 b = 0; b < trace.BranchDetails.size(); ++b )
+			{
+				const SBranchDetails &	details( trace.BranchDetails[ b ] );
+
+				WriteU32( fp, details.TargetAddress );
+				WriteU32( fp, details.DelaySlotTraceIndex );
+				WriteU32( fp, details.ConditionalBranchTaken );
+				WriteU32( fp, details.Likely );
+				WriteU32( fp, details.Direct );
+				WriteU32( fp, details.Eret );
+				WriteU32( fp, details.SpeedHack );
+			}
+		}
+	}
+
+	fclose(fp);
+	mDirty = false;
+}
+
+//*************************************************************************************
+//	Anything unexpected in the file throws away the whole thing
+//*************************************************************************************
+bool CTraceCache::Load()
+{
+	Clear();
+
+	IO::Filename name;
+
+	Dump_GetSaveDirectory(name, g_ROM.mFileName, ".trc");
+	FILE *fp = fopen(name, "rb");
+
+	if (fp == NULL)
+		return false;
+
+	u32		magic, version, crc0, crc1, country_id, num_traces;
+	bool	ok( ReadU32( fp, &magic ) && magic == MAGIC_HEADER &&
+				ReadU32( fp, &version ) && version == VERSION &&
+				ReadU32( fp, &crc0 ) && crc0 == g_ROM.mRomID.CRC[0] &&
+				ReadU32( fp, &crc1 ) && crc1 == g_ROM.mRomID.CRC[1] &&
+				ReadU32( fp, &country_id ) && country_id == g_ROM.mRomID.CountryID &&
+				ReadU32( fp, &num_traces ) && num_traces <= MAX_TRACES );
+
+	for( u32 i = 0; ok && i < num_traces; ++i )
+	{
+		SCachedTrace		cached_trace;
+		SRecordedTrace &	trace( cached_trace.Trace );
+		u32					need_indirect_exit_map, num_entries, num_branches;
+
+		ok = ReadU32( fp, &cached_trace.Hash ) &&
+			 ReadU32( fp, &trace.StartAddress ) &&
+			 ReadU32( fp, &trace.ExitAddress ) &&
+			 ReadU32( fp, &need_indirect_exit_map ) &&
+			 ReadU32( fp, &num_entries ) && num_entries > 0 && num_entries <= MAX_TRACE_ENTRIES &&
+			 ReadU32( fp, &num_branches ) && num_branches <= num_entries;
+
+		trace.NeedIndirectExitMap = need_indirect_exit_map != 0;
+
+		if( ok )
+		{
+			trace.TraceBuffer.resize( num_entries );
+			trace.BranchDetails.resize( num_branches );
+		}
+
+		for( u32 e = 0; ok && e < num_entries; ++e )
+		{
+			STraceEntry &	entry( trace.TraceBuffer[ e ] );
+			u32				branch_delay_slot;
+
+			ok = ReadU32( fp, &entry.Address ) &&
+				 ReadU32( fp, &entry.OpCode._u32 ) &&
+				 ReadU32( fp, &entry.BranchIdx ) && (entry.BranchIdx < num_branches || entry.BranchIdx == INVALID_IDX) &&
+				 ReadU32( fp, &branch_delay_slot );
+
+			entry.BranchDelaySlot = branch_delay_slot != 0;
+
+			// Cheaper to recalculate this than store it
+			StaticAnalysis::Analyse( entry.OpCode, entry.Usage );
+		}
+
+		for( u32 b = 0; ok && b < num_branches; ++b )
+		{
+			SBranchDetails &	details( trace.BranchDetails[ b ] );
+			u32					delay_slot_trace_index, taken, likely, direct, eret, speed_hack;
+
+			ok = ReadU32( fp, &details.TargetAddress ) &&
+				 ReadU32( fp, &delay_slot_trace_index ) && (delay_slot_trace_index < num_entries || s32( delay_slot_trace_index ) == -1) &&
+				 ReadU32( fp, &taken ) &&
+				 ReadU32( fp, &likely ) &&
+				 ReadU32( fp, &direct ) &&
+				 ReadU32( fp, &eret ) &&
+				 ReadU32( fp, &speed_hack ) && speed_hack <= SHACK_IDLELOOP;
+
+			details.DelaySlotTraceIndex = s32( delay_slot_trace_index );
+			details.ConditionalBranchTaken = taken != 0;
+			details.Likely = likely != 0;
+			details.Direct = direct != 0;
+			details.Eret = eret != 0;
+			details.SpeedHack = SpeedHackProbe( speed_hack );
+		}
+
+		ok = ok && cached_trace.Hash == HashTrace( trace );
+
+		if( ok )
+		{
+			InsertTrace( cached_trace );
+		}
+	}
+
+	fclose(fp);
+
+	if( !ok )
+	{
+		DBGConsole_Msg(0, "Ignoring trace cache: %s", name);
+		Clear();
+		return false;
+	}
+
+	DBGConsole_Msg(0, "Read from trace cache: %s (%d traces)", name, mNumTraces);
+	mDirty = false;
+	return true;
+}
+
+#endif // DAEDALUS_ENABLE_TRACE_CACHE
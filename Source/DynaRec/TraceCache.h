@@ -0,0 +1,90 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef DYNAREC_TRACECACHE_H_
+#define DYNAREC_TRACECACHE_H_
+
+//
+//	Keeps the traces recorded for the current rom, and saves them alongside
+//	the savegames (as <rom>.trc) when the rom is closed.
+//
+//	The traces are stored rather than the code generated for them, as the
+//	code embeds the addresses of the code buffer, the emulator's globals
+//	and the other fragments. Compiling a trace is cheap compared to
+//	interpreting it gHotTraceThreshold times to find it again.
+//
+//	A trace is only ever handed back if the ops it was recorded from are
+//	still in RDRAM, so overlays and self modifying code are handled the same
+//	way as on the first boot. Only traces running entirely from KSEG0/KSEG1
+//	are kept, as TLB mapped code may not be at the same place next time.
+//
+#ifdef DAEDALUS_ENABLE_TRACE_CACHE
+
+#include <map>
+#include <vector>
+
+#include "TraceRecorder.h"
+
+class CTraceCache
+{
+public:
+	CTraceCache();
+
+	bool			Load();							// Replaces the contents with those saved for g_ROM
+	void			Save();							// Does nothing if no traces have been added since Load()
+	void			Clear();
+
+	void			AddTrace( const SRecordedTrace & trace );
+
+	// Fills in trace and returns true if a trace starting at address matches the contents of RDRAM
+	bool			FindTrace( u32 address, SRecordedTrace & trace ) const;
+
+	u32				GetNumTraces() const			{ return mNumTraces; }
+
+private:
+	struct SCachedTrace
+	{
+		u32				Hash;
+		SRecordedTrace	Trace;
+	};
+
+	typedef std::vector< SCachedTrace >		TraceList;		// Oldest first
+	typedef std::map< u32, TraceList >		TraceMap;
+
+	void			InsertTrace( const SCachedTrace & cached_trace );
+
+	static u32		HashTrace( const SRecordedTrace & trace );
+	static bool		IsTraceInRam( const SRecordedTrace & trace );
+
+private:
+	static const u32	MAX_TRACES = 16384;
+	static const u32	MAX_TRACES_PER_ADDRESS = 4;		// Overlays can put different code at the same address
+
+	TraceMap		mTraces;
+	u32				mNumTraces;
+	bool			mDirty;
+};
+
+extern CTraceCache				gTraceCache;
+
+#endif // DAEDALUS_ENABLE_TRACE_CACHE
+
+#endif // DYNAREC_TRACECACHE_H_
@@ -0,0 +1,312 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "TraceCompiler.h"
+
+#ifdef DAEDALUS_ENABLE_DYNAREC_THREAD
+
+#include "Fragment.h"
+#include "FragmentCache.h"
+#include "TraceRecorder.h"
+
+#include "Debug/DBGConsole.h"
+#include "Utility/Cond.h"
+
+CTraceCompiler				gTraceCompiler;
+
+//*************************************************************************************
+//
+//*************************************************************************************
+CTraceCompiler::CTraceCompiler()
+:	mpCodeBufferManager( NULL )
+,	mThread( kInvalidThreadHandle )
+,	mMutex( "TraceCompiler" )
+,	mWorkReady( CondCreate() )
+,	mWorkDone( CondCreate() )
+,	mBusy( false )
+,	mNumCompiled( 0 )
+,	mNumOutstanding( 0 )
+,	mWantQuit( false )
+{
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+CTraceCompiler::~CTraceCompiler()
+{
+	Stop();
+
+	std::vector< u32 >	discarded;
+	Flush( discarded );
+
+	CondDestroy( mWorkReady );
+	CondDestroy( mWorkDone );
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+bool CTraceCompiler::Start( CCodeBufferManager * p_manager )
+{
+	if( mThread != kInvalidThreadHandle )
+	{
+		DAEDALUS_ASSERT( p_manager == mpCodeBufferManager, "Code buffer manager has changed" );
+		return true;
+	}
+
+#ifdef DAEDALUS_ENABLE_PROFILING
+	// The profiler isn't thread safe
+	return false;
+#else
+	mpCodeBufferManager = p_manager;
+	mWantQuit = false;
+	mThread = CreateThread( "TraceCompiler", CompileThread, this );
+
+	if( mThread == kInvalidThreadHandle )
+	{
+		DBGConsole_Msg( 0, "Couldn't start the trace compiler thread - compiling synchronously" );
+		return false;
+	}
+
+	return true;
+#endif
+}
+
+//*************************************************************************************
+//	Traces which are still queued stay queued, to be thrown away by Flush
+//*************************************************************************************
+void CTraceCompiler::Stop()
+{
+	if( mThread != kInvalidThreadHandle )
+	{
+		mMutex.Lock();
+		mWantQuit = true;
+		CondSignal( mWorkReady );
+		mMutex.Unlock();
+
+		JoinThread( mThread, -1 );
+		ReleaseThreadHandle( mThread );
+		mThread = kInvalidThreadHandle;
+	}
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+bool CTraceCompiler::Submit( SRecordedTrace & trace )
+{
+	MutexLock	lock( &mMutex );
+
+	if( mNumOutstanding >= MAX_QUEUED_TRACES )
+	{
+		return false;
+	}
+
+	SRecordedTrace *	p_trace( new SRecordedTrace );
+	p_trace->StartAddress = trace.StartAddress;
+	p_trace->ExitAddress = trace.ExitAddress;
+	p_trace->TraceBuffer.swap( trace.TraceBuffer );
+	p_trace->BranchDetails.swap( trace.BranchDetails );
+	p_trace->NeedIndirectExitMap = trace.NeedIndirectExitMap;
+
+	mQueued.push_back( p_trace );
+	UpdateCounts();
+	CondSignal( mWorkReady );
+	return true;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+CFragment * CTraceCompiler::TakeCompiledFragment()
+{
+	MutexLock	lock( &mMutex );
+
+	if( mCompiled.empty() )
+		return NULL;
+
+	// Hand them back in the order they were compiled
+	CFragment *	p_fragment( mCompiled.front() );
+	mCompiled.erase( mCompiled.begin() );
+	UpdateCounts();
+
+	return p_fragment;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void CTraceCompiler::Flush( std::vector< u32 > & discarded )
+{
+	Discard( true, 0, 0, discarded );
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void CTraceCompiler::FlushRange( u32 address, u32 length, std::vector< u32 > & discarded )
+{
+	Discard( false, address, length, discarded );
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+namespace
+{
+	bool	IsPageInRange( u32 page, u32 first_page, u32 last_page )
+	{
+		return page >= first_page && page <= last_page;
+	}
+
+	bool	IsTraceInRange( const SRecordedTrace & trace, u32 first_page, u32 last_page )
+	{
+		for( u32 i = 0; i < trace.TraceBuffer.size(); ++i )
+		{
+			u32		page;
+			if( CFragmentPageIndex::AddressToPage( trace.TraceBuffer[ i ].Address, &page ) && IsPageInRange( page, first_page, last_page ) )
+				return true;
+		}
+		return false;
+	}
+
+	bool	IsFragmentInRange( const CFragment * p_fragment, u32 first_page, u32 last_page )
+	{
+		const std::vector< u32 > &	pages( p_fragment->GetCodePages() );
+		for( u32 i = 0; i < pages.size(); ++i )
+		{
+			if( IsPageInRange( pages[ i ], first_page, last_page ) )
+				return true;
+		}
+		return false;
+	}
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void CTraceCompiler::Discard( bool all, u32 address, u32 length, std::vector< u32 > & discarded )
+{
+	u32		first_page( 0 );
+	u32		last_page( 0 );
+
+	if( !all && !CFragmentPageIndex::GetPageRange( address, length, &first_page, &last_page ) )
+		return;
+
+	MutexLock	lock( &mMutex );
+
+	for( std::deque< SRecordedTrace * >::iterator it = mQueued.begin(); it != mQueued.end(); )
+	{
+		if( all || IsTraceInRange( **it, first_page, last_page ) )
+		{
+			discarded.push_back( (*it)->StartAddress );
+			delete *it;
+			it = mQueued.erase( it );
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	while( mBusy )
+	{
+		CondWait( mWorkDone, &mMutex, kTimeoutInfinity );
+	}
+
+	// The code for these stays in the code buffer until it's next reset
+	for( std::vector< CFragment * >::iterator it = mCompiled.begin(); it != mCompiled.end(); )
+	{
+		if( all || IsFragmentInRange( *it, first_page, last_page ) )
+		{
+			discarded.push_back( (*it)->GetEntryAddress() );
+			delete *it;
+			it = mCompiled.erase( it );
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	UpdateCounts();
+}
+
+//*************************************************************************************
+//	Must be called with the lock held
+//*************************************************************************************
+void CTraceCompiler::UpdateCounts()
+{
+	mNumCompiled = mCompiled.size();
+	mNumOutstanding = mQueued.size() + mCompiled.size() + (mBusy ? 1 : 0);
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+u32 DAEDALUS_THREAD_CALL_TYPE CTraceCompiler::CompileThread( void * arg )
+{
+	CTraceCompiler *	compiler( static_cast< CTraceCompiler * >( arg ) );
+
+	compiler->Run();
+
+	return 0;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void CTraceCompiler::Run()
+{
+	mMutex.Lock();
+
+	while( true )
+	{
+		while( mQueued.empty() && !mWantQuit )
+		{
+			CondWait( mWorkReady, &mMutex, kTimeoutInfinity );
+		}
+
+		if( mWantQuit )
+			break;
+
+		SRecordedTrace *	p_trace( mQueued.front() );
+		mQueued.pop_front();
+		mBusy = true;
+		UpdateCounts();
+
+		mMutex.Unlock();
+
+		CFragment *	p_fragment( CTraceRecorder::CompileTrace( mpCodeBufferManager, *p_trace ) );
+		delete p_trace;
+
+		mMutex.Lock();
+
+		mCompiled.push_back( p_fragment );
+		mBusy = false;
+		UpdateCounts();
+		CondSignal( mWorkDone );
+	}
+
+	mMutex.Unlock();
+}
+
+#endif // DAEDALUS_ENABLE_DYNAREC_THREAD
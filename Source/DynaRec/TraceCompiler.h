@@ -0,0 +1,103 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef DYNAREC_TRACECOMPILER_H_
+#define DYNAREC_TRACECOMPILER_H_
+
+//
+//	Compiles recorded traces on a worker thread, so the emulation thread can
+//	keep interpreting while a burst of new traces (e.g. on a level load) is
+//	turned into fragments.
+//
+//	Finished fragments sit in a list until the emulation thread collects them
+//	at a safe point and inserts them into the fragment cache. The compile
+//	thread is the only thing allocating from the code buffer while it runs,
+//	so Flush() must be called before the fragment cache is cleared.
+//
+#ifdef DAEDALUS_ENABLE_DYNAREC_THREAD
+
+#include <deque>
+#include <vector>
+
+#include "Utility/DaedalusTypes.h"
+#include "Utility/Mutex.h"
+#include "Utility/Thread.h"
+
+class CCodeBufferManager;
+class CFragment;
+struct Cond;
+struct SRecordedTrace;
+
+class CTraceCompiler
+{
+public:
+	CTraceCompiler();
+	~CTraceCompiler();
+
+	bool			Start( CCodeBufferManager * p_manager );	// Returns true if the thread is running
+	void			Stop();
+
+	// Takes the contents of the trace. Returns false if the queue is full (the trace is dropped)
+	bool			Submit( SRecordedTrace & trace );
+
+	// Returns NULL if there's nothing ready
+	CFragment *		TakeCompiledFragment();
+	bool			HasCompiledFragments() const				{ return mNumCompiled != 0; }
+
+	// True if anything is queued, being compiled or waiting to be collected
+	bool			HasOutstandingTraces() const				{ return mNumOutstanding != 0; }
+
+	// Both wait for the trace being compiled, then throw away everything queued or compiled
+	// (or just the traces recorded from code in the range). The entry addresses of the
+	// discarded traces are appended to discarded.
+	void			Flush( std::vector< u32 > & discarded );
+	void			FlushRange( u32 address, u32 length, std::vector< u32 > & discarded );
+
+private:
+	static u32 DAEDALUS_THREAD_CALL_TYPE	CompileThread( void * arg );
+
+	void			Run();
+	void			Discard( bool all, u32 address, u32 length, std::vector< u32 > & discarded );
+	void			UpdateCounts();
+
+private:
+	static const u32	MAX_QUEUED_TRACES = 32;		// Queued + being compiled + waiting to be collected
+
+	CCodeBufferManager *			mpCodeBufferManager;
+	ThreadHandle					mThread;
+
+	Mutex							mMutex;
+	Cond *							mWorkReady;
+	Cond *							mWorkDone;
+
+	std::deque< SRecordedTrace * >	mQueued;
+	std::vector< CFragment * >		mCompiled;
+	bool							mBusy;
+	volatile u32					mNumCompiled;		// These are read without the lock so the checks in Dynamo are cheap
+	volatile u32					mNumOutstanding;
+	volatile bool					mWantQuit;
+};
+
+extern CTraceCompiler				gTraceCompiler;
+
+#endif // DAEDALUS_ENABLE_DYNAREC_THREAD
+
+#endif // DYNAREC_TRACECOMPILER_H_
@@ -0,0 +1,475 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "TraceOptimiser.h"
+
+#include "Core/Memory.h"
+#include "Core/N64Reg.h"
+#include "Core/R4300OpCode.h"
+
+namespace TraceOptimiser
+{
+	SStats		gStats;
+}
+
+namespace
+{
+	const u32	INVALID_IDX( u32(~0) );
+
+	struct SConstants
+	{
+		u32		Known;				// Bitmask of the registers with a known value
+		s64		Values[ 32 ];
+
+		SConstants()	{ Reset(); }
+
+		void	Reset()						{ Known = 1 << N64Reg_R0; Values[ N64Reg_R0 ] = 0; }
+		bool	IsKnown( u32 reg ) const	{ return (Known & (1 << reg)) != 0; }
+		void	Forget( u32 regs )			{ Known &= ~regs | (1 << N64Reg_R0); }
+		void	Set( u32 reg, s64 value )
+		{
+			if( reg != N64Reg_R0 )
+			{
+				Known |= 1 << reg;
+				Values[ reg ] = value;
+			}
+		}
+	};
+
+	//	The last store which a following load might be able to use
+	struct SStore
+	{
+		bool	Valid;
+		u32		Base;
+		u32		Offset;
+		u32		Source;
+	};
+
+	bool	IsBranchOrDelaySlot( const STraceEntry & entry )
+	{
+		return entry.BranchIdx != INVALID_IDX || entry.BranchDelaySlot;
+	}
+
+	//*************************************************************************************
+	//	Simple ALU ops only write dst, only read the registers in reads, and can't
+	//	raise an exception. Everything else is treated as a barrier.
+	//*************************************************************************************
+	bool	GetSimpleOpDetails( OpCode op_code, u32 * p_reads, u32 * p_dst )
+	{
+		switch( op_code.op )
+		{
+		case OP_LUI:
+			*p_reads = 0;
+			*p_dst = op_code.rt;
+			return true;
+
+		case OP_ADDIU:
+		case OP_DADDIU:
+		case OP_SLTI:
+		case OP_SLTIU:
+		case OP_ANDI:
+		case OP_ORI:
+		case OP_XORI:
+			*p_reads = 1 << op_code.rs;
+			*p_dst = op_code.rt;
+			return true;
+
+		case OP_SPECOP:
+			switch( op_code.spec_op )
+			{
+			case SpecOp_SLL:
+			case SpecOp_SRL:
+			case SpecOp_SRA:
+			case SpecOp_DSLL:
+			case SpecOp_DSRL:
+			case SpecOp_DSRA:
+			case SpecOp_DSLL32:
+			case SpecOp_DSRL32:
+			case SpecOp_DSRA32:
+				*p_reads = 1 << op_code.rt;
+				*p_dst = op_code.rd;
+				return true;
+
+			case SpecOp_SLLV:
+			case SpecOp_SRLV:
+			case SpecOp_SRAV:
+			case SpecOp_DSLLV:
+			case SpecOp_DSRLV:
+			case SpecOp_DSRAV:
+			case SpecOp_ADDU:
+			case SpecOp_SUBU:
+			case SpecOp_AND:
+			case SpecOp_OR:
+			case SpecOp_XOR:
+			case SpecOp_NOR:
+			case SpecOp_SLT:
+			case SpecOp_SLTU:
+			case SpecOp_DADDU:
+			case SpecOp_DSUBU:
+				*p_reads = (1 << op_code.rs) | (1 << op_code.rt);
+				*p_dst = op_code.rd;
+				return true;
+
+			default:
+				break;
+			}
+			break;
+
+		default:
+			break;
+		}
+
+		return false;
+	}
+
+	//*************************************************************************************
+	//	Must match the interpreter (R4300.cpp) exactly
+	//*************************************************************************************
+	bool	EvaluateConstant( OpCode op_code, const SConstants & constants, s64 * p_value )
+	{
+		u32		reads, dst;
+		if( !GetSimpleOpDetails( op_code, &reads, &dst ) || (constants.Known & reads) != reads )
+			return false;
+
+		const s64	rs( constants.Values[ op_code.rs ] );
+		const s64	rt( constants.Values[ op_code.rt ] );
+		const s64	imm( s16( op_code.immediate ) );
+
+		switch( op_code.op )
+		{
+		case OP_LUI:	*p_value = s64( s32( u32( op_code.immediate ) << 16 ) );	return true;
+		case OP_ADDIU:	*p_value = s64( s32( u32( rs ) + u32( imm ) ) );			return true;
+		case OP_DADDIU:	*p_value = rs + imm;										return true;
+		case OP_SLTI:	*p_value = rs < imm ? 1 : 0;								return true;
+		case OP_SLTIU:	*p_value = u64( rs ) < u64( imm ) ? 1 : 0;					return true;
+		case OP_ANDI:	*p_value = rs & u16( op_code.immediate );					return true;
+		case OP_ORI:	*p_value = rs | u16( op_code.immediate );					return true;
+		case OP_XORI:	*p_value = rs ^ u16( op_code.immediate );					return true;
+
+		case OP_SPECOP:
+			switch( op_code.spec_op )
+			{
+			case SpecOp_SLL:	*p_value = s64( s32( u32( rt ) << op_code.sa ) );	return true;
+			case SpecOp_SRL:	*p_value = s64( s32( u32( rt ) >> op_code.sa ) );	return true;
+			case SpecOp_SRA:	*p_value = s64( s32( rt ) >> op_code.sa );			return true;
+			case SpecOp_ADDU:	*p_value = s64( s32( u32( rs ) + u32( rt ) ) );		return true;
+			case SpecOp_SUBU:	*p_value = s64( s32( u32( rs ) - u32( rt ) ) );		return true;
+			case SpecOp_AND:	*p_value = rs & rt;									return true;
+			case SpecOp_OR:		*p_value = rs | rt;									return true;
+			case SpecOp_XOR:	*p_value = rs ^ rt;									return true;
+			case SpecOp_NOR:	*p_value = ~(rs | rt);								return true;
+			case SpecOp_SLT:	*p_value = rs < rt ? 1 : 0;							return true;
+			case SpecOp_SLTU:	*p_value = u64( rs ) < u64( rt ) ? 1 : 0;			return true;
+			case SpecOp_DADDU:	*p_value = s64( u64( rs ) + u64( rt ) );			return true;
+			case SpecOp_DSUBU:	*p_value = s64( u64( rs ) - u64( rt ) );			return true;
+			default:
+				break;
+			}
+			break;
+
+		default:
+			break;
+		}
+
+		// The remaining shifts aren't worth folding
+		return false;
+	}
+
+	//*************************************************************************************
+	//	Builds a single op which writes value to dst without reading any registers
+	//*************************************************************************************
+	bool	MakeConstantOp( u32 dst, s64 value, OpCode * p_op_code )
+	{
+		OpCode	op_code;
+		op_code._u32 = 0;
+		op_code.rs = N64Reg_R0;
+		op_code.rt = dst;
+
+		if( value == s64( s16( value ) ) )
+		{
+			op_code.op = OP_ADDIU;
+			op_code.immediate = u16( value );
+		}
+		else if( value == s64( u16( value ) ) )
+		{
+			op_code.op = OP_ORI;
+			op_code.immediate = u16( value );
+		}
+		else if( value == s64( s32( value ) ) && (value & 0xffff) == 0 )
+		{
+			op_code.op = OP_LUI;
+			op_code.immediate = u16( value >> 16 );
+		}
+		else
+		{
+			return false;
+		}
+
+		*p_op_code = op_code;
+		return true;
+	}
+
+	bool	IsConstantOp( OpCode op_code )
+	{
+		switch( op_code.op )
+		{
+		case OP_LUI:
+		case OP_ADDIU:
+		case OP_DADDIU:
+		case OP_SLTI:
+		case OP_SLTIU:
+		case OP_ANDI:
+		case OP_ORI:
+		case OP_XORI:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	u32		GetAccessSize( OpCode op_code )
+	{
+		switch( op_code.op )
+		{
+		case OP_LB:
+		case OP_LBU:
+		case OP_SB:
+			return 1;
+		case OP_LH:
+		case OP_LHU:
+		case OP_SH:
+			return 2;
+		case OP_LW:
+		case OP_LWU:
+		case OP_SW:
+		case OP_LWC1:
+		case OP_SWC1:
+			return 4;
+		case OP_LD:
+		case OP_SD:
+		case OP_LDC1:
+		case OP_SDC1:
+			return 8;
+		default:
+			return 0;
+		}
+	}
+
+	bool	IsGPRLoad( OpCode op_code )
+	{
+		switch( op_code.op )
+		{
+		case OP_LB:
+		case OP_LBU:
+		case OP_LH:
+		case OP_LHU:
+		case OP_LW:
+		case OP_LWU:
+		case OP_LD:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	void	SetOpCode( STraceEntry & entry, OpCode op_code )
+	{
+		StaticAnalysis::RegisterUsage	usage;
+		StaticAnalysis::Analyse( op_code, usage );
+
+		entry.OpCode = op_code;
+		entry.Usage = usage;
+	}
+
+	//*************************************************************************************
+	//	Walks the trace in order, keeping track of the registers with known values
+	//	and the last store to RAM
+	//*************************************************************************************
+	void	PropagateConstants( std::vector< STraceEntry > & trace )
+	{
+		SConstants	constants;
+		SStore		store = { false, 0, 0, 0 };
+
+		for( u32 i = 0; i < trace.size(); ++i )
+		{
+			STraceEntry &	entry( trace[ i ] );
+			OpCode			op_code( entry.OpCode );
+			const bool		can_rewrite( !entry.BranchDelaySlot );
+
+			// Loads of the word just stored become moves
+			if( op_code.op == OP_LW && store.Valid && can_rewrite &&
+				op_code.base == store.Base && op_code.offset == store.Offset )
+			{
+				OpCode	move;
+				move._u32 = 0;
+				if( op_code.rt != N64Reg_R0 )
+				{
+					move.op = OP_SPECOP;
+					move.spec_op = SpecOp_ADDU;
+					move.rd = op_code.rt;
+					move.rs = store.Source;
+					move.rt = N64Reg_R0;
+				}
+
+				SetOpCode( entry, move );
+				op_code = move;
+				TraceOptimiser::gStats.LoadsForwarded++;
+			}
+
+			u32		reads, dst;
+			if( GetSimpleOpDetails( op_code, &reads, &dst ) )
+			{
+				s64		value;
+				if( dst == N64Reg_R0 )
+				{
+					if( can_rewrite && op_code._u32 != 0 )
+					{
+						OpCode	nop;
+						nop._u32 = 0;
+						SetOpCode( entry, nop );
+						TraceOptimiser::gStats.WritesRemoved++;
+					}
+				}
+				else if( EvaluateConstant( op_code, constants, &value ) )
+				{
+					OpCode	constant_op;
+					if( can_rewrite && reads != 0 && MakeConstantOp( dst, value, &constant_op ) && constant_op._u32 != op_code._u32 )
+					{
+						SetOpCode( entry, constant_op );
+						TraceOptimiser::gStats.ConstantsFolded++;
+					}
+
+					if( IsConstantOp( entry.OpCode ) )
+					{
+						entry.Flags |= TEF_CONSTANT_RESULT;
+						entry.Constant = value;
+					}
+
+					constants.Set( dst, value );
+				}
+				else
+				{
+					constants.Forget( 1 << dst );
+				}
+
+				if( store.Valid && (dst == store.Base || dst == store.Source) )
+				{
+					store.Valid = false;
+				}
+				continue;
+			}
+
+			// Loads and stores through a constant address in RDRAM
+			u32		access_size( GetAccessSize( op_code ) );
+			bool	ram_address( false );
+			if( access_size != 0 && constants.IsKnown( op_code.base ) )
+			{
+				s64		address( constants.Values[ op_code.base ] + s16( op_code.offset ) );
+
+				ram_address = address >= s64( s32( 0x80000000 ) ) &&
+							  address < s64( s32( 0x80000000 ) ) + s64( gRamSize ) &&
+							  (address & (access_size - 1)) == 0;
+				if( ram_address )
+				{
+					entry.Flags |= TEF_RAM_ADDRESS;
+					TraceOptimiser::gStats.RamAccesses++;
+				}
+			}
+
+			// The stack is always in RDRAM (the backends' stack optimisations assume the same)
+			if( op_code.op == OP_SW && (ram_address || op_code.base == N64Reg_SP) )
+			{
+				store.Valid = true;
+				store.Base = op_code.base;
+				store.Offset = op_code.offset;
+				store.Source = op_code.rt;
+			}
+			else
+			{
+				store.Valid = false;
+			}
+
+			if( access_size != 0 )
+			{
+				if( IsGPRLoad( op_code ) )
+				{
+					constants.Forget( 1 << op_code.rt );
+				}
+			}
+			else
+			{
+				// Not something we understand, so forget anything it might write
+				constants.Forget( entry.Usage.RegWrites | (1 << op_code.rt) | (1 << op_code.rd) | (1 << N64Reg_RA) );
+			}
+
+			if( op_code.op == OP_JAL )
+			{
+				constants.Set( N64Reg_RA, s64( s32( entry.Address + 8 ) ) );
+			}
+		}
+	}
+
+	//*************************************************************************************
+	//	A simple op is dead if a later simple op overwrites its result before
+	//	anything reads it. Give up at anything which could leave the trace.
+	//*************************************************************************************
+	void	RemoveDeadWrites( std::vector< STraceEntry > & trace )
+	{
+		for( u32 i = 0; i < trace.size(); ++i )
+		{
+			STraceEntry &	entry( trace[ i ] );
+			u32				reads, dst;
+
+			if( IsBranchOrDelaySlot( entry ) || !GetSimpleOpDetails( entry.OpCode, &reads, &dst ) || dst == N64Reg_R0 )
+				continue;
+
+			for( u32 j = i + 1; j < trace.size(); ++j )
+			{
+				const STraceEntry &	next( trace[ j ] );
+				u32					next_reads, next_dst;
+
+				if( IsBranchOrDelaySlot( next ) || !GetSimpleOpDetails( next.OpCode, &next_reads, &next_dst ) )
+					break;
+
+				if( next_reads & (1 << dst) )
+					break;
+
+				if( next_dst == dst )
+				{
+					OpCode	nop;
+					nop._u32 = 0;
+					SetOpCode( entry, nop );
+					entry.Flags &= ~TEF_CONSTANT_RESULT;
+					TraceOptimiser::gStats.WritesRemoved++;
+					break;
+				}
+			}
+		}
+	}
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void TraceOptimiser::Optimise( std::vector< STraceEntry > & trace )
+{
+	PropagateConstants( trace );
+	RemoveDeadWrites( trace );
+}
@@ -0,0 +1,68 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef DYNAREC_TRACEOPTIMISER_H_
+#define DYNAREC_TRACEOPTIMISER_H_
+
+//
+//	Rewrites the ops of a trace before it is assembled. Everything is done
+//	in terms of R4300 ops, so all the backends benefit:
+//
+//	- Constants built up with LUI/ORI/ADDIU (or simple ALU ops on other
+//	  constants) are folded into a single op which doesn't read any
+//	  registers, and tagged with TEF_CONSTANT_RESULT.
+//	- Writes to r0, and writes which are overwritten before they are read,
+//	  are turned into NOPs.
+//	- A LW of the word just stored by a SW through the same base becomes a
+//	  register move.
+//	- Loads and stores through a base known to point into RDRAM are tagged
+//	  with TEF_RAM_ADDRESS, so the backend can skip the memory tables.
+//
+//	Values are only tracked along the recorded path, and the state is
+//	forgotten at anything that isn't a simple ALU op, so this is safe
+//	whichever way the trace exits.
+//
+//	The ops in branch delay slots are never rewritten, as they are also
+//	generated on the branch exit path.
+//
+
+#include <vector>
+
+#include "Trace.h"
+
+namespace TraceOptimiser
+{
+	struct SStats
+	{
+		u32		ConstantsFolded;
+		u32		WritesRemoved;
+		u32		LoadsForwarded;
+		u32		RamAccesses;
+
+		void	Reset()		{ ConstantsFolded = WritesRemoved = LoadsForwarded = RamAccesses = 0; }
+	};
+
+	void		Optimise( std::vector< STraceEntry > & trace );
+
+	extern SStats	gStats;
+}
+
+#endif // DYNAREC_TRACEOPTIMISER_H_
@@ -21,8 +21,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "TraceRecorder.h"
 #include "Fragment.h"
 #include "BranchType.h"
+#include "TraceOptimiser.h"
 
+#include "Config/ConfigOptions.h"
 #include "Core/CPU.h"			// For dubious use of PC/NewPC
+#include "Core/IdleLoop.h"
 #include "Core/Registers.h"
 
 #include "Debug/DBGConsole.h"
@@ -215,6 +218,10 @@ CTraceRecorder::EUpdateTraceStatus	CTraceRecorder::UpdateTrace( u32 address,
 				{
 					details.SpeedHack = SHACK_POSSIBLE;
 				}
+				else if (gCPUState.TargetPC == mStartTraceAddress && IdleLoop_IsIdleLoop( gCPUState.CurrentPC, gCPUState.TargetPC ))
+				{
+					details.SpeedHack = SHACK_IDLELOOP;
+				}
 			}
 
 			u32		branch_target_address( GetBranchTarget( address, op_code, branch_type ) );
@@ -250,7 +257,7 @@ CTraceRecorder::EUpdateTraceStatus	CTraceRecorder::UpdateTrace( u32 address,
 	}
 
 	// Add this op to the trace buffer.
-	STraceEntry		entry = { address, op_code, usage, branch_idx, branch_delay_slot };
+	STraceEntry		entry = { address, op_code, usage, branch_idx, branch_delay_slot, 0, 0 };
 
 	mTraceBuffer.push_back( entry );
 
@@ -284,15 +291,24 @@ CFragment *		CTraceRecorder::CreateFragment( CCodeBufferManager * p_manager )
 {
 	DAEDALUS_PROFILE( "CTraceRecorder::CreateFragment" );
 
-	DAEDALUS_ASSERT( !mTraceBuffer.empty(), "No trace ready for creation?" );
+	SRecordedTrace	trace;
+	TakeTrace( trace );
 
-	SRegisterUsageInfo	register_usage;
-	Analyse( register_usage );
+	return CompileTrace( p_manager, trace );
+}
 
-	CFragment *	p_frament( new CFragment( p_manager, mStartTraceAddress, mExpectedExitTraceAddress,
-		mTraceBuffer, register_usage, mBranchDetails, mNeedIndirectExitMap ) );
+//*************************************************************************************
+//
+//*************************************************************************************
+void	CTraceRecorder::TakeTrace( SRecordedTrace & trace )
+{
+	DAEDALUS_ASSERT( !mTraceBuffer.empty(), "No trace ready for creation?" );
 
-	//DBGConsole_Msg( 0, "Inserting hot trace for [R%08x]!", mStartTraceAddress );
+	trace.StartAddress = mStartTraceAddress;
+	trace.ExitAddress = mExpectedExitTraceAddress;
+	trace.TraceBuffer.swap( mTraceBuffer );
+	trace.BranchDetails.swap( mBranchDetails );
+	trace.NeedIndirectExitMap = mNeedIndirectExitMap;
 
 	mTracing = false;
 	mStartTraceAddress = 0;
@@ -302,6 +318,30 @@ CFragment *		CTraceRecorder::CreateFragment( CCodeBufferManager * p_manager )
 	mActiveBranchIdx = INVALID_IDX;
 	mStopTraceAfterDelaySlot = false;
 	mNeedIndirectExitMap = false;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+CFragment *		CTraceRecorder::CompileTrace( CCodeBufferManager * p_manager, const SRecordedTrace & trace )
+{
+	// Optimise a copy, so the trace cache only ever sees the ops as they are in RAM
+	std::vector< STraceEntry >	trace_buffer( trace.TraceBuffer );
+
+#ifndef FRAGMENT_SIMULATE_EXECUTION
+	if( gDynarecTraceOptimisation )
+	{
+		TraceOptimiser::Optimise( trace_buffer );
+	}
+#endif
+
+	SRegisterUsageInfo	register_usage;
+	Analyse( trace_buffer, register_usage );
+
+	CFragment *	p_frament( new CFragment( p_manager, trace.StartAddress, trace.ExitAddress,
+		trace_buffer, register_usage, trace.BranchDetails, trace.NeedIndirectExitMap ) );
+
+	//DBGConsole_Msg( 0, "Inserting hot trace for [R%08x]!", trace.StartAddress );
 
 	return p_frament;
 }
@@ -368,18 +408,18 @@ void	CTraceRecorder::AbortTrace()
 //*************************************************************************************
 //
 //*************************************************************************************
-void CTraceRecorder::Analyse( SRegisterUsageInfo & register_usage )
+void CTraceRecorder::Analyse( const std::vector< STraceEntry > & trace_buffer, SRegisterUsageInfo & register_usage )
 {
 	DAEDALUS_PROFILE( "CTraceRecorder::Analyse" );
 
 	std::pair< s32, s32 >		reg_spans[ NUM_N64_REGS ];
-	std::pair< s32, s32 >		invalid_span( std::pair< s32, s32 >( mTraceBuffer.size(), -1 ) );
+	std::pair< s32, s32 >		invalid_span( std::pair< s32, s32 >( trace_buffer.size(), -1 ) );
 
 	std::fill( reg_spans, reg_spans + NUM_N64_REGS, invalid_span );		// Set the interval to an invalid range
 
-	for( u32 i = 0; i < mTraceBuffer.size(); ++i )
+	for( u32 i = 0; i < trace_buffer.size(); ++i )
 	{
-		const STraceEntry & ti( mTraceBuffer[ i ] );
+		const STraceEntry & ti( trace_buffer[ i ] );
 		const StaticAnalysis::RegisterUsage&	usage = ti.Usage;
 
 		register_usage.RegistersRead |= usage.RegReads;
@@ -31,6 +31,18 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 class CFragment;
 class CCodeBufferManager;
 
+//
+//	Everything needed to compile a trace once it's been recorded
+//
+struct SRecordedTrace
+{
+	u32								StartAddress;
+	u32								ExitAddress;
+	std::vector< STraceEntry >		TraceBuffer;
+	std::vector< SBranchDetails >	BranchDetails;
+	bool							NeedIndirectExitMap;
+};
+
 class CTraceRecorder
 {
 
@@ -48,8 +60,12 @@ public:
 	EUpdateTraceStatus	UpdateTrace( u32 address, bool branch_delay_slot, bool branch_taken, OpCode op_code, CFragment * p_fragment );
 	void				StopTrace( u32 exit_address );
 	CFragment *			CreateFragment( CCodeBufferManager * p_manager );
+	void				TakeTrace( SRecordedTrace & trace );		// Hand the recorded trace over to be compiled elsewhere
 	void				AbortTrace();
 
+	// Doesn't touch any recorder state, so can be called from another thread
+	static CFragment *	CompileTrace( CCodeBufferManager * p_manager, const SRecordedTrace & trace );
+
 	bool				IsTraceActive() const						{ return mTracing; }
 
 	u32					GetStartTraceAddress() const				{ DAEDALUS_ASSERT_Q( mTracing ); return mStartTraceAddress; }
@@ -66,7 +82,7 @@ private:
 	bool							mStopTraceAfterDelaySlot;
 	bool							mNeedIndirectExitMap;
 
-	void	Analyse(SRegisterUsageInfo & register_usage );
+	static void	Analyse( const std::vector< STraceEntry > & trace_buffer, SRegisterUsageInfo & register_usage );
 };
 extern CTraceRecorder				gTraceRecorder;
 
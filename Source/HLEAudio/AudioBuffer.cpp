@@ -22,6 +22,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "Config/ConfigOptions.h"
 #include "Debug/DBGConsole.h"
+#include "Utility/AtomicPrimitives.h"
 #include "Utility/Thread.h"
 
 #ifdef DAEDALUS_PSP
@@ -71,9 +72,6 @@ void CAudioBuffer::AddSamples( const Sample * samples, u32 num_samples, u32 freq
 	//fwrite( samples, sizeof( Sample ), num_samples, fh );
 	//fflush( fh );
 
-	const Sample *	read_ptr( mReadPtr );		// No need to invalidate, as this is uncached/volatile
-	Sample *		write_ptr( mWritePtr );
-
 	//
 	//	'r' is the number of input samples we progress through for each output sample.
 	//	's' keeps track of how far between the current two input samples we are.
@@ -87,63 +85,76 @@ void CAudioBuffer::AddSamples( const Sample * samples, u32 num_samples, u32 freq
 	u32		  in_idx( 0 );
 	u32		  output_samples( (( num_samples * output_freq ) / frequency) - 1);
 
-	for( u32 i = output_samples; i != 0 ; i-- )
-	{
-		DAEDALUS_ASSERT( in_idx + 1 < num_samples, "Input index out of range - %d / %d", in_idx+1, num_samples );
-
-#if 0 // 1->Sine tone, 0->Normal
-		//static float c= 0.0f;
-		//c += 100.0f / 44100.0f;
-		//if( c >= 1.0f )
-		//  c-=1.f;
-		//s16 v( s16( SHRT_MAX * sinf( c * 3.141f*2 ) ) );
-		Sample	out;
-		s16 v = WriteCounter++;
-		if( WriteCounter >= MAX_COUNTER )
-		{
-			printf( "Loop write\n" );
-			WriteCounter = 0;
-		}
-		out.L = out.R = v;
+	// One slot is always left empty, so a full buffer can be told from an empty one
+	const u32 capacity( (mBufferEnd - mBufferBegin) - 1 );
 
-#else
-		// Resample in integer mode (faster & less ASM code) //Corn
-		Sample	out;
+	Sample *  write_ptr( mWritePtr );
 
-		out.L = samples[ in_idx ].L + ((( samples[ in_idx + 1 ].L - samples[ in_idx ].L ) * s ) >> 12 );
-		out.R = samples[ in_idx ].R + ((( samples[ in_idx + 1 ].R - samples[ in_idx ].R ) * s ) >> 12 );
-
-		s += r;
-		in_idx += s >> 12;
-		s &= 4095;
-#endif
-
-		write_ptr++;
-		if( write_ptr >= mBufferEnd )
-			write_ptr = mBufferBegin;
+	while( output_samples > 0 )
+	{
+		u32 batch( output_samples < capacity ? output_samples : capacity );
 
-		while( write_ptr == read_ptr )
+		while( capacity - GetNumBufferedSamples() < batch )
 		{
-			// The buffer is full - spin until the read pointer advances.
+			// The buffer is full - wait until there's room for the whole batch.
 			//    Note - spends a lot of time here if program is running
 			//    fast. This loop locks the speed to the playback rate
 			//    as the program winds up waiting for the buffer to empty.
+			//    We only wait once per batch (normally once per AI buffer)
+			//    rather than once per sample.
 			// ToDo: Adjust Audio Frequency/ Look at Turok in this regard.
 			// We might want to put a Sleep in when executing on the SC?
 			//Give time to other threads when using SYNC mode.
 			if ( gAudioPluginEnabled == APM_ENABLED_SYNC )	ThreadYield();
-
-			read_ptr = mReadPtr;
 		}
 
-		*write_ptr = out;
-	}
+		output_samples -= batch;
 
-	//Todo: Check Cache Routines
-	// Ensure samples array is written back before mWritePtr
-	//dcache_wbinv_range_unaligned( mBufferBegin, mBufferEnd );
+		for( u32 i = batch; i != 0 ; i-- )
+		{
+			DAEDALUS_ASSERT( in_idx + 1 < num_samples, "Input index out of range - %d / %d", in_idx+1, num_samples );
+
+#if 0 // 1->Sine tone, 0->Normal
+			//static float c= 0.0f;
+			//c += 100.0f / 44100.0f;
+			//if( c >= 1.0f )
+			//  c-=1.f;
+			//s16 v( s16( SHRT_MAX * sinf( c * 3.141f*2 ) ) );
+			Sample	out;
+			s16 v = WriteCounter++;
+			if( WriteCounter >= MAX_COUNTER )
+			{
+				printf( "Loop write\n" );
+				WriteCounter = 0;
+			}
+			out.L = out.R = v;
 
-	mWritePtr = write_ptr;		// Needs cache wbinv
+#else
+			// Resample in integer mode (faster & less ASM code) //Corn
+			Sample	out;
+
+			out.L = samples[ in_idx ].L + ((( samples[ in_idx + 1 ].L - samples[ in_idx ].L ) * s ) >> 12 );
+			out.R = samples[ in_idx ].R + ((( samples[ in_idx + 1 ].R - samples[ in_idx ].R ) * s ) >> 12 );
+
+			s += r;
+			in_idx += s >> 12;
+			s &= 4095;
+#endif
+
+			*write_ptr = out;
+
+			write_ptr++;
+			if( write_ptr >= mBufferEnd )
+				write_ptr = mBufferBegin;
+		}
+
+		//Todo: Check Cache Routines
+		// Ensure samples array is written back before mWritePtr
+		//dcache_wbinv_range_unaligned( mBufferBegin, mBufferEnd );
+		AtomicMemoryBarrier();
+
+		mWritePtr = write_ptr;		// Needs cache wbinv
+	}
 }
 
 #ifdef DAEDALUS_PSP
@@ -211,6 +222,8 @@ u32	CAudioBuffer::Drain( Sample * samples, u32 num_samples )
 	const Sample *	read_ptr( mReadPtr );		// No need to invalidate, as this is uncached/volatile
 	const Sample *	write_ptr( mWritePtr );		//
 
+	AtomicMemoryBarrier();		// Read the samples after mWritePtr
+
 	Sample *	out_ptr( samples );
 	u32			samples_required( num_samples );
 
@@ -236,6 +249,7 @@ u32	CAudioBuffer::Drain( Sample * samples, u32 num_samples )
 	//fwrite( samples, sizeof( Sample ), (num_samples-samples_required), fh );
 	//fflush( fh );
 
+	AtomicMemoryBarrier();		// Finish reading the samples before handing back the space
 	mReadPtr = read_ptr;		// No need to invalidate, as this is uncached
 
 	//
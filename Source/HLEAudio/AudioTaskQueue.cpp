@@ -0,0 +1,190 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "AudioTaskQueue.h"
+
+#ifdef DAEDALUS_ENABLE_AUDIO_TASK_THREAD
+
+#include <vector>
+
+#include "audiohle.h"
+
+#include "Core/CPU.h"
+#include "Core/Memory.h"
+#include "Debug/DBGConsole.h"
+#include "Utility/Cond.h"
+#include "Utility/Mutex.h"
+#include "Utility/Thread.h"
+
+namespace
+{
+	// About the time the RSP spends on a typical alist. If the worker takes
+	// longer than this the CPU thread waits for it in CPU_EVENT_AUDIO.
+	const s32			kAudioTaskCycles = 20000;
+
+	ThreadHandle		gThread = kInvalidThreadHandle;
+	Mutex				gMutex( "AudioTask" );
+	Cond *				gWorkReady = NULL;
+	Cond *				gWorkDone = NULL;
+
+	OSTask				gTask;
+	std::vector< u32 >	gAList;
+	bool				gPending = false;		// Set until the worker has finished with gTask and gAList
+	bool				gWantQuit = false;
+
+	//*************************************************************************************
+	//
+	//*************************************************************************************
+	u32 DAEDALUS_THREAD_CALL_TYPE	AudioTaskThread( void * arg )
+	{
+		gMutex.Lock();
+
+		while( true )
+		{
+			while( !gPending && !gWantQuit )
+			{
+				CondWait( gWorkReady, &gMutex, kTimeoutInfinity );
+			}
+
+			// Finish off the last task before quitting
+			if( !gPending )
+				break;
+
+			gMutex.Unlock();
+
+			Audio_ProcessAList( gTask, gAList.empty() ? NULL : &gAList[0], gAList.size() / 2 );
+
+			gMutex.Lock();
+
+			gPending = false;
+			CondSignal( gWorkDone );
+		}
+
+		gMutex.Unlock();
+		return 0;
+	}
+
+	//*************************************************************************************
+	//	Must be called with the lock held
+	//*************************************************************************************
+	void	WaitForTask()
+	{
+		while( gPending )
+		{
+			CondWait( gWorkDone, &gMutex, kTimeoutInfinity );
+		}
+	}
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+bool AudioTask_Start()
+{
+	if( gThread != kInvalidThreadHandle )
+		return true;
+
+#ifdef DAEDALUS_ENABLE_PROFILING
+	// The profiler isn't thread safe
+	return false;
+#else
+	if( gWorkReady == NULL )
+	{
+		gWorkReady = CondCreate();
+		gWorkDone = CondCreate();
+	}
+
+	gWantQuit = false;
+	gThread = CreateThread( "AudioTask", AudioTaskThread, NULL );
+
+	if( gThread == kInvalidThreadHandle )
+	{
+		DBGConsole_Msg( 0, "Couldn't start the audio task thread - processing synchronously" );
+		return false;
+	}
+
+	return true;
+#endif
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void AudioTask_Stop()
+{
+	if( gThread != kInvalidThreadHandle )
+	{
+		gMutex.Lock();
+		gWantQuit = true;
+		CondSignal( gWorkReady );
+		gMutex.Unlock();
+
+		JoinThread( gThread, -1 );
+		ReleaseThreadHandle( gThread );
+		gThread = kInvalidThreadHandle;
+	}
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void AudioTask_Submit()
+{
+	DAEDALUS_ASSERT( gThread != kInvalidThreadHandle, "The audio task thread isn't running" );
+
+	const OSTask *	p_task( (const OSTask *)(g_pu8SpMemBase + 0x0FC0) );
+	u32				address( u32( reinterpret_cast< uintptr_t >( p_task->t.data_ptr ) ) & (MAX_RAM_ADDRESS - 1) );
+	u32				num_commands( p_task->t.data_size >> 3 );	//ABI5 can return 0 here!!!
+
+	if( address + num_commands * 8 > MAX_RAM_ADDRESS )
+	{
+		num_commands = (MAX_RAM_ADDRESS - address) >> 3;
+	}
+
+	{
+		MutexLock	lock( &gMutex );
+
+		WaitForTask();
+
+		const u32 *	p_alist( (const u32 *)(g_pu8RamBase + address) );
+
+		gTask = *p_task;
+		gAList.assign( p_alist, p_alist + num_commands * 2 );
+		gPending = true;
+		CondSignal( gWorkReady );
+	}
+
+	CPU_AddEvent( kAudioTaskCycles, CPU_EVENT_AUDIO );
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void AudioTask_Sync()
+{
+	if( gThread == kInvalidThreadHandle )
+		return;
+
+	MutexLock	lock( &gMutex );
+
+	WaitForTask();
+}
+
+#endif // DAEDALUS_ENABLE_AUDIO_TASK_THREAD
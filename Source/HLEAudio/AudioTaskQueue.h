@@ -0,0 +1,49 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef HLEAUDIO_AUDIOTASKQUEUE_H_
+#define HLEAUDIO_AUDIOTASKQUEUE_H_
+
+//
+//	Runs audio tasks on a worker thread, for the audio plugins'
+//	APM_ENABLED_ASYNC mode. This is the desktop equivalent of the PSP plugin
+//	handing Audio_Ucode to the Media Engine.
+//
+//	The task and its alist are copied when the task is submitted, so the
+//	game is free to start building the next alist. The samples, ADPCM state
+//	and output buffers are left in RDRAM - the game doesn't touch those until
+//	the task has finished on the real hardware either.
+//
+//	Completion is signalled with CPU_EVENT_AUDIO, as on the PSP. The event is
+//	queued for roughly the time the RSP takes to run an alist, and when it
+//	fires the CPU thread waits for the worker if it hasn't caught up.
+//
+#ifdef DAEDALUS_ENABLE_AUDIO_TASK_THREAD
+
+bool	AudioTask_Start();		// Returns true if the thread is running
+void	AudioTask_Stop();		// Waits for any outstanding task first
+
+void	AudioTask_Submit();		// Takes the task currently in SP memory
+void	AudioTask_Sync();		// Waits for the last task submitted to finish
+
+#endif // DAEDALUS_ENABLE_AUDIO_TASK_THREAD
+
+#endif // HLEAUDIO_AUDIOTASKQUEUE_H_
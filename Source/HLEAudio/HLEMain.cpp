@@ -93,7 +93,7 @@ void Audio_Reset()
 //*****************************************************************************
 //
 //*****************************************************************************
-inline void Audio_Ucode_Detect(OSTask * pTask)
+inline void Audio_Ucode_Detect(const OSTask * pTask)
 {
 	u8* p_base = g_pu8RamBase + (u32)pTask->t.ucode_data;
 	if (*(u32*)(p_base + 0) != 0x01)
@@ -117,24 +117,30 @@ inline void Audio_Ucode_Detect(OSTask * pTask)
 //*****************************************************************************
 void Audio_Ucode()
 {
-	DAEDALUS_PROFILE( "HLEMain::Audio_Ucode" );
+	const OSTask * pTask = (const OSTask *)(g_pu8SpMemBase + 0x0FC0);
+	const u32 * p_alist = (const u32 *)(g_pu8RamBase + (u32)pTask->t.data_ptr);
 
-	OSTask * pTask = (OSTask *)(g_pu8SpMemBase + 0x0FC0);
+	Audio_ProcessAList( *pTask, p_alist, pTask->t.data_size >> 3 );	//ABI5 can return 0 here!!!
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void Audio_ProcessAList( const OSTask & task, const u32 * p_alist, u32 num_commands )
+{
+	DAEDALUS_PROFILE( "HLEMain::Audio_Ucode" );
 
 	// Only detect ABI once per game
 	if ( !bAudioChanged )
 	{
 		bAudioChanged = true;
-		Audio_Ucode_Detect( pTask );
+		Audio_Ucode_Detect( &task );
 	}
 
 	gAudioHLEState.LoopVal = 0;
 	//memset( gAudioHLEState.Segments, 0, sizeof( gAudioHLEState.Segments ) );
 
-	u32 * p_alist = (u32 *)(g_pu8RamBase + (u32)pTask->t.data_ptr);
-	u32 ucode_size = (pTask->t.data_size >> 3);	//ABI5 can return 0 here!!!
-
-	while( ucode_size )
+	while( num_commands )
 	{
 		AudioHLECommand command;
 		command.cmd0 = *p_alist++;
@@ -142,7 +148,7 @@ void Audio_Ucode()
 
 		ABI[command.cmd](command);
 
-		--ucode_size;
+		--num_commands;
 
 		//printf("%08X %08X\n",command.cmd0,command.cmd1);
 	}
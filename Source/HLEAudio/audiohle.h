@@ -398,6 +398,7 @@ typedef void ( * AudioHLEInstruction )( AudioHLECommand command );
 
 // These must be defined...
 #include "Core/Memory.h"
+#include "OSHLE/ultra_sptask.h"
 
 // MMmm, why not use the defines from Memory.h?
 // ToDo : remove these and use the ones already provided by the core?
@@ -409,4 +410,7 @@ typedef void ( * AudioHLEInstruction )( AudioHLECommand command );
 void Audio_Ucode();
 void Audio_Reset();
 
+// Runs an alist which has been copied out of RDRAM (see AudioTaskQueue.h)
+void Audio_ProcessAList( const OSTask & task, const u32 * p_alist, u32 num_commands );
+
 #endif // HLEAUDIO_AUDIOHLE_H_
@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "TextureCache.h"
 #include "RDPStateManager.h"
 #include "DLDebug.h"
+#include "TnLSSE.h"
 
 #include "Graphics/NativeTexture.h"
 #include "Graphics/GraphicsContext.h"
@@ -569,18 +570,9 @@ ALIGNED_TYPE(const v4, NDCPlane[6], 16) =
 //VFPU tris clip(fast)
 //*****************************************************************************
 #ifdef DAEDALUS_PSP_USE_VFPU
-u32 clip_tri_to_frustum( DaedalusVtx4 * v0, DaedalusVtx4 * v1 )
+static inline u32 clipToHyperPlane( DaedalusVtx4 * dest, const DaedalusVtx4 * source, u32 inCount, const v4 &plane )
 {
-	u32 vOut( 3 );
-
-	vOut = _ClipToHyperPlane( v1, v0, &NDCPlane[0], vOut ); if( vOut < 3 ) return vOut;		// near
-	vOut = _ClipToHyperPlane( v0, v1, &NDCPlane[1], vOut ); if( vOut < 3 ) return vOut;		// far
-	vOut = _ClipToHyperPlane( v1, v0, &NDCPlane[2], vOut ); if( vOut < 3 ) return vOut;		// left
-	vOut = _ClipToHyperPlane( v0, v1, &NDCPlane[3], vOut ); if( vOut < 3 ) return vOut;		// right
-	vOut = _ClipToHyperPlane( v1, v0, &NDCPlane[4], vOut ); if( vOut < 3 ) return vOut;		// bottom
-	vOut = _ClipToHyperPlane( v0, v1, &NDCPlane[5], vOut );									// top
-
-	return vOut;
+	return _ClipToHyperPlane( dest, source, &plane, inCount );
 }
 
 #else	// FPU/CPU(slower)
@@ -656,23 +648,42 @@ static u32 clipToHyperPlane( DaedalusVtx4 * dest, const DaedalusVtx4 * source, u
 	return outCount;
 }
 
+#endif // CPU clip
+
 //*****************************************************************************
-//CPU tris clip to frustum
+//Tris clip to frustum. Only the planes of the axes in clip_flags are tested,
+//as no vertex can be outside the others. Both planes of an axis are tested
+//as a vertex with w < 0 only gets one of the two flags //Corn
+//Returns the number of vertices, which are left in v0
 //*****************************************************************************
-u32 clip_tri_to_frustum( DaedalusVtx4 * v0, DaedalusVtx4 * v1 )
+u32 clip_tri_to_frustum( DaedalusVtx4 * v0, DaedalusVtx4 * v1, u32 clip_flags )
 {
+	const u32 AxisFlags[6] = { Z_POS | Z_NEG, Z_POS | Z_NEG, X_POS | X_NEG, X_POS | X_NEG, Y_POS | Y_NEG, Y_POS | Y_NEG };	// Same order as NDCPlane
+
+	DaedalusVtx4 * source( v0 );
+	DaedalusVtx4 * dest( v1 );
 	u32 vOut = 3;
 
-	vOut = clipToHyperPlane( v1, v0, vOut, NDCPlane[0] ); if ( vOut < 3 ) return vOut;		// near
-	vOut = clipToHyperPlane( v0, v1, vOut, NDCPlane[1] ); if ( vOut < 3 ) return vOut;		// far
-	vOut = clipToHyperPlane( v1, v0, vOut, NDCPlane[2] ); if ( vOut < 3 ) return vOut;		// left
-	vOut = clipToHyperPlane( v0, v1, vOut, NDCPlane[3] ); if ( vOut < 3 ) return vOut;		// right
-	vOut = clipToHyperPlane( v1, v0, vOut, NDCPlane[4] ); if ( vOut < 3 ) return vOut;		// bottom
-	vOut = clipToHyperPlane( v0, v1, vOut, NDCPlane[5] );									// top
+	for( u32 p = 0; p < 6; ++p )
+	{
+		if( clip_flags & AxisFlags[p] )
+		{
+			vOut = clipToHyperPlane( dest, source, vOut, NDCPlane[p] );
+			if ( vOut < 3 ) return vOut;
+
+			DaedalusVtx4 * temp( source );
+			source = dest;
+			dest = temp;
+		}
+	}
+
+	if( source != v0 )
+	{
+		memcpy( v0, source, vOut * sizeof( DaedalusVtx4 ) );
+	}
 
 	return vOut;
 }
-#endif // CPU clip
 
 //*****************************************************************************
 //
@@ -684,6 +695,22 @@ namespace
 	// Flying Dragon clips more than 256
 	const u32			MAX_CLIPPED_VERTS = 320;
 	DaedalusVtx			clip_vtx[MAX_CLIPPED_VERTS];
+	u8					tri_clip_flags[MAX_CLIPPED_VERTS / 3];
+
+#ifndef DAEDALUS_ENABLE_SSE_TNL
+	//Union of each tri's clip flags, or CLIP_REJECTED if it can't be seen //Corn
+	void ClassifyTris( const DaedalusVtx4 * verts, const u16 * indices, u32 num_tris, u8 * tri_flags )
+	{
+		for( u32 t = 0; t < num_tris; ++t )
+		{
+			const u32 f0 = verts[ indices[ t*3 + 0 ] ].ClipFlags;
+			const u32 f1 = verts[ indices[ t*3 + 1 ] ].ClipFlags;
+			const u32 f2 = verts[ indices[ t*3 + 2 ] ].ClipFlags;
+
+			tri_flags[ t ] = (f0 & f1 & f2) ? CLIP_REJECTED : u8( f0 | f1 | f2 );
+		}
+	}
+#endif
 }
 
 //*****************************************************************************
@@ -705,22 +732,38 @@ void BaseRenderer::PrepareTrisClipped( TempVerts * temp_verts ) const
 	//
 	//  Convert directly to PSP hardware format, that way we only copy 24 bytes instead of 64 bytes //Corn
 	//
+	//  The tris are classified all at once, so only the ones straddling the clipbox go through clip_tri_to_frustum //Corn
+	//
 	u32 num_vertices = 0;
+	const u32 num_tris = mNumIndices / 3;
+
+	DAEDALUS_STATIC_ASSERT( ARRAYSIZE( tri_clip_flags ) >= kMaxIndices / 3 );
+#ifdef DAEDALUS_ENABLE_SSE_TNL
+	ClassifyTrisSSE( mVtxProjected, mIndexBuffer, num_tris, tri_clip_flags );
+#else
+	ClassifyTris( mVtxProjected, mIndexBuffer, num_tris, tri_clip_flags );
+#endif
 
-	for(u32 i = 0; i < (mNumIndices - 2);)
+	for(u32 t = 0; t < num_tris; ++t)
 	{
-		const u32 & idx0 = mIndexBuffer[ i++ ];
-		const u32 & idx1 = mIndexBuffer[ i++ ];
-		const u32 & idx2 = mIndexBuffer[ i++ ];
+		const u32 i = (t + 1) * 3;
+		const u32 & idx0 = mIndexBuffer[ i - 3 ];
+		const u32 & idx1 = mIndexBuffer[ i - 2 ];
+		const u32 & idx2 = mIndexBuffer[ i - 1 ];
+		const u32 clip_flags = tri_clip_flags[ t ];
+
+		//All the vertices are outside the same plane, so there's nothing to draw
+		if( clip_flags == CLIP_REJECTED )
+			continue;
 
 		//Check if any of the vertices are outside the clipbox (NDC), if so we need to clip the triangle
-		if(mVtxProjected[idx0].ClipFlags | mVtxProjected[idx1].ClipFlags | mVtxProjected[idx2].ClipFlags)
+		if( clip_flags )
 		{
 			temp_a[ 0 ] = mVtxProjected[ idx0 ];
 			temp_a[ 1 ] = mVtxProjected[ idx1 ];
 			temp_a[ 2 ] = mVtxProjected[ idx2 ];
 
-			u32 out = clip_tri_to_frustum( temp_a, temp_b );
+			u32 out = clip_tri_to_frustum( temp_a, temp_b, clip_flags );
 			//If we have less than 3 vertices left after the clipping
 			//we can't make a triangle so we bail and skip rendering it.
 			DL_PF("    Clip & re-tesselate [%d,%d,%d] with %d vertices", i-3, i-2, i-1, out);
@@ -1033,6 +1076,9 @@ void BaseRenderer::SetNewVertexInfo(u32 address, u32 v0, u32 n)
 	DL_PF( "    Ambient color RGB[%f][%f][%f] Texture scale X[%f] Texture scale Y[%f]", mTnL.Lights[mTnL.NumLights].Colour.x, mTnL.Lights[mTnL.NumLights].Colour.y, mTnL.Lights[mTnL.NumLights].Colour.z, mTnL.TextureScaleX, mTnL.TextureScaleY);
 	DL_PF( "    Light[%d %s] Texture[%s] EnvMap[%s] Fog[%s]", mTnL.NumLights, (mTnL.Flags.Light)? (mTnL.Flags.PointLight)? "Point":"Normal":"Off", (mTnL.Flags.Texture)? "On":"Off", (mTnL.Flags.TexGen)? (mTnL.Flags.TexGenLin)? "Linear":"Spherical":"Off", (mTnL.Flags.Fog)? "On":"Off");
 
+#ifdef DAEDALUS_ENABLE_SSE_TNL
+	TnLSSE( mat_world, mat_world_project, pVtxBase, &mVtxProjected[v0], n, mTnL );
+#else
 	// Transform and Project + Lighting or Transform and Project with Colour
 	//
 	for (u32 i = v0; i < v0 + n; i++)
@@ -1153,6 +1199,7 @@ void BaseRenderer::SetNewVertexInfo(u32 address, u32 v0, u32 n)
 		}
 #endif
 	}
+#endif
 }
 
 #endif // Transform VFPU/FPU
@@ -1190,6 +1237,9 @@ void BaseRenderer::SetNewVertexInfoConker(u32 address, u32 v0, u32 n)
 	//Model normal base vector
 	const s8 *mn = (const s8*)(g_pu8RamBase + gAuxAddr);
 
+#ifdef DAEDALUS_ENABLE_SSE_TNL
+	TnLSSE_CBFD( mat_world, mat_project, pVtxBase, &mVtxProjected[v0], n, mTnL, mn, v0 );
+#else
 	// Transform and Project + Lighting or Transform and Project with Colour
 	//
 	for (u32 i = v0; i < v0 + n; i++)
@@ -1318,6 +1368,7 @@ void BaseRenderer::SetNewVertexInfoConker(u32 address, u32 v0, u32 n)
 			mVtxProjected[i].Texture.y = (f32)vert.tv * mTnL.TextureScaleY;
 		}
 	}
+#endif
 }
 #endif
 
@@ -1395,6 +1446,8 @@ void BaseRenderer::SetNewVertexInfoDKR(u32 address, u32 v0, u32 n, bool billboar
 		}
 #ifdef DAEDALUS_PSP_USE_VFPU
 		_TnLVFPUDKR( n, &mat_world_project, (const FiddledVtx*)pVtxBase, &mVtxProjected[v0] );
+#elif defined(DAEDALUS_ENABLE_SSE_TNL)
+		TnLSSE_DKR( mat_world_project, g_pu8RamBase, address, &mVtxProjected[v0], n );
 #else
 		for (u32 i = v0; i < v0 + n; i++)
 		{
@@ -1468,6 +1521,9 @@ void BaseRenderer::SetNewVertexInfoPD(u32 address, u32 v0, u32 n)
 	//Model normal and color base vector
 	const u8 *mn = (u8*)(g_pu8RamBase + gAuxAddr);
 
+#ifdef DAEDALUS_ENABLE_SSE_TNL
+	TnLSSE_PD( mat_world, mat_project, pVtxBase, &mVtxProjected[v0], n, mTnL, mn );
+#else
 	for (u32 i = v0; i < v0 + n; i++)
 	{
 		const FiddledVtxPD & vert = pVtxBase[i - v0];
@@ -1542,6 +1598,7 @@ void BaseRenderer::SetNewVertexInfoPD(u32 address, u32 v0, u32 n)
 			mVtxProjected[i].Texture.y = (float)vert.tv * mTnL.TextureScaleY;
 		}
 	}
+#endif
 }
 #endif
 
@@ -195,6 +195,7 @@ ALIGNED_TYPE(struct, TnLParams, 16)
 #define Y_POS  0x10	//top
 #define Z_POS  0x20	//near
 #define CLIP_TEST_FLAGS ( X_POS | X_NEG | Y_POS | Y_NEG | Z_POS | Z_NEG )
+#define CLIP_REJECTED  0x80	//All three vertices of a tri are outside the same plane
 
 enum CycleType
 {
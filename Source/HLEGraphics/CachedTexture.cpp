@@ -25,6 +25,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "TextureInfo.h"
 #include "ConvertImage.h"
 #include "ConvertTile.h"
+#include "RDPStateManager.h"
 #include "Graphics/ColourValue.h"
 #include "Graphics/NativePixelFormat.h"
 #include "Graphics/NativeTexture.h"
@@ -32,6 +33,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Graphics/TextureTransform.h"
 
 #include "Config/ConfigOptions.h"
+#include "Core/DirtyPages.h"
 #include "Core/ROM.h"
 #include "Debug/DBGConsole.h"
 #include "Debug/Dump.h"
@@ -47,10 +49,12 @@ static NativePf8888			gPaletteBuffer[ 256 ];
 
 // NB: On the PSP we generate a lightweight hash of the texture data before
 // updating the native texture. This avoids some expensive work where possible.
-// On other platforms (e.g. OSX) updating textures is relatively inexpensive, so
+// Where writes to RDRAM are tracked (see Core/DirtyPages.h) textures are only
+// hashed when their source has been written to, and updated if the hash changes.
+// On other platforms updating textures is relatively inexpensive, so
 // we just skip the hashing process entirely, and update textures every frame
 // regardless of whether they've actually changed.
-#ifdef DAEDALUS_PSP
+#if defined(DAEDALUS_PSP) || defined(DAEDALUS_ENABLE_DIRTY_PAGES)
 static const bool kUpdateTexturesEveryFrame = false;
 #else
 static const bool kUpdateTexturesEveryFrame = true;
@@ -201,7 +205,7 @@ CachedTexture * CachedTexture::Create( const TextureInfo & ti )
 	}
 
 	CachedTexture *	texture = new CachedTexture( ti );
-	if (!texture->Initialise())
+	if (!texture->Initialise( false ))
 	{
 		return NULL;
 	}
@@ -209,20 +213,55 @@ CachedTexture * CachedTexture::Create( const TextureInfo & ti )
 	return texture;
 }
 
+#ifdef DAEDALUS_TEXTURE_DECODE_THREADS
+CachedTexture * CachedTexture::CreateAsync( const TextureInfo & ti )
+{
+	if( !STextureDecodeJob::CanDecode( ti ) )
+	{
+		return NULL;
+	}
+
+	CachedTexture *	texture = new CachedTexture( ti );
+	if (!texture->Initialise( true ))
+	{
+		return NULL;
+	}
+
+	return texture;
+}
+#endif
+
 CachedTexture::CachedTexture( const TextureInfo & ti )
 :	mTextureInfo( ti )
 ,	mpTexture(NULL)
 ,	mTextureContentsHash( 0 )
 ,	mFrameLastUpToDate( gRDPFrame )
 ,	mFrameLastUsed( gRDPFrame )
+#ifdef DAEDALUS_ENABLE_DIRTY_PAGES
+,	mDirtyEpoch( 0 )
+,	mTlutLoadCount( 0 )
+#endif
+,	mpLRUPrev( NULL )
+,	mpLRUNext( NULL )
+#ifdef DAEDALUS_TEXTURE_DECODE_THREADS
+,	mpDecodeJob( NULL )
+#endif
 {
 }
 
 CachedTexture::~CachedTexture()
 {
+#ifdef DAEDALUS_TEXTURE_DECODE_THREADS
+	// The workers may still be writing to it
+	if( mpDecodeJob != NULL )
+	{
+		gTextureDecoder.Wait( mpDecodeJob );
+		delete mpDecodeJob;
+	}
+#endif
 }
 
-bool CachedTexture::Initialise()
+bool CachedTexture::Initialise( bool async )
 {
 	DAEDALUS_ASSERT_Q(mpTexture == NULL);
 
@@ -244,12 +283,63 @@ bool CachedTexture::Initialise()
 			mFrameLastUpToDate = gRDPFrame + (FastRand() & (gCheckTextureHashFrequency - 1));
 		}
 		UpdateTextureHash();
-		UpdateTexture( mTextureInfo, mpTexture );
+#ifdef DAEDALUS_TEXTURE_DECODE_THREADS
+		if( !async || !StartDecode() )
+#endif
+		{
+			UpdateTexture( mTextureInfo, mpTexture );
+		}
 	}
 
 	return mpTexture != NULL;
 }
 
+#ifdef DAEDALUS_TEXTURE_DECODE_THREADS
+bool CachedTexture::StartDecode()
+{
+	DAEDALUS_ASSERT_Q(mpDecodeJob == NULL);
+
+	if( !mpTexture->HasData() )
+	{
+		return false;
+	}
+
+	STextureDecodeJob *	job = new STextureDecodeJob( mTextureInfo, mpTexture->GetFormat(), mpTexture->GetStride(),
+													 mpTexture->GetCorrectedWidth(), mpTexture->GetCorrectedHeight(),
+													 mpTexture->GetBytesRequired() );
+	if( !gTextureDecoder.Submit( job ) )
+	{
+		delete job;
+		return false;
+	}
+
+	mpDecodeJob = job;
+	return true;
+}
+
+void CachedTexture::FinishDecode()
+{
+	DAEDALUS_PROFILE( "CachedTexture::FinishDecode" );
+
+	gTextureDecoder.Wait( mpDecodeJob );
+
+	// If another texture has been loaded over this one since it was submitted, the texels are stale
+	if( !mpDecodeJob->Failed && mpDecodeJob->IsTmemUnchanged() )
+	{
+		void *	palette = IsTextureFormatPalettised( mpDecodeJob->Format ) ? mpDecodeJob->Palette : NULL;
+
+		mpTexture->SetData( &mpDecodeJob->Texels[0], palette );
+	}
+	else
+	{
+		UpdateTexture( mTextureInfo, mpTexture );
+	}
+
+	delete mpDecodeJob;
+	mpDecodeJob = NULL;
+}
+#endif
+
 // Update the hash of the texture. Returns true if the texture should be updated.
 bool CachedTexture::UpdateTextureHash()
 {
@@ -259,6 +349,11 @@ bool CachedTexture::UpdateTextureHash()
 		return true;
 	}
 
+#ifdef DAEDALUS_ENABLE_DIRTY_PAGES
+	mDirtyEpoch = DirtyPages_GetEpoch();
+	mTlutLoadCount = gTlutLoadCount;
+#endif
+
 	u32 new_hash_value = mTextureInfo.GenerateHashValue();
 	bool changed       = new_hash_value != mTextureContentsHash;
 
@@ -268,9 +363,20 @@ bool CachedTexture::UpdateTextureHash()
 
 void CachedTexture::UpdateIfNecessary()
 {
+#ifdef DAEDALUS_TEXTURE_DECODE_THREADS
+	if( mpDecodeJob != NULL )
+	{
+		FinishDecode();
+	}
+#endif
+
 	if( !IsFresh() )
 	{
-		if (UpdateTextureHash())
+		bool changed = UpdateTextureHash();
+#ifndef DAEDALUS_ENABLE_DIRTY_PAGES
+		changed |= AlwaysReload();
+#endif
+		if (changed)
 		{
 			UpdateTexture( mTextureInfo, mpTexture );
 		}
@@ -289,6 +395,14 @@ bool CachedTexture::IsFresh() const
 	if (gRDPFrame == mFrameLastUsed)
 		return true;
 
+#ifdef DAEDALUS_ENABLE_DIRTY_PAGES
+	// Loading any palette may have changed this one (or where it comes from)
+	if( mTextureInfo.GetFormat() == G_IM_FMT_CI && mTlutLoadCount != gTlutLoadCount )
+		return false;
+
+	// Can't have changed if nothing it's made from has been written to
+	return !mTextureInfo.HasSourceChanged( mDirtyEpoch );
+#else
 	// If we're not updating textures every frame, check how long it's been
 	// since we last updated it.
 	if (!kUpdateTexturesEveryFrame)
@@ -298,32 +412,17 @@ bool CachedTexture::IsFresh() const
 	}
 
 	return false;
+#endif
 }
 
-bool CachedTexture::HasExpired() const
+#ifndef DAEDALUS_ENABLE_DIRTY_PAGES
+// Some textures need reloading whenever they're checked, even if their hash is unchanged.
+bool CachedTexture::AlwaysReload() const
 {
-	if (!kUpdateTexturesEveryFrame)
-	{
-		if (!IsFresh())
-		{
-			//Hack to make WONDER PROJECT J2 work (need to reload some textures every frame!) //Corn
-			if( (g_ROM.GameHacks == WONDER_PROJECTJ2) && (mTextureInfo.GetTLutFormat() == kTT_RGBA16) && (mTextureInfo.GetSize() == G_IM_SIZ_8b) ) return true;
-
-			//Hack for Worms Armageddon
-			if( (g_ROM.GameHacks == WORMS_ARMAGEDDON) && (mTextureInfo.GetSize() == G_IM_SIZ_8b) && (mTextureContentsHash != mTextureInfo.GenerateHashValue()) ) return true;
-
-			//Hack for Zelda OOT & MM text (only needed if there is not a general hash check) //Corn
-			if( g_ROM.ZELDA_HACK && (mTextureInfo.GetSize() == G_IM_SIZ_4b) && mTextureContentsHash != mTextureInfo.GenerateHashValue() ) return true;
-
-			//Check if texture has changed
-			//if( mTextureContentsHash != mTextureInfo.GenerateHashValue() ) return true;
-		}
-	}
-
-	//Otherwise we wait 20+random(0-3) frames before trashing the texture if unused
-	//Spread trashing them over time so not all get killed at once (lower value uses less VRAM) //Corn
-	return gRDPFrame - mFrameLastUsed > (20 + (FastRand() & 0x3));
+	//Hack to make WONDER PROJECT J2 work (need to reload some textures every frame!) //Corn
+	return (g_ROM.GameHacks == WONDER_PROJECTJ2) && (mTextureInfo.GetTLutFormat() == kTT_RGBA16) && (mTextureInfo.GetSize() == G_IM_SIZ_8b);
 }
+#endif
 
 #ifdef DAEDALUS_DEBUG_DISPLAYLIST
 void CachedTexture::DumpTexture( const TextureInfo & ti, const CNativeTexture * texture )
@@ -25,6 +25,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "Graphics/NativeTexture.h"
 #include "TextureInfo.h"
+#include "TextureDecoder.h"
 
 extern u32 gRDPFrame;
 
@@ -36,6 +37,10 @@ class CachedTexture
 
 	public:
 		static CachedTexture *			Create( const TextureInfo & ti );
+#ifdef DAEDALUS_TEXTURE_DECODE_THREADS
+		// Starts decoding the texture on the worker threads, if possible. It's finished by the first UpdateIfNecessary.
+		static CachedTexture *			CreateAsync( const TextureInfo & ti );
+#endif
 
 		inline const CRefPtr<CNativeTexture> &	GetTexture() const			{ return mpTexture; }
 		inline const TextureInfo &		GetTextureInfo() const				{ return mTextureInfo; }
@@ -43,15 +48,21 @@ class CachedTexture
 #ifdef DAEDALUS_DEBUG_DISPLAYLIST
 		static void						DumpTexture( const TextureInfo & ti, const CNativeTexture * texture );
 #endif
-		bool							HasExpired() const;
 
 	private:
 		friend class CTextureCache;
 		void							UpdateIfNecessary();
 
-		bool							Initialise();
+		bool							Initialise( bool async );
 		bool							IsFresh() const;
 		bool							UpdateTextureHash();
+#ifndef DAEDALUS_ENABLE_DIRTY_PAGES
+		bool							AlwaysReload() const;
+#endif
+#ifdef DAEDALUS_TEXTURE_DECODE_THREADS
+		bool							StartDecode();
+		void							FinishDecode();
+#endif
 
 	private:
 		const TextureInfo				mTextureInfo;
@@ -61,6 +72,16 @@ class CachedTexture
 		u32								mTextureContentsHash;
 		u32								mFrameLastUpToDate;	// Frame # that this was last updated
 		u32								mFrameLastUsed;		// Frame # that this was last used
+#ifdef DAEDALUS_ENABLE_DIRTY_PAGES
+		u32								mDirtyEpoch;		// DirtyPages_GetEpoch() when the hash was last updated
+		u32								mTlutLoadCount;		// gTlutLoadCount when the hash was last updated
+#endif
+
+		CachedTexture *					mpLRUPrev;			// The CTextureCache's list, most recently used first
+		CachedTexture *					mpLRUNext;
+#ifdef DAEDALUS_TEXTURE_DECODE_THREADS
+		STextureDecodeJob *				mpDecodeJob;		// Non-NULL until the texture decoded by the workers has been uploaded
+#endif
 };
 
 
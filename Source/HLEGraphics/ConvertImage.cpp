@@ -19,6 +19,7 @@ Copyright (C) 2001 StrmnNrmn
 
 #include "stdafx.h"
 #include "ConvertImage.h"
+#include "ConvertSSE.h"
 #include "TextureInfo.h"
 
 #include "DLDebug.h"
@@ -243,6 +244,52 @@ static void ConvertPalettisedToCI( const TextureDestInfo & dsti, const TextureIn
 	}
 }
 
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+//
+//	Converts the bulk of a row with ConvertTexelsSSE, and leaves the rest to the
+//	scalar row function. SrcXor is the twiddle that src[src_offset ^ F] (and any
+//	fiddling of the output) comes to for aligned offsets.
+//
+template< ETexelKernel Kernel, u32 TexelBits, u32 SrcXor, void (*RowFn)( NativePf8888 *, const u8 *, u32, u32 ) >
+static void ConvertRowSSE( NativePf8888 * dst, const u8 * src, u32 src_offset, u32 width )
+{
+	u32		done( 0 );
+
+	if( ConvertTexelsSSE_IsAligned( src_offset, SrcXor ) )
+	{
+		u32		bytes( ConvertTexelsSSE( Kernel, dst, src + src_offset, width * TexelBits / 8, SrcXor, NULL ) );
+
+		done = bytes * 8 / TexelBits;
+		src_offset += bytes;
+	}
+
+	RowFn( dst + done, src, src_offset, width - done );
+}
+
+template< ETexelKernel Kernel, u32 TexelBits, u32 SrcXor, ConvertPalettisedRowFunction RowFn >
+static void ConvertPalettisedRowSSE( NativePf8888 * dst, const u8 * src, u32 src_offset, u32 width, const NativePf8888 * palette )
+{
+	u32		done( 0 );
+
+	if( ConvertTexelsSSE_IsAligned( src_offset, SrcXor ) )
+	{
+		u32		bytes( ConvertTexelsSSE( Kernel, dst, src + src_offset, width * TexelBits / 8, SrcXor, palette ) );
+
+		done = bytes * 8 / TexelBits;
+		src_offset += bytes;
+	}
+
+	RowFn( dst + done, src, src_offset, width - done, palette );
+}
+
+template< typename InT > struct STexelKernel;
+template<> struct STexelKernel< N64Pf5551 >	{ static const ETexelKernel Kernel = TEXEL_RGBA16; };
+template<> struct STexelKernel< N64Pf8888 >	{ static const ETexelKernel Kernel = TEXEL_RGBA32; };
+template<> struct STexelKernel< N64PfIA16 >	{ static const ETexelKernel Kernel = TEXEL_IA16; };
+template<> struct STexelKernel< N64PfIA8 >	{ static const ETexelKernel Kernel = TEXEL_IA8; };
+template<> struct STexelKernel< N64PfI8 >	{ static const ETexelKernel Kernel = TEXEL_I8; };
+#endif
+
 template < typename InT >
 struct SConvert
 {
@@ -287,6 +334,18 @@ struct SConvert
 												 ConvertRow< OutT, Fiddle, 0 > );
 	}
 
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+	static inline void ConvertTextureSSE( const TextureDestInfo & dsti, const TextureInfo & ti )
+	{
+		// Swizzling the output comes to swapping the words (or for 32 bit texels, the dwords) of the input
+		enum { SwappedXor = sizeof( InT ) == 4 ? 0x8 | 0x3 : 0x4 | 0x3 };
+
+		SConvertGeneric< NativePf8888 >::ConvertGeneric( dsti, ti,
+			ConvertRowSSE< STexelKernel< InT >::Kernel, sizeof( InT ) * 8, SwappedXor, ConvertRow< NativePf8888, Fiddle, Swizzle > >,
+			ConvertRowSSE< STexelKernel< InT >::Kernel, sizeof( InT ) * 8, 0x3, ConvertRow< NativePf8888, Fiddle, 0 > > );
+	}
+#endif
+
 	static void ConvertTexture( const TextureDestInfo & dsti, const TextureInfo & ti )
 	{
 		switch( dsti.Format )
@@ -294,7 +353,11 @@ struct SConvert
 		case TexFmt_5650:	ConvertTextureT< NativePf5650 >( dsti, ti ); return;
 		case TexFmt_5551:	ConvertTextureT< NativePf5551 >( dsti, ti ); return;
 		case TexFmt_4444:	ConvertTextureT< NativePf4444 >( dsti, ti ); return;
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+		case TexFmt_8888:	ConvertTextureSSE( dsti, ti ); return;
+#else
 		case TexFmt_8888:	ConvertTextureT< NativePf8888 >( dsti, ti ); return;
+#endif
 
 		case TexFmt_CI4_8888: break;
 		case TexFmt_CI8_8888: break;
@@ -348,6 +411,15 @@ struct SConvertIA4
 		SConvertGeneric< OutT >::ConvertGeneric( dsti, ti, ConvertRow< OutT, 0x4 | Fiddle >, ConvertRow< OutT, Fiddle > );
 	}
 
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+	static inline void ConvertTextureSSE( const TextureDestInfo & dsti, const TextureInfo & ti )
+	{
+		SConvertGeneric< NativePf8888 >::ConvertGeneric( dsti, ti,
+			ConvertRowSSE< TEXEL_IA4, 4, 0x4 | Fiddle, ConvertRow< NativePf8888, 0x4 | Fiddle > >,
+			ConvertRowSSE< TEXEL_IA4, 4, Fiddle, ConvertRow< NativePf8888, Fiddle > > );
+	}
+#endif
+
 	static void ConvertTexture( const TextureDestInfo & dsti, const TextureInfo & ti )
 	{
 		switch( dsti.Format )
@@ -355,7 +427,11 @@ struct SConvertIA4
 		case TexFmt_5650:	ConvertTextureT< NativePf5650 >( dsti, ti ); return;
 		case TexFmt_5551:	ConvertTextureT< NativePf5551 >( dsti, ti ); return;
 		case TexFmt_4444:	ConvertTextureT< NativePf4444 >( dsti, ti ); return;
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+		case TexFmt_8888:	ConvertTextureSSE( dsti, ti ); return;
+#else
 		case TexFmt_8888:	ConvertTextureT< NativePf8888 >( dsti, ti ); return;
+#endif
 
 		case TexFmt_CI4_8888: break;
 		case TexFmt_CI8_8888: break;
@@ -411,6 +487,15 @@ struct SConvertI4
 		SConvertGeneric< OutT >::ConvertGeneric( dsti, ti, ConvertRow< OutT, 0x4 | Fiddle >, ConvertRow< OutT, Fiddle > );
 	}
 
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+	static inline void ConvertTextureSSE( const TextureDestInfo & dsti, const TextureInfo & ti )
+	{
+		SConvertGeneric< NativePf8888 >::ConvertGeneric( dsti, ti,
+			ConvertRowSSE< TEXEL_I4, 4, 0x4 | Fiddle, ConvertRow< NativePf8888, 0x4 | Fiddle > >,
+			ConvertRowSSE< TEXEL_I4, 4, Fiddle, ConvertRow< NativePf8888, Fiddle > > );
+	}
+#endif
+
 	static void ConvertTexture( const TextureDestInfo & dsti, const TextureInfo & ti )
 	{
 		switch( dsti.Format )
@@ -418,7 +503,11 @@ struct SConvertI4
 		case TexFmt_5650:	ConvertTextureT< NativePf5650 >( dsti, ti ); return;
 		case TexFmt_5551:	ConvertTextureT< NativePf5551 >( dsti, ti ); return;
 		case TexFmt_4444:	ConvertTextureT< NativePf4444 >( dsti, ti ); return;
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+		case TexFmt_8888:	ConvertTextureSSE( dsti, ti ); return;
+#else
 		case TexFmt_8888:	ConvertTextureT< NativePf8888 >( dsti, ti ); return;
+#endif
 
 		case TexFmt_CI4_8888: break;
 		case TexFmt_CI8_8888: break;
@@ -575,9 +664,15 @@ static void ConvertCI8(const TextureDestInfo & dsti, const TextureInfo & ti)
 	switch( dsti.Format )
 	{
 	case TexFmt_8888:
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+		ConvertPalettisedTo8888( dsti, ti, dst_palette,
+								 ConvertPalettisedRowSSE< TEXEL_CI8, 8, 0x4 | 0x3, ConvertCI8_Row_To_8888< 0x4 | 0x3 > >,
+								 ConvertPalettisedRowSSE< TEXEL_CI8, 8, 0x3, ConvertCI8_Row_To_8888< 0x3 > > );
+#else
 		ConvertPalettisedTo8888( dsti, ti, dst_palette,
 								 ConvertCI8_Row_To_8888< 0x4 | 0x3 >,
 								 ConvertCI8_Row_To_8888< 0x3 > );
+#endif
 		break;
 
 	case TexFmt_CI8_8888:
@@ -606,9 +701,15 @@ static void ConvertCI4(const TextureDestInfo & dsti, const TextureInfo & ti)
 	switch( dsti.Format )
 	{
 	case TexFmt_8888:
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+		ConvertPalettisedTo8888( dsti, ti, dst_palette,
+								 ConvertPalettisedRowSSE< TEXEL_CI4, 4, 0x4 | 0x3, ConvertCI4_Row_To_8888< 0x4 | 0x3 > >,
+								 ConvertPalettisedRowSSE< TEXEL_CI4, 4, 0x3, ConvertCI4_Row_To_8888< 0x3 > > );
+#else
 		ConvertPalettisedTo8888( dsti, ti, dst_palette,
 								 ConvertCI4_Row_To_8888< 0x4 | 0x3 >,
 								 ConvertCI4_Row_To_8888< 0x3 > );
+#endif
 		break;
 
 	case TexFmt_CI4_8888:
@@ -0,0 +1,157 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "ConvertSSE.h"
+
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+
+#include <immintrin.h>
+
+#include "Graphics/NativePixelFormat.h"
+
+namespace
+{
+
+typedef u32 (*TexelConvertFunction)( NativePf8888 * dst, const u8 * src, u32 num_bytes, u32 src_xor, const NativePf8888 * palette );
+
+namespace SSE2
+{
+#define TEXCONV_TARGET	__attribute__(( target( "sse2" ) ))
+#define TEXCONV_SSSE3	0
+#define TEXCONV_AVX2	0
+#include "ConvertSSE.inl"
+#undef TEXCONV_TARGET
+#undef TEXCONV_SSSE3
+#undef TEXCONV_AVX2
+}
+
+namespace SSSE3
+{
+#define TEXCONV_TARGET	__attribute__(( target( "ssse3" ) ))
+#define TEXCONV_SSSE3	1
+#define TEXCONV_AVX2	0
+#include "ConvertSSE.inl"
+#undef TEXCONV_TARGET
+#undef TEXCONV_SSSE3
+#undef TEXCONV_AVX2
+}
+
+namespace AVX2
+{
+#define TEXCONV_TARGET	__attribute__(( target( "avx2" ) ))
+#define TEXCONV_SSSE3	1
+#define TEXCONV_AVX2	1
+#include "ConvertSSE.inl"
+#undef TEXCONV_TARGET
+#undef TEXCONV_SSSE3
+#undef TEXCONV_AVX2
+}
+
+const TexelConvertFunction *	gKernelTables[ NUM_TEXEL_ISAS ] =
+{
+	NULL,
+	SSE2::gKernels,
+	SSSE3::gKernels,
+	AVX2::gKernels,
+};
+
+const u32	kTexelBits[ NUM_TEXEL_KERNELS ] =
+{
+	16,		// TEXEL_RGBA16
+	32,		// TEXEL_RGBA32
+	16,		// TEXEL_IA16
+	8,		// TEXEL_IA8
+	8,		// TEXEL_I8
+	4,		// TEXEL_IA4
+	4,		// TEXEL_I4
+	4,		// TEXEL_CI4
+	8,		// TEXEL_CI8
+};
+
+bool	IsISASupported( ETexelISA isa )
+{
+	__builtin_cpu_init();
+
+	switch( isa )
+	{
+	case TEXEL_ISA_NONE:	return true;
+	case TEXEL_ISA_SSE2:	return __builtin_cpu_supports( "sse2" );
+	case TEXEL_ISA_SSSE3:	return __builtin_cpu_supports( "ssse3" );
+	case TEXEL_ISA_AVX2:	return __builtin_cpu_supports( "avx2" );
+	case NUM_TEXEL_ISAS:	break;
+	}
+	return false;
+}
+
+ETexelISA	ChooseISA()
+{
+	if( IsISASupported( TEXEL_ISA_AVX2 ) )	return TEXEL_ISA_AVX2;
+	if( IsISASupported( TEXEL_ISA_SSSE3 ) )	return TEXEL_ISA_SSSE3;
+	if( IsISASupported( TEXEL_ISA_SSE2 ) )	return TEXEL_ISA_SSE2;
+	return TEXEL_ISA_NONE;
+}
+
+ETexelISA	gISA( ChooseISA() );
+
+} // anonymous namespace
+
+//*****************************************************************************
+//
+//*****************************************************************************
+u32 ConvertTexelsSSE( ETexelKernel kernel, NativePf8888 * dst, const u8 * src, u32 num_bytes, u32 src_xor, const NativePf8888 * palette )
+{
+	DAEDALUS_ASSERT( kernel < NUM_TEXEL_KERNELS, "Invalid kernel %d", kernel );
+	DAEDALUS_ASSERT( palette != NULL || (kernel != TEXEL_CI4 && kernel != TEXEL_CI8), "No palette" );
+
+	if( gISA == TEXEL_ISA_NONE )
+		return 0;
+
+	u32		done( gKernelTables[ gISA ][ kernel ]( dst, src, num_bytes, src_xor, palette ) );
+
+	// AVX2 works on 32 bytes at a time, so there may be a 16 byte block left over
+	if( gISA == TEXEL_ISA_AVX2 && num_bytes - done >= 16 )
+	{
+		done += SSSE3::gKernels[ kernel ]( dst + done * 8 / kTexelBits[ kernel ], src + done, num_bytes - done, src_xor, palette );
+	}
+
+	return done;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+ETexelISA ConvertTexelsSSE_GetISA()
+{
+	return gISA;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+bool ConvertTexelsSSE_SetISA( ETexelISA isa )
+{
+	if( !IsISASupported( isa ) )
+		return false;
+
+	gISA = isa;
+	return true;
+}
+
+#endif // DAEDALUS_ENABLE_SSE_TEXCONV
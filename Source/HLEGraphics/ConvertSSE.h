@@ -0,0 +1,87 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef HLEGRAPHICS_CONVERTSSE_H_
+#define HLEGRAPHICS_CONVERTSSE_H_
+
+//
+//	SIMD versions of the inner loops of ConvertImage and ConvertTile, for the
+//	desktop builds which always convert to NativePf8888. Each kernel takes a
+//	run of N64 texels and converts them 16 (or with AVX2, 32) bytes at a time.
+//
+//	N64 texture data is twiddled, differently in RDRAM and TMEM and on odd
+//	rows of swapped textures. The kernels take the twiddle as an XOR on the
+//	byte offsets: logical byte i of the run is read from src[i ^ src_xor],
+//	and is undone with a shuffle before the texels are converted. This only
+//	matches the callers' src[(src_offset + i) ^ src_xor] when src_offset is
+//	aligned to the twiddle - see ConvertTexelsSSE_IsAligned.
+//
+//	The kernels are built for SSE2, SSSE3 and AVX2, and the best one the cpu
+//	supports is picked the first time they're used. The results are the same
+//	as the scalar code's, bit for bit (see ConvertSSE_test.cpp).
+//
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+
+struct NativePf8888;
+
+enum ETexelKernel
+{
+	TEXEL_RGBA16 = 0,
+	TEXEL_RGBA32,
+	TEXEL_IA16,
+	TEXEL_IA8,
+	TEXEL_I8,
+	TEXEL_IA4,
+	TEXEL_I4,
+	TEXEL_CI4,			// palette is 16 already converted entries
+	TEXEL_CI8,			// palette is 256 already converted entries
+
+	NUM_TEXEL_KERNELS
+};
+
+enum ETexelISA
+{
+	TEXEL_ISA_NONE = 0,	// Leave everything to the scalar code
+	TEXEL_ISA_SSE2,
+	TEXEL_ISA_SSSE3,
+	TEXEL_ISA_AVX2,
+
+	NUM_TEXEL_ISAS
+};
+
+// Converts as many whole blocks of the num_bytes at src as possible, returning the number of bytes converted.
+// src_xor must be 0, 3, 4, 7, 8 or 11.
+u32			ConvertTexelsSSE( ETexelKernel kernel, NativePf8888 * dst, const u8 * src, u32 num_bytes, u32 src_xor, const NativePf8888 * palette );
+
+// Can the texels at src_offset be passed to ConvertTexelsSSE with this src_xor?
+inline bool	ConvertTexelsSSE_IsAligned( u32 src_offset, u32 src_xor )
+{
+	u32		period( src_xor >= 8 ? 16 : src_xor >= 4 ? 8 : src_xor ? 4 : 1 );
+
+	return (src_offset & (period - 1)) == 0;
+}
+
+ETexelISA	ConvertTexelsSSE_GetISA();
+bool		ConvertTexelsSSE_SetISA( ETexelISA isa );		// Returns false if the cpu doesn't support isa
+
+#endif // DAEDALUS_ENABLE_SSE_TEXCONV
+
+#endif // HLEGRAPHICS_CONVERTSSE_H_
@@ -0,0 +1,484 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+//
+//	The kernels for one instruction set. Included by ConvertSSE.cpp once per
+//	instruction set, inside its own namespace, with:
+//
+//	TEXCONV_TARGET	The target attribute for the instruction set
+//	TEXCONV_SSSE3	Non zero if pshufb can be used
+//	TEXCONV_AVX2	Non zero to work on 32 byte blocks
+//
+//	Everything is written in terms of 128 bit lanes. The AVX2 unpacks work
+//	within each lane, so a 32 byte block is converted as two 16 byte blocks
+//	side by side, and the lanes put back in order by StoreTexels. This means
+//	all of a block's results have to be stored with a single StoreTexels.
+//
+
+#define TEXCONV_FN	static inline TEXCONV_TARGET
+
+//*****************************************************************************
+//
+//*****************************************************************************
+#if TEXCONV_AVX2
+typedef __m256i V;
+
+TEXCONV_FN V	Load( const u8 * p )			{ return _mm256_loadu_si256( reinterpret_cast< const __m256i * >( p ) ); }
+TEXCONV_FN void	Store( NativePf8888 * p, V v )	{ _mm256_storeu_si256( reinterpret_cast< __m256i * >( p ), v ); }
+TEXCONV_FN V	Zero()							{ return _mm256_setzero_si256(); }
+TEXCONV_FN V	Set8( u8 x )					{ return _mm256_set1_epi8( x ); }
+TEXCONV_FN V	Set16( u16 x )					{ return _mm256_set1_epi16( x ); }
+TEXCONV_FN V	And( V a, V b )					{ return _mm256_and_si256( a, b ); }
+TEXCONV_FN V	Or( V a, V b )					{ return _mm256_or_si256( a, b ); }
+TEXCONV_FN V	Sub8( V a, V b )				{ return _mm256_sub_epi8( a, b ); }
+TEXCONV_FN V	Sub16( V a, V b )				{ return _mm256_sub_epi16( a, b ); }
+TEXCONV_FN V	Sll16( V a, int n )				{ return _mm256_slli_epi16( a, n ); }
+TEXCONV_FN V	Srl16( V a, int n )				{ return _mm256_srli_epi16( a, n ); }
+TEXCONV_FN V	UnpackLo8( V a, V b )			{ return _mm256_unpacklo_epi8( a, b ); }
+TEXCONV_FN V	UnpackHi8( V a, V b )			{ return _mm256_unpackhi_epi8( a, b ); }
+TEXCONV_FN V	UnpackLo16( V a, V b )			{ return _mm256_unpacklo_epi16( a, b ); }
+TEXCONV_FN V	UnpackHi16( V a, V b )			{ return _mm256_unpackhi_epi16( a, b ); }
+TEXCONV_FN V	Shuffle8( V a, V idx )			{ return _mm256_shuffle_epi8( a, idx ); }
+TEXCONV_FN V	Broadcast( __m128i a )			{ return _mm256_broadcastsi128_si256( a ); }
+
+// out[] holds the results for both lanes - write out all of the first lane's, then all of the second's
+template< u32 N >
+TEXCONV_FN void StoreTexels( NativePf8888 * dst, const V * out )
+{
+	for( u32 k = 0; k < N; k += 2 )
+	{
+		Store( dst + 4*k,       _mm256_permute2x128_si256( out[ k ], out[ k+1 ], 0x20 ) );
+		Store( dst + 4*(N + k), _mm256_permute2x128_si256( out[ k ], out[ k+1 ], 0x31 ) );
+	}
+}
+#else
+typedef __m128i V;
+
+TEXCONV_FN V	Load( const u8 * p )			{ return _mm_loadu_si128( reinterpret_cast< const __m128i * >( p ) ); }
+TEXCONV_FN void	Store( NativePf8888 * p, V v )	{ _mm_storeu_si128( reinterpret_cast< __m128i * >( p ), v ); }
+TEXCONV_FN V	Zero()							{ return _mm_setzero_si128(); }
+TEXCONV_FN V	Set8( u8 x )					{ return _mm_set1_epi8( x ); }
+TEXCONV_FN V	Set16( u16 x )					{ return _mm_set1_epi16( x ); }
+TEXCONV_FN V	And( V a, V b )					{ return _mm_and_si128( a, b ); }
+TEXCONV_FN V	Or( V a, V b )					{ return _mm_or_si128( a, b ); }
+TEXCONV_FN V	Sub8( V a, V b )				{ return _mm_sub_epi8( a, b ); }
+TEXCONV_FN V	Sub16( V a, V b )				{ return _mm_sub_epi16( a, b ); }
+TEXCONV_FN V	Sll16( V a, int n )				{ return _mm_slli_epi16( a, n ); }
+TEXCONV_FN V	Srl16( V a, int n )				{ return _mm_srli_epi16( a, n ); }
+TEXCONV_FN V	UnpackLo8( V a, V b )			{ return _mm_unpacklo_epi8( a, b ); }
+TEXCONV_FN V	UnpackHi8( V a, V b )			{ return _mm_unpackhi_epi8( a, b ); }
+TEXCONV_FN V	UnpackLo16( V a, V b )			{ return _mm_unpacklo_epi16( a, b ); }
+TEXCONV_FN V	UnpackHi16( V a, V b )			{ return _mm_unpackhi_epi16( a, b ); }
+#if TEXCONV_SSSE3
+TEXCONV_FN V	Shuffle8( V a, V idx )			{ return _mm_shuffle_epi8( a, idx ); }
+TEXCONV_FN V	Broadcast( __m128i a )			{ return a; }
+#endif
+
+template< u32 N >
+TEXCONV_FN void StoreTexels( NativePf8888 * dst, const V * out )
+{
+	for( u32 k = 0; k < N; ++k )
+	{
+		Store( dst + 4*k, out[ k ] );
+	}
+}
+#endif
+
+//*****************************************************************************
+//	Puts the bytes of each 16 byte lane back in their logical order
+//*****************************************************************************
+template< u32 Xor >
+TEXCONV_FN V Untwiddle( V v )
+{
+	if( Xor == 0 )
+		return v;
+
+#if TEXCONV_SSSE3
+	const __m128i	idx( _mm_setr_epi8( 0^Xor, 1^Xor,  2^Xor,  3^Xor,  4^Xor,  5^Xor,  6^Xor,  7^Xor,
+										8^Xor, 9^Xor, 10^Xor, 11^Xor, 12^Xor, 13^Xor, 14^Xor, 15^Xor ) );
+	return Shuffle8( v, Broadcast( idx ) );
+#else
+	if( Xor & 3 )
+	{
+		// Byteswap each word
+		v = Or( Sll16( v, 8 ), Srl16( v, 8 ) );
+		v = _mm_shufflelo_epi16( v, _MM_SHUFFLE( 2, 3, 0, 1 ) );
+		v = _mm_shufflehi_epi16( v, _MM_SHUFFLE( 2, 3, 0, 1 ) );
+	}
+	if( Xor & 4 )
+	{
+		v = _mm_shuffle_epi32( v, _MM_SHUFFLE( 2, 3, 0, 1 ) );
+	}
+	if( Xor & 8 )
+	{
+		v = _mm_shuffle_epi32( v, _MM_SHUFFLE( 1, 0, 3, 2 ) );
+	}
+	return v;
+#endif
+}
+
+//*****************************************************************************
+//	Interleaves four planes of 16 bytes into 16 NativePf8888s
+//*****************************************************************************
+TEXCONV_FN void Interleave( V r, V g, V b, V a, V * out )
+{
+	V	rg_lo( UnpackLo8( r, g ) );
+	V	ba_lo( UnpackLo8( b, a ) );
+	V	rg_hi( UnpackHi8( r, g ) );
+	V	ba_hi( UnpackHi8( b, a ) );
+
+	out[ 0 ] = UnpackLo16( rg_lo, ba_lo );
+	out[ 1 ] = UnpackHi16( rg_lo, ba_lo );
+	out[ 2 ] = UnpackLo16( rg_hi, ba_hi );
+	out[ 3 ] = UnpackHi16( rg_hi, ba_hi );
+}
+
+//*****************************************************************************
+//	Splits 16 bytes of 4 bit texels into 32 bytes, high nibble first
+//*****************************************************************************
+TEXCONV_FN void SplitNibbles( V v, V * n )
+{
+	V	hi( And( Srl16( v, 4 ), Set8( 0x0f ) ) );
+	V	lo( And( v, Set8( 0x0f ) ) );
+
+	n[ 0 ] = UnpackLo8( hi, lo );
+	n[ 1 ] = UnpackHi8( hi, lo );
+}
+
+//*****************************************************************************
+//	The converters. Each converts a block of logically ordered bytes
+//*****************************************************************************
+struct SConvertRGBA16
+{
+	enum { kBits = 16 };
+
+	explicit SConvertRGBA16( const NativePf8888 * ) {}
+
+	TEXCONV_TARGET void Block( V v, NativePf8888 * dst ) const
+	{
+		V	p( Or( Sll16( v, 8 ), Srl16( v, 8 ) ) );		// The N64Pf5551s
+		V	mask( Set16( 0xf8 ) );
+
+		V	r( And( Srl16( p, 8 ), mask ) );
+		V	g( And( Srl16( p, 3 ), mask ) );
+		V	b( And( Sll16( p, 2 ), mask ) );
+		V	a( Sub16( Zero(), And( p, Set16( 0x0001 ) ) ) );
+
+		r = Or( r, Srl16( r, 5 ) );
+		g = Or( g, Srl16( g, 5 ) );
+		b = Or( b, Srl16( b, 5 ) );
+
+		V	rg( Or( r, Sll16( g, 8 ) ) );
+		V	ba( Or( b, And( a, Set16( 0xff00 ) ) ) );
+		V	out[ 2 ] = { UnpackLo16( rg, ba ), UnpackHi16( rg, ba ) };
+
+		StoreTexels< 2 >( dst, out );
+	}
+};
+
+struct SConvertRGBA32
+{
+	enum { kBits = 32 };
+
+	explicit SConvertRGBA32( const NativePf8888 * ) {}
+
+	// RGBA is already in NativePf8888's byte order
+	TEXCONV_TARGET void Block( V v, NativePf8888 * dst ) const
+	{
+		Store( dst, v );
+	}
+};
+
+struct SConvertIA16
+{
+	enum { kBits = 16 };
+
+	explicit SConvertIA16( const NativePf8888 * ) {}
+
+	TEXCONV_TARGET void Block( V v, NativePf8888 * dst ) const
+	{
+		V	ii( Or( And( v, Set16( 0x00ff ) ), Sll16( v, 8 ) ) );
+		V	out[ 2 ] = { UnpackLo16( ii, v ), UnpackHi16( ii, v ) };
+
+		StoreTexels< 2 >( dst, out );
+	}
+};
+
+struct SConvertIA8
+{
+	enum { kBits = 8 };
+
+	explicit SConvertIA8( const NativePf8888 * ) {}
+
+	TEXCONV_TARGET void Block( V v, NativePf8888 * dst ) const
+	{
+		V	i( And( Srl16( v, 4 ), Set8( 0x0f ) ) );
+		V	a( And( v, Set8( 0x0f ) ) );
+		V	out[ 4 ];
+
+		i = Or( i, Sll16( i, 4 ) );
+		a = Or( a, Sll16( a, 4 ) );
+
+		Interleave( i, i, i, a, out );
+		StoreTexels< 4 >( dst, out );
+	}
+};
+
+struct SConvertI8
+{
+	enum { kBits = 8 };
+
+	explicit SConvertI8( const NativePf8888 * ) {}
+
+	TEXCONV_TARGET void Block( V v, NativePf8888 * dst ) const
+	{
+		V	out[ 4 ];
+
+		Interleave( v, v, v, v, out );
+		StoreTexels< 4 >( dst, out );
+	}
+};
+
+struct SConvertIA4
+{
+	enum { kBits = 4 };
+
+	explicit SConvertIA4( const NativePf8888 * ) {}
+
+	TEXCONV_TARGET void Block( V v, NativePf8888 * dst ) const
+	{
+		V	n[ 2 ];
+		SplitNibbles( v, n );
+
+		V	out[ 8 ];
+
+		for( u32 h = 0; h < 2; ++h )
+		{
+			// ThreeToEight and OneToEight
+			V	i3( And( Srl16( n[ h ], 1 ), Set8( 0x07 ) ) );
+			V	i( Or( Or( Sll16( i3, 5 ), Sll16( i3, 2 ) ), And( Srl16( i3, 1 ), Set8( 0x03 ) ) ) );
+			V	a( Sub8( Zero(), And( n[ h ], Set8( 0x01 ) ) ) );
+
+			Interleave( i, i, i, a, out + 4*h );
+		}
+
+		StoreTexels< 8 >( dst, out );
+	}
+};
+
+struct SConvertI4
+{
+	enum { kBits = 4 };
+
+	explicit SConvertI4( const NativePf8888 * ) {}
+
+	TEXCONV_TARGET void Block( V v, NativePf8888 * dst ) const
+	{
+		V	n[ 2 ];
+		SplitNibbles( v, n );
+
+		V	out[ 8 ];
+
+		for( u32 h = 0; h < 2; ++h )
+		{
+			V	i( Or( n[ h ], Sll16( n[ h ], 4 ) ) );
+
+			Interleave( i, i, i, i, out + 4*h );
+		}
+
+		StoreTexels< 8 >( dst, out );
+	}
+};
+
+#if TEXCONV_SSSE3
+//
+//	The 16 entry palette fits in a register per channel, so the lookups are
+//	done with pshufb.
+//
+struct SConvertCI4
+{
+	enum { kBits = 4 };
+
+	TEXCONV_TARGET explicit SConvertCI4( const NativePf8888 * palette )
+	{
+		const __m128i	transpose( _mm_setr_epi8( 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15 ) );
+		const __m128i *	p( reinterpret_cast< const __m128i * >( palette ) );
+
+		__m128i		t0( _mm_shuffle_epi8( _mm_loadu_si128( p + 0 ), transpose ) );		// R0-3, G0-3, B0-3, A0-3
+		__m128i		t1( _mm_shuffle_epi8( _mm_loadu_si128( p + 1 ), transpose ) );
+		__m128i		t2( _mm_shuffle_epi8( _mm_loadu_si128( p + 2 ), transpose ) );
+		__m128i		t3( _mm_shuffle_epi8( _mm_loadu_si128( p + 3 ), transpose ) );
+
+		__m128i		rg_lo( _mm_unpacklo_epi32( t0, t1 ) );		// R0-7, G0-7
+		__m128i		rg_hi( _mm_unpacklo_epi32( t2, t3 ) );
+		__m128i		ba_lo( _mm_unpackhi_epi32( t0, t1 ) );
+		__m128i		ba_hi( _mm_unpackhi_epi32( t2, t3 ) );
+
+		mR = Broadcast( _mm_unpacklo_epi64( rg_lo, rg_hi ) );
+		mG = Broadcast( _mm_unpackhi_epi64( rg_lo, rg_hi ) );
+		mB = Broadcast( _mm_unpacklo_epi64( ba_lo, ba_hi ) );
+		mA = Broadcast( _mm_unpackhi_epi64( ba_lo, ba_hi ) );
+	}
+
+	TEXCONV_TARGET void Block( V v, NativePf8888 * dst ) const
+	{
+		V	n[ 2 ];
+		SplitNibbles( v, n );
+
+		V	out[ 8 ];
+
+		for( u32 h = 0; h < 2; ++h )
+		{
+			Interleave( Shuffle8( mR, n[ h ] ), Shuffle8( mG, n[ h ] ), Shuffle8( mB, n[ h ] ), Shuffle8( mA, n[ h ] ), out + 4*h );
+		}
+
+		StoreTexels< 8 >( dst, out );
+	}
+
+	V		mR;
+	V		mG;
+	V		mB;
+	V		mA;
+};
+#else
+struct SConvertCI4
+{
+	enum { kBits = 4 };
+
+	explicit SConvertCI4( const NativePf8888 * palette ) : mPalette( palette ) {}
+
+	TEXCONV_TARGET void Block( V v, NativePf8888 * dst ) const
+	{
+		V	n[ 2 ];
+		SplitNibbles( v, n );
+
+		u8	idx[ 2 * sizeof( V ) ];
+		_mm_storeu_si128( reinterpret_cast< __m128i * >( idx ),     n[ 0 ] );
+		_mm_storeu_si128( reinterpret_cast< __m128i * >( idx ) + 1, n[ 1 ] );
+
+		for( u32 x = 0; x < 2 * sizeof( V ); ++x )
+		{
+			dst[ x ] = mPalette[ idx[ x ] ];
+		}
+	}
+
+	const NativePf8888 *	mPalette;
+};
+#endif
+
+#if TEXCONV_AVX2
+struct SConvertCI8
+{
+	enum { kBits = 8 };
+
+	explicit SConvertCI8( const NativePf8888 * palette ) : mPalette( reinterpret_cast< const int * >( palette ) ) {}
+
+	TEXCONV_TARGET void Block( V v, NativePf8888 * dst ) const
+	{
+		const __m128i	lanes[ 2 ] = { _mm256_castsi256_si128( v ), _mm256_extracti128_si256( v, 1 ) };
+
+		for( u32 h = 0; h < 2; ++h )
+		{
+			__m256i		lo( _mm256_cvtepu8_epi32( lanes[ h ] ) );
+			__m256i		hi( _mm256_cvtepu8_epi32( _mm_srli_si128( lanes[ h ], 8 ) ) );
+
+			Store( dst + 0, _mm256_i32gather_epi32( mPalette, lo, 4 ) );
+			Store( dst + 8, _mm256_i32gather_epi32( mPalette, hi, 4 ) );
+
+			dst += 16;
+		}
+	}
+
+	const int *		mPalette;
+};
+#else
+struct SConvertCI8
+{
+	enum { kBits = 8 };
+
+	explicit SConvertCI8( const NativePf8888 * palette ) : mPalette( palette ) {}
+
+	// No gathers, so just untwiddle the indices
+	TEXCONV_TARGET void Block( V v, NativePf8888 * dst ) const
+	{
+		u8	idx[ sizeof( V ) ];
+		_mm_storeu_si128( reinterpret_cast< __m128i * >( idx ), v );
+
+		for( u32 x = 0; x < sizeof( V ); ++x )
+		{
+			dst[ x ] = mPalette[ idx[ x ] ];
+		}
+	}
+
+	const NativePf8888 *	mPalette;
+};
+#endif
+
+//*****************************************************************************
+//
+//*****************************************************************************
+template< typename Converter, u32 Xor >
+TEXCONV_FN u32 ConvertBlocks( const Converter & converter, NativePf8888 * dst, const u8 * src, u32 num_bytes )
+{
+	const u32	num_blocks( num_bytes / sizeof( V ) );
+
+	for( u32 i = 0; i < num_blocks; ++i )
+	{
+		converter.Block( Untwiddle< Xor >( Load( src ) ), dst );
+
+		src += sizeof( V );
+		dst += sizeof( V ) * 8 / Converter::kBits;
+	}
+
+	return num_blocks * sizeof( V );
+}
+
+template< typename Converter >
+static TEXCONV_TARGET u32 Convert( NativePf8888 * dst, const u8 * src, u32 num_bytes, u32 src_xor, const NativePf8888 * palette )
+{
+	const Converter		converter( palette );
+
+	switch( src_xor )
+	{
+	case 0:		return ConvertBlocks< Converter, 0 >( converter, dst, src, num_bytes );
+	case 3:		return ConvertBlocks< Converter, 3 >( converter, dst, src, num_bytes );
+	case 4:		return ConvertBlocks< Converter, 4 >( converter, dst, src, num_bytes );
+	case 7:		return ConvertBlocks< Converter, 7 >( converter, dst, src, num_bytes );
+	case 8:		return ConvertBlocks< Converter, 8 >( converter, dst, src, num_bytes );
+	case 11:	return ConvertBlocks< Converter, 11 >( converter, dst, src, num_bytes );
+	}
+
+	DAEDALUS_ERROR( "Unhandled twiddle %d", src_xor );
+	return 0;
+}
+
+static const TexelConvertFunction gKernels[ NUM_TEXEL_KERNELS ] =
+{
+	Convert< SConvertRGBA16 >,
+	Convert< SConvertRGBA32 >,
+	Convert< SConvertIA16 >,
+	Convert< SConvertIA8 >,
+	Convert< SConvertI8 >,
+	Convert< SConvertIA4 >,
+	Convert< SConvertI4 >,
+	Convert< SConvertCI4 >,
+	Convert< SConvertCI8 >,
+};
+
+#undef TEXCONV_FN
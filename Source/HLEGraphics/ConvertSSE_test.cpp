@@ -0,0 +1,217 @@
+#include <stdafx.h>
+#include "HLEGraphics/ConvertSSE.h"
+#include "HLEGraphics/ConvertImage.h"
+#include "HLEGraphics/ConvertTile.h"
+#include "HLEGraphics/TextureInfo.h"
+#include "Core/Memory.h"
+#include "Graphics/NativePixelFormat.h"
+#include "OSHLE/ultra_gbi.h"
+#include "Utility/Alignment.h"
+#include "Utility/Macros.h"
+
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+
+//
+//	The kernels are checked against the production scalar converters, by
+//	running ConvertTexture and ConvertTileRows with TEXEL_ISA_NONE (which
+//	leaves every texel to the scalar row functions) and then with each ISA.
+//
+struct SFormat
+{
+	u32			Format;
+	u32			Size;
+	ETLutFmt	TLutFormat;
+};
+
+static const SFormat kFormats[] =
+{
+	{ G_IM_FMT_RGBA,	G_IM_SIZ_16b,	kTT_NONE },
+	{ G_IM_FMT_RGBA,	G_IM_SIZ_32b,	kTT_NONE },
+	{ G_IM_FMT_IA,		G_IM_SIZ_16b,	kTT_NONE },
+	{ G_IM_FMT_IA,		G_IM_SIZ_8b,	kTT_NONE },
+	{ G_IM_FMT_I,		G_IM_SIZ_8b,	kTT_NONE },
+	{ G_IM_FMT_IA,		G_IM_SIZ_4b,	kTT_NONE },
+	{ G_IM_FMT_I,		G_IM_SIZ_4b,	kTT_NONE },
+	{ G_IM_FMT_CI,		G_IM_SIZ_4b,	kTT_RGBA16 },
+	{ G_IM_FMT_CI,		G_IM_SIZ_8b,	kTT_RGBA16 },
+	{ G_IM_FMT_CI,		G_IM_SIZ_4b,	kTT_IA16 },
+	{ G_IM_FMT_CI,		G_IM_SIZ_8b,	kTT_IA16 },
+};
+
+static const u32 kWidths[] = { 1, 2, 3, 7, 8, 15, 16, 17, 24, 31, 32, 33, 48, 63, 64 };
+static const u32 kHeight = 4;
+static const u32 kMaxWidth = 64;
+static const u32 kDstPitch = (kMaxWidth + 8) * sizeof(NativePf8888);	// Room for the scalar code's overrun
+
+static u32 GetRowBytes(const SFormat & format, u32 width)
+{
+	return (width << format.Size) / 2;
+}
+
+class ConvertTextureSSETest : public ::testing::TestWithParam< ::std::tr1::tuple<u32, u32, bool> >
+{
+protected:
+	virtual void SetUp()
+	{
+		mOldISA = ConvertTexelsSSE_GetISA();
+		mOldRamBase = g_pMemoryBuffers[MEM_RD_RAM];
+		g_pMemoryBuffers[MEM_RD_RAM] = mRam;
+
+		u32 seed = 0x12345678;
+		for (u32 i = 0; i < sizeof(mRam); ++i)
+		{
+			seed = seed * 1664525 + 1013904223;
+			mRam[i] = seed >> 24;
+		}
+		for (u32 i = 0; i < sizeof(mTmem); ++i)
+		{
+			seed = seed * 1664525 + 1013904223;
+			mTmem[i] = seed >> 24;
+		}
+	}
+
+	virtual void TearDown()
+	{
+		ConvertTexelsSSE_SetISA(mOldISA);
+		g_pMemoryBuffers[MEM_RD_RAM] = mOldRamBase;
+	}
+
+	void Clear()
+	{
+		memset(mExpected, 0xcd, sizeof(mExpected));
+		memset(mDst, 0xcd, sizeof(mDst));
+	}
+
+	::testing::AssertionResult Matches() const
+	{
+		for (u32 i = 0; i < sizeof(mDst) / sizeof(mDst[0]); ++i)
+		{
+			if (mExpected[i] != mDst[i])
+				return ::testing::AssertionFailure() << "word " << i << " expected " << std::hex << mExpected[i] << " got " << mDst[i];
+		}
+		return ::testing::AssertionSuccess();
+	}
+
+	ETexelISA	mOldISA;
+	void *		mOldRamBase;
+
+	ALIGNED_MEMBER(u8, mRam[16384], 16);
+	ALIGNED_MEMBER(u8, mTmem[4096], 16);
+	u32			mExpected[kHeight * kDstPitch / sizeof(u32)];
+	u32			mDst[kHeight * kDstPitch / sizeof(u32)];
+};
+
+TEST_P(ConvertTextureSSETest, ConvertTextureMatchesScalar)
+{
+	ETexelISA		isa     = ETexelISA(::std::tr1::get<0>(GetParam()));
+	const SFormat &	format  = kFormats[::std::tr1::get<1>(GetParam())];
+	bool			swapped = ::std::tr1::get<2>(GetParam());
+
+	if (!ConvertTexelsSSE_SetISA(isa))
+		return;
+
+	// TlutAddress is a 32 bit host address, so the RDRAM palettes can't be pointed at
+	// on 64 bit hosts. The CI kernels are covered by ConvertTileMatchesScalar.
+	if (format.Format == G_IM_FMT_CI)
+		return;
+
+	const u32 offsets[] = { 0, 4, 8, 16, 20 };
+	for (u32 w = 0; w < ARRAYSIZE(kWidths); ++w)
+	{
+		for (u32 o = 0; o < ARRAYSIZE(offsets); ++o)
+		{
+			u32 width = kWidths[w];
+
+			TextureInfo ti;
+			ti.SetFormat(format.Format);
+			ti.SetSize(format.Size);
+			ti.SetWidth(width);
+			ti.SetHeight(kHeight);
+			ti.SetPitch(((GetRowBytes(format, width) + 7) & ~7) + (o & 8));
+			ti.SetLoadAddress(1024 + offsets[o]);
+			ti.SetSwapped(swapped);
+
+			Clear();
+			ASSERT_TRUE(ConvertTexelsSSE_SetISA(TEXEL_ISA_NONE));
+			ASSERT_TRUE(ConvertTexture(ti, mExpected, NULL, TexFmt_8888, kDstPitch));
+			ASSERT_TRUE(ConvertTexelsSSE_SetISA(isa));
+			ASSERT_TRUE(ConvertTexture(ti, mDst, NULL, TexFmt_8888, kDstPitch));
+
+			EXPECT_TRUE(Matches()) << "width " << width << " offset " << offsets[o];
+		}
+	}
+}
+
+TEST_P(ConvertTextureSSETest, ConvertTileMatchesScalar)
+{
+	ETexelISA		isa     = ETexelISA(::std::tr1::get<0>(GetParam()));
+	const SFormat &	format  = kFormats[::std::tr1::get<1>(GetParam())];
+	bool			odd_line = ::std::tr1::get<2>(GetParam());
+
+	if (!ConvertTexelsSSE_SetISA(isa))
+		return;
+
+	const u32 tmem_addresses[] = { 0, 1, 2, 5 };
+	for (u32 w = 0; w < ARRAYSIZE(kWidths); ++w)
+	{
+		for (u32 t = 0; t < ARRAYSIZE(tmem_addresses); ++t)
+		{
+			u32 width = kWidths[w];
+			u32 line = (GetRowBytes(format, width) + 7) / 8;
+			if (format.Size == G_IM_SIZ_32b)
+				line = (line + 1) / 2;			// RGBA32 is split between the two halves of TMEM
+
+			TextureInfo ti;
+			ti.SetFormat(format.Format);
+			ti.SetSize(format.Size);
+			ti.SetTLutFormat(format.TLutFormat);
+			ti.SetWidth(width);
+			ti.SetHeight(kHeight);
+			ti.SetTmemAddress(tmem_addresses[t]);
+			ti.SetLine(line + (odd_line ? 1 : 0));
+			ti.SetPalette(t);
+
+			Clear();
+			ASSERT_TRUE(ConvertTexelsSSE_SetISA(TEXEL_ISA_NONE));
+			ASSERT_TRUE(ConvertTileRows(ti, mTmem, 0, kHeight, mExpected, NULL, TexFmt_8888, kDstPitch));
+			ASSERT_TRUE(ConvertTexelsSSE_SetISA(isa));
+			ASSERT_TRUE(ConvertTileRows(ti, mTmem, 0, kHeight, mDst, NULL, TexFmt_8888, kDstPitch));
+
+			EXPECT_TRUE(Matches()) << "width " << width << " tmem " << tmem_addresses[t];
+		}
+	}
+}
+
+INSTANTIATE_TEST_CASE_P(X, ConvertTextureSSETest, ::testing::Combine(::testing::Values(TEXEL_ISA_SSE2, TEXEL_ISA_SSSE3, TEXEL_ISA_AVX2),
+																	 ::testing::Range(0u, u32(ARRAYSIZE(kFormats))),
+																	 ::testing::Bool()));
+
+TEST(ConvertTexelsSSE, NoneConvertsNothing)
+{
+	ETexelISA old_isa = ConvertTexelsSSE_GetISA();
+	ASSERT_TRUE(ConvertTexelsSSE_SetISA(TEXEL_ISA_NONE));
+
+	u8 src[64] = { 0 };
+	NativePf8888 dst[64];
+	for (u32 k = 0; k < NUM_TEXEL_KERNELS; ++k)
+		EXPECT_EQ(0u, ConvertTexelsSSE(ETexelKernel(k), dst, src, sizeof(src), 0, dst));
+
+	ConvertTexelsSSE_SetISA(old_isa);
+}
+
+TEST(ConvertTexelsSSE, IsAligned)
+{
+	EXPECT_TRUE(ConvertTexelsSSE_IsAligned(5, 0));
+	EXPECT_TRUE(ConvertTexelsSSE_IsAligned(4, 3));
+	EXPECT_FALSE(ConvertTexelsSSE_IsAligned(2, 3));
+	EXPECT_TRUE(ConvertTexelsSSE_IsAligned(8, 7));
+	EXPECT_FALSE(ConvertTexelsSSE_IsAligned(4, 4));
+	EXPECT_TRUE(ConvertTexelsSSE_IsAligned(16, 11));
+	EXPECT_FALSE(ConvertTexelsSSE_IsAligned(8, 8));
+}
+
+#endif // DAEDALUS_ENABLE_SSE_TEXCONV
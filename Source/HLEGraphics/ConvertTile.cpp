@@ -2,6 +2,7 @@
 
 #ifdef DAEDALUS_ACCURATE_TMEM
 #include "ConvertTile.h"
+#include "ConvertSSE.h"
 #include "RDP.h"
 #include "Core/ROM.h"
 #include "TextureInfo.h"
@@ -20,6 +21,8 @@ struct TileDestInfo
 		,	Height( 0 )
 		,	Pitch( 0 )
 		,	Data( NULL )
+		,	Tmem( NULL )
+		,	FirstRow( 0 )
 		//,	Palette( NULL )
 	{
 	}
@@ -29,6 +32,8 @@ struct TileDestInfo
 	u32					Height;			// Describes the height of the locked area
 	s32					Pitch;			// Specifies the number of bytes on each row (not necessarily bitdepth*width/8)
 	void *				Data;			// Pointer to the top left pixel of the image
+	const u8 *			Tmem;			// The TMEM contents to convert from (usually gTMEM)
+	u32					FirstRow;		// The row of the tile that Data corresponds to. Always even, so the row swizzle starts at 0
 	//NativePf8888 *		Palette;
 };
 
@@ -126,6 +131,20 @@ static u32 IA4(u8 v)
 	return (a<<24) | (i<<16) | (i<<8) | i;
 }
 
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+// Converts as much of the row as possible with ConvertTexelsSSE, returning the number of texels converted
+static u32 ConvertRowSSE( const u8 * tmem, ETexelKernel kernel, u32 texel_bits, void * dst, u32 src_offset, u32 width, u32 row_swizzle, const u32 * palette = NULL )
+{
+	if( !ConvertTexelsSSE_IsAligned( src_offset, row_swizzle ) )
+		return 0;
+
+	u32 bytes = ConvertTexelsSSE( kernel, static_cast<NativePf8888*>(dst), tmem + src_offset, width * texel_bits / 8, row_swizzle,
+								  reinterpret_cast<const NativePf8888*>(palette) );
+
+	return bytes * 8 / texel_bits;
+}
+#endif
+
 static void ConvertRGBA32(const TileDestInfo & dsti, const TextureInfo & ti)
 {
 	u32 width = dsti.Width;
@@ -135,19 +154,26 @@ static void ConvertRGBA32(const TileDestInfo & dsti, const TextureInfo & ti)
 	u32 dst_row_stride = dsti.Pitch;
 	u32 dst_row_offset = 0;
 
-	const u8 * src     = gTMEM;
+	const u8 * src     = dsti.Tmem;
 	u32 src_row_stride = ti.GetLine()<<3;
 	u32 src_row_offset = ti.GetTmemAddress()<<3;
 
 	// NB! RGBA/32 line needs to be doubled.
 	src_row_stride *= 2;
+	src_row_offset += dsti.FirstRow * src_row_stride;
 
 	u32 row_swizzle = 0;
 	for (u32 y = 0; y < height; ++y)
 	{
 		u32 src_offset = src_row_offset;
 		u32 dst_offset = dst_row_offset;
-		for (u32 x = 0; x < width; ++x)
+		u32 x = 0;
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+		x = ConvertRowSSE(dsti.Tmem, TEXEL_RGBA32, 32, &dst[dst_offset], src_offset, width, row_swizzle);
+		src_offset += x*4;
+		dst_offset += x*4;
+#endif
+		for (; x < width; ++x)
 		{
 			u32 o = src_offset^row_swizzle;
 
@@ -175,16 +201,22 @@ static void ConvertRGBA16(const TileDestInfo & dsti, const TextureInfo & ti)
 	u32 dst_row_stride = dsti.Pitch / sizeof(u32);
 	u32 dst_row_offset = 0;
 
-	const u16 * src     = (u16*)gTMEM;
+	const u16 * src     = (const u16*)dsti.Tmem;
 	u32 src_row_stride = ti.GetLine()<<2;
-	u32 src_row_offset = ti.GetTmemAddress()<<2;
+	u32 src_row_offset = (ti.GetTmemAddress()<<2) + dsti.FirstRow * src_row_stride;
 
 	u32 row_swizzle = 0;
 	for (u32 y = 0; y < height; ++y)
 	{
 		u32 src_offset = src_row_offset;
 		u32 dst_offset = dst_row_offset;
-		for (u32 x = 0; x < width; ++x)
+		u32 x = 0;
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+		x = ConvertRowSSE(dsti.Tmem, TEXEL_RGBA16, 16, &dst[dst_offset], src_offset*2, width, row_swizzle*2);
+		src_offset += x;
+		dst_offset += x;
+#endif
+		for (; x < width; ++x)
 		{
 			u16 src_pixel = BSWAP16( src[src_offset^row_swizzle] );
 
@@ -210,11 +242,11 @@ static void ConvertCI8T(const TileDestInfo & dsti, const TextureInfo & ti)
 	u32 dst_row_stride = dsti.Pitch / sizeof(u32);
 	u32 dst_row_offset = 0;
 
-	const u8 * src     = gTMEM;
-	const u16 * src16  = (u16*)src;
+	const u8 * src     = dsti.Tmem;
+	const u16 * src16  = (const u16*)src;
 
 	u32 src_row_stride = ti.GetLine()<<3;
-	u32 src_row_offset = ti.GetTmemAddress()<<3;
+	u32 src_row_offset = (ti.GetTmemAddress()<<3) + dsti.FirstRow * src_row_stride;
 
 	// Convert the palette once, here.
 	u32 palette[256];
@@ -229,7 +261,13 @@ static void ConvertCI8T(const TileDestInfo & dsti, const TextureInfo & ti)
 	{
 		u32 src_offset = src_row_offset;
 		u32 dst_offset = dst_row_offset;
-		for (u32 x = 0; x < width; ++x)
+		u32 x = 0;
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+		x = ConvertRowSSE(dsti.Tmem, TEXEL_CI8, 8, &dst[dst_offset], src_offset, width, row_swizzle, palette);
+		src_offset += x;
+		dst_offset += x;
+#endif
+		for (; x < width; ++x)
 		{
 			u8 src_pixel = src[src_offset^row_swizzle];
 
@@ -255,11 +293,11 @@ static void ConvertCI4T(const TileDestInfo & dsti, const TextureInfo & ti)
 	u32 dst_row_stride = dsti.Pitch / sizeof(u32);
 	u32 dst_row_offset = 0;
 
-	const u8 * src     = gTMEM;
-	const u16 * src16  = (u16*)src;
+	const u8 * src     = dsti.Tmem;
+	const u16 * src16  = (const u16*)src;
 
 	u32 src_row_stride = ti.GetLine()<<3;
-	u32 src_row_offset = ti.GetTmemAddress()<<3;
+	u32 src_row_offset = (ti.GetTmemAddress()<<3) + dsti.FirstRow * src_row_stride;
 
 	// Convert the palette once, here.
 	u32 pal_address = 0x400 + (ti.GetPalette()<<6);
@@ -276,9 +314,15 @@ static void ConvertCI4T(const TileDestInfo & dsti, const TextureInfo & ti)
 	{
 		u32 src_offset = src_row_offset;
 		u32 dst_offset = dst_row_offset;
+		u32 x = 0;
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+		x = ConvertRowSSE(dsti.Tmem, TEXEL_CI4, 4, &dst[dst_offset], src_offset, width, row_swizzle, palette);
+		src_offset += x/2;
+		dst_offset += x;
+#endif
 
 		// Process 2 pixels at a time
-		for (u32 x = 0; x+1 < width; x += 2)
+		for (; x+1 < width; x += 2)
 		{
 			u16 src_pixel = src[src_offset^row_swizzle];
 
@@ -350,16 +394,22 @@ static void ConvertIA16(const TileDestInfo & dsti, const TextureInfo & ti)
 	u32 dst_row_stride = dsti.Pitch;
 	u32 dst_row_offset = 0;
 
-	const u8 * src     = gTMEM;
+	const u8 * src     = dsti.Tmem;
 	u32 src_row_stride = ti.GetLine()<<3;
-	u32 src_row_offset = ti.GetTmemAddress()<<3;
+	u32 src_row_offset = (ti.GetTmemAddress()<<3) + dsti.FirstRow * src_row_stride;
 
 	u32 row_swizzle = 0;
 	for (u32 y = 0; y < height; ++y)
 	{
 		u32 src_offset = src_row_offset;
 		u32 dst_offset = dst_row_offset;
-		for (u32 x = 0; x < width; ++x)
+		u32 x = 0;
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+		x = ConvertRowSSE(dsti.Tmem, TEXEL_IA16, 16, &dst[dst_offset], src_offset, width, row_swizzle);
+		src_offset += x*2;
+		dst_offset += x*4;
+#endif
+		for (; x < width; ++x)
 		{
 			u32 o        = src_offset^row_swizzle;
 
@@ -390,16 +440,22 @@ static void ConvertIA8(const TileDestInfo & dsti, const TextureInfo & ti)
 	u32 dst_row_stride = dsti.Pitch;
 	u32 dst_row_offset = 0;
 
-	const u8 * src     = gTMEM;
+	const u8 * src     = dsti.Tmem;
 	u32 src_row_stride = ti.GetLine()<<3;
-	u32 src_row_offset = ti.GetTmemAddress()<<3;
+	u32 src_row_offset = (ti.GetTmemAddress()<<3) + dsti.FirstRow * src_row_stride;
 
 	u32 row_swizzle = 0;
 	for (u32 y = 0; y < height; ++y)
 	{
 		u32 src_offset = src_row_offset;
 		u32 dst_offset = dst_row_offset;
-		for (u32 x = 0; x < width; ++x)
+		u32 x = 0;
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+		x = ConvertRowSSE(dsti.Tmem, TEXEL_IA8, 8, &dst[dst_offset], src_offset, width, row_swizzle);
+		src_offset += x;
+		dst_offset += x*4;
+#endif
+		for (; x < width; ++x)
 		{
 			u8 src_pixel = src[src_offset^row_swizzle];
 
@@ -430,18 +486,24 @@ static void ConvertIA4(const TileDestInfo & dsti, const TextureInfo & ti)
 	u32 dst_row_stride = dsti.Pitch / sizeof(u32);
 	u32 dst_row_offset = 0;
 
-	const u8 * src     = gTMEM;
+	const u8 * src     = dsti.Tmem;
 	u32 src_row_stride = ti.GetLine()<<3;
-	u32 src_row_offset = ti.GetTmemAddress()<<3;
+	u32 src_row_offset = (ti.GetTmemAddress()<<3) + dsti.FirstRow * src_row_stride;
 
 	u32 row_swizzle = 0;
 	for (u32 y = 0; y < height; ++y)
 	{
 		u32 src_offset = src_row_offset;
 		u32 dst_offset = dst_row_offset;
+		u32 x = 0;
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+		x = ConvertRowSSE(dsti.Tmem, TEXEL_IA4, 4, &dst[dst_offset], src_offset, width, row_swizzle);
+		src_offset += x/2;
+		dst_offset += x;
+#endif
 
 		// Process 2 pixels at a time
-		for (u32 x = 0; x+1 < width; x += 2)
+		for (; x+1 < width; x += 2)
 		{
 			u8 src_pixel = src[src_offset^row_swizzle];
 
@@ -479,16 +541,22 @@ static void ConvertI8(const TileDestInfo & dsti, const TextureInfo & ti)
 	u32 dst_row_stride = dsti.Pitch;
 	u32 dst_row_offset = 0;
 
-	const u8 * src     = gTMEM;
+	const u8 * src     = dsti.Tmem;
 	u32 src_row_stride = ti.GetLine()<<3;
-	u32 src_row_offset = ti.GetTmemAddress()<<3;
+	u32 src_row_offset = (ti.GetTmemAddress()<<3) + dsti.FirstRow * src_row_stride;
 
 	u32 row_swizzle = 0;
 	for (u32 y = 0; y < height; ++y)
 	{
 		u32 src_offset = src_row_offset;
 		u32 dst_offset = dst_row_offset;
-		for (u32 x = 0; x < width; ++x)
+		u32 x = 0;
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+		x = ConvertRowSSE(dsti.Tmem, TEXEL_I8, 8, &dst[dst_offset], src_offset, width, row_swizzle);
+		src_offset += x;
+		dst_offset += x*4;
+#endif
+		for (; x < width; ++x)
 		{
 			u8 i = src[src_offset^row_swizzle];
 
@@ -516,19 +584,25 @@ static void ConvertI4(const TileDestInfo & dsti, const TextureInfo & ti)
 	u32 dst_row_stride = dsti.Pitch / sizeof(u32);
 	u32 dst_row_offset = 0;
 
-	const u8 * src     = gTMEM;
+	const u8 * src     = dsti.Tmem;
 
 	u32 src_row_stride = ti.GetLine()<<3;
-	u32 src_row_offset = ti.GetTmemAddress()<<3;
+	u32 src_row_offset = (ti.GetTmemAddress()<<3) + dsti.FirstRow * src_row_stride;
 
 	u32 row_swizzle = 0;
 	for (u32 y = 0; y < height; ++y)
 	{
 		u32 src_offset = src_row_offset;
 		u32 dst_offset = dst_row_offset;
+		u32 x = 0;
+#ifdef DAEDALUS_ENABLE_SSE_TEXCONV
+		x = ConvertRowSSE(dsti.Tmem, TEXEL_I4, 4, &dst[dst_offset], src_offset, width, row_swizzle);
+		src_offset += x/2;
+		dst_offset += x;
+#endif
 
 		// Process 2 pixels at a time
-		for (u32 x = 0; x+1 < width; x += 2)
+		for (; x+1 < width; x += 2)
 		{
 			u8 src_pixel = src[src_offset^row_swizzle];
 
@@ -576,14 +650,30 @@ bool ConvertTile(const TextureInfo & ti,
 				 NativePf8888 * palette,
 				 ETextureFormat texture_format,
 				 u32 pitch)
+{
+	return ConvertTileRows(ti, gTMEM, 0, ti.GetHeight(), texels, palette, texture_format, pitch);
+}
+
+bool ConvertTileRows(const TextureInfo & ti,
+					 const u8 * tmem,
+					 u32 first_row,
+					 u32 num_rows,
+					 void * texels,
+					 NativePf8888 * palette,
+					 ETextureFormat texture_format,
+					 u32 pitch)
 {
 	DAEDALUS_ASSERT(texture_format == TexFmt_8888, "OSX should only use RGBA 8888 textures");
+	DAEDALUS_ASSERT((first_row & 1) == 0, "First row must be even");
+	DAEDALUS_ASSERT(first_row + num_rows <= ti.GetHeight(), "Too many rows");
 
 	TileDestInfo dsti( texture_format );
-	dsti.Data    = texels;
-	dsti.Width   = ti.GetWidth();
-	dsti.Height  = ti.GetHeight();
-	dsti.Pitch   = pitch;
+	dsti.Data     = static_cast<u8*>(texels) + first_row * pitch;
+	dsti.Width    = ti.GetWidth();
+	dsti.Height   = num_rows;
+	dsti.Pitch    = pitch;
+	dsti.Tmem     = tmem;
+	dsti.FirstRow = first_row;
 	//dsti.Palette = palette;
 
 	DAEDALUS_ASSERT(ti.GetLine() != 0, "No line");
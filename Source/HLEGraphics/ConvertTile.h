@@ -12,4 +12,16 @@ bool ConvertTile(const TextureInfo & ti,
 				 ETextureFormat texture_format,
 				 u32 pitch);
 
+// Converts rows [first_row, first_row+num_rows) of the tile from a copy of TMEM.
+// texels points at the top left of the whole tile. first_row must be even, as
+// odd rows are swizzled. Used to decode the rows of a tile in parallel.
+bool ConvertTileRows(const TextureInfo & ti,
+					 const u8 * tmem,
+					 u32 first_row,
+					 u32 num_rows,
+					 void * texels,
+					 NativePf8888 * palette,
+					 ETextureFormat texture_format,
+					 u32 pitch);
+
 #endif // HLEGRAPHICS_CONVERTTILE_H_
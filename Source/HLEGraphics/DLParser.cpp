@@ -183,6 +183,12 @@ static u32				gLastUcodeBase   = 0;
 static SImageDescriptor g_CI = { G_IM_FMT_RGBA, G_IM_SIZ_16b, 1, 0 };
 static SImageDescriptor g_DI = { G_IM_FMT_RGBA, G_IM_SIZ_16b, 1, 0 };
 
+#ifdef DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+static const u32		kMaxTaskImages = 8;
+static SFramebufferRange gTaskImages[ kMaxTaskImages ];
+static u32				gNumTaskImages = 0;
+#endif
+
 const MicroCodeInstruction *gUcodeFunc = NULL;
 MicroCodeInstruction gCustomInstruction[256];
 
@@ -509,13 +515,11 @@ static u32 DLParser_ProcessDList(u32 instruction_limit)
 //*****************************************************************************
 //
 //*****************************************************************************
-u32 DLParser_Process(u32 instruction_limit, DLDebugOutput * debug_output)
+bool DLParser_BeginTask()
 {
-	DAEDALUS_PROFILE( "DLParser_Process" );
-
 	if ( !CGraphicsContext::Get()->IsInitialised() || !gRenderer )
 	{
-		return 0;
+		return false;
 	}
 
 	// Shut down the debug console when we start rendering
@@ -528,10 +532,19 @@ u32 DLParser_Process(u32 instruction_limit, DLDebugOutput * debug_output)
 		gFirstCall = false;
 	}
 
-	// Update Screen only when something is drawn, otherwise several games ex Army Men will flash or shake.
-	if( g_ROM.GameHacks != CHAMELEON_TWIST_2 ) gGraphicsPlugin->UpdateScreen();
+	if(!gFrameskipActive)
+	{
+		gRenderer->SetVIScales();
+	}
 
-	OSTask * pTask = (OSTask *)(g_pu8SpMemBase + 0x0FC0);
+	return true;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+static u32 DLParser_RunTask(const OSTask * pTask, u32 instruction_limit, DLDebugOutput * debug_output)
+{
 	u32 code_base = (u32)pTask->t.ucode & 0x1fffffff;
 	u32 code_size = pTask->t.ucode_size;
 	u32 data_base = (u32)pTask->t.ucode_data & 0x1fffffff;
@@ -551,6 +564,10 @@ u32 DLParser_Process(u32 instruction_limit, DLDebugOutput * debug_output)
 
 	gRDPFrame++;
 
+#ifdef DAEDALUS_ENABLE_DIRTY_PAGES
+	DirtyPages_Sweep();
+#endif
+
 	CTextureCache::Get()->PurgeOldTextures();
 
 	// Initialise stack
@@ -560,6 +577,10 @@ u32 DLParser_Process(u32 instruction_limit, DLDebugOutput * debug_output)
 
 	gRDPStateManager.Reset();
 
+#ifdef DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+	gNumTaskImages = 0;
+#endif
+
 #ifdef DAEDALUS_DEBUG_DISPLAYLIST
 	gNumDListsCulled = 0;
 	gNumVertices = 0;
@@ -575,7 +596,6 @@ u32 DLParser_Process(u32 instruction_limit, DLDebugOutput * debug_output)
 
 	if(!gFrameskipActive)
 	{
-		gRenderer->SetVIScales();
 		gRenderer->ResetMatrices(stack_size);
 		gRenderer->Reset();
 		gRenderer->BeginScene();
@@ -583,13 +603,6 @@ u32 DLParser_Process(u32 instruction_limit, DLDebugOutput * debug_output)
 		gRenderer->EndScene();
 	}
 
-	// Hack for Chameleon Twist 2, only works if screen is update at last
-	//
-	if( g_ROM.GameHacks == CHAMELEON_TWIST_2 ) gGraphicsPlugin->UpdateScreen();
-
-	// Do this regardless!
-	FinishRDPJob();
-
 #ifdef DAEDALUS_DEBUG_DISPLAYLIST
 	DLDebug_SetOutput(NULL);
 
@@ -599,6 +612,34 @@ u32 DLParser_Process(u32 instruction_limit, DLDebugOutput * debug_output)
 		gNumInstructionsExecuted = count;
 #endif
 
+	return count;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+u32 DLParser_Process(u32 instruction_limit, DLDebugOutput * debug_output)
+{
+	DAEDALUS_PROFILE( "DLParser_Process" );
+
+	if ( !DLParser_BeginTask() )
+	{
+		return 0;
+	}
+
+	// Update Screen only when something is drawn, otherwise several games ex Army Men will flash or shake.
+	if( g_ROM.GameHacks != CHAMELEON_TWIST_2 ) gGraphicsPlugin->UpdateScreen();
+
+	const OSTask * pTask = (const OSTask *)(g_pu8SpMemBase + 0x0FC0);
+	u32 count = DLParser_RunTask(pTask, instruction_limit, debug_output);
+
+	// Hack for Chameleon Twist 2, only works if screen is update at last
+	//
+	if( g_ROM.GameHacks == CHAMELEON_TWIST_2 ) gGraphicsPlugin->UpdateScreen();
+
+	// Do this regardless!
+	FinishRDPJob();
+
 #ifdef DAEDALUS_BATCH_TEST_ENABLED
 	CBatchTestEventHandler * handler( BatchTest_GetHandler() );
 	if( handler )
@@ -608,6 +649,50 @@ u32 DLParser_Process(u32 instruction_limit, DLDebugOutput * debug_output)
 	return count;
 }
 
+//*****************************************************************************
+//	The task has been copied out of SP memory by the caller, and it's up to
+//	the caller to call DLParser_BeginTask, update the screen and raise the
+//	DP interrupt.
+//*****************************************************************************
+u32 DLParser_ProcessTask(const OSTask & task)
+{
+	DAEDALUS_PROFILE( "DLParser_ProcessTask" );
+
+	if ( !CGraphicsContext::Get()->IsInitialised() || !gRenderer )
+	{
+		return 0;
+	}
+
+	return DLParser_RunTask(&task, kUnlimitedInstructionCount, NULL);
+}
+
+#ifdef DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+//*****************************************************************************
+//	Only the width is known, so the images are assumed to be 4:3
+//*****************************************************************************
+static void DLParser_AddTaskImage( u32 address, u32 pitch, u32 width )
+{
+	for( u32 i = 0; i < gNumTaskImages; ++i )
+	{
+		if( gTaskImages[ i ].Address == address )
+			return;
+	}
+
+	if( gNumTaskImages < kMaxTaskImages )
+	{
+		gTaskImages[ gNumTaskImages ].Address = address;
+		gTaskImages[ gNumTaskImages ].Length = pitch * (width * 3 / 4);
+		gNumTaskImages++;
+	}
+}
+
+u32 DLParser_GetTaskImages( const SFramebufferRange ** images )
+{
+	*images = gTaskImages;
+	return gNumTaskImages;
+}
+#endif
+
 //*****************************************************************************
 //
 //*****************************************************************************
@@ -851,6 +936,14 @@ void DLParser_SetTileSize( MicroCodeCommand command )
 				((tile.bottom/4) - (tile.top/4)) + 1);
 
 	gRDPStateManager.SetTileSize( tile );
+
+#ifdef DAEDALUS_TEXTURE_DECODE_THREADS
+	// The texture is usually loaded by now, so start decoding it while the rest of the display list is parsed
+	if( tile.tile_idx != G_TX_LOADTILE && gRDPStateManager.IsTileInitialised( tile.tile_idx ) )
+	{
+		CTextureCache::Get()->PrefetchTexture( gRDPStateManager.GetUpdatedTextureDescriptor( tile.tile_idx ) );
+	}
+#endif
 }
 
 
@@ -1057,6 +1150,8 @@ void Clear_N64DepthBuffer( MicroCodeCommand command )
 	u32 zi_width_in_dwords = g_CI.Width >> 1;
 	u32 fill_colour = gRenderer->GetFillColour();
 	u32 * dst = (u32*)(g_pu8RamBase + g_CI.Address) + y0 * zi_width_in_dwords;
+
+	MEMORY_MARK_DIRTY_HOST_RANGE( dst, (y1 - y0) * zi_width_in_dwords * 4 );
 	
 	for( u32 y = y0; y <y1; y++ )
 	{
@@ -1160,6 +1255,11 @@ void DLParser_SetZImg( MicroCodeCommand command )
 
 	// No need check for (MAX_RAM_ADDRESS-1) here, since g_DI.Address is never used to reference a RAM location
 	g_DI.Address = RDPSegAddr(command.inst.cmd1);
+
+#ifdef DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+	// The depth buffer is always 16 bit, and as wide as the colour image
+	DLParser_AddTaskImage( g_DI.Address & (MAX_RAM_ADDRESS-1), g_CI.Width << 1, g_CI.Width );
+#endif
 }
 
 //*****************************************************************************
@@ -1173,6 +1273,10 @@ void DLParser_SetCImg( MicroCodeCommand command )
 	g_CI.Address = RDPSegAddr(command.img.addr) & (MAX_RAM_ADDRESS-1);
 	//g_CI.Bpl		= g_CI.Width << g_CI.Size >> 1;
 
+#ifdef DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+	DLParser_AddTaskImage( g_CI.Address, g_CI.GetPitch(), g_CI.Width );
+#endif
+
 	DL_PF("    CImg Adr[0x%08x] Format[%s] Size[%s] Width[%d]", RDPSegAddr(command.inst.cmd1), gFormatNames[ g_CI.Format ], gSizeNames[ g_CI.Size ], g_CI.Width);
 }
 
@@ -23,6 +23,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include <stdlib.h>
 
+#include "OSHLE/ultra_sptask.h"
 #include "Utility/DaedalusTypes.h"
 
 class DLDebugOutput;
@@ -33,4 +34,21 @@ void DLParser_Finalise();
 const u32 kUnlimitedInstructionCount = u32( ~0 );
 u32 DLParser_Process(u32 instruction_limit = kUnlimitedInstructionCount, DLDebugOutput * debug_output = NULL);
 
+// Reads the VI state for the next task. Returns false if there's nothing to render to.
+bool DLParser_BeginTask();
+
+// Runs a copy of a graphics task without touching the RSP or MI state, for the display list thread
+u32 DLParser_ProcessTask(const OSTask & task);
+
+#ifdef DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+struct SFramebufferRange
+{
+	u32		Address;
+	u32		Length;
+};
+
+// The colour and depth images the last task was given, as ranges of RDRAM
+u32 DLParser_GetTaskImages( const SFramebufferRange ** images );
+#endif
+
 #endif // HLEGRAPHICS_DLPARSER_H_
@@ -44,6 +44,7 @@ RDP_OtherMode		gRDPOtherMode;
 
 //Granularity down to 24bytes is good enuff also only need to address the upper half of TMEM for palettes//Corn
 u32* gTlutLoadAddresses[ MAX_TMEM_ADDRESS >> 6 ];
+u32 gTlutLoadCount = 0;
 
 
 #ifdef DAEDALUS_ACCURATE_TMEM
@@ -564,6 +565,7 @@ void CRDPStateManager::LoadTlut(const SetLoadTile & load)
 
 	//Store address of PAL (assuming PAL is only stored in upper half of TMEM) //Corn
 	gTlutLoadAddresses[ (rdp_tile.tmem>>2) & 0x3F ] = (u32*)address;
+	gTlutLoadCount++;
 
 	DL_PF("    TLut Addr[0x%08x] TMEM[0x%03x] Tile[%d] Count[%d] Format[%s] (%d,%d)->(%d,%d)",
 		address, rdp_tile.tmem, tile_idx, count, kTLUTTypeName[gRDPOtherMode.text_tlut], uls >> 2, ult >> 2, lrs >> 2, lrt >> 2);
@@ -92,6 +92,7 @@ extern RDP_OtherMode		gRDPOtherMode;
 
 extern u32* gTlutLoadAddresses[ 4096 >> 6 ];
 #define TLUT_BASE ((u32)(gTlutLoadAddresses[0]))
+extern u32 gTlutLoadCount;		// Bumped by every palette load, so cached CI textures know to check their palette
 
 
 #endif // HLEGRAPHICS_RDPSTATEMANAGER_H_
@@ -18,7 +18,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 */
 
 // Manages textures for RDP code
-// Uses a HashTable (hashing on TImg) to allow quick access
+// Uses an open addressed hash table (keyed on TextureInfo) to allow quick access
 //  to previously used textures
 
 #include "stdafx.h"
@@ -26,12 +26,13 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "TextureCache.h"
 #include "TextureInfo.h"
 
+#include "Config/ConfigOptions.h"
+#include "Utility/Hash.h"
 #include "Utility/Profiler.h"
 
 #include "DLDebug.h"
 
 #include <vector>
-#include <algorithm>
 
 //#define PROFILE_TEXTURE_CACHE
 
@@ -44,127 +45,197 @@ template<> bool CSingleton< CTextureCache >::Create()
 }
 
 CTextureCache::CTextureCache()
+:	mEntries( INITIAL_TABLE_SIZE )
+,	mNumTextures( 0 )
+,	mBytesUsed( 0 )
+,	mpMostRecent( NULL )
+,	mpLeastRecent( NULL )
 #ifdef DAEDALUS_DEBUG_DISPLAYLIST
-:	mDebugMutex("TextureCache")
+,	mDebugMutex("TextureCache")
 #endif
 {
-	memset( mpCacheHashTable, 0, sizeof(mpCacheHashTable) );
+#ifdef DAEDALUS_TEXTURE_DECODE_THREADS
+	gTextureDecoder.Start();
+#endif
 }
 
 CTextureCache::~CTextureCache()
 {
 	DropTextures();
+#ifdef DAEDALUS_TEXTURE_DECODE_THREADS
+	gTextureDecoder.Stop();
+#endif
 }
 
-inline u32 CTextureCache::MakeHashIdxA( const TextureInfo & ti )
+inline u32 CTextureCache::MakeHash( const TextureInfo & ti )
 {
-	u32 address( ti.GetLoadAddress() );
-	u32 hash( (address >> (HASH_TABLE_BITS*2)) ^ (address >> HASH_TABLE_BITS) ^ address );
+	return murmur2_hash( &ti, sizeof( TextureInfo ), 0 );
+}
 
-	hash ^= ti.GetPalette() >> 2;			// Useful for palettised fonts, e.g in Starfox
+u32 CTextureCache::FindSlot( const TextureInfo & ti, u32 hash ) const
+{
+	u32 mask = mEntries.size() - 1;
 
-	return hash & (HASH_TABLE_SIZE-1);
+	for( u32 slot = hash & mask; ; slot = (slot + 1) & mask )
+	{
+		const SEntry & entry = mEntries[ slot ];
+		if( entry.Texture == NULL || (entry.Hash == hash && entry.Info == ti) )
+		{
+			return slot;
+		}
+	}
 }
 
-inline u32 CTextureCache::MakeHashIdxB( const TextureInfo & ti )
+void CTextureCache::Insert( u32 slot, u32 hash, CachedTexture * texture )
 {
-	return ti.GetHashCode() & (HASH_TABLE_SIZE-1);
+	DAEDALUS_ASSERT( mEntries[ slot ].Texture == NULL, "Slot is in use" );
+
+	SEntry & entry = mEntries[ slot ];
+	entry.Info    = texture->GetTextureInfo();
+	entry.Hash    = hash;
+	entry.Texture = texture;
+
+	mNumTextures++;
+	mBytesUsed += texture->GetTexture()->GetBytesRequired();
+	LinkMostRecent( texture );
+
+	// Keep the table at most half full, so probes stay short
+	if( mNumTextures * 2 > mEntries.size() )
+	{
+		Grow();
+	}
 }
 
-// Purge any textures that haven't been used recently
-void CTextureCache::PurgeOldTextures()
+// Closes the gap left by the texture by shifting back any entries which probed past it,
+// so lookups never need to skip over deleted entries.
+void CTextureCache::Remove( CachedTexture * texture )
 {
-	MutexLock lock(GetDebugMutex());
+	const TextureInfo & ti = texture->GetTextureInfo();
+	u32 mask = mEntries.size() - 1;
+	u32 hole = FindSlot( ti, MakeHash( ti ) );
 
-	//
-	//	Erase expired textures in reverse order, which should require less
-	//	copying when large clumps of textures are released simultaneously.
-	//
-	for( s32 i = mTextures.size() - 1; i >= 0; --i )
+	DAEDALUS_ASSERT( mEntries[ hole ].Texture == texture, "Texture isn't in the cache" );
+
+	for( u32 slot = (hole + 1) & mask; mEntries[ slot ].Texture != NULL; slot = (slot + 1) & mask )
 	{
-		CachedTexture * texture = mTextures[ i ];
-		if ( texture->HasExpired() )
+		u32 home = mEntries[ slot ].Hash & mask;
+
+		// Leave the entry where it is if its home slot is cyclically in (hole, slot]
+		bool reachable = (hole <= slot) ? (hole < home && home <= slot)
+										: (hole < home || home <= slot);
+		if( !reachable )
 		{
-			u32	ixa = MakeHashIdxA( texture->GetTextureInfo() );
-			u32 ixb = MakeHashIdxB( texture->GetTextureInfo() );
+			mEntries[ hole ] = mEntries[ slot ];
+			hole = slot;
+		}
+	}
+
+	mEntries[ hole ].Texture = NULL;
 
-			if( mpCacheHashTable[ixa] == texture )
-			{
-				mpCacheHashTable[ixa] = NULL;
-			}
-			if( mpCacheHashTable[ixb] == texture )
-			{
-				mpCacheHashTable[ixb] = NULL;
-			}
+	mNumTextures--;
+	mBytesUsed -= texture->GetTexture()->GetBytesRequired();
+	Unlink( texture );
+}
 
-			mTextures.erase( mTextures.begin() + i );
+void CTextureCache::Grow()
+{
+	std::vector< SEntry > old_entries( mEntries.size() * 2 );
+	old_entries.swap( mEntries );
 
-			delete texture;
+	for( u32 i = 0; i < old_entries.size(); ++i )
+	{
+		const SEntry & entry = old_entries[ i ];
+		if( entry.Texture != NULL )
+		{
+			mEntries[ FindSlot( entry.Info, entry.Hash ) ] = entry;
 		}
 	}
 }
 
-void CTextureCache::DropTextures()
+void CTextureCache::LinkMostRecent( CachedTexture * texture )
+{
+	texture->mpLRUPrev = NULL;
+	texture->mpLRUNext = mpMostRecent;
+
+	if( mpMostRecent != NULL )
+	{
+		mpMostRecent->mpLRUPrev = texture;
+	}
+	else
+	{
+		mpLeastRecent = texture;
+	}
+	mpMostRecent = texture;
+}
+
+void CTextureCache::Unlink( CachedTexture * texture )
+{
+	if( texture->mpLRUPrev != NULL )	texture->mpLRUPrev->mpLRUNext = texture->mpLRUNext;
+	else								mpMostRecent = texture->mpLRUNext;
+
+	if( texture->mpLRUNext != NULL )	texture->mpLRUNext->mpLRUPrev = texture->mpLRUPrev;
+	else								mpLeastRecent = texture->mpLRUPrev;
+
+	texture->mpLRUPrev = NULL;
+	texture->mpLRUNext = NULL;
+}
+
+// Purge the least recently used textures until we're within budget
+void CTextureCache::PurgeOldTextures()
 {
 	MutexLock lock(GetDebugMutex());
 
-	for( u32 i = 0; i < mTextures.size(); ++i)
+	while( mBytesUsed > gTextureCacheBudget && mpLeastRecent != NULL &&
+		   gRDPFrame - mpLeastRecent->mFrameLastUsed >= MIN_FRAMES_TO_KEEP )
 	{
-		delete mTextures[i];
+		CachedTexture * texture = mpLeastRecent;
+
+		Remove( texture );
+		delete texture;
 	}
-	mTextures.clear();
-	for( u32 i = 0; i < HASH_TABLE_SIZE; ++i )
+}
+
+void CTextureCache::DropTextures()
+{
+	MutexLock lock(GetDebugMutex());
+
+	while( mpMostRecent != NULL )
 	{
-		mpCacheHashTable[i] = NULL;
+		CachedTexture * texture = mpMostRecent;
+
+		Unlink( texture );
+		delete texture;
 	}
+
+	std::vector< SEntry > entries( INITIAL_TABLE_SIZE );
+	mEntries.swap( entries );
+	mNumTextures = 0;
+	mBytesUsed = 0;
 }
 
 #ifdef PROFILE_TEXTURE_CACHE
-#define RECORD_CACHE_HIT( a, b )		TextureCacheStat( a, b, mTextures.size() )
+#define RECORD_CACHE_HIT( a )		TextureCacheStat( a, mNumTextures, mBytesUsed )
 
-static void TextureCacheStat( u32 l1_hit, u32 l2_hit, u32 size )
+static void TextureCacheStat( u32 hit, u32 size, u32 bytes )
 {
 	static u32 total_lookups = 0;
-	static u32 total_l1_hits = 0;
-	static u32 total_l2_hits = 0;
+	static u32 total_hits = 0;
 
-	total_l1_hits += l1_hit;
-	total_l2_hits += l2_hit;
+	total_hits += hit;
 	++total_lookups;
 
 	if( total_lookups == 1000 )
 	{
-		printf( "L1 hits[%d] L2 hits[%d] Miss[%d] (%d entries)\n", total_l1_hits, total_l2_hits, total_lookups - (total_l1_hits+total_l2_hits), size );
-		total_lookups = total_l1_hits = total_l2_hits = 0;
+		printf( "Hits[%d] Miss[%d] (%d entries, %d bytes)\n", total_hits, total_lookups - total_hits, size, bytes );
+		total_lookups = total_hits = 0;
 	}
 }
 #else
 
-#define RECORD_CACHE_HIT( a, b )
+#define RECORD_CACHE_HIT( a )
 
 #endif
 
-struct SSortTextureEntries
-{
-public:
-	bool operator()( const TextureInfo & a, const TextureInfo & b ) const
-	{
-		return a < b;
-	}
-	bool operator()( const CachedTexture * a, const TextureInfo & b ) const
-	{
-		return a->GetTextureInfo() < b;
-	}
-	bool operator()( const TextureInfo & a, const CachedTexture * b ) const
-	{
-		return a < b->GetTextureInfo();
-	}
-	bool operator()( const CachedTexture * a, const CachedTexture * b ) const
-	{
-		return a->GetTextureInfo() < b->GetTextureInfo();
-	}
-};
-
 // If already in table, return cached copy
 // Otherwise, create surfaces, and load texture into memory
 CachedTexture * CTextureCache::GetOrCreateCachedTexture(const TextureInfo & ti)
@@ -174,57 +245,62 @@ CachedTexture * CTextureCache::GetOrCreateCachedTexture(const TextureInfo & ti)
 	// NB: this is a no-op in normal builds.
 	MutexLock lock(GetDebugMutex());
 
-	//
-	// Retrieve the texture from the cache (if it already exists)
-	//
-	u32	ixa = MakeHashIdxA( ti );
-	if( mpCacheHashTable[ixa] && mpCacheHashTable[ixa]->GetTextureInfo() == ti )
-	{
-		RECORD_CACHE_HIT( 1, 0 );
-		mpCacheHashTable[ixa]->UpdateIfNecessary();
-
-		return mpCacheHashTable[ixa];
-	}
+	u32 hash = MakeHash( ti );
+	u32 slot = FindSlot( ti, hash );
 
-	u32 ixb = MakeHashIdxB( ti );
-	if( mpCacheHashTable[ixb] && mpCacheHashTable[ixb]->GetTextureInfo() == ti )
+	CachedTexture * texture = mEntries[ slot ].Texture;
+	if( texture != NULL )
 	{
-		RECORD_CACHE_HIT( 1, 0 );
-		mpCacheHashTable[ixb]->UpdateIfNecessary();
+		RECORD_CACHE_HIT( 1 );
 
-		return mpCacheHashTable[ixb];
-	}
-
-	CachedTexture *	texture = NULL;
-	TextureVec::iterator	it = std::lower_bound( mTextures.begin(), mTextures.end(), ti, SSortTextureEntries() );
-	if( it != mTextures.end() && (*it)->GetTextureInfo() == ti )
-	{
-		texture = *it;
-		RECORD_CACHE_HIT( 0, 1 );
+		if( texture != mpMostRecent )
+		{
+			Unlink( texture );
+			LinkMostRecent( texture );
+		}
 	}
 	else
 	{
 		texture = CachedTexture::Create( ti );
 		if (texture != NULL)
 		{
-			mTextures.insert( it, texture );
+			Insert( slot, hash, texture );
 		}
 
-		RECORD_CACHE_HIT( 0, 0 );
+		RECORD_CACHE_HIT( 0 );
 	}
 
-	// Update the hashtable
 	if( texture )
 	{
 		texture->UpdateIfNecessary();
-
-		mpCacheHashTable[ixa] = texture;
-		mpCacheHashTable[ixb] = texture;
 	}
 
 	return texture;
 }
 
+#ifdef DAEDALUS_TEXTURE_DECODE_THREADS
+void CTextureCache::PrefetchTexture(const TextureInfo & ti)
+{
+	DAEDALUS_PROFILE( "CTextureCache::PrefetchTexture" );
+
+	MutexLock lock(GetDebugMutex());
+
+	// Textures which are already cached are checked for changes when they're used, as usual
+	u32 hash = MakeHash( ti );
+	u32 slot = FindSlot( ti, hash );
+	if( mEntries[ slot ].Texture != NULL )
+	{
+		return;
+	}
+
+	CachedTexture * texture = CachedTexture::CreateAsync( ti );
+	if (texture != NULL)
+	{
+		Insert( slot, hash, texture );
+	}
+}
+#endif
+
 CRefPtr<CNativeTexture> CTextureCache::GetOrCreateTexture(const TextureInfo & ti)
 {
 	CachedTexture * base_texture = GetOrCreateCachedTexture(ti);
@@ -241,9 +317,9 @@ void CTextureCache::Snapshot(const MutexLock & lock, std::vector< STextureInfoSn
 
 	snapshot.erase( snapshot.begin(), snapshot.end() );
 
-	for( TextureVec::const_iterator it = mTextures.begin(); it != mTextures.end(); ++it )
+	for( const CachedTexture * texture = mpMostRecent; texture != NULL; texture = texture->mpLRUNext )
 	{
-		STextureInfoSnapshot	info( (*it)->GetTextureInfo(), (*it)->GetTexture() );
+		STextureInfoSnapshot	info( texture->GetTextureInfo(), texture->GetTexture() );
 		snapshot.push_back( info );
 	}
 }
@@ -20,6 +20,19 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #ifndef HLEGRAPHICS_TEXTURECACHE_H_
 #define HLEGRAPHICS_TEXTURECACHE_H_
 
+//
+//	The textures are kept in an open addressed hash table (with linear
+//	probing), which stores the TextureInfo keys inline so a lookup usually
+//	touches a single cache line.
+//
+//	The textures are also kept on an intrusive list, most recently used
+//	first. Rather than throwing textures away after a number of frames,
+//	PurgeOldTextures throws away the least recently used textures until the
+//	texels held by the cache fit in gTextureCacheBudget bytes. Textures used
+//	in the last couple of frames are never thrown away, so the budget can be
+//	exceeded if a game draws more than that each frame.
+//
+
 #include "CachedTexture.h"
 
 #include "Utility/Singleton.h"
@@ -38,6 +51,10 @@ public:
 	virtual ~CTextureCache();
 
 	CRefPtr<CNativeTexture>	GetOrCreateTexture(const TextureInfo & ti);
+#ifdef DAEDALUS_TEXTURE_DECODE_THREADS
+	// Starts decoding a texture which isn't in the cache yet, so it's ready by the time it's drawn
+	void		PrefetchTexture(const TextureInfo & ti);
+#endif
 
 	void		PurgeOldTextures();
 	void		DropTextures();
@@ -66,23 +83,36 @@ public:
 private:
 	CachedTexture * GetOrCreateCachedTexture(const TextureInfo & ti);
 
-	//
-	//	We implement a 2-way skewed associative cache.
-	//	Each TextureInfo is hashed using two different methods, to reduce the chance of collisions
-	//
-	static const u32 HASH_TABLE_BITS = 9;
-	static const u32 HASH_TABLE_SIZE = 1<<HASH_TABLE_BITS;
-
-	inline static u32 MakeHashIdxA( const TextureInfo & ti );
-	inline static u32 MakeHashIdxB( const TextureInfo & ti );
-
-	// FIXME(strmnnrmn): we should have a struct of TextureInfo+CachedTexture instead -
-	// doing binary search on this array needs a memory indirect for every probe.
-	typedef std::vector< CachedTexture * >	TextureVec;
-	TextureVec			mTextures;
-	CachedTexture *		mpCacheHashTable[HASH_TABLE_SIZE];
+	struct SEntry
+	{
+		SEntry() : Hash( 0 ), Texture( NULL ) {}
+
+		TextureInfo			Info;
+		u32					Hash;
+		CachedTexture *		Texture;		// NULL if the slot is empty
+	};
+
+	inline static u32 MakeHash( const TextureInfo & ti );
+
+	u32				FindSlot( const TextureInfo & ti, u32 hash ) const;	// The slot holding ti, or the empty slot it would go in
+	void			Insert( u32 slot, u32 hash, CachedTexture * texture );
+	void			Remove( CachedTexture * texture );
+	void			Grow();
+
+	void			LinkMostRecent( CachedTexture * texture );
+	void			Unlink( CachedTexture * texture );
+
+	static const u32 INITIAL_TABLE_SIZE = 512;			// Must be a power of two
+	static const u32 MIN_FRAMES_TO_KEEP = 2;			// Textures used this recently aren't purged, whatever the budget
+
+	std::vector< SEntry >	mEntries;
+	u32						mNumTextures;
+	u32						mBytesUsed;
+
+	CachedTexture *			mpMostRecent;
+	CachedTexture *			mpLeastRecent;
 #ifdef DAEDALUS_DEBUG_DISPLAYLIST
-	Mutex				mDebugMutex;
+	Mutex					mDebugMutex;
 #endif
 };
 
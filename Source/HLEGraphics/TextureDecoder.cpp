@@ -0,0 +1,341 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "TextureDecoder.h"
+
+#ifdef DAEDALUS_TEXTURE_DECODE_THREADS
+
+#include <string.h>
+
+#include "ConvertTile.h"
+#include "Debug/DBGConsole.h"
+#include "Graphics/ColourValue.h"
+#include "Graphics/TextureTransform.h"
+#include "OSHLE/ultra_gbi.h"
+#include "Utility/Alignment.h"
+#include "Utility/Cond.h"
+
+ALIGNED_EXTERN(u8, gTMEM[4096], 16);
+
+CTextureDecoder				gTextureDecoder;
+
+namespace
+{
+	const u32	TMEM_SIZE = sizeof( gTMEM );
+	const u32	TLUT_START = 0x800;
+
+	// The range of TMEM read for the texels. Rounded out to 16 bytes, as odd rows are swizzled within 16 byte blocks.
+	void	GetTexelRange( const TextureInfo & ti, u32 * p_start, u32 * p_end )
+	{
+		u32		row_bytes( ti.GetLine() << 3 );
+		if( ti.GetSize() == G_IM_SIZ_32b )
+			row_bytes *= 2;
+
+		u32		start( ti.GetTmemAddress() << 3 );
+		u32		width_bytes( ((ti.GetWidth() << ti.GetSize()) + 1) >> 1 );
+		u32		end( start + row_bytes * (ti.GetHeight() - 1) + width_bytes );
+
+		*p_start = start & ~15;
+		*p_end = (end + 15) & ~15;
+	}
+
+	// The range of TMEM read for the palette, if there is one
+	bool	GetPaletteRange( const TextureInfo & ti, u32 * p_start, u32 * p_end )
+	{
+		if( ti.GetFormat() != G_IM_FMT_CI )
+			return false;
+
+		if( ti.GetSize() == G_IM_SIZ_4b )
+		{
+			*p_start = TLUT_START + (ti.GetPalette() << 7);
+			*p_end = *p_start + (16 << 3);
+			return true;
+		}
+
+		*p_start = TLUT_START;
+		*p_end = TMEM_SIZE;
+		return true;
+	}
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+STextureDecodeJob::STextureDecodeJob( const TextureInfo & ti, ETextureFormat format, u32 stride, u32 corrected_width, u32 corrected_height, u32 buffer_size )
+:	Info( ti )
+,	Format( format )
+,	Stride( stride )
+,	CorrectedWidth( corrected_width )
+,	CorrectedHeight( corrected_height )
+,	Texels( buffer_size )
+,	BandsLeft( 0 )
+,	Failed( false )
+,	Done( false )
+{
+	memcpy( Tmem, gTMEM, sizeof( Tmem ) );
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+bool STextureDecodeJob::CanDecode( const TextureInfo & ti )
+{
+	if( ti.GetLine() == 0 || ti.GetWidth() == 0 || ti.GetHeight() == 0 )
+		return false;
+
+	u32		start, end;
+	GetTexelRange( ti, &start, &end );
+	return end <= TMEM_SIZE;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+bool STextureDecodeJob::IsTmemUnchanged() const
+{
+	u32		start, end;
+
+	GetTexelRange( Info, &start, &end );
+	if( memcmp( Tmem + start, gTMEM + start, end - start ) != 0 )
+		return false;
+
+	if( GetPaletteRange( Info, &start, &end ) && memcmp( Tmem + start, gTMEM + start, end - start ) != 0 )
+		return false;
+
+	return true;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+CTextureDecoder::CTextureDecoder()
+:	mNumThreads( 0 )
+,	mMutex( "TextureDecoder" )
+,	mWorkReady( CondCreate() )
+,	mJobDone( CondCreate() )
+,	mWantQuit( false )
+{
+	for( u32 i = 0; i < NUM_THREADS; ++i )
+	{
+		mThreads[ i ] = kInvalidThreadHandle;
+	}
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+CTextureDecoder::~CTextureDecoder()
+{
+	Stop();
+
+	CondDestroy( mWorkReady );
+	CondDestroy( mJobDone );
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+bool CTextureDecoder::Start()
+{
+	if( mNumThreads > 0 )
+		return true;
+
+#ifdef DAEDALUS_ENABLE_PROFILING
+	// The profiler isn't thread safe
+	return false;
+#else
+	mWantQuit = false;
+
+	for( u32 i = 0; i < NUM_THREADS; ++i )
+	{
+		ThreadHandle	thread( CreateThread( "TextureDecoder", DecodeThread, this ) );
+		if( thread == kInvalidThreadHandle )
+			break;
+
+		mThreads[ mNumThreads++ ] = thread;
+	}
+
+	if( mNumThreads == 0 )
+	{
+		DBGConsole_Msg( 0, "Couldn't start the texture decoder threads - decoding synchronously" );
+		return false;
+	}
+
+	return true;
+#endif
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void CTextureDecoder::Stop()
+{
+	if( mNumThreads == 0 )
+		return;
+
+	mMutex.Lock();
+	mWantQuit = true;
+	for( u32 i = 0; i < mNumThreads; ++i )
+	{
+		CondSignal( mWorkReady );
+	}
+	mMutex.Unlock();
+
+	for( u32 i = 0; i < mNumThreads; ++i )
+	{
+		JoinThread( mThreads[ i ], -1 );
+		ReleaseThreadHandle( mThreads[ i ] );
+		mThreads[ i ] = kInvalidThreadHandle;
+	}
+	mNumThreads = 0;
+}
+
+//*************************************************************************************
+//	Splits the texture into bands with an even number of rows, as ConvertTileRows needs
+//*************************************************************************************
+bool CTextureDecoder::Submit( STextureDecodeJob * job )
+{
+	if( mNumThreads == 0 )
+		return false;
+
+	u32		height( job->Info.GetHeight() );
+	u32		band_rows( (height + mNumThreads - 1) / mNumThreads );
+
+	band_rows = ((band_rows < MIN_BAND_ROWS ? MIN_BAND_ROWS : band_rows) + 1) & ~1;
+
+	MutexLock	lock( &mMutex );
+
+	for( u32 first_row = 0; first_row < height; first_row += band_rows )
+	{
+		SBand	band;
+		band.Job = job;
+		band.FirstRow = first_row;
+		band.NumRows = (height - first_row < band_rows) ? height - first_row : band_rows;
+
+		mQueued.push_back( band );
+		job->BandsLeft++;
+		CondSignal( mWorkReady );
+	}
+
+	return true;
+}
+
+//*************************************************************************************
+//	CondSignal only wakes one waiter, which is why only one thread may wait
+//*************************************************************************************
+void CTextureDecoder::Wait( STextureDecodeJob * job )
+{
+	MutexLock	lock( &mMutex );
+
+	while( !job->Done )
+	{
+		CondWait( mJobDone, &mMutex, kTimeoutInfinity );
+	}
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+u32 DAEDALUS_THREAD_CALL_TYPE CTextureDecoder::DecodeThread( void * arg )
+{
+	CTextureDecoder *	decoder( static_cast< CTextureDecoder * >( arg ) );
+
+	decoder->Run();
+
+	return 0;
+}
+
+//*************************************************************************************
+//	Carries on until the queue is empty, so nothing is left waiting on Stop
+//*************************************************************************************
+void CTextureDecoder::Run()
+{
+	mMutex.Lock();
+
+	while( true )
+	{
+		while( mQueued.empty() && !mWantQuit )
+		{
+			CondWait( mWorkReady, &mMutex, kTimeoutInfinity );
+		}
+
+		if( mQueued.empty() )
+			break;
+
+		SBand	band( mQueued.front() );
+		mQueued.pop_front();
+
+		mMutex.Unlock();
+
+		DecodeBand( band );
+
+		mMutex.Lock();
+	}
+
+	mMutex.Unlock();
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void CTextureDecoder::DecodeBand( const SBand & band )
+{
+	STextureDecodeJob *	job( band.Job );
+	const TextureInfo &	ti( job->Info );
+	u8 *				texels( &job->Texels[ 0 ] );
+
+	bool	ok( ConvertTileRows( ti, job->Tmem, band.FirstRow, band.NumRows, texels, job->Palette, job->Format, job->Stride ) );
+
+	if( ok && ti.GetWhite() )
+	{
+		Recolour( texels + band.FirstRow * job->Stride, job->Palette, ti.GetWidth(), band.NumRows, job->Stride, job->Format, c32::White );
+	}
+
+	bool	last_band;
+	{
+		MutexLock	lock( &mMutex );
+
+		job->Failed |= !ok;
+		last_band = --job->BandsLeft == 0;
+	}
+
+	if( !last_band )
+		return;
+
+	// The other bands have all finished, so the whole texture can be clamped and mirrored
+	if( !job->Failed )
+	{
+		ClampTexels( texels, ti.GetWidth(), ti.GetHeight(), job->CorrectedWidth, job->CorrectedHeight, job->Stride, job->Format );
+
+		bool mirror_s = ti.GetEmulateMirrorS();
+		bool mirror_t = ti.GetEmulateMirrorT();
+		if( mirror_s || mirror_t )
+		{
+			MirrorTexels( mirror_s, mirror_t, texels, job->Stride, texels, job->Stride, job->Format, ti.GetWidth(), ti.GetHeight() );
+		}
+	}
+
+	MutexLock	lock( &mMutex );
+
+	job->Done = true;
+	CondSignal( mJobDone );
+}
+
+#endif // DAEDALUS_TEXTURE_DECODE_THREADS
@@ -0,0 +1,135 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef HLEGRAPHICS_TEXTUREDECODER_H_
+#define HLEGRAPHICS_TEXTUREDECODER_H_
+
+//
+//	Decodes textures on a small pool of worker threads, so the display list
+//	thread doesn't stall when a frame loads dozens of new textures.
+//
+//	A texture is submitted as soon as a LoadBlock/LoadTile and SetTileSize
+//	describe it (see CTextureCache::PrefetchTexture), and the display list
+//	only waits for it at the first draw which samples it. Tall textures are
+//	split into bands of rows, so one large texture can use all the workers.
+//	The last band to finish clamps and mirrors the whole texture.
+//
+//	TMEM is copied when the texture is submitted, as the display list will
+//	carry on loading more textures over it. When the texture is first used,
+//	the parts of TMEM it was decoded from are compared with the copy and
+//	the texture is decoded again synchronously if anything has changed.
+//	The native texture is always updated on the display list thread.
+//
+//	Only textures loaded into TMEM are decoded like this (ti.GetLine() != 0),
+//	so this needs DAEDALUS_ACCURATE_TMEM.
+//
+#if defined(DAEDALUS_ENABLE_TEXTURE_DECODE_THREADS) && defined(DAEDALUS_ACCURATE_TMEM)
+#define DAEDALUS_TEXTURE_DECODE_THREADS
+#endif
+
+#ifdef DAEDALUS_TEXTURE_DECODE_THREADS
+
+#include <deque>
+#include <vector>
+
+#include "TextureInfo.h"
+#include "Graphics/NativePixelFormat.h"
+#include "Graphics/TextureFormat.h"
+#include "Utility/DaedalusTypes.h"
+#include "Utility/Mutex.h"
+#include "Utility/Thread.h"
+
+struct Cond;
+
+struct STextureDecodeJob
+{
+	STextureDecodeJob( const TextureInfo & ti, ETextureFormat format, u32 stride, u32 corrected_width, u32 corrected_height, u32 buffer_size );
+
+	// Returns false if the texture reads outside of TMEM, so can't be decoded from the copy
+	static bool			CanDecode( const TextureInfo & ti );
+
+	// True if the parts of gTMEM the texture is decoded from match the copy
+	bool				IsTmemUnchanged() const;
+
+	const TextureInfo	Info;
+	const ETextureFormat Format;
+	const u32			Stride;
+	const u32			CorrectedWidth;
+	const u32			CorrectedHeight;
+
+	std::vector<u8>		Texels;
+	NativePf8888		Palette[ 256 ];
+	u8					Tmem[ 4096 ];
+
+	// These are protected by the decoder's mutex
+	u32					BandsLeft;
+	bool				Failed;
+	bool				Done;
+};
+
+class CTextureDecoder
+{
+public:
+	CTextureDecoder();
+	~CTextureDecoder();
+
+	bool			Start();				// Returns true if the threads are running
+	void			Stop();					// Finishes anything already submitted first
+
+	// Returns false if the threads aren't running, in which case the caller should decode synchronously
+	bool			Submit( STextureDecodeJob * job );
+
+	// Waits for a job to finish. Only the display list thread should call this.
+	void			Wait( STextureDecodeJob * job );
+
+private:
+	struct SBand
+	{
+		STextureDecodeJob *	Job;
+		u32					FirstRow;
+		u32					NumRows;
+	};
+
+	static u32 DAEDALUS_THREAD_CALL_TYPE	DecodeThread( void * arg );
+
+	void			Run();
+	void			DecodeBand( const SBand & band );
+
+private:
+	static const u32	NUM_THREADS = 3;
+	static const u32	MIN_BAND_ROWS = 32;		// Don't bother splitting textures with fewer rows than this
+
+	ThreadHandle		mThreads[ NUM_THREADS ];
+	u32					mNumThreads;
+
+	Mutex				mMutex;
+	Cond *				mWorkReady;
+	Cond *				mJobDone;
+
+	std::deque< SBand >	mQueued;
+	bool				mWantQuit;
+};
+
+extern CTextureDecoder		gTextureDecoder;
+
+#endif // DAEDALUS_TEXTURE_DECODE_THREADS
+
+#endif // HLEGRAPHICS_TEXTUREDECODER_H_
@@ -22,9 +22,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "TextureInfo.h"
 
 #include "Config/ConfigOptions.h"
+#include "Core/DirtyPages.h"
 #include "Core/Memory.h"
 #include "Core/ROM.h"
+#include "Math/MathUtil.h"
 #include "OSHLE/ultra_gbi.h"
+#include "Utility/Alignment.h"
 #include "Utility/Hash.h"
 #include "Utility/Profiler.h"
 
@@ -41,6 +44,113 @@ u32 TextureInfo::GetSizeInBits() const
 	return gImageSizesInBits[ Size ];
 }
 
+#ifdef DAEDALUS_ENABLE_DIRTY_PAGES
+
+#ifdef DAEDALUS_ACCURATE_TMEM
+ALIGNED_EXTERN(u8, gTMEM[4096], 16);
+
+// Textures with a line are converted from TMEM (see CachedTexture.cpp), and so is
+// their palette. Each entry is quadrupled in the upper half, and CI4 textures use
+// the 16 entries of their palette index (see ConvertTile.cpp).
+// Palettes only change here when one is loaded, which CachedTexture checks for.
+static const u8 * GetTmemTlut( const TextureInfo & ti, u32 * p_length )
+{
+	if( ti.GetFormat() != G_IM_FMT_CI )
+		return NULL;
+
+	if( ti.GetSize() == G_IM_SIZ_4b )
+	{
+		*p_length = 16 * sizeof( u64 );
+		return gTMEM + 0x800 + (ti.GetPalette() << 7);
+	}
+
+	*p_length = 256 * sizeof( u64 );
+	return gTMEM + 0x800;
+}
+#endif
+
+// The palette pointer is a host address, so work out where it is in RDRAM.
+// Returns false if it doesn't point into RDRAM (e.g. no TLUT has been loaded).
+static bool GetTlutRange( const TextureInfo & ti, u32 * p_offset, u32 * p_length )
+{
+	if( ti.GetFormat() != G_IM_FMT_CI )
+		return false;
+
+	const u8 * tlut = reinterpret_cast< const u8 * >( uintptr_t( ti.GetTlutAddress() ) );
+	if( tlut < g_pu8RamBase || tlut >= g_pu8RamBase + MemoryRegionSizes[MEM_RD_RAM] )
+		return false;
+
+	u32 offset = u32( tlut - g_pu8RamBase );
+	u32 length = (ti.GetSize() == G_IM_SIZ_4b ? 16 : 256) * sizeof( u16 );
+
+	if( length > MemoryRegionSizes[MEM_RD_RAM] - offset )
+		return false;
+
+	*p_offset = offset;
+	*p_length = length;
+	return true;
+}
+
+// Clamped so that garbage tile descriptors can't read past the end of RDRAM
+static u32 GetSourceLength( const TextureInfo & ti )
+{
+	u32 address = ti.GetLoadAddress();
+	u32 length  = ti.GetHeight() * ti.GetPitch();
+
+	if( address >= MemoryRegionSizes[MEM_RD_RAM] )
+		return 0;
+
+	return Min<u32>( length, MemoryRegionSizes[MEM_RD_RAM] - address );
+}
+
+// Writes to RDRAM are tracked (see Core/DirtyPages.h), so this is only called
+// when something the texture is made from might have changed. That makes it
+// affordable to hash all of the data rather than a few rows, and the palette
+// too, so there's no need for any per-game hash hacks.
+u32 TextureInfo::GenerateHashValue() const
+{
+	DAEDALUS_PROFILE( "TextureInfo::GenerateHashValue" );
+
+	u32 hash_value = xxhash32( g_pu8RamBase + GetLoadAddress(), GetSourceLength( *this ), 0 );
+
+#ifdef DAEDALUS_ACCURATE_TMEM
+	if( GetLine() > 0 )
+	{
+		u32 tmem_tlut_length;
+		if( const u8 * tmem_tlut = GetTmemTlut( *this, &tmem_tlut_length ) )
+		{
+			hash_value = xxhash32( tmem_tlut, tmem_tlut_length, hash_value );
+		}
+		return hash_value;
+	}
+#endif
+
+	u32 tlut_offset, tlut_length;
+	if( GetTlutRange( *this, &tlut_offset, &tlut_length ) )
+	{
+		hash_value = xxhash32( g_pu8RamBase + tlut_offset, tlut_length, hash_value );
+	}
+
+	return hash_value;
+}
+
+bool TextureInfo::HasSourceChanged( u32 epoch ) const
+{
+	if( DirtyPages_HasChanged( GetLoadAddress(), GetSourceLength( *this ), epoch ) )
+		return true;
+
+#ifdef DAEDALUS_ACCURATE_TMEM
+	if( GetLine() > 0 )
+		return false;
+#endif
+
+	u32 tlut_offset, tlut_length;
+	return GetTlutRange( *this, &tlut_offset, &tlut_length ) &&
+		   DirtyPages_HasChanged( tlut_offset, tlut_length, epoch );
+}
+
+#else
+
 // Fast hash for checking is data in a texture source has changed //Corn
 u32 TextureInfo::GenerateHashValue() const
 {
@@ -127,3 +237,5 @@ u32 TextureInfo::GenerateHashValue() const
 	return hash_value;
 }
 
+#endif // DAEDALUS_ENABLE_DIRTY_PAGES
+
@@ -70,6 +70,12 @@ public:
 	// Compute a hash of the contents of the texture data. Not to be confused with GetHashCode() that hashes the Textureinfo!
 	u32						GenerateHashValue() const;
 
+#ifdef DAEDALUS_ENABLE_DIRTY_PAGES
+	// Has the texture data (or palette) been written since DirtyPages_GetEpoch() returned epoch?
+	// Palettes converted from TMEM aren't covered - they only change when gTlutLoadCount does.
+	bool					HasSourceChanged( u32 epoch ) const;
+#endif
+
 	const char *			GetFormatName() const;
 	u32						GetSizeInBits() const;
 
@@ -0,0 +1,782 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "TnLSSE.h"
+
+#ifdef DAEDALUS_ENABLE_SSE_TNL
+
+#include <string.h>
+
+#include <emmintrin.h>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+#include "BaseRenderer.h"
+
+#include "Math/MathUtil.h"
+#include "Math/Matrix4x4.h"
+
+namespace
+{
+
+//*****************************************************************************
+//	Four lanes of SSE
+//*****************************************************************************
+struct SLanes4
+{
+	typedef __m128	V;
+	static const u32	kWidth = 4;
+
+	static V	Set( f32 f )				{ return _mm_set1_ps( f ); }
+	static V	Bits( u32 b )				{ return _mm_castsi128_ps( _mm_set1_epi32( b ) ); }
+	static V	Load( const f32 * p )		{ return _mm_loadu_ps( p ); }
+	static void	Store( f32 * p, V v )		{ _mm_storeu_ps( p, v ); }
+
+	static V	Add( V a, V b )				{ return _mm_add_ps( a, b ); }
+	static V	Sub( V a, V b )				{ return _mm_sub_ps( a, b ); }
+	static V	Mul( V a, V b )				{ return _mm_mul_ps( a, b ); }
+	static V	Div( V a, V b )				{ return _mm_div_ps( a, b ); }
+	static V	Sqrt( V a )					{ return _mm_sqrt_ps( a ); }
+	static V	Neg( V a )					{ return _mm_xor_ps( a, Set( -0.0f ) ); }
+	static V	Abs( V a )					{ return _mm_andnot_ps( Set( -0.0f ), a ); }
+
+	static V	Less( V a, V b )			{ return _mm_cmplt_ps( a, b ); }
+	static V	Greater( V a, V b )			{ return _mm_cmpgt_ps( a, b ); }
+	static V	And( V a, V b )				{ return _mm_and_ps( a, b ); }
+	static V	AndNot( V a, V b )			{ return _mm_andnot_ps( a, b ); }		// ~a & b
+	static V	Or( V a, V b )				{ return _mm_or_ps( a, b ); }
+	static V	Select( V mask, V a, V b )	{ return Or( And( mask, a ), AndNot( mask, b ) ); }
+
+	// Writes the first count lanes of x/y/z/w to (p_out[i].*member)
+	static void	StoreVec4( V x, V y, V z, V w, DaedalusVtx4 * p_out, v4 DaedalusVtx4::* member, u32 count )
+	{
+		_MM_TRANSPOSE4_PS( x, y, z, w );
+		const V		rows[ 4 ] = { x, y, z, w };
+
+		for( u32 i = 0; i < count; ++i )
+		{
+			_mm_store_ps( &(p_out[ i ].*member).x, rows[ i ] );
+		}
+	}
+};
+
+#ifdef __AVX__
+//*****************************************************************************
+//	Eight lanes of AVX
+//*****************************************************************************
+struct SLanes8
+{
+	typedef __m256	V;
+	static const u32	kWidth = 8;
+
+	static V	Set( f32 f )				{ return _mm256_set1_ps( f ); }
+	static V	Bits( u32 b )				{ return _mm256_castsi256_ps( _mm256_set1_epi32( b ) ); }
+	static V	Load( const f32 * p )		{ return _mm256_loadu_ps( p ); }
+	static void	Store( f32 * p, V v )		{ _mm256_storeu_ps( p, v ); }
+
+	static V	Add( V a, V b )				{ return _mm256_add_ps( a, b ); }
+	static V	Sub( V a, V b )				{ return _mm256_sub_ps( a, b ); }
+	static V	Mul( V a, V b )				{ return _mm256_mul_ps( a, b ); }
+	static V	Div( V a, V b )				{ return _mm256_div_ps( a, b ); }
+	static V	Sqrt( V a )					{ return _mm256_sqrt_ps( a ); }
+	static V	Neg( V a )					{ return _mm256_xor_ps( a, Set( -0.0f ) ); }
+	static V	Abs( V a )					{ return _mm256_andnot_ps( Set( -0.0f ), a ); }
+
+	static V	Less( V a, V b )			{ return _mm256_cmp_ps( a, b, _CMP_LT_OQ ); }
+	static V	Greater( V a, V b )			{ return _mm256_cmp_ps( a, b, _CMP_GT_OQ ); }
+	static V	And( V a, V b )				{ return _mm256_and_ps( a, b ); }
+	static V	AndNot( V a, V b )			{ return _mm256_andnot_ps( a, b ); }	// ~a & b
+	static V	Or( V a, V b )				{ return _mm256_or_ps( a, b ); }
+	static V	Select( V mask, V a, V b )	{ return _mm256_blendv_ps( b, a, mask ); }
+
+	static void	StoreVec4( V x, V y, V z, V w, DaedalusVtx4 * p_out, v4 DaedalusVtx4::* member, u32 count )
+	{
+		SLanes4::StoreVec4( _mm256_castps256_ps128( x ), _mm256_castps256_ps128( y ),
+							_mm256_castps256_ps128( z ), _mm256_castps256_ps128( w ),
+							p_out, member, Min< u32 >( count, 4 ) );
+		if( count > 4 )
+		{
+			SLanes4::StoreVec4( _mm256_extractf128_ps( x, 1 ), _mm256_extractf128_ps( y, 1 ),
+								_mm256_extractf128_ps( z, 1 ), _mm256_extractf128_ps( w, 1 ),
+								p_out + 4, member, count - 4 );
+		}
+	}
+};
+
+typedef SLanes8		L;
+#else
+typedef SLanes4		L;
+#endif
+
+typedef L::V		V;
+const u32			kWidth = L::kWidth;
+
+//*****************************************************************************
+//	The inputs for kWidth vertices, unpacked into floats
+//*****************************************************************************
+struct SVertexBlock
+{
+	f32		X[ kWidth ], Y[ kWidth ], Z[ kWidth ];
+	f32		NX[ kWidth ], NY[ kWidth ], NZ[ kWidth ];
+	f32		R[ kWidth ], G[ kWidth ], B[ kWidth ], A[ kWidth ];
+	f32		TU[ kWidth ], TV[ kWidth ];
+
+	// Unused lanes are zeroed so they can't raise any exceptions
+	void	Clear()		{ memset( this, 0, sizeof( *this ) ); }
+};
+
+struct SVec3
+{
+	V		x, y, z;
+};
+
+struct SVec4
+{
+	V		x, y, z, w;
+};
+
+//*****************************************************************************
+//	Same order of operations as Matrix4x4::Transform/TransformNormal
+//*****************************************************************************
+inline SVec4 Transform( const Matrix4x4 & mat, const SVec4 & v )
+{
+	SVec4	r;
+	r.x = L::Add( L::Add( L::Add( L::Mul( v.x, L::Set( mat.m11 ) ), L::Mul( v.y, L::Set( mat.m21 ) ) ), L::Mul( v.z, L::Set( mat.m31 ) ) ), L::Mul( v.w, L::Set( mat.m41 ) ) );
+	r.y = L::Add( L::Add( L::Add( L::Mul( v.x, L::Set( mat.m12 ) ), L::Mul( v.y, L::Set( mat.m22 ) ) ), L::Mul( v.z, L::Set( mat.m32 ) ) ), L::Mul( v.w, L::Set( mat.m42 ) ) );
+	r.z = L::Add( L::Add( L::Add( L::Mul( v.x, L::Set( mat.m13 ) ), L::Mul( v.y, L::Set( mat.m23 ) ) ), L::Mul( v.z, L::Set( mat.m33 ) ) ), L::Mul( v.w, L::Set( mat.m43 ) ) );
+	r.w = L::Add( L::Add( L::Add( L::Mul( v.x, L::Set( mat.m14 ) ), L::Mul( v.y, L::Set( mat.m24 ) ) ), L::Mul( v.z, L::Set( mat.m34 ) ) ), L::Mul( v.w, L::Set( mat.m44 ) ) );
+	return r;
+}
+
+inline SVec3 TransformNormal( const Matrix4x4 & mat, const SVec3 & v )
+{
+	SVec3	r;
+	r.x = L::Add( L::Add( L::Mul( v.x, L::Set( mat.m11 ) ), L::Mul( v.y, L::Set( mat.m21 ) ) ), L::Mul( v.z, L::Set( mat.m31 ) ) );
+	r.y = L::Add( L::Add( L::Mul( v.x, L::Set( mat.m12 ) ), L::Mul( v.y, L::Set( mat.m22 ) ) ), L::Mul( v.z, L::Set( mat.m32 ) ) );
+	r.z = L::Add( L::Add( L::Mul( v.x, L::Set( mat.m13 ) ), L::Mul( v.y, L::Set( mat.m23 ) ) ), L::Mul( v.z, L::Set( mat.m33 ) ) );
+	return r;
+}
+
+inline V Dot( const SVec3 & v, const v3 & rhs )
+{
+	return L::Add( L::Add( L::Mul( v.x, L::Set( rhs.x ) ), L::Mul( v.y, L::Set( rhs.y ) ) ), L::Mul( v.z, L::Set( rhs.z ) ) );
+}
+
+inline V LengthSq( V x, V y, V z )
+{
+	return L::Add( L::Add( L::Mul( x, x ), L::Mul( y, y ) ), L::Mul( z, z ) );
+}
+
+//*****************************************************************************
+//	As v3::Normalise - zero length vectors are left alone
+//*****************************************************************************
+inline void Normalise( SVec3 & v )
+{
+	const V		one( L::Set( 1.0f ) );
+	V			len_sq( LengthSq( v.x, v.y, v.z ) );
+	V			r( L::Select( L::Greater( len_sq, L::Set( 0.0f ) ), L::Div( one, L::Sqrt( len_sq ) ), one ) );
+
+	v.x = L::Mul( v.x, r );
+	v.y = L::Mul( v.y, r );
+	v.z = L::Mul( v.z, r );
+}
+
+//*****************************************************************************
+//	result += colour * scale, for the lanes in mask
+//*****************************************************************************
+inline void AddLight( SVec3 & result, V mask, const v3 & colour, V scale )
+{
+	result.x = L::Select( mask, L::Add( result.x, L::Mul( L::Set( colour.x ), scale ) ), result.x );
+	result.y = L::Select( mask, L::Add( result.y, L::Mul( L::Set( colour.y ), scale ) ), result.y );
+	result.z = L::Select( mask, L::Add( result.z, L::Mul( L::Set( colour.z ), scale ) ), result.z );
+}
+
+inline V ClampToOne( V v )
+{
+	const V		one( L::Set( 1.0f ) );
+	return L::Select( L::Greater( v, one ), one, v );
+}
+
+inline SVec3 Ambient( const TnLParams & params )
+{
+	const v3 &	col( params.Lights[ params.NumLights ].Colour );
+	SVec3		result = { L::Set( col.x ), L::Set( col.y ), L::Set( col.z ) };
+	return result;
+}
+
+//*****************************************************************************
+//	As BaseRenderer::LightVert
+//*****************************************************************************
+SVec3 LightVert( const TnLParams & params, const SVec3 & norm )
+{
+	SVec3	result( Ambient( params ) );
+
+	for( u32 l = 0; l < params.NumLights; l++ )
+	{
+		V	cos_t( Dot( norm, params.Lights[ l ].Direction ) );
+
+		AddLight( result, L::Greater( cos_t, L::Set( 0.0f ) ), params.Lights[ l ].Colour, cos_t );
+	}
+
+	result.x = ClampToOne( result.x );
+	result.y = ClampToOne( result.y );
+	result.z = ClampToOne( result.z );
+	return result;
+}
+
+//*****************************************************************************
+//	As BaseRenderer::LightPointVert
+//*****************************************************************************
+SVec3 LightPointVert( const TnLParams & params, const SVec4 & w )
+{
+	SVec3	result( Ambient( params ) );
+
+	for( u32 l = 0; l < params.NumLights; l++ )
+	{
+		const DaedalusLight &	light( params.Lights[ l ] );
+		if( light.SkipIfZero )
+		{
+			V	dx( L::Sub( L::Set( light.Position.x ), w.x ) );
+			V	dy( L::Sub( L::Set( light.Position.y ), w.y ) );
+			V	dz( L::Sub( L::Set( light.Position.z ), w.z ) );
+
+			V	light_qlen( LengthSq( dx, dy, dz ) );
+			V	light_llen( L::Sqrt( light_qlen ) );
+
+			V	at( L::Add( L::Add( L::Set( light.ca ), L::Mul( L::Set( light.la ), light_llen ) ), L::Mul( L::Set( light.qa ), light_qlen ) ) );
+
+			AddLight( result, L::Greater( at, L::Set( 0.0f ) ), light.Colour, L::Div( L::Set( 1.0f ), at ) );
+		}
+	}
+
+	result.x = ClampToOne( result.x );
+	result.y = ClampToOne( result.y );
+	result.z = ClampToOne( result.z );
+	return result;
+}
+
+//*****************************************************************************
+//	See the CBFD path of BaseRenderer::SetNewVertexInfoConker
+//*****************************************************************************
+SVec3 LightVertCBFD( const TnLParams & params, const SVec3 & norm, const SVec4 & projected )
+{
+	const f32 *	coord_mod( params.CoordMod );
+	const V		zero( L::Set( 0.0f ) );
+	const V		one( L::Set( 1.0f ) );
+
+	SVec4		pos;
+	pos.x = L::Mul( L::Add( projected.x, L::Set( coord_mod[ 8] ) ), L::Set( coord_mod[12] ) );
+	pos.y = L::Mul( L::Add( projected.y, L::Set( coord_mod[ 9] ) ), L::Set( coord_mod[13] ) );
+	pos.z = L::Mul( L::Add( projected.z, L::Set( coord_mod[10] ) ), L::Set( coord_mod[14] ) );
+	pos.w = L::Mul( L::Add( projected.w, L::Set( coord_mod[11] ) ), L::Set( coord_mod[15] ) );
+
+	SVec3		result( Ambient( params ) );
+	u32			l;
+
+	if( params.Flags.PointLight )
+	{
+		for( l = 0; l < params.NumLights-1; l++ )
+		{
+			const DaedalusLight &	light( params.Lights[ l ] );
+			if( light.SkipIfZero )
+			{
+				V	cos_t( Dot( norm, light.Direction ) );
+				V	lit( L::Greater( cos_t, zero ) );
+				V	dx( L::Sub( pos.x, L::Set( light.Position.x ) ) );
+				V	dy( L::Sub( pos.y, L::Set( light.Position.y ) ) );
+				V	dz( L::Sub( pos.z, L::Set( light.Position.z ) ) );
+				V	dw( L::Sub( pos.w, L::Set( light.Position.w ) ) );
+				V	pi( L::Div( L::Set( light.Iscale ), L::Add( LengthSq( dx, dy, dz ), L::Mul( dw, dw ) ) ) );
+
+				cos_t = L::Select( L::Less( pi, one ), L::Mul( cos_t, pi ), cos_t );
+				AddLight( result, lit, light.Colour, cos_t );
+			}
+		}
+
+		V	cos_t( Dot( norm, params.Lights[ l ].Direction ) );
+		AddLight( result, L::Greater( cos_t, zero ), params.Lights[ l ].Colour, cos_t );
+	}
+	else
+	{
+		const V		all( L::Bits( ~0 ) );
+
+		for( l = 0; l < params.NumLights; l++ )
+		{
+			const DaedalusLight &	light( params.Lights[ l ] );
+			if( light.SkipIfZero )
+			{
+				V	dx( L::Sub( pos.x, L::Set( light.Position.x ) ) );
+				V	dy( L::Sub( pos.y, L::Set( light.Position.y ) ) );
+				V	dz( L::Sub( pos.z, L::Set( light.Position.z ) ) );
+				V	dw( L::Sub( pos.w, L::Set( light.Position.w ) ) );
+				V	pi( L::Div( L::Set( light.Iscale ), L::Add( LengthSq( dx, dy, dz ), L::Mul( dw, dw ) ) ) );
+
+				AddLight( result, all, light.Colour, ClampToOne( pi ) );
+			}
+		}
+	}
+
+	return result;
+}
+
+//*****************************************************************************
+//	Cheap way to do ~Acos(x)/Pi //Corn
+//*****************************************************************************
+inline V SphereMap( V n )
+{
+	const V		quarter( L::Set( 0.25f ) );
+	return L::Sub( L::Sub( L::Set( 0.5f ), L::Mul( quarter, n ) ), L::Mul( L::Mul( L::Mul( quarter, n ), n ), n ) );
+}
+
+inline V LinearMap( V n )
+{
+	return L::Mul( L::Set( 0.5f ), L::Add( L::Set( 1.0f ), n ) );
+}
+
+//*****************************************************************************
+//	Same tests (including the else) as the FPU code
+//*****************************************************************************
+inline V ClipFlags( const SVec4 & projected )
+{
+	const V		neg_w( L::Neg( projected.w ) );
+	const V		axes[ 3 ]	= { projected.x, projected.y, projected.z };
+	const u32	pos[ 3 ]	= { X_POS, Y_POS, Z_POS };
+	const u32	neg[ 3 ]	= { X_NEG, Y_NEG, Z_NEG };
+	V			flags( L::Bits( 0 ) );
+
+	for( u32 a = 0; a < 3; ++a )
+	{
+		V	lt( L::Less( axes[ a ], neg_w ) );
+		V	gt( L::AndNot( lt, L::Greater( axes[ a ], projected.w ) ) );
+
+		flags = L::Or( flags, L::Or( L::And( lt, L::Bits( pos[ a ] ) ), L::And( gt, L::Bits( neg[ a ] ) ) ) );
+	}
+
+	return flags;
+}
+
+//*****************************************************************************
+//	The outputs for kWidth vertices
+//*****************************************************************************
+struct SVertexResult
+{
+	SVec4	Transformed;
+	SVec4	Projected;
+	SVec4	Colour;
+	V		TexU, TexV;
+	V		ClipFlags;
+
+	void	Scatter( DaedalusVtx4 * p_out, u32 count, bool texture = true ) const
+	{
+		L::StoreVec4( Transformed.x, Transformed.y, Transformed.z, Transformed.w, p_out, &DaedalusVtx4::TransformedPos, count );
+		L::StoreVec4( Projected.x, Projected.y, Projected.z, Projected.w, p_out, &DaedalusVtx4::ProjectedPos, count );
+		L::StoreVec4( Colour.x, Colour.y, Colour.z, Colour.w, p_out, &DaedalusVtx4::Colour, count );
+
+		f32		tex_u[ kWidth ], tex_v[ kWidth ], clip_flags[ kWidth ];
+		L::Store( tex_u, TexU );
+		L::Store( tex_v, TexV );
+		L::Store( clip_flags, ClipFlags );
+
+		for( u32 i = 0; i < count; ++i )
+		{
+			if( texture )
+			{
+				p_out[ i ].Texture.x = tex_u[ i ];
+				p_out[ i ].Texture.y = tex_v[ i ];
+			}
+			memcpy( &p_out[ i ].ClipFlags, &clip_flags[ i ], sizeof( u32 ) );
+		}
+	}
+};
+
+inline SVec4 LoadPosition( const SVertexBlock & block )
+{
+	SVec4	w = { L::Load( block.X ), L::Load( block.Y ), L::Load( block.Z ), L::Set( 1.0f ) };
+	return w;
+}
+
+inline SVec3 LoadNormal( const SVertexBlock & block )
+{
+	SVec3	n = { L::Load( block.NX ), L::Load( block.NY ), L::Load( block.NZ ) };
+	return n;
+}
+
+inline SVec4 LoadColour( const SVertexBlock & block )
+{
+	const V		scale( L::Set( 1.0f / 255.0f ) );
+	SVec4		c = { L::Mul( L::Load( block.R ), scale ), L::Mul( L::Load( block.G ), scale ),
+					  L::Mul( L::Load( block.B ), scale ), L::Mul( L::Load( block.A ), scale ) };
+	return c;
+}
+
+inline void ScaleTexture( SVertexResult & result, const SVertexBlock & block, const TnLParams & params )
+{
+	result.TexU = L::Mul( L::Load( block.TU ), L::Set( params.TextureScaleX ) );
+	result.TexV = L::Mul( L::Load( block.TV ), L::Set( params.TextureScaleY ) );
+}
+
+//*****************************************************************************
+//	Texgen for CBFD and PD, which have the meaning of TexGenLin swapped
+//*****************************************************************************
+inline void TexGenSwapped( SVertexResult & result, const SVec3 & norm, const SVertexBlock & block, const TnLParams & params )
+{
+	if( params.Flags.TexGen )
+	{
+		if( params.Flags.TexGenLin )
+		{
+			result.TexU = SphereMap( norm.x );
+			result.TexV = SphereMap( norm.y );
+		}
+		else
+		{
+			result.TexU = LinearMap( norm.x );
+			result.TexV = LinearMap( norm.y );
+		}
+	}
+	else
+	{
+		ScaleTexture( result, block, params );
+	}
+}
+
+}
+
+//*****************************************************************************
+//	See BaseRenderer::SetNewVertexInfo
+//*****************************************************************************
+void TnLSSE( const Matrix4x4 & mat_world, const Matrix4x4 & mat_world_project, const FiddledVtx * p_in, DaedalusVtx4 * p_out, u32 num_vertices, const TnLParams & params )
+{
+	SVertexBlock	block;
+
+	for( u32 base = 0; base < num_vertices; base += kWidth )
+	{
+		const u32	count( Min< u32 >( num_vertices - base, kWidth ) );
+
+		block.Clear();
+		for( u32 i = 0; i < count; ++i )
+		{
+			const FiddledVtx &	vert( p_in[ base + i ] );
+
+			block.X[ i ] = f32( vert.x );
+			block.Y[ i ] = f32( vert.y );
+			block.Z[ i ] = f32( vert.z );
+			block.TU[ i ] = f32( vert.tu );
+			block.TV[ i ] = f32( vert.tv );
+
+			if( params.Flags.Light )
+			{
+				block.NX[ i ] = f32( vert.norm_x );
+				block.NY[ i ] = f32( vert.norm_y );
+				block.NZ[ i ] = f32( vert.norm_z );
+			}
+			else
+			{
+				block.R[ i ] = f32( vert.rgba_r );
+				block.G[ i ] = f32( vert.rgba_g );
+				block.B[ i ] = f32( vert.rgba_b );
+			}
+			block.A[ i ] = f32( vert.rgba_a );
+		}
+
+		SVertexResult	result;
+		const SVec4		w( LoadPosition( block ) );
+
+		result.Projected = Transform( mat_world_project, w );
+		result.Transformed = Transform( mat_world, w );
+		result.ClipFlags = ClipFlags( result.Projected );
+		result.Colour = LoadColour( block );
+
+		if( params.Flags.Light )
+		{
+			const SVec3		model_normal( LoadNormal( block ) );
+			SVec3			norm( TransformNormal( mat_world, model_normal ) );
+			Normalise( norm );
+
+			SVec3	col( params.Flags.PointLight ? LightPointVert( params, w ) : LightVert( params, norm ) );
+			result.Colour.x = col.x;
+			result.Colour.y = col.y;
+			result.Colour.z = col.z;
+
+			if( params.Flags.TexGen )
+			{
+				// Uses mat_world_project rather than mat_world, as the FPU code does
+				norm = TransformNormal( mat_world_project, model_normal );
+				Normalise( norm );
+
+				if( params.Flags.TexGenLin )
+				{
+					result.TexU = LinearMap( norm.x );
+					result.TexV = LinearMap( norm.y );
+				}
+				else
+				{
+					result.TexU = SphereMap( L::Abs( norm.x ) );
+					result.TexV = SphereMap( L::Abs( norm.y ) );
+				}
+			}
+			else
+			{
+				ScaleTexture( result, block, params );
+			}
+		}
+		else
+		{
+			ScaleTexture( result, block, params );
+		}
+
+		result.Scatter( p_out + base, count );
+	}
+}
+
+//*****************************************************************************
+//	See BaseRenderer::SetNewVertexInfoConker
+//*****************************************************************************
+void TnLSSE_CBFD( const Matrix4x4 & mat_world, const Matrix4x4 & mat_project, const FiddledVtx * p_in, DaedalusVtx4 * p_out, u32 num_vertices, const TnLParams & params, const s8 * model_norm, u32 v0 )
+{
+	SVertexBlock	block;
+
+	for( u32 base = 0; base < num_vertices; base += kWidth )
+	{
+		const u32	count( Min< u32 >( num_vertices - base, kWidth ) );
+
+		block.Clear();
+		for( u32 i = 0; i < count; ++i )
+		{
+			const FiddledVtx &	vert( p_in[ base + i ] );
+			const u32			idx( v0 + base + i );
+
+			block.X[ i ] = f32( vert.x );
+			block.Y[ i ] = f32( vert.y );
+			block.Z[ i ] = f32( vert.z );
+			block.TU[ i ] = f32( vert.tu );
+			block.TV[ i ] = f32( vert.tv );
+			block.R[ i ] = f32( vert.rgba_r );
+			block.G[ i ] = f32( vert.rgba_g );
+			block.B[ i ] = f32( vert.rgba_b );
+			block.A[ i ] = f32( vert.rgba_a );
+
+			if( params.Flags.Light )
+			{
+				block.NX[ i ] = f32( model_norm[ ((idx<<1)+0)^3 ] );
+				block.NY[ i ] = f32( model_norm[ ((idx<<1)+1)^3 ] );
+				block.NZ[ i ] = f32( vert.normz );
+			}
+		}
+
+		SVertexResult	result;
+
+		result.Transformed = Transform( mat_world, LoadPosition( block ) );
+		result.Projected = Transform( mat_project, result.Transformed );
+		result.ClipFlags = ClipFlags( result.Projected );
+		result.Colour = LoadColour( block );
+
+		if( params.Flags.Light )
+		{
+			SVec3	norm( TransformNormal( mat_world, LoadNormal( block ) ) );
+			Normalise( norm );
+
+			const SVec3		light( LightVertCBFD( params, norm, result.Projected ) );
+			const V			one( L::Set( 1.0f ) );
+
+			result.Colour.x = L::Select( L::Less( light.x, one ), L::Mul( result.Colour.x, light.x ), result.Colour.x );
+			result.Colour.y = L::Select( L::Less( light.y, one ), L::Mul( result.Colour.y, light.y ), result.Colour.y );
+			result.Colour.z = L::Select( L::Less( light.z, one ), L::Mul( result.Colour.z, light.z ), result.Colour.z );
+
+			TexGenSwapped( result, norm, block, params );
+		}
+		else
+		{
+			ScaleTexture( result, block, params );
+		}
+
+		result.Scatter( p_out + base, count );
+	}
+}
+
+//*****************************************************************************
+//	See BaseRenderer::SetNewVertexInfoPD
+//*****************************************************************************
+void TnLSSE_PD( const Matrix4x4 & mat_world, const Matrix4x4 & mat_project, const FiddledVtxPD * p_in, DaedalusVtx4 * p_out, u32 num_vertices, const TnLParams & params, const u8 * model_norm )
+{
+	SVertexBlock	block;
+
+	for( u32 base = 0; base < num_vertices; base += kWidth )
+	{
+		const u32	count( Min< u32 >( num_vertices - base, kWidth ) );
+
+		block.Clear();
+		for( u32 i = 0; i < count; ++i )
+		{
+			const FiddledVtxPD &	vert( p_in[ base + i ] );
+			const u8 *				mn( model_norm + vert.cidx );
+
+			block.X[ i ] = f32( vert.x );
+			block.Y[ i ] = f32( vert.y );
+			block.Z[ i ] = f32( vert.z );
+			block.TU[ i ] = f32( vert.tu );
+			block.TV[ i ] = f32( vert.tv );
+
+			// The same bytes are the normal when lighting, and the colour otherwise
+			block.NX[ i ] = block.R[ i ] = f32( mn[3] );
+			block.NY[ i ] = block.G[ i ] = f32( mn[2] );
+			block.NZ[ i ] = block.B[ i ] = f32( mn[1] );
+			block.A[ i ] = f32( mn[0] );
+		}
+
+		SVertexResult	result;
+
+		result.Transformed = Transform( mat_world, LoadPosition( block ) );
+		result.Projected = Transform( mat_project, result.Transformed );
+		result.ClipFlags = ClipFlags( result.Projected );
+		result.Colour = LoadColour( block );
+
+		if( params.Flags.Light )
+		{
+			SVec3	norm( TransformNormal( mat_world, LoadNormal( block ) ) );
+			Normalise( norm );
+
+			SVec3	col( LightVert( params, norm ) );
+			result.Colour.x = col.x;
+			result.Colour.y = col.y;
+			result.Colour.z = col.z;
+
+			TexGenSwapped( result, norm, block, params );
+		}
+		else
+		{
+			ScaleTexture( result, block, params );
+		}
+
+		result.Scatter( p_out + base, count );
+	}
+}
+
+//*****************************************************************************
+//	See the non billboard path of BaseRenderer::SetNewVertexInfoDKR
+//*****************************************************************************
+void TnLSSE_DKR( const Matrix4x4 & mat_world_project, const u8 * p_ram, u32 address, DaedalusVtx4 * p_out, u32 num_vertices )
+{
+	SVertexBlock	block;
+
+	for( u32 base = 0; base < num_vertices; base += kWidth )
+	{
+		const u32	count( Min< u32 >( num_vertices - base, kWidth ) );
+
+		block.Clear();
+		for( u32 i = 0; i < count; ++i )
+		{
+			block.X[ i ] = f32( *(const s16*)(p_ram + ((address + 0) ^ 2)) );
+			block.Y[ i ] = f32( *(const s16*)(p_ram + ((address + 2) ^ 2)) );
+			block.Z[ i ] = f32( *(const s16*)(p_ram + ((address + 4) ^ 2)) );
+
+			const u32 WL = *(const u16*)(p_ram + ((address + 6) ^ 2));
+			const u32 WH = *(const u16*)(p_ram + ((address + 8) ^ 2));
+
+			block.R[ i ] = f32( WL >> 8 );
+			block.G[ i ] = f32( WL & 0xFF );
+			block.B[ i ] = f32( WH >> 8 );
+			block.A[ i ] = f32( WH & 0xFF );
+
+			address += 10;
+		}
+
+		SVertexResult	result;
+
+		result.Transformed = LoadPosition( block );
+		result.Projected = Transform( mat_world_project, result.Transformed );
+		result.ClipFlags = ClipFlags( result.Projected );
+		result.Colour = LoadColour( block );
+
+		// The FPU code leaves the texture coordinates alone
+		result.TexU = result.TexV = L::Set( 0.0f );
+		result.Scatter( p_out + base, count, false );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+namespace
+{
+	// Or of the flags, or CLIP_REJECTED where the and of the flags is non zero
+	inline __m128i TriClipFlags( __m128i f0, __m128i f1, __m128i f2 )
+	{
+		const __m128i	visible( _mm_cmpeq_epi32( _mm_and_si128( _mm_and_si128( f0, f1 ), f2 ), _mm_setzero_si128() ) );
+
+		return _mm_or_si128( _mm_and_si128( visible, _mm_or_si128( _mm_or_si128( f0, f1 ), f2 ) ),
+							 _mm_andnot_si128( visible, _mm_set1_epi32( CLIP_REJECTED ) ) );
+	}
+
+	inline void StoreTriClipFlags( u8 * p_tri_flags, __m128i flags )
+	{
+		const u32	packed( _mm_cvtsi128_si32( _mm_packus_epi16( _mm_packs_epi32( flags, flags ), flags ) ) );
+
+		memcpy( p_tri_flags, &packed, sizeof( packed ) );
+	}
+}
+
+void ClassifyTrisSSE( const DaedalusVtx4 * p_verts, const u16 * p_indices, u32 num_tris, u8 * p_tri_flags )
+{
+	u32		t( 0 );
+
+#ifdef __AVX2__
+	const int *		p_flags( reinterpret_cast< const int * >( &p_verts[ 0 ].ClipFlags ) );
+
+	for( ; t + 8 <= num_tris; t += 8 )
+	{
+		const u16 *		idx( p_indices + t * 3 );
+
+		// DaedalusVtx4 is 16 words, so the word index of a vertex's flags is index << 4
+		const __m256i	i0( _mm256_slli_epi32( _mm256_setr_epi32( idx[ 0], idx[ 3], idx[ 6], idx[ 9], idx[12], idx[15], idx[18], idx[21] ), 4 ) );
+		const __m256i	i1( _mm256_slli_epi32( _mm256_setr_epi32( idx[ 1], idx[ 4], idx[ 7], idx[10], idx[13], idx[16], idx[19], idx[22] ), 4 ) );
+		const __m256i	i2( _mm256_slli_epi32( _mm256_setr_epi32( idx[ 2], idx[ 5], idx[ 8], idx[11], idx[14], idx[17], idx[20], idx[23] ), 4 ) );
+
+		const __m256i	f0( _mm256_i32gather_epi32( p_flags, i0, 4 ) );
+		const __m256i	f1( _mm256_i32gather_epi32( p_flags, i1, 4 ) );
+		const __m256i	f2( _mm256_i32gather_epi32( p_flags, i2, 4 ) );
+
+		StoreTriClipFlags( p_tri_flags + t,     TriClipFlags( _mm256_castsi256_si128( f0 ), _mm256_castsi256_si128( f1 ), _mm256_castsi256_si128( f2 ) ) );
+		StoreTriClipFlags( p_tri_flags + t + 4, TriClipFlags( _mm256_extracti128_si256( f0, 1 ), _mm256_extracti128_si256( f1, 1 ), _mm256_extracti128_si256( f2, 1 ) ) );
+	}
+#endif
+
+	for( ; t + 4 <= num_tris; t += 4 )
+	{
+		const u16 *		idx( p_indices + t * 3 );
+
+		const __m128i	f0( _mm_setr_epi32( p_verts[ idx[0] ].ClipFlags, p_verts[ idx[3] ].ClipFlags, p_verts[ idx[6] ].ClipFlags, p_verts[ idx[ 9] ].ClipFlags ) );
+		const __m128i	f1( _mm_setr_epi32( p_verts[ idx[1] ].ClipFlags, p_verts[ idx[4] ].ClipFlags, p_verts[ idx[7] ].ClipFlags, p_verts[ idx[10] ].ClipFlags ) );
+		const __m128i	f2( _mm_setr_epi32( p_verts[ idx[2] ].ClipFlags, p_verts[ idx[5] ].ClipFlags, p_verts[ idx[8] ].ClipFlags, p_verts[ idx[11] ].ClipFlags ) );
+
+		StoreTriClipFlags( p_tri_flags + t, TriClipFlags( f0, f1, f2 ) );
+	}
+
+	for( ; t < num_tris; ++t )
+	{
+		const u32	f0( p_verts[ p_indices[ t*3 + 0 ] ].ClipFlags );
+		const u32	f1( p_verts[ p_indices[ t*3 + 1 ] ].ClipFlags );
+		const u32	f2( p_verts[ p_indices[ t*3 + 2 ] ].ClipFlags );
+
+		p_tri_flags[ t ] = (f0 & f1 & f2) ? CLIP_REJECTED : u8( f0 | f1 | f2 );
+	}
+}
+
+#endif // DAEDALUS_ENABLE_SSE_TNL
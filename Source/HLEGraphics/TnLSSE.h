@@ -0,0 +1,59 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef HLEGRAPHICS_TNLSSE_H_
+#define HLEGRAPHICS_TNLSSE_H_
+
+//
+//	SSE2 versions of the FPU transform and lighting loops in BaseRenderer, the
+//	desktop equivalent of the PSP's TnLVFPU.S. Vertices are processed four at
+//	a time (eight when built with AVX) in structure of arrays form, and the
+//	results scattered back into the DaedalusVtx4 array.
+//
+//	The results are the same as the FPU code's, bit for bit on x86_64 - the
+//	arithmetic is done in the same order, and the branches in the FPU code
+//	are replaced with masks rather than approximations. Fog is left alone as
+//	the FPU code only does it on the PSP.
+//
+//	The tris to be clipped are classified the same way, several at a time, so
+//	PrepareTrisClipped only has to clip the ones straddling the clipbox. With
+//	AVX2 the clip flags are fetched with gathers.
+//
+#ifdef DAEDALUS_ENABLE_SSE_TNL
+
+#include "DaedalusVtx.h"
+
+class Matrix4x4;
+struct FiddledVtx;
+struct FiddledVtxPD;
+struct TnLParams;
+
+void	TnLSSE( const Matrix4x4 & mat_world, const Matrix4x4 & mat_world_project, const FiddledVtx * p_in, DaedalusVtx4 * p_out, u32 num_vertices, const TnLParams & params );
+void	TnLSSE_CBFD( const Matrix4x4 & mat_world, const Matrix4x4 & mat_project, const FiddledVtx * p_in, DaedalusVtx4 * p_out, u32 num_vertices, const TnLParams & params, const s8 * model_norm, u32 v0 );
+void	TnLSSE_PD( const Matrix4x4 & mat_world, const Matrix4x4 & mat_project, const FiddledVtxPD * p_in, DaedalusVtx4 * p_out, u32 num_vertices, const TnLParams & params, const u8 * model_norm );
+void	TnLSSE_DKR( const Matrix4x4 & mat_world_project, const u8 * p_ram, u32 address, DaedalusVtx4 * p_out, u32 num_vertices );		// address is the RDRAM offset of the 10 byte DKR vertices
+
+// Writes the union of the clip flags of each tri's vertices to p_tri_flags, or CLIP_REJECTED if they are all outside the same plane
+void	ClassifyTrisSSE( const DaedalusVtx4 * p_verts, const u16 * p_indices, u32 num_tris, u8 * p_tri_flags );
+
+#endif // DAEDALUS_ENABLE_SSE_TNL
+
+#endif // HLEGRAPHICS_TNLSSE_H_
@@ -482,6 +482,7 @@ void DLParser_S2DEX_ObjLoadTxtr( MicroCodeCommand command )
 
 		// Store TLUT pointer
 		gTlutLoadAddresses[ (ObjTxtr->tlut.phead>>2) & 0x3F ] = (u32*)(g_pu8RamBase + RDPSegAddr(ObjTlut->image));
+		gTlutLoadCount++;
 		gObjTxtr = NULL;
 	}
 	else // (TXTRBLOCK, TXTRTILE)
@@ -522,6 +523,11 @@ inline void DLParser_Yoshi_MemRect( MicroCodeCommand command )
 
 	DL_PF ("    MemRect->Addr[0x%08x] (%d, %d -> %d, %d) Width[%d]", tile_addr, x0, y0, mem_rect.x1, y1, g_CI.Width);
 
+	if (y1 > y0)
+	{
+		MEMORY_MARK_DIRTY_HOST_RANGE( g_pu8RamBase + g_CI.Address + y0 * g_CI.Width, (y1 - y0) * g_CI.Width + x0 + 16 );
+	}
+
 #if 1	//1->Optimized, 0->Generic
 	// This assumes Yoshi always copy 16 bytes per line and dst is aligned and we force alignment on src!!! //Corn
 	u32 tex_width = rdp_tile.line << 3;
@@ -606,6 +612,8 @@ void DLParser_OB_YUV(const uObjSprite *sprite)
 	u16 * dst = (u16*)(g_pu8RamBase + g_CI.Address);
 	dst += ul_x + ul_y * ci_width;
 
+	MEMORY_MARK_DIRTY_HOST_RANGE( dst, 16 * ci_width * sizeof( u16 ) );
+
 	//yuv macro block contains 16x16 texture. we need to put it in the proper place inside cimg
 	for (u16 h = 0; h < 16; h++)
 	{
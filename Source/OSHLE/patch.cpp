@@ -31,6 +31,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Config/ConfigOptions.h"
 #include "Core/CPU.h"
 #include "Core/DMA.h"
+#include "Core/Dynamo.h"
 #include "Core/Memory.h"
 #include "Core/R4300.h"
 #include "Core/Registers.h"
@@ -209,6 +210,9 @@ void Patch_ApplyPatch(u32 i)
 #ifdef DAEDALUS_ENABLE_DYNAREC
 	u32 pc = g_PatchSymbols[i]->Location;
 
+	// The compile thread allocates from the same code buffer
+	CPU_FlushTraceCompiler();
+
 	CFragment *frag = new CFragment(gFragmentCache.GetCodeBufferManager(),
 									PHYS_TO_K0(pc),
 									g_PatchSymbols[i]->Signatures->NumOps,
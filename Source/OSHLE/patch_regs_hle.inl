@@ -55,6 +55,7 @@ u32 Patch_osGetCount()
 {
 TEST_DISABLE_REG_FUNCS
 
+	CPU_SyncCounter();
 	gGPR[REG_v0]._s64 = (s64)gCPUState.CPUControl[C0_COUNT]._u32;
 
 	return PATCH_RET_JR_RA;
@@ -119,7 +120,7 @@ u32 Patch___osSetFpcCsr()
 TEST_DISABLE_REG_FUNCS
 	gGPR[REG_v0]._s64 = (s64)gCPUState.FPUControl[31]._u32;
 
-	gCPUState.FPUControl[31]._u32 = gGPR[REG_a0]._u32_0;
+	R4300_SetFPCSR(gGPR[REG_a0]._u32_0);
 	DBGConsole_Msg(0, "__osSetFpcCsr()");
 
 	return PATCH_RET_JR_RA;
@@ -233,7 +233,7 @@ TEST_DISABLE_THREAD_FUNCS
 	if (RestoreFP != 0)
 	{
 		// Restore control reg
-		gCPUState.FPUControl[31]._u32 = QuickRead32Bits(pThreadBase, offsetof(OSThread, context.fpcsr));
+		R4300_SetFPCSR(QuickRead32Bits(pThreadBase, offsetof(OSThread, context.fpcsr)));
 
 		// Floats - can probably optimise this to eliminate 64 bits reads...
 		for (u32 FPReg = 0; FPReg < 16; FPReg++)
@@ -371,7 +371,7 @@ TEST_DISABLE_THREAD_FUNCS
 	if (RestoreFP != 0)
 	{
 		// Restore control reg
-		gCPUState.FPUControl[31]._u32 = QuickRead32Bits(pThreadBase, offsetof(OSThread, context.fpcsr));
+		R4300_SetFPCSR(QuickRead32Bits(pThreadBase, offsetof(OSThread, context.fpcsr)));
 
 		// Floats - can probably optimise this to eliminate 64 bits reads...
 		for (u32 FPReg = 0; FPReg < 16; FPReg++)
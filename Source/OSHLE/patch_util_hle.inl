@@ -41,6 +41,7 @@ TEST_DISABLE_UTIL_FUNCS
 
 #if 1	//1->Fast, 0->Old way
 	fast_memcpy_swizzle( (void *)ReadAddress(dst), (void *)ReadAddress(src), len);
+	MEMORY_MARK_DIRTY_HOST_RANGE( ReadAddress(dst), len );
 #else
 	//DBGConsole_Msg(0, "memcpy(0x%08x, 0x%08x, %d)", dst, src, len);
 	u8 *pdst = (u8*)ReadAddress(dst);
@@ -159,6 +160,8 @@ TEST_DISABLE_UTIL_FUNCS
 	u8 *pdst = (u8*)ReadAddress(dst);
 	u8 *psrc = (u8*)ReadAddress(src);
 
+	MEMORY_MARK_DIRTY_HOST_RANGE( pdst, len );
+
 	if (dst > src && dst < src + len)
 	{
 		pdst += len;
@@ -197,6 +200,8 @@ u32 Patch_bzero()
 
 	u8* dst8 = (u8*)ReadAddress(dst);
 
+	MEMORY_MARK_DIRTY_HOST_RANGE( dst8, len );
+
 #if (DAEDALUS_ENDIAN_MODE == DAEDALUS_ENDIAN_BIG)
 	memset( dst8, 0, len);
 #else
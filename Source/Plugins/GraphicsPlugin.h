@@ -32,6 +32,7 @@ class CGraphicsPlugin
 		virtual void		ViStatusChanged() = 0;
 		virtual void		ViWidthChanged() = 0;
 		virtual void		ProcessDList() = 0;
+		virtual void		SyncDList()				{}	// Waits for a display list still being processed on another thread
 
 		virtual void		UpdateScreen() = 0;
 
@@ -2,6 +2,9 @@
 
 #include <stdio.h>
 
+#include "Config/ConfigOptions.h"
+
+#include "Core/CPU.h"
 #include "Core/Memory.h"
 
 #include "Debug/DBGConsole.h"
@@ -13,8 +16,14 @@
 #include "HLEGraphics/DLParser.h"
 #include "HLEGraphics/DisplayListDebugger.h"
 
+#include "OSHLE/ultra_rcp.h"
+#include "OSHLE/ultra_sptask.h"
+
 #include "Plugins/GraphicsPlugin.h"
 
+#include "Utility/Cond.h"
+#include "Utility/Mutex.h"
+#include "Utility/Thread.h"
 #include "Utility/Timing.h"
 
 #include "SysGL/GL.h"
@@ -88,6 +97,241 @@ static void	UpdateFramerate()
 }
 }
 
+#ifdef DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+//
+//	Runs the display lists on a worker thread, so the next frame can be
+//	emulated while this one is being drawn. The worker only has the GL
+//	context while it's running a display list; the emulation thread takes
+//	it back in between to swap buffers, as everything that reads the VI
+//	registers stays on the emulation thread.
+//
+//	Only the OSTask is copied. Games double buffer their display lists, and
+//	at most one display list is in flight (Submit waits for the last one),
+//	so anything the game rebuilds after the DP interrupt is in the other
+//	buffer. Games which read back a framebuffer need to wait for it to be
+//	drawn, so while a display list is in flight the colour and depth images
+//	of the last few display lists are watched, and the first CPU access to
+//	one of them waits for the worker. Textures or vertices which are updated
+//	in place in RDRAM can still be a frame out, which is why this is optional.
+//
+class CDisplayListThread
+{
+public:
+	CDisplayListThread();
+	~CDisplayListThread();
+
+	bool			Start();				// Returns true if the thread is running
+	void			Stop();
+
+	void			Submit( const OSTask & task );
+	void			Sync();
+
+private:
+	static u32 DAEDALUS_THREAD_CALL_TYPE	DisplayListThread( void * arg );
+	void			Run();
+	void			UpdateRecentImages();
+
+private:
+	static const u32	kMaxRecentImages = 4;		// Triple buffering plus a depth buffer
+
+	ThreadHandle	mThread;
+	Mutex			mMutex;
+	Cond *			mWorkReady;
+	Cond *			mWorkDone;
+	OSTask			mTask;
+	bool			mPending;				// Set until the worker has finished with mTask
+	bool			mWantQuit;
+
+	SFramebufferRange	mRecentImages[ kMaxRecentImages ];	// Most recently used first
+	u32				mNumRecentImages;
+	bool			mImagesChanged;			// Set when a task has finished since UpdateRecentImages
+};
+
+// Called by the memory watch, which can be from the fastmem fault handler
+static void SyncDisplayListThread()
+{
+	gGraphicsPlugin->SyncDList();
+}
+
+CDisplayListThread::CDisplayListThread()
+:	mThread( kInvalidThreadHandle )
+,	mMutex( "DisplayList" )
+,	mWorkReady( CondCreate() )
+,	mWorkDone( CondCreate() )
+,	mPending( false )
+,	mWantQuit( false )
+,	mNumRecentImages( 0 )
+,	mImagesChanged( false )
+{
+}
+
+CDisplayListThread::~CDisplayListThread()
+{
+	Stop();
+
+	CondDestroy( mWorkReady );
+	CondDestroy( mWorkDone );
+}
+
+bool CDisplayListThread::Start()
+{
+	if( mThread != kInvalidThreadHandle )
+		return true;
+
+	mWantQuit = false;
+	mThread = CreateThread( "DisplayList", DisplayListThread, this );
+
+	if( mThread == kInvalidThreadHandle )
+	{
+		DBGConsole_Msg( 0, "Couldn't start the display list thread - processing synchronously" );
+		return false;
+	}
+
+	// Pick up the images from the display lists run so far
+	mNumRecentImages = 0;
+	mImagesChanged = true;
+	return true;
+}
+
+void CDisplayListThread::Stop()
+{
+	if( mThread != kInvalidThreadHandle )
+	{
+		mMutex.Lock();
+		mWantQuit = true;
+		CondSignal( mWorkReady );
+		mMutex.Unlock();
+
+		JoinThread( mThread, -1 );
+		ReleaseThreadHandle( mThread );
+		mThread = kInvalidThreadHandle;
+
+		Memory_UnwatchRanges();
+
+		glfwMakeContextCurrent( gWindow );
+	}
+}
+
+//*****************************************************************************
+//	The caller has to release the context first
+//*****************************************************************************
+void CDisplayListThread::Submit( const OSTask & task )
+{
+	Sync();
+
+	{
+		MutexLock	lock( &mMutex );
+
+		mTask = task;
+		mPending = true;
+		mImagesChanged = true;
+		CondSignal( mWorkReady );
+	}
+
+	for( u32 i = 0; i < mNumRecentImages; ++i )
+	{
+		Memory_WatchRange( mRecentImages[ i ].Address, mRecentImages[ i ].Length, SyncDisplayListThread );
+	}
+}
+
+//*****************************************************************************
+//	This has to be safe to call from the fastmem fault handler, so no GL
+//*****************************************************************************
+void CDisplayListThread::Sync()
+{
+	{
+		MutexLock	lock( &mMutex );
+
+		while( mPending )
+		{
+			CondWait( mWorkDone, &mMutex, kTimeoutInfinity );
+		}
+	}
+
+	// Nothing is being drawn, so there's nothing to wait for
+	Memory_UnwatchRanges();
+
+	if( mImagesChanged )
+	{
+		UpdateRecentImages();
+		mImagesChanged = false;
+	}
+}
+
+void CDisplayListThread::UpdateRecentImages()
+{
+	const SFramebufferRange *	images;
+	u32							num_images( DLParser_GetTaskImages( &images ) );
+
+	for( u32 i = 0; i < num_images; ++i )
+	{
+		u32		existing( 0 );
+		while( existing < mNumRecentImages && mRecentImages[ existing ].Address != images[ i ].Address )
+		{
+			existing++;
+		}
+
+		if( existing == mNumRecentImages && mNumRecentImages < kMaxRecentImages )
+		{
+			mNumRecentImages++;
+		}
+		else if( existing == mNumRecentImages )
+		{
+			existing = mNumRecentImages - 1;
+		}
+
+		// Move it (or the one it replaces) to the front
+		for( u32 j = existing; j > 0; --j )
+		{
+			mRecentImages[ j ] = mRecentImages[ j - 1 ];
+		}
+		mRecentImages[ 0 ] = images[ i ];
+	}
+}
+
+u32 DAEDALUS_THREAD_CALL_TYPE CDisplayListThread::DisplayListThread( void * arg )
+{
+	CDisplayListThread *	thread( static_cast< CDisplayListThread * >( arg ) );
+
+	thread->Run();
+
+	return 0;
+}
+
+void CDisplayListThread::Run()
+{
+	mMutex.Lock();
+
+	while( true )
+	{
+		while( !mPending && !mWantQuit )
+		{
+			CondWait( mWorkReady, &mMutex, kTimeoutInfinity );
+		}
+
+		// Finish off the last display list before quitting
+		if( !mPending )
+			break;
+
+		OSTask	task( mTask );
+
+		mMutex.Unlock();
+
+		// A context can only be current on one thread at a time
+		glfwMakeContextCurrent( gWindow );
+		DLParser_ProcessTask( task );
+		glfwMakeContextCurrent( NULL );
+
+		mMutex.Lock();
+
+		mPending = false;
+		CondSignal( mWorkDone );
+	}
+
+	mMutex.Unlock();
+}
+#endif // DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+
 class CGraphicsPluginImpl : public CGraphicsPlugin
 {
 	public:
@@ -101,17 +345,26 @@ class CGraphicsPluginImpl : public CGraphicsPlugin
 		virtual void		ViStatusChanged()		{}
 		virtual void		ViWidthChanged()		{}
 		virtual void		ProcessDList();
+		virtual void		SyncDList();
 
 		virtual void		UpdateScreen();
 
 		virtual void		RomClosed();
 
+	private:
+				void		UpdateWindowTitle();
+
 	private:
 		u32					LastOrigin;
+		float				LastTitleFramerate;
+#ifdef DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+		CDisplayListThread	DisplayListThread;
+#endif
 };
 
 CGraphicsPluginImpl::CGraphicsPluginImpl()
 :	LastOrigin( 0 )
+,	LastTitleFramerate( 0.0f )
 {
 }
 
@@ -147,24 +400,65 @@ void CGraphicsPluginImpl::ProcessDList()
 		DLParser_Process();
 	}
 #else
+#ifdef DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+	// The first display list is always run here, so the framebuffers are
+	// known (and watched) before the worker draws to any of them.
+	extern u32 gRDPFrame;
+	if (gDisplayListThreadEnabled && gRDPFrame > 0 && DisplayListThread.Start())
+	{
+		// The last frame has to be finished before it's shown. The Chameleon
+		// Twist 2 hack doesn't apply, as that's already the case.
+		DisplayListThread.Sync();
+
+		glfwMakeContextCurrent(gWindow);
+		if (DLParser_BeginTask())
+		{
+			UpdateScreen();
+		}
+		glfwMakeContextCurrent(NULL);
+
+		DisplayListThread.Submit(*(const OSTask *)(g_pu8SpMemBase + 0x0FC0));
+
+		// Tell the game the RDP is done straight away, as DLParser_Process would
+		Memory_MI_SetRegisterBits(MI_INTR_REG, MI_INTR_DP);
+		gCPUState.AddJob(CPU_CHECK_INTERRUPTS);
+		return;
+	}
+#endif
 	DLParser_Process();
 #endif
 }
 
-void CGraphicsPluginImpl::UpdateScreen()
+void CGraphicsPluginImpl::SyncDList()
 {
-	u32 current_origin = Memory_VI_GetRegister(VI_ORIGIN_REG);
+#ifdef DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+	DisplayListThread.Sync();
+#endif
+}
 
-	if (current_origin != LastOrigin)
+void CGraphicsPluginImpl::UpdateWindowTitle()
+{
+	if (gCurrentFramerate != LastTitleFramerate)
 	{
-		UpdateFramerate();
-
 		// FIXME: safe printf
 		char string[22];
 		sprintf(string, "Daedalus | FPS %#.1f", gCurrentFramerate);
 
 		glfwSetWindowTitle(gWindow, string);
 
+		LastTitleFramerate = gCurrentFramerate;
+	}
+}
+
+void CGraphicsPluginImpl::UpdateScreen()
+{
+	u32 current_origin = Memory_VI_GetRegister(VI_ORIGIN_REG);
+
+	if (current_origin != LastOrigin)
+	{
+		UpdateFramerate();
+		UpdateWindowTitle();
+
 		if (gTakeScreenshot)
 		{
 			CGraphicsContext::Get()->DumpNextScreen();
@@ -180,6 +474,9 @@ void CGraphicsPluginImpl::UpdateScreen()
 void CGraphicsPluginImpl::RomClosed()
 {
 	DBGConsole_Msg(0, "Finalising GLGraphics");
+#ifdef DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+	DisplayListThread.Stop();
+#endif
 	DLParser_Finalise();
 	CTextureCache::Destroy();
 	DestroyRenderer();
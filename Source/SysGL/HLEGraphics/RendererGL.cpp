@@ -3,8 +3,11 @@
 
 #include <vector>
 
+#include "ShaderCache.h"
+
 #include "Core/ROM.h"
 #include "Debug/DBGConsole.h"
+#include "Debug/Dump.h"
 #include "Graphics/ColourValue.h"
 #include "Graphics/GraphicsContext.h"
 #include "Graphics/NativeTexture.h"
@@ -13,6 +16,7 @@
 #include "OSHLE/ultra_gbi.h"
 #include "SysGL/GL.h"
 #include "System/Paths.h"
+#include "Utility/Hash.h"
 #include "Utility/IO.h"
 #include "Utility/Macros.h"
 #include "Utility/Profiler.h"
@@ -35,6 +39,12 @@ static PFN_glDeleteVertexArrays         pglDeleteVertexArrays = NULL;
 // We read n64.psh into this.
 static const char * 					gN64FramentLibrary = NULL;
 
+// Set if the driver can save and restore linked programs (see ShaderCache.h)
+static bool								gProgramBinariesSupported = false;
+static u32								gShaderContextHash = 0;
+
+static u32 MakeShaderContextHash();
+
 static const u32 kNumTextures = 2;
 
 #define RESOLVE_GL_FCN(type, var, name) \
@@ -136,6 +146,14 @@ bool initgl()
 
 	glBindBuffer(GL_ARRAY_BUFFER, gVBOs[kColorBuffer]);
 	glBufferData(GL_ARRAY_BUFFER, sizeof(gColorBuffer), gColorBuffer, GL_DYNAMIC_DRAW);
+
+	if (GLEW_ARB_get_program_binary || GLEW_VERSION_4_1)
+	{
+		GLint num_formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+		gProgramBinariesSupported = num_formats > 0;
+	}
+	gShaderContextHash = MakeShaderContextHash();
 	return true;
 }
 
@@ -155,37 +173,12 @@ void sceGuSetMatrix(EGuMatrixType type, const ScePspFMatrix4 * mtx)
 	}
 }
 
-// This defines all the state that is expressed by a given shader.
-// If any of these fields change, it requires building a different shader.
-struct ShaderConfiguration
-{
-	u64		Mux;
-	u32		CycleType : 2;
-	u32		BilerpFilter : 1;
-	u32		ClampS0 : 1;
-	u32		ClampT0 : 1;
-	u32		ClampS1 : 1;
-	u32		ClampT1 : 1;
-	u8		AlphaThreshold;
-};
-
-inline bool operator==(const ShaderConfiguration & a, const ShaderConfiguration & b)
-{
-	return
-		a.Mux            == b.Mux &&
-		a.CycleType      == b.CycleType &&
-		a.BilerpFilter   == b.BilerpFilter &&
-		a.ClampS0        == b.ClampS0 &&
-		a.ClampT0        == b.ClampT0 &&
-		a.ClampS1        == b.ClampS1 &&
-		a.ClampT1        == b.ClampT1 &&
-		a.AlphaThreshold == b.AlphaThreshold;
-}
-
 struct ShaderProgram
 {
 	ShaderConfiguration config;
 	GLuint 				program;
+	u32					source_hash;		// Hash of the fragment shader source
+	u32					rom_session;		// The last gRomSession this program was used in
 
 	GLint				uloc_project;
 	GLint				uloc_primcol;
@@ -204,7 +197,12 @@ struct ShaderProgram
 
 	GLint				uloc_foo;
 };
-static std::vector<ShaderProgram *>		gShaders;
+static CShaderProgramMap				gShaderPrograms;
+
+// The programs used (or loaded from the shader cache) since the rom was opened
+static std::vector<ShaderProgram *>		gRomShaders;
+static u32								gRomSession = 0;
+static bool								gRomShadersDirty = false;	// Set if any programs were compiled from source
 
 
 /* Creates a shader object of the specified type using the specified text
@@ -262,6 +260,11 @@ static GLuint make_shader_program(const char ** vertex_lines, size_t num_vertex_
 				glAttachShader(program, vertex_shader);
 				glAttachShader(program, fragment_shader);
 
+				if (gProgramBinariesSupported)
+				{
+					glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+				}
+
 				glLinkProgram(program);
 				glGetProgramiv(program, GL_LINK_STATUS, &program_ok);
 
@@ -465,10 +468,12 @@ static void SprintShader(char (&frag_shader)[2048], const ShaderConfiguration &
 	sprintf(frag_shader, default_fragment_shader_fmt, body);
 }
 
-static void InitShaderProgram(ShaderProgram * program, const ShaderConfiguration & config, GLuint shader_program)
+static void InitShaderProgram(ShaderProgram * program, const ShaderConfiguration & config, GLuint shader_program, u32 source_hash)
 {
 	program->config            = config;
 	program->program           = shader_program;
+	program->source_hash       = source_hash;
+	program->rom_session       = 0;
 	program->uloc_project      = glGetUniformLocation(shader_program, "uProject");
 	program->uloc_primcol      = glGetUniformLocation(shader_program, "uPrimColour");
 	program->uloc_envcol       = glGetUniformLocation(shader_program, "uEnvColour");
@@ -566,15 +571,30 @@ void RendererGL::MakeShaderConfigFromCurrentState(ShaderConfiguration * config)
 	}
 }
 
+static u32 HashFragmentShader(const char * frag_shader)
+{
+	return murmur2_hash(frag_shader, strlen(frag_shader), 0);
+}
+
+static void NoteShaderUsed(ShaderProgram * program)
+{
+	if (program->rom_session != gRomSession)
+	{
+		program->rom_session = gRomSession;
+		gRomShaders.push_back(program);
+	}
+}
+
 static ShaderProgram * GetShaderForConfig(const ShaderConfiguration & config)
 {
 	DAEDALUS_ASSERT( gN64FramentLibrary != NULL, "Haven't initialised the n64 fragment library" );
 
-	for (u32 i = 0; i < gShaders.size(); ++i)
+	ShaderKey key = MakeShaderKey(config);
+	ShaderProgram * program = gShaderPrograms.Find(key);
+	if (program != NULL)
 	{
-		ShaderProgram * program = gShaders[i];
-		if (program->config == config)
-			return program;
+		NoteShaderUsed(program);
+		return program;
 	}
 
 	char frag_shader[2048];
@@ -592,13 +612,168 @@ static ShaderProgram * GetShaderForConfig(const ShaderConfiguration & config)
 		return NULL;
 	}
 
-	ShaderProgram * program = new ShaderProgram;
-	InitShaderProgram(program, config, shader_program);
-	gShaders.push_back(program);
+	program = new ShaderProgram;
+	InitShaderProgram(program, config, shader_program, HashFragmentShader(frag_shader));
+	gShaderPrograms.Insert(key, program);
+
+	NoteShaderUsed(program);
+	gRomShadersDirty = true;
+
+	return program;
+}
+
+// Identifies the driver and the shader source shared by all the programs
+static u32 MakeShaderContextHash()
+{
+	const char * strings[] =
+	{
+		(const char *)glGetString(GL_VENDOR),
+		(const char *)glGetString(GL_RENDERER),
+		(const char *)glGetString(GL_VERSION),
+		default_vertex_shader,
+		default_fragment_shader_fmt,
+		gN64FramentLibrary,
+	};
+
+	u32 hash = 0;
+	for (u32 i = 0; i < ARRAYSIZE(strings); ++i)
+	{
+		if (strings[i] != NULL)
+			hash = murmur2_hash(strings[i], strlen(strings[i]), hash);
+	}
+	return hash;
+}
+
+static ShaderProgram * MakeShaderFromBinary(const SShaderBinary & binary)
+{
+	ShaderConfiguration config = MakeShaderConfiguration(binary.Key);
+
+	// Don't use binaries built from a different version of this shader
+	char frag_shader[2048];
+	SprintShader(frag_shader, config);
+
+	u32 source_hash = HashFragmentShader(frag_shader);
+	if (binary.SourceHash != source_hash)
+		return NULL;
+
+	GLuint shader_program = glCreateProgram();
+	if (shader_program == 0)
+		return NULL;
+
+	glProgramBinary(shader_program, binary.Format, &binary.Data[0], binary.Data.size());
+
+	GLint program_ok;
+	glGetProgramiv(shader_program, GL_LINK_STATUS, &program_ok);
+	if (program_ok != GL_TRUE)
+	{
+		glDeleteProgram(shader_program);
+		return NULL;
+	}
 
+	ShaderProgram * program = new ShaderProgram;
+	InitShaderProgram(program, config, shader_program, source_hash);
 	return program;
 }
 
+// Creates the programs saved by the last session with this rom, so they don't have to be compiled when they're first drawn.
+static void LoadShaderCache()
+{
+	gRomSession++;
+	gRomShaders.clear();
+	gRomShadersDirty = false;
+
+	if (!gProgramBinariesSupported)
+		return;
+
+	IO::Filename name;
+	Dump_GetSaveDirectory(name, g_ROM.mFileName, ".shc");
+
+	FILE * fh = fopen(name, "rb");
+	if (fh == NULL)
+		return;
+
+	std::vector<SShaderBinary> binaries;
+	bool ok = ShaderCache_Read(fh, gShaderContextHash, binaries);
+	fclose(fh);
+
+	if (!ok)
+	{
+		DBGConsole_Msg(0, "Ignoring shader cache: %s", name);
+		gRomShadersDirty = true;
+		return;
+	}
+
+	u32 num_loaded = 0;
+	for (u32 i = 0; i < binaries.size(); ++i)
+	{
+		const SShaderBinary & binary = binaries[i];
+
+		ShaderProgram * program = gShaderPrograms.Find(binary.Key);
+		if (program == NULL)
+		{
+			program = MakeShaderFromBinary(binary);
+			if (program == NULL)
+			{
+				// The driver or shader has changed - rewrite the file with whatever gets compiled instead
+				gRomShadersDirty = true;
+				continue;
+			}
+
+			gShaderPrograms.Insert(binary.Key, program);
+			num_loaded++;
+		}
+
+		NoteShaderUsed(program);
+	}
+
+	DBGConsole_Msg(0, "Read from shader cache: %s (%d of %d programs)", name, num_loaded, u32(binaries.size()));
+}
+
+static void SaveShaderCache()
+{
+	if (!gProgramBinariesSupported || !gRomShadersDirty)
+		return;
+
+	std::vector<SShaderBinary> binaries;
+	for (u32 i = 0; i < gRomShaders.size(); ++i)
+	{
+		const ShaderProgram * program = gRomShaders[i];
+
+		GLint length = 0;
+		glGetProgramiv(program->program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			continue;
+
+		SShaderBinary binary;
+		binary.Key        = MakeShaderKey(program->config);
+		binary.SourceHash = program->source_hash;
+		binary.Data.resize(length);
+
+		GLsizei written = 0;
+		GLenum  format  = 0;
+		glGetProgramBinary(program->program, length, &written, &format, &binary.Data[0]);
+		if (written <= 0)
+			continue;
+
+		binary.Data.resize(written);
+		binary.Format = format;
+		binaries.push_back(binary);
+	}
+
+	IO::Filename name;
+	Dump_GetSaveDirectory(name, g_ROM.mFileName, ".shc");
+	DBGConsole_Msg(0, "Write shader cache: %s (%d programs)", name, u32(binaries.size()));
+
+	FILE * fh = fopen(name, "wb");
+	if (fh == NULL)
+		return;
+
+	ShaderCache_Write(fh, gShaderContextHash, binaries);
+	fclose(fh);
+
+	gRomShadersDirty = false;
+}
+
 void RendererGL::RestoreRenderStates()
 {
 	// Initialise the device to our default state
@@ -1278,10 +1453,14 @@ bool CreateRenderer()
 	DAEDALUS_ASSERT_Q(gRenderer == NULL);
 	gRendererGL = new RendererGL();
 	gRenderer   = gRendererGL;
+
+	LoadShaderCache();
 	return true;
 }
 void DestroyRenderer()
 {
+	SaveShaderCache();
+
 	delete gRendererGL;
 	gRendererGL = NULL;
 	gRenderer   = NULL;
@@ -0,0 +1,234 @@
+/*
+Copyright (C) 2013 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "ShaderCache.h"
+
+#include "Utility/Hash.h"
+
+namespace
+{
+	const u32	MAGIC_HEADER = 0x53484331;		// 'SHC1'
+	const u32	VERSION = 1;					// Bump this whenever the file layout or ShaderKey change
+	const u32	MAX_PROGRAMS = 4096;			// Anything bigger than this has come from a corrupt file
+	const u32	MAX_BINARY_SIZE = 4 * 1024 * 1024;
+
+	void	WriteU32( FILE * fp, u32 data )
+	{
+		fwrite( &data, 1, sizeof( data ), fp );
+	}
+
+	bool	ReadU32( FILE * fp, u32 * p_data )
+	{
+		return fread( p_data, 1, sizeof( *p_data ), fp ) == sizeof( *p_data );
+	}
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+ShaderKey MakeShaderKey( const ShaderConfiguration & config )
+{
+	ShaderKey	key;
+	key.Mux   = config.Mux;
+	key.State = (config.CycleType      <<  0) |
+				(config.BilerpFilter   <<  2) |
+				(config.ClampS0        <<  3) |
+				(config.ClampT0        <<  4) |
+				(config.ClampS1        <<  5) |
+				(config.ClampT1        <<  6) |
+				(config.AlphaThreshold <<  8);
+	return key;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+ShaderConfiguration MakeShaderConfiguration( const ShaderKey & key )
+{
+	ShaderConfiguration	config;
+	config.Mux            = key.Mux;
+	config.CycleType      = (key.State >> 0) & 0x3;
+	config.BilerpFilter   = (key.State >> 2) & 0x1;
+	config.ClampS0        = (key.State >> 3) & 0x1;
+	config.ClampT0        = (key.State >> 4) & 0x1;
+	config.ClampS1        = (key.State >> 5) & 0x1;
+	config.ClampT1        = (key.State >> 6) & 0x1;
+	config.AlphaThreshold = (key.State >> 8) & 0xff;
+	return config;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+u32 HashShaderKey( const ShaderKey & key )
+{
+	u32		data[ 3 ] = { u32( key.Mux ), u32( key.Mux >> 32 ), key.State };
+
+	return murmur2_hash( data, sizeof( data ), 0 );
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+CShaderProgramMap::CShaderProgramMap()
+:	mEntries( INITIAL_TABLE_SIZE )
+,	mNumPrograms( 0 )
+{
+}
+
+//*************************************************************************************
+//	The slot holding key, or the empty slot it would go in
+//*************************************************************************************
+u32 CShaderProgramMap::FindSlot( const ShaderKey & key ) const
+{
+	u32		mask( mEntries.size() - 1 );
+
+	for( u32 slot = HashShaderKey( key ) & mask; ; slot = (slot + 1) & mask )
+	{
+		const SEntry &	entry( mEntries[ slot ] );
+		if( entry.Program == NULL || entry.Key == key )
+			return slot;
+	}
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+ShaderProgram * CShaderProgramMap::Find( const ShaderKey & key ) const
+{
+	return mEntries[ FindSlot( key ) ].Program;
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void CShaderProgramMap::Insert( const ShaderKey & key, ShaderProgram * program )
+{
+	DAEDALUS_ASSERT( program != NULL, "Can't insert a NULL program" );
+
+	SEntry &	entry( mEntries[ FindSlot( key ) ] );
+	DAEDALUS_ASSERT( entry.Program == NULL, "Already have a program for this key" );
+
+	entry.Key = key;
+	entry.Program = program;
+	mNumPrograms++;
+
+	// Keep the table at most half full, so probes stay short
+	if( mNumPrograms * 2 > mEntries.size() )
+	{
+		Grow();
+	}
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void CShaderProgramMap::Grow()
+{
+	std::vector< SEntry >	old_entries( mEntries.size() * 2 );
+	old_entries.swap( mEntries );
+
+	for( u32 i = 0; i < old_entries.size(); ++i )
+	{
+		const SEntry &	entry( old_entries[ i ] );
+		if( entry.Program != NULL )
+		{
+			mEntries[ FindSlot( entry.Key ) ] = entry;
+		}
+	}
+}
+
+//*************************************************************************************
+//
+//*************************************************************************************
+void ShaderCache_Write( FILE * fp, u32 context_hash, const std::vector< SShaderBinary > & binaries )
+{
+	WriteU32( fp, MAGIC_HEADER );
+	WriteU32( fp, VERSION );
+	WriteU32( fp, context_hash );
+	WriteU32( fp, binaries.size() );
+
+	for( u32 i = 0; i < binaries.size(); ++i )
+	{
+		const SShaderBinary &	binary( binaries[ i ] );
+		u32						size( binary.Data.size() );
+
+		DAEDALUS_ASSERT( size > 0, "Empty program binary" );
+
+		WriteU32( fp, u32( binary.Key.Mux ) );
+		WriteU32( fp, u32( binary.Key.Mux >> 32 ) );
+		WriteU32( fp, binary.Key.State );
+		WriteU32( fp, binary.SourceHash );
+		WriteU32( fp, binary.Format );
+		WriteU32( fp, size );
+		WriteU32( fp, murmur2_hash( &binary.Data[ 0 ], size, 0 ) );
+
+		fwrite( &binary.Data[ 0 ], 1, size, fp );
+	}
+}
+
+//*************************************************************************************
+//	Anything unexpected in the file throws away the whole thing
+//*************************************************************************************
+bool ShaderCache_Read( FILE * fp, u32 context_hash, std::vector< SShaderBinary > & binaries )
+{
+	binaries.clear();
+
+	u32		magic, version, hash, num_binaries;
+	bool	ok( ReadU32( fp, &magic ) && magic == MAGIC_HEADER &&
+				ReadU32( fp, &version ) && version == VERSION &&
+				ReadU32( fp, &hash ) && hash == context_hash &&
+				ReadU32( fp, &num_binaries ) && num_binaries <= MAX_PROGRAMS );
+
+	if( ok )
+	{
+		binaries.resize( num_binaries );
+	}
+
+	for( u32 i = 0; ok && i < num_binaries; ++i )
+	{
+		SShaderBinary &	binary( binaries[ i ] );
+		u32				mux_lo, mux_hi, size, data_hash;
+
+		ok = ReadU32( fp, &mux_lo ) &&
+			 ReadU32( fp, &mux_hi ) &&
+			 ReadU32( fp, &binary.Key.State ) &&
+			 ReadU32( fp, &binary.SourceHash ) &&
+			 ReadU32( fp, &binary.Format ) &&
+			 ReadU32( fp, &size ) && size > 0 && size <= MAX_BINARY_SIZE &&
+			 ReadU32( fp, &data_hash );
+
+		if( ok )
+		{
+			binary.Key.Mux = (u64( mux_hi ) << 32) | mux_lo;
+			binary.Data.resize( size );
+
+			ok = fread( &binary.Data[ 0 ], 1, size, fp ) == size &&
+				 murmur2_hash( &binary.Data[ 0 ], size, 0 ) == data_hash;
+		}
+	}
+
+	if( !ok )
+	{
+		binaries.clear();
+	}
+
+	return ok;
+}
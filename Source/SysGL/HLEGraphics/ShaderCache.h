@@ -0,0 +1,141 @@
+/*
+Copyright (C) 2013 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef SYSGL_HLEGRAPHICS_SHADERCACHE_H_
+#define SYSGL_HLEGRAPHICS_SHADERCACHE_H_
+
+//
+//	RendererGL builds a shader program for each combination of combiner mux
+//	and the other state in ShaderConfiguration. The programs are found by
+//	hashing a packed ShaderKey, rather than comparing against every program
+//	built so far.
+//
+//	Compiling and linking a program the first time a combiner is seen causes
+//	a noticeable hitch, so the programs used by each rom are saved (as
+//	<rom>.shc alongside the savegames) as glGetProgramBinary blobs, and
+//	loaded again when the rom is next opened. The blobs are only valid for
+//	the driver that produced them, and for the same shader source, so the
+//	file is tagged with a hash of the driver and the shared shader source,
+//	and each program with a hash of its own fragment shader.
+//
+//	None of this needs a GL context - RendererGL does the GL side.
+//
+
+#include <stdio.h>
+#include <vector>
+
+#include "Utility/DaedalusTypes.h"
+
+struct ShaderProgram;
+
+// This defines all the state that is expressed by a given shader.
+// If any of these fields change, it requires building a different shader.
+struct ShaderConfiguration
+{
+	u64		Mux;
+	u32		CycleType : 2;
+	u32		BilerpFilter : 1;
+	u32		ClampS0 : 1;
+	u32		ClampT0 : 1;
+	u32		ClampS1 : 1;
+	u32		ClampT1 : 1;
+	u8		AlphaThreshold;
+};
+
+inline bool operator==(const ShaderConfiguration & a, const ShaderConfiguration & b)
+{
+	return
+		a.Mux            == b.Mux &&
+		a.CycleType      == b.CycleType &&
+		a.BilerpFilter   == b.BilerpFilter &&
+		a.ClampS0        == b.ClampS0 &&
+		a.ClampT0        == b.ClampT0 &&
+		a.ClampS1        == b.ClampS1 &&
+		a.ClampT1        == b.ClampT1 &&
+		a.AlphaThreshold == b.AlphaThreshold;
+}
+
+// A ShaderConfiguration with no padding or unused bits, so it can be hashed and saved
+struct ShaderKey
+{
+	u64		Mux;
+	u32		State;		// CycleType, BilerpFilter, ClampS0, ClampT0, ClampS1, ClampT1 in bits 0-6, AlphaThreshold in bits 8-15
+};
+
+inline bool operator==(const ShaderKey & a, const ShaderKey & b)
+{
+	return a.Mux == b.Mux && a.State == b.State;
+}
+
+ShaderKey				MakeShaderKey( const ShaderConfiguration & config );
+ShaderConfiguration		MakeShaderConfiguration( const ShaderKey & key );
+u32						HashShaderKey( const ShaderKey & key );
+
+//
+//	Open addressed (linear probing) map from ShaderKey to ShaderProgram.
+//	Programs are never removed.
+//
+class CShaderProgramMap
+{
+public:
+	CShaderProgramMap();
+
+	ShaderProgram *		Find( const ShaderKey & key ) const;				// NULL if there's no program for key
+	void				Insert( const ShaderKey & key, ShaderProgram * program );
+
+	u32					GetNumPrograms() const						{ return mNumPrograms; }
+
+private:
+	struct SEntry
+	{
+		SEntry() : Program( NULL ) {}
+
+		ShaderKey			Key;
+		ShaderProgram *		Program;		// NULL if the slot is empty
+	};
+
+	u32					FindSlot( const ShaderKey & key ) const;
+	void				Grow();
+
+	static const u32	INITIAL_TABLE_SIZE = 256;		// Must be a power of two
+
+	std::vector< SEntry >	mEntries;
+	u32						mNumPrograms;
+};
+
+//
+//	The contents of a <rom>.shc file
+//
+struct SShaderBinary
+{
+	ShaderKey			Key;
+	u32					SourceHash;		// Hash of the fragment shader source the program was built from
+	u32					Format;			// As returned by glGetProgramBinary
+	std::vector< u8 >	Data;
+};
+
+// context_hash identifies the driver and shader source the binaries were built from
+void	ShaderCache_Write( FILE * fp, u32 context_hash, const std::vector< SShaderBinary > & binaries );
+
+// Returns false (and no binaries) if the file is corrupt or was written for a different context_hash
+bool	ShaderCache_Read( FILE * fp, u32 context_hash, std::vector< SShaderBinary > & binaries );
+
+#endif // SYSGL_HLEGRAPHICS_SHADERCACHE_H_
@@ -0,0 +1,211 @@
+#include <stdafx.h>
+#include "SysGL/HLEGraphics/ShaderCache.h"
+
+#include <string.h>
+
+#include <gtest/gtest.h>
+
+static ShaderConfiguration MakeTestConfiguration()
+{
+	ShaderConfiguration config;
+	memset(&config, 0, sizeof(config));
+	config.Mux            = 0x00fc9a6015fffe38LL;
+	config.CycleType      = 1;
+	config.BilerpFilter   = 1;
+	config.ClampS0        = 0;
+	config.ClampT0        = 1;
+	config.ClampS1        = 1;
+	config.ClampT1        = 0;
+	config.AlphaThreshold = 0x80;
+	return config;
+}
+
+static SShaderBinary MakeTestBinary(u32 i)
+{
+	SShaderBinary binary;
+	binary.Key.Mux     = 0x1234567800000000LL | i;
+	binary.Key.State   = i & 0xff7f;
+	binary.SourceHash  = i * 0x9e3779b9;
+	binary.Format      = 0x8e21;
+	binary.Data.resize(1 + i * 13);
+	for (u32 j = 0; j < binary.Data.size(); ++j)
+		binary.Data[j] = u8(i + j * 7);
+	return binary;
+}
+
+static bool operator==(const SShaderBinary & a, const SShaderBinary & b)
+{
+	return a.Key == b.Key && a.SourceHash == b.SourceHash && a.Format == b.Format && a.Data == b.Data;
+}
+
+TEST(ShaderKey, RoundTrips)
+{
+	ShaderConfiguration config = MakeTestConfiguration();
+	EXPECT_TRUE(MakeShaderConfiguration(MakeShaderKey(config)) == config);
+
+	for (u32 state = 0; state < 0x10000; ++state)
+	{
+		if (state & 0x80)
+			continue;
+
+		ShaderKey key;
+		key.Mux   = 0xffffffff00000001LL;
+		key.State = state;
+		EXPECT_TRUE(MakeShaderKey(MakeShaderConfiguration(key)) == key);
+	}
+}
+
+TEST(ShaderKey, EveryFieldChangesTheKey)
+{
+	const ShaderConfiguration base = MakeTestConfiguration();
+	const ShaderKey base_key = MakeShaderKey(base);
+
+	ShaderConfiguration configs[8];
+	for (u32 i = 0; i < 8; ++i)
+		configs[i] = base;
+
+	configs[0].Mux ^= 1LL << 63;
+	configs[1].CycleType = 2;
+	configs[2].BilerpFilter = 0;
+	configs[3].ClampS0 = 1;
+	configs[4].ClampT0 = 0;
+	configs[5].ClampS1 = 0;
+	configs[6].ClampT1 = 1;
+	configs[7].AlphaThreshold = 0x7f;
+
+	for (u32 i = 0; i < 8; ++i)
+	{
+		ShaderKey key = MakeShaderKey(configs[i]);
+		EXPECT_FALSE(key == base_key) << "field " << i;
+		EXPECT_NE(HashShaderKey(base_key), HashShaderKey(key)) << "field " << i;
+	}
+}
+
+TEST(ShaderKey, IgnoresPadding)
+{
+	ShaderConfiguration a;
+	ShaderConfiguration b;
+	memset(&a, 0x00, sizeof(a));
+	memset(&b, 0xff, sizeof(b));
+
+	ShaderConfiguration config = MakeTestConfiguration();
+	a.Mux = b.Mux = config.Mux;
+	a.CycleType = b.CycleType = config.CycleType;
+	a.BilerpFilter = b.BilerpFilter = config.BilerpFilter;
+	a.ClampS0 = b.ClampS0 = config.ClampS0;
+	a.ClampT0 = b.ClampT0 = config.ClampT0;
+	a.ClampS1 = b.ClampS1 = config.ClampS1;
+	a.ClampT1 = b.ClampT1 = config.ClampT1;
+	a.AlphaThreshold = b.AlphaThreshold = config.AlphaThreshold;
+
+	EXPECT_TRUE(MakeShaderKey(a) == MakeShaderKey(b));
+	EXPECT_EQ(HashShaderKey(MakeShaderKey(a)), HashShaderKey(MakeShaderKey(b)));
+}
+
+TEST(CShaderProgramMap, FindsEveryProgramAfterGrowing)
+{
+	CShaderProgramMap map;
+	const u32 kNumPrograms = 2000;
+
+	for (u32 i = 0; i < kNumPrograms; ++i)
+	{
+		ShaderKey key = MakeTestBinary(i).Key;
+		EXPECT_TRUE(map.Find(key) == NULL);
+		map.Insert(key, reinterpret_cast<ShaderProgram *>(uintptr_t(i + 1)));
+	}
+
+	EXPECT_EQ(kNumPrograms, map.GetNumPrograms());
+
+	for (u32 i = 0; i < kNumPrograms; ++i)
+	{
+		ShaderKey key = MakeTestBinary(i).Key;
+		EXPECT_EQ(uintptr_t(i + 1), uintptr_t(map.Find(key)));
+	}
+
+	ShaderKey missing = MakeTestBinary(kNumPrograms).Key;
+	EXPECT_TRUE(map.Find(missing) == NULL);
+}
+
+class ShaderCacheFileTest : public ::testing::Test
+{
+protected:
+	virtual void SetUp()
+	{
+		for (u32 i = 0; i < 20; ++i)
+			mBinaries.push_back(MakeTestBinary(i));
+
+		mFile = tmpfile();
+		ASSERT_TRUE(mFile != NULL);
+		ShaderCache_Write(mFile, kContextHash, mBinaries);
+		mSize = ftell(mFile);
+		rewind(mFile);
+	}
+
+	virtual void TearDown()
+	{
+		if (mFile)
+			fclose(mFile);
+	}
+
+	// Overwrites the byte at offset, and rewinds for reading
+	void CorruptByte(long offset)
+	{
+		fseek(mFile, offset, SEEK_SET);
+		int c = fgetc(mFile);
+		fseek(mFile, offset, SEEK_SET);
+		fputc(c ^ 0x5a, mFile);
+		rewind(mFile);
+	}
+
+	static const u32 kContextHash = 0xdeadbeef;
+
+	std::vector<SShaderBinary>	mBinaries;
+	FILE *						mFile;
+	long						mSize;
+};
+
+TEST_F(ShaderCacheFileTest, RoundTrips)
+{
+	std::vector<SShaderBinary> read;
+	ASSERT_TRUE(ShaderCache_Read(mFile, kContextHash, read));
+	ASSERT_EQ(mBinaries.size(), read.size());
+	for (u32 i = 0; i < read.size(); ++i)
+		EXPECT_TRUE(read[i] == mBinaries[i]) << "binary " << i;
+}
+
+TEST_F(ShaderCacheFileTest, RejectsDifferentContext)
+{
+	std::vector<SShaderBinary> read;
+	EXPECT_FALSE(ShaderCache_Read(mFile, kContextHash + 1, read));
+	EXPECT_TRUE(read.empty());
+}
+
+TEST_F(ShaderCacheFileTest, RejectsTruncatedFile)
+{
+	for (long size = 0; size < mSize; size += 37)
+	{
+		FILE * fh = tmpfile();
+		ASSERT_TRUE(fh != NULL);
+
+		std::vector<u8> contents(size + 1);
+		rewind(mFile);
+		fread(&contents[0], 1, size, mFile);
+		fwrite(&contents[0], 1, size, fh);
+		rewind(fh);
+
+		std::vector<SShaderBinary> read;
+		EXPECT_FALSE(ShaderCache_Read(fh, kContextHash, read)) << "size " << size;
+		EXPECT_TRUE(read.empty());
+		fclose(fh);
+	}
+}
+
+TEST_F(ShaderCacheFileTest, RejectsCorruptData)
+{
+	// The last byte of the file is in the data of the last binary
+	CorruptByte(mSize - 1);
+
+	std::vector<SShaderBinary> read;
+	EXPECT_FALSE(ShaderCache_Read(mFile, kContextHash, read));
+	EXPECT_TRUE(read.empty());
+}
@@ -0,0 +1,303 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "Core/Fastmem.h"
+
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "Core/Memory.h"
+#include "Debug/DBGConsole.h"
+
+//
+//	Layout of the shared memory object. Each region is mapped twice: once as
+//	the buffer the rest of the emulator uses (g_pMemoryBuffers), and at its
+//	KSEG0 address in the reserved range. KSEG1 isn't mapped, as only KSEG0
+//	accesses take the fast path.
+//	Only the KSEG0 view has its protection changed (for the 4MB/8MB switch)
+//	so code using g_pMemoryBuffers directly never faults.
+//
+static const u32	RDRAM_OFFSET( 0 );
+static const u32	SPMEM_OFFSET( MEMORY_8_MEG );
+static const u32	SPMEM_MAPPED_SIZE( 0x2000 );
+static const u32	SHARED_SIZE( SPMEM_OFFSET + SPMEM_MAPPED_SIZE );
+
+// The whole 32 bit space, plus a page so 64 bit accesses at the very top still fault cleanly
+static const u64	RESERVE_SIZE( (u64(1) << 32) + 0x1000 );
+
+u8 *	gFastmemBase  = NULL;
+u32		gFastmemRange = 0;
+
+namespace
+{
+
+struct SSite
+{
+	const u8 *		Instruction;
+	const u8 *		Resume;
+	EFastmemAccess	Access;
+
+	bool operator<( const SSite & rhs ) const	{ return Instruction < rhs.Instruction; }
+};
+
+int						gSharedFd( -1 );
+u8 *					gSharedView( NULL );
+std::vector< SSite >	gSites;
+struct sigaction		gPreviousAction;
+
+}
+
+// Provided by the linker for the section the accessors in Fastmem.h emit into
+extern "C" const SFastmemSite __start_daedalus_fastmem[] __attribute__((weak));
+extern "C" const SFastmemSite __stop_daedalus_fastmem[] __attribute__((weak));
+
+//*****************************************************************************
+//
+//*****************************************************************************
+static void Fastmem_CollectSites()
+{
+	gSites.clear();
+
+	for( const SFastmemSite * p_site = __start_daedalus_fastmem; p_site < __stop_daedalus_fastmem; ++p_site )
+	{
+		SSite	site;
+		site.Instruction = reinterpret_cast< const u8 * >( &p_site->InstructionOffset ) + p_site->InstructionOffset;
+		site.Resume      = reinterpret_cast< const u8 * >( &p_site->ResumeOffset ) + p_site->ResumeOffset;
+		site.Access      = EFastmemAccess( p_site->Access );
+		gSites.push_back( site );
+	}
+
+	std::sort( gSites.begin(), gSites.end() );
+}
+
+static const SSite * Fastmem_FindSite( const u8 * instruction )
+{
+	SSite	key;
+	key.Instruction = instruction;
+
+	std::vector< SSite >::const_iterator it( std::lower_bound( gSites.begin(), gSites.end(), key ) );
+	if( it != gSites.end() && it->Instruction == instruction )
+		return &*it;
+
+	return NULL;
+}
+
+//*****************************************************************************
+//	Faults which aren't from a fastmem access go to whoever had SIGSEGV before.
+//	Our handler stays installed, so fastmem keeps working if they return.
+//*****************************************************************************
+static void Fastmem_ChainSignal( int sig, siginfo_t * info, void * raw_context )
+{
+	if( gPreviousAction.sa_flags & SA_SIGINFO )
+	{
+		gPreviousAction.sa_sigaction( sig, info, raw_context );
+	}
+	else if( gPreviousAction.sa_handler != SIG_DFL && gPreviousAction.sa_handler != SIG_IGN )
+	{
+		gPreviousAction.sa_handler( sig );
+	}
+	else
+	{
+		// A real crash - return with the default action in place so the access faults again and the process dies
+		signal( sig, SIG_DFL );
+	}
+}
+
+//*****************************************************************************
+//	Perform the access through the lookup tables, exactly as the non-fastmem
+//	Read/WriteXXBits functions in Memory.h do
+//*****************************************************************************
+static void Fastmem_SignalHandler( int sig, siginfo_t * info, void * raw_context )
+{
+	ucontext_t *	context( static_cast< ucontext_t * >( raw_context ) );
+	greg_t *		regs( context->uc_mcontext.gregs );
+
+	const u8 *		fault( static_cast< const u8 * >( info->si_addr ) );
+	const SSite *	site( NULL );
+
+	if( gFastmemBase != NULL && fault >= gFastmemBase && fault < gFastmemBase + RESERVE_SIZE )
+	{
+		site = Fastmem_FindSite( reinterpret_cast< const u8 * >( regs[ REG_RIP ] ) );
+	}
+
+	if( site == NULL )
+	{
+		Fastmem_ChainSignal( sig, info, raw_context );
+		return;
+	}
+
+	u32		address( u32( fault - gFastmemBase ) );
+	u64		value( regs[ REG_RAX ] );
+
+	switch( site->Access )
+	{
+	case FASTMEM_LOAD8:		regs[ REG_RAX ] = *(u8 *)ReadAddress( address );		break;
+	case FASTMEM_LOAD16:	regs[ REG_RAX ] = *(u16 *)ReadAddress( address );		break;
+	case FASTMEM_LOAD32:	regs[ REG_RAX ] = *(u32 *)ReadAddress( address );		break;
+	case FASTMEM_LOAD64:	regs[ REG_RAX ] = *(u64 *)ReadAddress( address );		break;
+	case FASTMEM_STORE8:	*(u8 *)ReadAddress( address ) = u8( value );			break;
+	case FASTMEM_STORE16:	*(u16 *)ReadAddress( address ) = u16( value );			break;
+	case FASTMEM_STORE32:	WriteAddress( address, u32( value ) );					break;
+	case FASTMEM_STORE64:	*(u64 *)ReadAddress( address ) = value;					break;
+	default:
+		NODEFAULT;
+	}
+
+	regs[ REG_RIP ] = reinterpret_cast< greg_t >( site->Resume );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+static bool Fastmem_MapView( u32 address, u32 offset, u32 size )
+{
+	void * p_view( mmap( gFastmemBase + address, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, gSharedFd, offset ) );
+	return p_view != MAP_FAILED;
+}
+
+bool Fastmem_Init()
+{
+	DAEDALUS_ASSERT( gFastmemBase == NULL, "Fastmem already initialised" );
+
+	gSharedFd = memfd_create( "daedalus-rdram", 0 );
+	if( gSharedFd < 0 || ftruncate( gSharedFd, SHARED_SIZE ) != 0 )
+	{
+		DBGConsole_Msg( 0, "Fastmem: couldn't create shared memory - using lookup tables" );
+		Fastmem_Fini();
+		return false;
+	}
+
+	void * p_shared( mmap( NULL, SHARED_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, gSharedFd, 0 ) );
+	void * p_reserved( mmap( NULL, RESERVE_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 ) );
+	gSharedView  = p_shared != MAP_FAILED ? static_cast< u8 * >( p_shared ) : NULL;
+	gFastmemBase = p_reserved != MAP_FAILED ? static_cast< u8 * >( p_reserved ) : NULL;
+
+	if( gSharedView == NULL || gFastmemBase == NULL ||
+		!Fastmem_MapView( 0x80000000 + MEMORY_START_RDRAM, RDRAM_OFFSET, MEMORY_8_MEG ) ||
+		!Fastmem_MapView( 0x80000000 + MEMORY_START_SPMEM, SPMEM_OFFSET, SPMEM_MAPPED_SIZE ) )
+	{
+		DBGConsole_Msg( 0, "Fastmem: couldn't reserve address space - using lookup tables" );
+		Fastmem_Fini();
+		return false;
+	}
+
+	Fastmem_CollectSites();
+
+	struct sigaction	action;
+	memset( &action, 0, sizeof( action ) );
+	action.sa_sigaction = Fastmem_SignalHandler;
+	action.sa_flags = SA_SIGINFO;
+	sigemptyset( &action.sa_mask );
+	if( sigaction( SIGSEGV, &action, &gPreviousAction ) != 0 )
+	{
+		DBGConsole_Msg( 0, "Fastmem: couldn't install fault handler - using lookup tables" );
+		Fastmem_Fini();
+		return false;
+	}
+
+	gFastmemRange = 0x20000000;
+
+	DBGConsole_Msg( 0, "Fastmem: mapped RDRAM at %p (%d access sites)", gFastmemBase + 0x80000000, u32( gSites.size() ) );
+	return true;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void Fastmem_Fini()
+{
+	if( gFastmemRange != 0 )
+	{
+		sigaction( SIGSEGV, &gPreviousAction, NULL );
+	}
+	gFastmemRange = 0;
+
+	if( gFastmemBase != NULL )
+	{
+		munmap( gFastmemBase, RESERVE_SIZE );
+		gFastmemBase = NULL;
+	}
+
+	if( gSharedView != NULL )
+	{
+		munmap( gSharedView, SHARED_SIZE );
+		gSharedView = NULL;
+	}
+
+	if( gSharedFd >= 0 )
+	{
+		close( gSharedFd );
+		gSharedFd = -1;
+	}
+
+	gSites.clear();
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void * Fastmem_GetBuffer( u32 bank )
+{
+	if( gSharedView == NULL )
+		return NULL;
+
+	switch( bank )
+	{
+	case MEM_RD_RAM:	return gSharedView + RDRAM_OFFSET;
+	case MEM_SP_MEM:	return gSharedView + SPMEM_OFFSET;
+	default:			return NULL;
+	}
+}
+
+//*****************************************************************************
+//	Without the expansion pak the top 4MB has to go through the tables
+//	(where it's mapped to MEM_UNUSED)
+//*****************************************************************************
+void Fastmem_SetRamSize( u32 ram_size )
+{
+	if( gFastmemBase == NULL )
+		return;
+
+	int		prot( ram_size == MEMORY_8_MEG ? PROT_READ | PROT_WRITE : PROT_NONE );
+
+	mprotect( gFastmemBase + 0x80000000 + MEMORY_START_EXRDRAM, MEMORY_SIZE_EXRDRAM, prot );
+}
+
+//*****************************************************************************
+//	Watched RDRAM is made inaccessible in the KSEG0 view, so the access
+//	faults and goes through the tables (see Memory_WatchRange)
+//*****************************************************************************
+void Fastmem_SetWatched( u32 address, u32 length, bool watched )
+{
+	if( gFastmemBase == NULL )
+		return;
+
+	uintptr_t	page_mask( uintptr_t( sysconf( _SC_PAGESIZE ) ) - 1 );
+	uintptr_t	start( uintptr_t( gFastmemBase + 0x80000000 + address ) & ~page_mask );
+	uintptr_t	end( (uintptr_t( gFastmemBase + 0x80000000 + address + length ) + page_mask) & ~page_mask );
+
+	mprotect( reinterpret_cast< void * >( start ), end - start, watched ? PROT_NONE : PROT_READ | PROT_WRITE );
+}
@@ -0,0 +1,734 @@
+/*
+Copyright (C) 2001,2005 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "AssemblyWriterX64.h"
+
+//*****************************************************************************
+//	Returns true if the value fits in a sign extended 32 bit field
+//*****************************************************************************
+static inline bool IsS32( s64 value )
+{
+	return value == s64( s32( value ) );
+}
+
+//*****************************************************************************
+//	Emit a REX prefix, but only if one is needed
+//*****************************************************************************
+void	CAssemblyWriterX64::EmitREX( bool wide, u32 reg, u32 index, u32 base )
+{
+	u8 rex( 0x40 );
+
+	if( wide )			rex |= 0x08;
+	if( reg & 8 )		rex |= 0x04;
+	if( index & 8 )		rex |= 0x02;
+	if( base & 8 )		rex |= 0x01;
+
+	if( rex != 0x40 )
+	{
+		EmitBYTE( rex );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::EmitModRM_Reg( u32 reg, u32 rm )
+{
+	EmitBYTE( 0xc0 | ((reg&7)<<3) | (rm&7) );
+}
+
+//*****************************************************************************
+//	Work out how to address mem. If it's not within reach of the base
+//	pointer, the address is loaded into r11 (so this must be called before
+//	any of the instruction bytes are emitted)
+//*****************************************************************************
+SMemOperandX64	CAssemblyWriterX64::PrepareMemOperand( const void * mem )
+{
+	SMemOperandX64	op;
+
+	s64		offset( reinterpret_cast< const u8 * >( mem ) - reinterpret_cast< const u8 * >( mpBasePointer ) );
+
+	if( mpBasePointer != NULL && IsS32( offset ) )
+	{
+		op.Base = CPU_STATE_BASE_REG;
+		op.Offset = s32( offset );
+	}
+	else
+	{
+		MOVI64( ADDRESS_TEMP_REG, reinterpret_cast< uintptr_t >( mem ) );
+		op.Base = ADDRESS_TEMP_REG;
+		op.Offset = 0;
+	}
+
+	return op;
+}
+
+//*****************************************************************************
+//	[base + disp]
+//*****************************************************************************
+void	CAssemblyWriterX64::EmitModRM_Mem( u32 reg, const SMemOperandX64 & op )
+{
+	const u32	base( op.Base & 7 );
+	u8			mod;
+
+	// rbp/r13 have no disp-less form
+	if( op.Offset == 0 && base != (RBP_CODE & 7) )
+	{
+		mod = 0x00;
+	}
+	else if( op.Offset <= 127 && op.Offset >= -128 )
+	{
+		mod = 0x40;
+	}
+	else
+	{
+		mod = 0x80;
+	}
+
+	EmitBYTE( mod | ((reg&7)<<3) | base );
+
+	// rsp/r12 need a SIB byte
+	if( base == (RSP_CODE & 7) )
+	{
+		EmitBYTE( 0x24 );
+	}
+
+	if( mod == 0x40 )
+	{
+		EmitBYTE( u8( op.Offset ) );
+	}
+	else if( mod == 0x80 )
+	{
+		EmitDWORD( u32( op.Offset ) );
+	}
+}
+
+//*****************************************************************************
+//	[base + index]
+//*****************************************************************************
+void	CAssemblyWriterX64::EmitModRM_BaseIndex( u32 reg, EIntelReg ibase, EIntelReg iindex )
+{
+	DAEDALUS_ASSERT( (iindex & 7) != RSP_CODE || iindex == R12_CODE, "rsp can't be used as an index" );
+
+	if( (ibase & 7) == (RBP_CODE & 7) )
+	{
+		EmitBYTE( 0x44 | ((reg&7)<<3) );
+		EmitBYTE( ((iindex&7)<<3) | (ibase&7) );
+		EmitBYTE( 0x00 );
+	}
+	else
+	{
+		EmitBYTE( 0x04 | ((reg&7)<<3) );
+		EmitBYTE( ((iindex&7)<<3) | (ibase&7) );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::PUSH(EIntelReg reg)
+{
+	EmitREX( false, 0, 0, reg );
+	EmitBYTE(0x50 | (reg&7));
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::POP(EIntelReg reg)
+{
+	EmitREX( false, 0, 0, reg );
+	EmitBYTE(0x58 | (reg&7));
+}
+
+//*****************************************************************************
+//	op	reg1, reg2	(reg1 is the ModRM reg field)
+//*****************************************************************************
+void	CAssemblyWriterX64::ALU_REG_REG( u8 opcode, EIntelReg reg1, EIntelReg reg2, bool wide )
+{
+	EmitREX( wide, reg1, 0, reg2 );
+	EmitBYTE( opcode );
+	EmitModRM_Reg( reg1, reg2 );
+}
+
+//*****************************************************************************
+//	op	reg, data	(ext is the /n opcode extension)
+//	Use short form (0x83) if data is just one byte!
+//*****************************************************************************
+void	CAssemblyWriterX64::ALU_REG_IMM( u8 ext, EIntelReg reg, u32 data )
+{
+	EmitREX( false, 0, 0, reg );
+	if (s32(data) <= 127 && s32(data) >= -128)
+	{
+		EmitBYTE(0x83);
+		EmitModRM_Reg( ext, reg );
+		EmitBYTE((u8)data);
+	}
+	else
+	{
+		EmitBYTE(0x81);
+		EmitModRM_Reg( ext, reg );
+		EmitDWORD(data);
+	}
+}
+
+//*****************************************************************************
+//	add	reg1, reg2
+//*****************************************************************************
+void	CAssemblyWriterX64::ADD(EIntelReg reg1, EIntelReg reg2)
+{
+	ALU_REG_REG( 0x03, reg1, reg2, false );
+}
+
+//*****************************************************************************
+//	sub	reg1, reg2
+//*****************************************************************************
+void	CAssemblyWriterX64::SUB(EIntelReg reg1, EIntelReg reg2)
+{
+	ALU_REG_REG( 0x2b, reg1, reg2, false );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::AND(EIntelReg reg1, EIntelReg reg2)
+{
+	if (reg1 != reg2)
+	{
+		ALU_REG_REG( 0x23, reg1, reg2, false );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::OR(EIntelReg reg1, EIntelReg reg2)
+{
+	if (reg1 != reg2)
+	{
+		ALU_REG_REG( 0x0b, reg1, reg2, false );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::XOR(EIntelReg reg1, EIntelReg reg2)
+{
+	ALU_REG_REG( 0x33, reg1, reg2, false );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::NOT(EIntelReg reg1)
+{
+	EmitREX( false, 0, 0, reg1 );
+	EmitBYTE(0xf7);
+	EmitModRM_Reg( 2, reg1 );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::ADDI(EIntelReg reg, s32 data)
+{
+	if (data == 0)
+		return;
+
+	ALU_REG_IMM( 0, reg, u32( data ) );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::ANDI(EIntelReg reg, u32 data)
+{
+	ALU_REG_IMM( 4, reg, data );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::ORI(EIntelReg reg, u32 data)
+{
+	ALU_REG_IMM( 1, reg, data );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::XOR_I32(EIntelReg reg, u32 data)
+{
+	EmitREX( false, 0, 0, reg );
+	EmitBYTE(0x81);
+	EmitModRM_Reg( 6, reg );
+	EmitDWORD(data);
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::XOR_I8(EIntelReg reg, u8 data)
+{
+	EmitREX( false, 0, 0, reg );
+	EmitBYTE(0x83);
+	EmitModRM_Reg( 6, reg );
+	EmitBYTE(data);
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::SHLI(EIntelReg reg, u8 sa)
+{
+	EmitREX( false, 0, 0, reg );
+	EmitBYTE(0xc1);
+	EmitModRM_Reg( 4, reg );
+	EmitBYTE(sa);
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::SHRI(EIntelReg reg, u8 sa)
+{
+	EmitREX( false, 0, 0, reg );
+	EmitBYTE(0xc1);
+	EmitModRM_Reg( 5, reg );
+	EmitBYTE(sa);
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::SARI(EIntelReg reg, u8 sa)
+{
+	EmitREX( false, 0, 0, reg );
+	EmitBYTE(0xc1);
+	EmitModRM_Reg( 7, reg );
+	EmitBYTE(sa);
+}
+
+//*****************************************************************************
+//	cmp	reg1, reg2
+//*****************************************************************************
+void	CAssemblyWriterX64::CMP(EIntelReg reg1, EIntelReg reg2)
+{
+	ALU_REG_REG( 0x3b, reg1, reg2, false );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::TEST(EIntelReg reg1, EIntelReg reg2)
+{
+	ALU_REG_REG( 0x85, reg2, reg1, false );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::TEST64(EIntelReg reg1, EIntelReg reg2)
+{
+	ALU_REG_REG( 0x85, reg2, reg1, true );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::CMPI(EIntelReg reg, u32 data)
+{
+	ALU_REG_IMM( 7, reg, data );
+}
+
+//*****************************************************************************
+//	cmp		dword ptr p_mem, data
+//*****************************************************************************
+void	CAssemblyWriterX64::CMP_MEM32_I32(const void *p_mem, u32 data)
+{
+	SMemOperandX64	op( PrepareMemOperand( p_mem ) );
+
+	EmitREX( false, 0, 0, op.Base );
+	EmitBYTE(0x81);
+	EmitModRM_Mem( 7, op );
+	EmitDWORD(data);
+}
+
+//*****************************************************************************
+//	cmp		dword ptr p_mem, data
+//*****************************************************************************
+void	CAssemblyWriterX64::CMP_MEM32_I8(const void *p_mem, u8 data)
+{
+	SMemOperandX64	op( PrepareMemOperand( p_mem ) );
+
+	EmitREX( false, 0, 0, op.Base );
+	EmitBYTE(0x83);
+	EmitModRM_Mem( 7, op );
+	EmitBYTE(data);
+}
+
+//*****************************************************************************
+//	Jumps between fragments stay rel32, so AssemblyUtils::PatchJumpLong
+//	works unchanged. The code buffer is a single 256MB reservation.
+//*****************************************************************************
+CJumpLocation CAssemblyWriterX64::JumpConditionalLong( CCodeLabel target, u8 jump_type )
+{
+	const u32	JUMP_LONG_LENGTH = 6;
+
+	CJumpLocation	jump_location( mpAssemblyBuffer->GetJumpLocation() );
+	s32				offset( jump_location.GetOffset( target ) - JUMP_LONG_LENGTH );
+
+	EmitBYTE( 0x0f );
+	EmitBYTE( jump_type );		//
+	EmitDWORD( offset );
+
+	return jump_location;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation CAssemblyWriterX64::JELong( CCodeLabel target )
+{
+	return JumpConditionalLong( target, 0x84 );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation CAssemblyWriterX64::JNELong( CCodeLabel target )
+{
+	return JumpConditionalLong( target, 0x85 );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation	CAssemblyWriterX64::JMPLong( CCodeLabel target )
+{
+	const u32	JUMP_DIRECT_LONG_LENGTH = 5;
+
+	CJumpLocation	jump_location( mpAssemblyBuffer->GetJumpLocation() );
+	s32				offset( jump_location.GetOffset( target ) - JUMP_DIRECT_LONG_LENGTH );
+
+	EmitBYTE(0xe9);
+	EmitDWORD( static_cast< u32 >( offset ) );
+
+	return jump_location;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::JMP_REG( EIntelReg reg )
+{
+	EmitREX( false, 0, 0, reg );
+	EmitBYTE(0xff);
+	EmitModRM_Reg( 4, reg );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::CALL_REG( EIntelReg reg )
+{
+	EmitREX( false, 0, 0, reg );
+	EmitBYTE(0xff);
+	EmitModRM_Reg( 2, reg );
+}
+
+//*****************************************************************************
+//	Calls out to C are usually more than 2GB away from the code buffer,
+//	so fall back to an absolute call through rax when needed.
+//	rax is caller saved and never used to pass arguments.
+//*****************************************************************************
+void	CAssemblyWriterX64::CALL( CCodeLabel target )
+{
+	const u32	CALL_LONG_LENGTH = 5;
+
+	const u8 *	p_current( mpAssemblyBuffer->GetLabel().GetTargetU8P() );
+	s64			offset( target.GetTargetU8P() - (p_current + CALL_LONG_LENGTH) );
+
+	if( IsS32( offset ) )
+	{
+		EmitBYTE( 0xe8 );
+		EmitDWORD( u32( offset ) );
+	}
+	else
+	{
+		MOVI64( RAX_CODE, reinterpret_cast< uintptr_t >( target.GetTarget() ) );
+		CALL_REG( RAX_CODE );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::RET()
+{
+	EmitBYTE(0xC3);
+}
+
+//*****************************************************************************
+// mov reg1, reg2
+//*****************************************************************************
+void	CAssemblyWriterX64::MOV(EIntelReg reg1, EIntelReg reg2)
+{
+	if (reg1 != reg2)
+	{
+		ALU_REG_REG( 0x8b, reg1, reg2, false );
+	}
+}
+
+//*****************************************************************************
+// mov reg1, reg2
+//*****************************************************************************
+void	CAssemblyWriterX64::MOV64(EIntelReg reg1, EIntelReg reg2)
+{
+	if (reg1 != reg2)
+	{
+		ALU_REG_REG( 0x8b, reg1, reg2, true );
+	}
+}
+
+//*****************************************************************************
+// movsxd reg1, reg2
+//*****************************************************************************
+void	CAssemblyWriterX64::MOVSXD(EIntelReg reg1, EIntelReg reg2)
+{
+	ALU_REG_REG( 0x63, reg1, reg2, true );
+}
+
+//*****************************************************************************
+// mov dword ptr[ mem ], reg
+//*****************************************************************************
+void	CAssemblyWriterX64::MOV_MEM_REG(void * mem, EIntelReg isrc)
+{
+	SMemOperandX64	op( PrepareMemOperand( mem ) );
+
+	EmitREX( false, isrc, 0, op.Base );
+	EmitBYTE(0x89);
+	EmitModRM_Mem( isrc, op );
+}
+
+//*****************************************************************************
+// mov reg, dword ptr[ mem ]
+//*****************************************************************************
+void	CAssemblyWriterX64::MOV_REG_MEM(EIntelReg reg, const void * mem)
+{
+	SMemOperandX64	op( PrepareMemOperand( mem ) );
+
+	EmitREX( false, reg, 0, op.Base );
+	EmitBYTE(0x8b);
+	EmitModRM_Mem( reg, op );
+}
+
+//*****************************************************************************
+// mov qword ptr[ mem ], reg
+//*****************************************************************************
+void	CAssemblyWriterX64::MOV64_MEM_REG(void * mem, EIntelReg isrc)
+{
+	SMemOperandX64	op( PrepareMemOperand( mem ) );
+
+	EmitREX( true, isrc, 0, op.Base );
+	EmitBYTE(0x89);
+	EmitModRM_Mem( isrc, op );
+}
+
+//*****************************************************************************
+// mov reg, qword ptr[ mem ]
+//*****************************************************************************
+void	CAssemblyWriterX64::MOV64_REG_MEM(EIntelReg reg, const void * mem)
+{
+	SMemOperandX64	op( PrepareMemOperand( mem ) );
+
+	EmitREX( true, reg, 0, op.Base );
+	EmitBYTE(0x8b);
+	EmitModRM_Mem( reg, op );
+}
+
+//*****************************************************************************
+// mov dst, dword ptr [base + index]
+//*****************************************************************************
+void	CAssemblyWriterX64::MOV_REG_MEM_BASE_INDEX( EIntelReg idst, EIntelReg ibase, EIntelReg iindex )
+{
+	EmitREX( false, idst, iindex, ibase );
+	EmitBYTE(0x8b);
+	EmitModRM_BaseIndex( idst, ibase, iindex );
+}
+
+//*****************************************************************************
+// mov dword ptr [base + index], src
+//*****************************************************************************
+void	CAssemblyWriterX64::MOV_MEM_BASE_INDEX_REG( EIntelReg ibase, EIntelReg iindex, EIntelReg isrc )
+{
+	EmitREX( false, isrc, iindex, ibase );
+	EmitBYTE(0x89);
+	EmitModRM_BaseIndex( isrc, ibase, iindex );
+}
+
+//*****************************************************************************
+// mov dst, qword ptr [base + index]
+//*****************************************************************************
+void	CAssemblyWriterX64::MOV64_REG_MEM_BASE_INDEX( EIntelReg idst, EIntelReg ibase, EIntelReg iindex )
+{
+	EmitREX( true, idst, iindex, ibase );
+	EmitBYTE(0x8b);
+	EmitModRM_BaseIndex( idst, ibase, iindex );
+}
+
+//*****************************************************************************
+// mov qword ptr [base + index], src
+//*****************************************************************************
+void	CAssemblyWriterX64::MOV64_MEM_BASE_INDEX_REG( EIntelReg ibase, EIntelReg iindex, EIntelReg isrc )
+{
+	EmitREX( true, isrc, iindex, ibase );
+	EmitBYTE(0x89);
+	EmitModRM_BaseIndex( isrc, ibase, iindex );
+}
+
+//*****************************************************************************
+// mov dst, dword ptr [base + offset]
+//*****************************************************************************
+void	CAssemblyWriterX64::MOV_REG_MEM_BASE( EIntelReg idst, EIntelReg ibase, s32 offset )
+{
+	SMemOperandX64	op;
+	op.Base = ibase;
+	op.Offset = offset;
+
+	EmitREX( false, idst, 0, op.Base );
+	EmitBYTE(0x8b);
+	EmitModRM_Mem( idst, op );
+}
+
+//*****************************************************************************
+// mov dst, qword ptr [base + offset]
+//*****************************************************************************
+void	CAssemblyWriterX64::MOV64_REG_MEM_BASE( EIntelReg idst, EIntelReg ibase, s32 offset )
+{
+	SMemOperandX64	op;
+	op.Base = ibase;
+	op.Offset = offset;
+
+	EmitREX( true, idst, 0, op.Base );
+	EmitBYTE(0x8b);
+	EmitModRM_Mem( idst, op );
+}
+
+//*****************************************************************************
+// movsx dst, byte/word ptr [base + index]
+//*****************************************************************************
+void	CAssemblyWriterX64::MOVSX_REG_MEM_BASE_INDEX( EIntelReg idst, EIntelReg ibase, EIntelReg iindex, bool _8bit )
+{
+	EmitREX( false, idst, iindex, ibase );
+	EmitBYTE(0x0f);
+	EmitBYTE(_8bit ? 0xbe : 0xbf);
+	EmitModRM_BaseIndex( idst, ibase, iindex );
+}
+
+//*****************************************************************************
+// movzx dst, byte/word ptr [base + index]
+//*****************************************************************************
+void	CAssemblyWriterX64::MOVZX_REG_MEM_BASE_INDEX( EIntelReg idst, EIntelReg ibase, EIntelReg iindex, bool _8bit )
+{
+	EmitREX( false, idst, iindex, ibase );
+	EmitBYTE(0x0f);
+	EmitBYTE(_8bit ? 0xb6 : 0xb7);
+	EmitModRM_BaseIndex( idst, ibase, iindex );
+}
+
+//*****************************************************************************
+//	Writing a 32 bit register zeroes the top half, so this is fine for
+//	pointers too as long as they're in the low 4GB
+//*****************************************************************************
+void	CAssemblyWriterX64::MOVI(EIntelReg reg, u32 data)
+{
+	EmitREX( false, 0, 0, reg );
+	EmitBYTE(0xB8 | (reg&7));
+	EmitDWORD(data);
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::MOVI64(EIntelReg reg, u64 data)
+{
+	if( data <= 0xffffffff )
+	{
+		MOVI( reg, u32( data ) );
+	}
+	else
+	{
+		EmitREX( true, 0, 0, reg );
+		EmitBYTE(0xB8 | (reg&7));
+		EmitQWORD(data);
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CAssemblyWriterX64::MOVI_MEM(void * mem, u32 data)
+{
+	SMemOperandX64	op( PrepareMemOperand( mem ) );
+
+	EmitREX( false, 0, 0, op.Base );
+	EmitBYTE(0xc7);
+	EmitModRM_Mem( 0, op );
+	EmitDWORD(data);
+}
+
+//*****************************************************************************
+//	mov		byte ptr mem, data
+//*****************************************************************************
+void	CAssemblyWriterX64::MOVI_MEM8(void * mem, u8 data)
+{
+	SMemOperandX64	op( PrepareMemOperand( mem ) );
+
+	EmitREX( false, 0, 0, op.Base );
+	EmitBYTE(0xc6);
+	EmitModRM_Mem( 0, op );
+	EmitBYTE(data);
+}
+
+//*****************************************************************************
+//	mov		byte ptr [base + index], data
+//*****************************************************************************
+void	CAssemblyWriterX64::MOVI8_MEM_BASE_INDEX( EIntelReg ibase, EIntelReg iindex, u8 data )
+{
+	EmitREX( false, 0, iindex, ibase );
+	EmitBYTE(0xc6);
+	EmitModRM_BaseIndex( 0, ibase, iindex );
+	EmitBYTE(data);
+}
+
+//*****************************************************************************
+//	mov		qword ptr mem, data (sign extended)
+//*****************************************************************************
+void	CAssemblyWriterX64::MOVI64_MEM(void * mem, s32 data)
+{
+	SMemOperandX64	op( PrepareMemOperand( mem ) );
+
+	EmitREX( true, 0, 0, op.Base );
+	EmitBYTE(0xc7);
+	EmitModRM_Mem( 0, op );
+	EmitDWORD(u32( data ));
+}
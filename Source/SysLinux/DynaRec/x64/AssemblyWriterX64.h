@@ -0,0 +1,166 @@
+/*
+Copyright (C) 2001,2005 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef SYSLINUX_DYNAREC_X64_ASSEMBLYWRITERX64_H_
+#define SYSLINUX_DYNAREC_X64_ASSEMBLYWRITERX64_H_
+
+#include "DynaRec/AssemblyBuffer.h"
+#include "DynarecTargetX64.h"
+
+//
+//	Memory operands can't be encoded as absolute 32 bit addresses on x86-64.
+//	Anything within +/-2GB of the base pointer (i.e. gCPUState) is addressed
+//	as [r15 + disp], everything else is loaded into r11 first.
+//
+struct SMemOperandX64
+{
+	EIntelReg	Base;
+	s32			Offset;
+};
+
+class CAssemblyWriterX64
+{
+	public:
+		CAssemblyWriterX64( CAssemblyBuffer * p_buffer )
+			:	mpAssemblyBuffer( p_buffer )
+			,	mpBasePointer( NULL )
+		{
+		}
+
+	public:
+		CAssemblyBuffer *	GetAssemblyBuffer() const									{ return mpAssemblyBuffer; }
+		void				SetAssemblyBuffer( CAssemblyBuffer * p_buffer )				{ mpAssemblyBuffer = p_buffer; }
+
+		const void *		GetBasePointer() const										{ return mpBasePointer; }
+		void				SetBasePointer( const void * p_base )						{ mpBasePointer = p_base; }
+
+	// XXXX
+	private:
+	public:
+				inline void NOP()
+				{
+					EmitBYTE(0x90);
+				}
+
+				inline void INT3()
+				{
+					EmitBYTE(0xcc);
+				}
+
+				void				PUSH(EIntelReg reg);
+				void				POP(EIntelReg reg);
+
+				void				ADD(EIntelReg reg1, EIntelReg reg2);				// add	reg1, reg2
+				void				SUB(EIntelReg reg1, EIntelReg reg2);
+				void				AND(EIntelReg reg1, EIntelReg reg2);
+				void				OR(EIntelReg reg1, EIntelReg reg2);
+				void				XOR(EIntelReg reg1, EIntelReg reg2);
+				void				NOT(EIntelReg reg1);
+
+				void				ADDI(EIntelReg reg, s32 data);
+				void				ANDI(EIntelReg reg, u32 data);
+				void				ORI(EIntelReg reg, u32 data);
+				void				XOR_I32(EIntelReg reg, u32 data);
+				void				XOR_I8(EIntelReg reg, u8 data);
+
+				void				SHLI(EIntelReg reg, u8 sa);
+				void				SHRI(EIntelReg reg, u8 sa);
+				void				SARI(EIntelReg reg, u8 sa);
+
+				void				CMP(EIntelReg reg1, EIntelReg reg2);
+				void				TEST(EIntelReg reg1, EIntelReg reg2);
+				void				TEST64(EIntelReg reg1, EIntelReg reg2);				// test	reg1, reg2 (64 bit)
+				void				CMPI(EIntelReg reg, u32 data);
+				void				CMP_MEM32_I32(const void *p_mem, u32 data);			// cmp		dword ptr p_mem, data
+				void				CMP_MEM32_I8(const void *p_mem, u8 data);			// cmp		dword ptr p_mem, data
+
+				CJumpLocation		JMPLong( CCodeLabel target );
+				CJumpLocation		JNELong( CCodeLabel target );
+				CJumpLocation		JELong( CCodeLabel target );
+
+				void				JMP_REG( EIntelReg reg );
+				void				CALL_REG( EIntelReg reg );
+				void				CALL( CCodeLabel target );
+				void				RET();
+
+				void				MOV(EIntelReg reg1, EIntelReg reg2);				// mov  reg1, reg2
+				void				MOV64(EIntelReg reg1, EIntelReg reg2);				// mov  reg1, reg2 (64 bit)
+				void				MOVSXD(EIntelReg reg1, EIntelReg reg2);				// movsxd reg1, reg2 (sign extend 32 -> 64)
+				void				MOV_MEM_REG(void * mem, EIntelReg isrc);			// mov dword ptr[ mem ], reg
+				void				MOV_REG_MEM(EIntelReg reg, const void * mem);		// mov reg, dword ptr[ mem ]
+				void				MOV64_MEM_REG(void * mem, EIntelReg isrc);			// mov qword ptr[ mem ], reg
+				void				MOV64_REG_MEM(EIntelReg reg, const void * mem);		// mov reg, qword ptr[ mem ]
+
+				void				MOV_REG_MEM_BASE_INDEX( EIntelReg idst, EIntelReg ibase, EIntelReg iindex );		// mov dst, dword ptr [base + index]
+				void				MOV_MEM_BASE_INDEX_REG( EIntelReg ibase, EIntelReg iindex, EIntelReg isrc );		// mov dword ptr [base + index], src
+				void				MOV64_REG_MEM_BASE_INDEX( EIntelReg idst, EIntelReg ibase, EIntelReg iindex );		// mov dst, qword ptr [base + index]
+				void				MOV64_MEM_BASE_INDEX_REG( EIntelReg ibase, EIntelReg iindex, EIntelReg isrc );		// mov qword ptr [base + index], src
+				void				MOV_REG_MEM_BASE( EIntelReg idst, EIntelReg ibase, s32 offset );					// mov dst, dword ptr [base + offset]
+				void				MOV64_REG_MEM_BASE( EIntelReg idst, EIntelReg ibase, s32 offset );				// mov dst, qword ptr [base + offset]
+				void				MOVSX_REG_MEM_BASE_INDEX( EIntelReg idst, EIntelReg ibase, EIntelReg iindex, bool _8bit );	// movsx dst, byte/word ptr [base + index]
+				void				MOVZX_REG_MEM_BASE_INDEX( EIntelReg idst, EIntelReg ibase, EIntelReg iindex, bool _8bit );	// movzx dst, byte/word ptr [base + index]
+
+				void				MOVI(EIntelReg reg, u32 data);						// mov reg, data
+				void				MOVI64(EIntelReg reg, u64 data);					// mov reg, data (64 bit immediate)
+				void				MOVI_MEM(void * mem, u32 data);						// mov dword ptr[ mem ], data
+				void				MOVI_MEM8(void * mem, u8 data);						// mov byte ptr[ mem ], data
+				void				MOVI8_MEM_BASE_INDEX( EIntelReg ibase, EIntelReg iindex, u8 data );				// mov byte ptr [base + index], data
+				void				MOVI64_MEM(void * mem, s32 data);					// mov qword ptr[ mem ], sign extended data
+
+	private:
+				CJumpLocation		JumpConditionalLong( CCodeLabel target, u8 jump_type );
+
+				SMemOperandX64		PrepareMemOperand( const void * mem );
+				void				EmitREX( bool wide, u32 reg, u32 index, u32 base );
+				void				EmitModRM_Reg( u32 reg, u32 rm );
+				void				EmitModRM_Mem( u32 reg, const SMemOperandX64 & op );
+				void				EmitModRM_BaseIndex( u32 reg, EIntelReg ibase, EIntelReg iindex );
+
+				void				ALU_REG_REG( u8 opcode, EIntelReg reg1, EIntelReg reg2, bool wide );
+				void				ALU_REG_IMM( u8 ext, EIntelReg reg, u32 data );
+
+		inline void EmitBYTE(u8 byte)
+		{
+			mpAssemblyBuffer->EmitBYTE( byte );
+		}
+
+		inline void EmitWORD(u16 word)
+		{
+			mpAssemblyBuffer->EmitWORD( word );
+		}
+
+		inline void EmitDWORD(u32 dword)
+		{
+			mpAssemblyBuffer->EmitDWORD( dword );
+		}
+
+		inline void EmitQWORD(u64 qword)
+		{
+			mpAssemblyBuffer->EmitDWORD( u32( qword ) );
+			mpAssemblyBuffer->EmitDWORD( u32( qword >> 32 ) );
+		}
+
+	private:
+		CAssemblyBuffer *		mpAssemblyBuffer;
+		const void *			mpBasePointer;
+};
+
+#endif // SYSLINUX_DYNAREC_X64_ASSEMBLYWRITERX64_H_
@@ -0,0 +1,213 @@
+/*
+Copyright (C) 2001,2005 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "DynaRec/CodeBufferManager.h"
+
+#include <sys/mman.h>
+
+#include "Debug/DBGConsole.h"
+
+#include "CodeGeneratorX64.h"
+
+//
+//	Same layout as the Win32 version (see CodeBufferManagerX86.cpp).
+//	The whole range is reserved up front with PROT_NONE so that every
+//	fragment lives within +/-2GB of every other fragment (jumps between
+//	fragments are rel32). Pages are made RWX in 1MB chunks as needed.
+//
+static const u32	CODE_BUFFER_RESERVE_SIZE( 256 * 1024 * 1024 );
+static const u32	SECOND_BUFFER_OFFSET( 192 * 1024 * 1024 );
+static const u32	CODE_BUFFER_COMMIT_SIZE( 1024 * 1024 );
+
+class CCodeBufferManagerX64 : public CCodeBufferManager
+{
+public:
+	CCodeBufferManagerX64()
+		:	mpBuffer( NULL )
+		,	mBufferPtr( 0 )
+		,	mBufferSize( 0 )
+		,	mpSecondBuffer( NULL )
+		,	mSecondBufferPtr( 0 )
+		,	mSecondBufferSize( 0 )
+	{
+	}
+
+	virtual bool			Initialise();
+	virtual void			Reset();
+	virtual void			Finalise();
+
+	virtual CCodeGenerator *StartNewBlock();
+	virtual u32				FinaliseCurrentBlock();
+
+private:
+	static bool				Commit( u8 * p_base, u32 * p_size );
+
+private:
+
+	u8	*					mpBuffer;
+	u32						mBufferPtr;
+	u32						mBufferSize;
+
+	u8 *					mpSecondBuffer;
+	u32						mSecondBufferPtr;
+	u32						mSecondBufferSize;
+
+private:
+	CAssemblyBuffer			mPrimaryBuffer;
+	CAssemblyBuffer			mSecondaryBuffer;
+};
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CCodeBufferManager *	CCodeBufferManager::Create()
+{
+	return new CCodeBufferManagerX64;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+bool	CCodeBufferManagerX64::Initialise()
+{
+	// Reserve a huge range of address space. We do this because we can't simply
+	// allocate a new buffer and copy the existing code across (this would
+	// mess up all the existing function pointers and jumps etc).
+	// MAP_NORESERVE|PROT_NONE means no storage is actually allocated here.
+	void * p_mem = mmap( NULL, CODE_BUFFER_RESERVE_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0 );
+	if (p_mem == MAP_FAILED)
+		return false;
+
+	mpBuffer = (u8*)p_mem;
+	mBufferPtr = 0;
+	mBufferSize = 0;
+
+	mpSecondBuffer = mpBuffer + SECOND_BUFFER_OFFSET;
+	mSecondBufferPtr = 0;
+	mSecondBufferSize = 0;
+
+	return true;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeBufferManagerX64::Reset()
+{
+	mBufferPtr = 0;
+	mSecondBufferPtr = 0;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeBufferManagerX64::Finalise()
+{
+	if (mpBuffer != NULL)
+	{
+		munmap(mpBuffer, CODE_BUFFER_RESERVE_SIZE);
+		mpBuffer = NULL;
+	}
+
+	mpSecondBuffer = NULL;
+	mBufferSize = 0;
+	mSecondBufferSize = 0;
+}
+
+//*****************************************************************************
+//	Make another 1MB of the reserved range usable
+//*****************************************************************************
+bool	CCodeBufferManagerX64::Commit( u8 * p_base, u32 * p_size )
+{
+	if (mprotect(p_base + *p_size, CODE_BUFFER_COMMIT_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC) != 0)
+	{
+		return false;
+	}
+
+	*p_size += CODE_BUFFER_COMMIT_SIZE;
+	return true;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CCodeGenerator * CCodeBufferManagerX64::StartNewBlock()
+{
+	// Round up to 16 byte boundry
+	u32 aligned_ptr( (mBufferPtr + 15) & (~15) );
+
+	// This is a bit of a hack. We assume that no single entry will generate more than
+	// 32k of storage. If there appear to be problems with this assumption, this
+	// value can be enlarged
+	if (aligned_ptr + 32768 > mBufferSize)
+	{
+		if (!Commit(mpBuffer, &mBufferSize))
+		{
+			DBGConsole_Msg(0, "SR Buffer allocation failed"); // maybe this should be an abort?
+		}
+		else
+		{
+			DBGConsole_Msg(0, "Allocated %dMB of storage for dynarec buffer", mBufferSize / (1024*1024));
+		}
+	}
+
+	u32	padding( aligned_ptr - mBufferPtr );
+	if( padding > 0 )
+	{
+		memset( mpBuffer + mBufferPtr, 0xcc, padding );		// 0xcc is 'int 3'
+	}
+
+	mBufferPtr = aligned_ptr;
+
+	if (mSecondBufferPtr + 32768 > mSecondBufferSize)
+	{
+		if (!Commit(mpSecondBuffer, &mSecondBufferSize))
+		{
+			DBGConsole_Msg(0, "SR Second Buffer allocation failed"); // maybe this should be an abort?
+		}
+		else
+		{
+			DBGConsole_Msg(0, "Allocated %dMB of storage for dynarec second buffer",
+				mSecondBufferSize / (1024*1024));
+		}
+	}
+
+	mPrimaryBuffer.SetBuffer( mpBuffer + mBufferPtr );
+	mSecondaryBuffer.SetBuffer( mpSecondBuffer + mSecondBufferPtr );
+
+	return new CCodeGeneratorX64( &mPrimaryBuffer, &mSecondaryBuffer );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+u32 CCodeBufferManagerX64::FinaliseCurrentBlock()
+{
+	u32		main_block_size( mPrimaryBuffer.GetSize() );
+
+	mBufferPtr += main_block_size;
+
+	mSecondBufferPtr += mSecondaryBuffer.GetSize();
+	mSecondBufferPtr = ((mSecondBufferPtr - 1) & 0xfffffff0) + 0x10; // align to 16-byte boundary
+
+	// x86 keeps the instruction cache coherent, so there's nothing to flush here
+
+	return main_block_size;
+}
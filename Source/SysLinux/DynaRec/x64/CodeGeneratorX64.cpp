@@ -0,0 +1,849 @@
+/*
+Copyright (C) 2001,2005 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+
+#include "stdafx.h"
+#include "CodeGeneratorX64.h"
+
+#include <stddef.h>
+
+#include "Config/ConfigOptions.h"
+#include "Core/CPU.h"
+#include "Core/DirtyPages.h"
+#include "Core/R4300.h"
+#include "Core/Registers.h"
+#include "Debug/DBGConsole.h"
+#include "Debug/DebugLog.h"
+#include "DynaRec/AssemblyUtils.h"
+#include "DynaRec/IndirectExitMap.h"
+#include "DynaRec/StaticAnalysis.h"
+#include "DynaRec/Trace.h"
+#include "OSHLE/ultra_R4300.h"
+
+//
+//	This is a port of the x86 backend to the SysV x86-64 ABI.
+//	_EnterDynaRec (DynaRecStubsX64.S) sets up:
+//		r15	- &gCPUState				(CPU_STATE_BASE_REG)
+//		r14	- g_pu8RamBase_8000			(RAM_BASE_REG)
+//		r13	- 0x80000000 + gRamSize		(MEM_LIMIT_REG)
+//	These are callee saved, so they survive calls out to the R4300 handlers.
+//	Arguments are passed in edi/esi, rather than ecx/edx for __fastcall.
+//
+
+using namespace AssemblyUtils;
+
+// XX this optimisation works very well on the PSP, option to disable it was removed
+static const bool		gDynarecStackOptimisation = true;
+
+//	Accesses through the stack pointer, or through a base the trace optimiser
+//	has shown to point into RDRAM, don't need to go through the memory tables.
+//	With the display list thread, the framebuffers are watched through the
+//	tables (see Memory_WatchRange), so only the stack can skip them.
+static bool CanAccessRamDirectly( EN64Reg base, bool ram_address )
+{
+#ifdef DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+	if (gDisplayListThreadEnabled)
+	{
+		return gDynarecStackOptimisation && base == N64Reg_SP;
+	}
+#endif
+	return ram_address || (gDynarecStackOptimisation && base == N64Reg_SP);
+}
+//*****************************************************************************
+//	XXXX
+//*****************************************************************************
+void Dynarec_ClearedCPUStuffToDo()
+{
+}
+void Dynarec_SetCPUStuffToDo()
+{
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CCodeGeneratorX64::CCodeGeneratorX64( CAssemblyBuffer * p_primary, CAssemblyBuffer * p_secondary )
+:	CCodeGenerator( )
+,	CAssemblyWriterX64( p_primary )
+,	mpPrimary( p_primary )
+,	mpSecondary( p_secondary )
+{
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::Finalise( ExceptionHandlerFn p_exception_handler_fn, const std::vector< CJumpLocation > & exception_handler_jumps )
+{
+	if( !exception_handler_jumps.empty() )
+	{
+		GenerateExceptionHander( p_exception_handler_fn, exception_handler_jumps );
+	}
+
+	SetAssemblyBuffer( NULL );
+	mpPrimary = NULL;
+	mpSecondary = NULL;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::Initialise( u32 entry_address, u32 exit_address, u32 * hit_counter, const void * p_base, const SRegisterUsageInfo & register_usage )
+{
+	// p_base is &gCPUState, which _EnterDynaRec keeps in r15
+	DAEDALUS_ASSERT( p_base == &gCPUState, "Unexpected base pointer" );
+	SetBasePointer( p_base );
+
+	if( hit_counter != NULL )
+	{
+		MOV_REG_MEM( EAX_CODE, hit_counter );
+		ADDI( EAX_CODE, 1 );
+		MOV_MEM_REG( hit_counter, EAX_CODE );
+	}
+
+	// span_list ignored for now
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::UpdateRegisterCaching( u32 instruction_idx )
+{
+	// This is ignored for now
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+RegisterSnapshotHandle	CCodeGeneratorX64::GetRegisterSnapshot()
+{
+	// This doesn't do anything useful yet.
+	return RegisterSnapshotHandle( 0 );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CCodeLabel	CCodeGeneratorX64::GetEntryPoint() const
+{
+	return mpPrimary->GetStartAddress();
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CCodeLabel	CCodeGeneratorX64::GetCurrentLocation() const
+{
+	return mpPrimary->GetLabel();
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+u32	CCodeGeneratorX64::GetCompiledCodeSize() const
+{
+	return mpPrimary->GetSize() + mpSecondary->GetSize();
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation CCodeGeneratorX64::GenerateExitCode( u32 exit_address, u32 jump_address, u32 num_instructions, CCodeLabel next_fragment )
+{
+	DAEDALUS_ASSERT( !next_fragment.IsSet() || jump_address == 0, "Shouldn't be specifying a jump address if we have a next fragment?" );
+
+#ifdef _DEBUG
+	if(exit_address == u32(~0))
+	{
+		INT3();
+	}
+#endif
+
+	MOVI(EDI_CODE, num_instructions);
+	CALL( CCodeLabel( reinterpret_cast< const void * >( CPU_UpdateCounter ) ) );
+
+	// This jump may be NULL, in which case we patch it below
+	// This gets patched with a jump to the next fragment if the target is later found
+	CJumpLocation jump_to_next_fragment( GenerateBranchIfNotSet( const_cast< u32 * >( &gCPUState.StuffToDo ), next_fragment ) );
+
+	// If the flag was set, we need in initialise the pc/delay to exit with
+	CCodeLabel interpret_next_fragment( GetAssemblyBuffer()->GetLabel() );
+
+	u8		exit_delay;
+
+	if( jump_address != 0 )
+	{
+		SetVar( &gCPUState.TargetPC, jump_address );
+		exit_delay = EXEC_DELAY;
+	}
+	else
+	{
+		exit_delay = NO_DELAY;
+	}
+
+	SetVar8( &gCPUState.Delay, exit_delay );
+	SetVar( &gCPUState.CurrentPC, exit_address );
+
+	// No need to call CPU_SetPC(), as this is handled by CFragment when we exit
+	RET();
+
+	// Patch up the exit jump
+	if( !next_fragment.IsSet() )
+	{
+		PatchJumpLong( jump_to_next_fragment, interpret_next_fragment );
+	}
+
+	return jump_to_next_fragment;
+}
+
+//*****************************************************************************
+// Handle branching back to the interpreter after an ERET
+//*****************************************************************************
+void CCodeGeneratorX64::GenerateEretExitCode( u32 num_instructions, CIndirectExitMap * p_map )
+{
+	MOVI(EDI_CODE, num_instructions);
+	CALL( CCodeLabel( reinterpret_cast< const void * >( CPU_UpdateCounter ) ) );
+
+	// We always exit to the interpreter, regardless of the state of gCPUState.StuffToDo
+
+	// Eret is a bit bodged so we exit at PC + 4
+	MOV_REG_MEM( EAX_CODE, &gCPUState.CurrentPC );
+	ADDI( EAX_CODE, 4 );
+	MOV_MEM_REG( &gCPUState.CurrentPC, EAX_CODE );
+	SetVar8( &gCPUState.Delay, NO_DELAY );
+
+	// No need to call CPU_SetPC(), as this is handled by CFragment when we exit
+
+	RET();
+}
+
+//*****************************************************************************
+// Handle branching back to the interpreter after an indirect jump
+//*****************************************************************************
+void CCodeGeneratorX64::GenerateIndirectExitCode( u32 num_instructions, CIndirectExitMap * p_map, bool is_return )
+{
+	MOVI(EDI_CODE, num_instructions);
+	CALL( CCodeLabel( reinterpret_cast< const void * >( CPU_UpdateCounter ) ) );
+
+	CCodeLabel		no_target( NULL );
+	CJumpLocation	jump_to_next_fragment( GenerateBranchIfNotSet( const_cast< u32 * >( &gCPUState.StuffToDo ), no_target ) );
+
+	CCodeLabel		exit_dynarec( GetAssemblyBuffer()->GetLabel() );
+	// New return address is in gCPUState.TargetPC
+	MOV_REG_MEM( EAX_CODE, &gCPUState.TargetPC );
+	MOV_MEM_REG( &gCPUState.CurrentPC, EAX_CODE );
+	SetVar8( &gCPUState.Delay, NO_DELAY );
+
+	// No need to call CPU_SetPC(), as this is handled by CFragment when we exit
+
+	RET();
+
+	// gCPUState.StuffToDo == 0, try to jump to the indirect target
+	PatchJumpLong( jump_to_next_fragment, GetAssemblyBuffer()->GetLabel() );
+
+	SIndirectExitCache *	p_exit_cache( p_map->AddExitCache() );
+
+	// esi holds the target and rdx the cache popped from the return address stack (or NULL),
+	// ready to be passed to IndirectExitMap_LookupAndCache
+	MOV_REG_MEM( ESI_CODE, &gCPUState.TargetPC );
+
+	if( is_return )
+	{
+		// The JR has already popped the stack (see GenerateOpCode), but the entry is still there
+		MOV_REG_MEM( EAX_CODE, &gReturnAddressStack.Top );
+		ADDI( EAX_CODE, 1 );
+		ANDI( EAX_CODE, SReturnAddressStack::NUM_ENTRIES - 1 );
+
+		SHLI( EAX_CODE, 3 );		// Entries are pointers
+		MOVI64( RCX_CODE, reinterpret_cast< uintptr_t >( gReturnAddressStack.Entries ) );
+		MOV64_REG_MEM_BASE_INDEX( RDX_CODE, RCX_CODE, RAX_CODE );
+
+		TEST64( RDX_CODE, RDX_CODE );
+		CJumpLocation	no_entry( JELong( no_target ) );
+
+		MOV_REG_MEM_BASE( EAX_CODE, RDX_CODE, offsetof( SIndirectExitCache, TargetPC ) );
+		CMP( EAX_CODE, ESI_CODE );
+		CJumpLocation	wrong_address( JNELong( no_target ) );
+
+		MOV64_REG_MEM_BASE( RAX_CODE, RDX_CODE, offsetof( SIndirectExitCache, Target ) );
+		TEST64( RAX_CODE, RAX_CODE );
+		CJumpLocation	no_fragment( JELong( no_target ) );
+
+		IncrementCounter( &gIndirectExitStats.ReturnHits );
+		JMP_REG( RAX_CODE );
+
+		CCodeLabel		check_exit_cache( GetAssemblyBuffer()->GetLabel() );
+		PatchJumpLong( no_entry, check_exit_cache );
+		PatchJumpLong( wrong_address, check_exit_cache );
+		PatchJumpLong( no_fragment, check_exit_cache );
+	}
+	else
+	{
+		XOR( EDX_CODE, EDX_CODE );
+	}
+
+	MOV_REG_MEM( EAX_CODE, &p_exit_cache->TargetPC );
+	CMP( EAX_CODE, ESI_CODE );
+	CJumpLocation	exit_cache_miss( JNELong( no_target ) );
+
+	MOV64_REG_MEM( RAX_CODE, &p_exit_cache->Target );
+	IncrementCounter( &gIndirectExitStats.InlineHits );
+	JMP_REG( RAX_CODE );
+
+	PatchJumpLong( exit_cache_miss, GetAssemblyBuffer()->GetLabel() );
+
+	MOVI64( RDI_CODE, reinterpret_cast< uintptr_t >( p_map ) );
+	MOVI64( RCX_CODE, reinterpret_cast< uintptr_t >( p_exit_cache ) );
+	CALL( CCodeLabel( reinterpret_cast< const void * >( IndirectExitMap_LookupAndCache ) ) );
+
+	// If the target was not found, exit
+	TEST64( RAX_CODE, RAX_CODE );
+	JELong( exit_dynarec );
+
+	JMP_REG( RAX_CODE );
+}
+
+//*****************************************************************************
+//	Push the cache for a JAL's return address on gReturnAddressStack
+//*****************************************************************************
+void CCodeGeneratorX64::PushReturnAddress( SIndirectExitCache * p_cache )
+{
+	MOV_REG_MEM( EAX_CODE, &gReturnAddressStack.Top );
+	ADDI( EAX_CODE, 1 );
+	ANDI( EAX_CODE, SReturnAddressStack::NUM_ENTRIES - 1 );
+	MOV_MEM_REG( &gReturnAddressStack.Top, EAX_CODE );
+
+	SHLI( EAX_CODE, 3 );		// Entries are pointers
+	MOVI64( RCX_CODE, reinterpret_cast< uintptr_t >( gReturnAddressStack.Entries ) );
+	MOVI64( RDX_CODE, reinterpret_cast< uintptr_t >( p_cache ) );
+	MOV64_MEM_BASE_INDEX_REG( RCX_CODE, RAX_CODE, RDX_CODE );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void CCodeGeneratorX64::PopReturnAddress()
+{
+	MOV_REG_MEM( EAX_CODE, &gReturnAddressStack.Top );
+	ADDI( EAX_CODE, -1 );
+	ANDI( EAX_CODE, SReturnAddressStack::NUM_ENTRIES - 1 );
+	MOV_MEM_REG( &gReturnAddressStack.Top, EAX_CODE );
+}
+
+//*****************************************************************************
+//	Uses ecx
+//*****************************************************************************
+void CCodeGeneratorX64::IncrementCounter( u32 * p_counter )
+{
+	MOV_REG_MEM( ECX_CODE, p_counter );
+	ADDI( ECX_CODE, 1 );
+	MOV_MEM_REG( p_counter, ECX_CODE );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void CCodeGeneratorX64::GenerateExceptionHander( ExceptionHandlerFn p_exception_handler_fn, const std::vector< CJumpLocation > & exception_handler_jumps )
+{
+	CCodeLabel exception_handler( GetAssemblyBuffer()->GetLabel() );
+
+	CALL( CCodeLabel( reinterpret_cast< const void * >( p_exception_handler_fn ) ) );
+	RET();
+
+	for( std::vector< CJumpLocation >::const_iterator it = exception_handler_jumps.begin(); it != exception_handler_jumps.end(); ++it )
+	{
+		CJumpLocation	jump( *it );
+		PatchJumpLong( jump, exception_handler );
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::SetVar( u32 * p_var, u32 value )
+{
+	MOVI_MEM( p_var, value );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::SetVar8( u32 * p_var, u8 value )
+{
+	MOVI_MEM8( p_var, value );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::GenerateBranchHandler( CJumpLocation branch_handler_jump, RegisterSnapshotHandle snapshot )
+{
+	PatchJumpLong( branch_handler_jump, GetAssemblyBuffer()->GetLabel() );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation	CCodeGeneratorX64::GenerateBranchAlways( CCodeLabel target )
+{
+	return JMPLong( target );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation	CCodeGeneratorX64::GenerateBranchIfSet( const u32 * p_var, CCodeLabel target )
+{
+	MOV_REG_MEM( EAX_CODE, p_var );
+	TEST( EAX_CODE, EAX_CODE );
+
+	return JNELong( target );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation	CCodeGeneratorX64::GenerateBranchIfNotSet( const u32 * p_var, CCodeLabel target )
+{
+	MOV_REG_MEM( EAX_CODE, p_var );
+	TEST( EAX_CODE, EAX_CODE );
+
+	return JELong( target );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation	CCodeGeneratorX64::GenerateBranchIfEqual32( const u32 * p_var, u32 value, CCodeLabel target )
+{
+	CMP_MEM32_I32( p_var, value );
+
+	return JELong( target );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation	CCodeGeneratorX64::GenerateBranchIfEqual8( const u32 * p_var, u8 value, CCodeLabel target )
+{
+	CMP_MEM32_I8( p_var, value );
+
+	return JELong( target );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation	CCodeGeneratorX64::GenerateBranchIfNotEqual32( const u32 * p_var, u32 value, CCodeLabel target )
+{
+	CMP_MEM32_I32( p_var, value );
+
+	return JNELong( target );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation	CCodeGeneratorX64::GenerateBranchIfNotEqual8( const u32 * p_var, u8 value, CCodeLabel target )
+{
+	CMP_MEM32_I8( p_var, value );
+
+	return JNELong( target );
+}
+
+//*****************************************************************************
+//	Generates instruction handler for the specified op code.
+//	Returns a jump location if an exception handler is required
+//*****************************************************************************
+CJumpLocation	CCodeGeneratorX64::GenerateOpCode( const STraceEntry& ti, bool branch_delay_slot, const SBranchDetails * p_branch, CJumpLocation * p_branch_jump)
+{
+	u32 address = ti.Address;
+	bool exception = false;
+	OpCode op_code = ti.OpCode;
+
+	if (op_code._u32 == 0)
+	{
+		if( branch_delay_slot )
+		{
+			SetVar8( &gCPUState.Delay, NO_DELAY );
+		}
+		return CJumpLocation();
+	}
+
+	if( branch_delay_slot )
+	{
+		SetVar8( &gCPUState.Delay, EXEC_DELAY );
+	}
+
+	const EN64Reg	rs = EN64Reg( op_code.rs );
+	const EN64Reg	rt = EN64Reg( op_code.rt );
+	const EN64Reg	base = EN64Reg( op_code.base );
+	const u32		ft = op_code.ft;
+	const bool		ram_address = (ti.Flags & TEF_RAM_ADDRESS) != 0;
+
+	bool handled = false;
+	if( ti.Flags & TEF_CONSTANT_RESULT )
+	{
+		handled = GenerateConstant( rt, ti.Constant );
+	}
+
+	if( !handled )
+	{
+		switch(op_code.op)
+		{
+			case OP_J:			handled = true; break;
+			case OP_JAL:		GenerateJAL( address ); handled = true; break;
+			case OP_CACHE:		GenerateCACHE( base, op_code.immediate, rt ); handled = true; break;
+
+			// For LW, SW, SWC1, LB etc, only generate an exception handler if access wasn't done directly to RAM (handle = false)
+			case OP_LW:
+				handled = GenerateLW(rt, base, s16(op_code.immediate), ram_address);
+				exception = !handled;
+				break;
+			case OP_SW:
+				handled = GenerateSW(rt, base, s16(op_code.immediate), ram_address);
+				exception = !handled;
+				break;
+			case OP_SWC1:
+				handled = GenerateSWC1(ft, base, s16(op_code.immediate), ram_address);
+				exception = !handled;
+				break;
+			case OP_LB:
+				handled = GenerateLB(rt, base, s16(op_code.immediate), ram_address);
+				exception = !handled;
+				break;
+			case OP_LBU:
+				handled = GenerateLBU(rt, base, s16(op_code.immediate), ram_address);
+				exception = !handled;
+				break;
+			case OP_LH:
+				handled = GenerateLH(rt, base, s16(op_code.immediate), ram_address);
+				exception = !handled;
+				break;
+			case OP_LWC1:
+				handled = GenerateLWC1(ft, base, s16(op_code.immediate), ram_address);
+				exception = !handled;
+				break;
+			case OP_ADDIU:
+			case OP_ADDI:
+				GenerateADDIU(rt, rs, s16(op_code.immediate)); handled = true;
+				break;
+		}
+	}
+
+	if (!handled)
+	{
+		if( R4300_InstructionHandlerNeedsPC( op_code ) )
+		{
+			SetVar( &gCPUState.CurrentPC, address );
+			exception = true;
+		}
+		GenerateGenericR4300( op_code, R4300_GetInstructionHandler( op_code ) );
+	}
+	CJumpLocation	exception_handler;
+	CCodeLabel		no_target( NULL );
+
+	if( exception )
+	{
+		exception_handler = GenerateBranchIfSet( const_cast< u32 * >( &gCPUState.StuffToDo ), no_target );
+	}
+
+	// Check whether we want to invert the status of this branch
+	if( p_branch != NULL )
+	{
+		//
+		// Check if the branch has been taken
+		//
+		if( p_branch->Direct )
+		{
+			if( p_branch->ConditionalBranchTaken )
+			{
+				*p_branch_jump = GenerateBranchIfNotEqual8( &gCPUState.Delay, DO_DELAY, no_target );
+			}
+			else
+			{
+				*p_branch_jump = GenerateBranchIfEqual8( &gCPUState.Delay, DO_DELAY, no_target );
+			}
+		}
+		else
+		{
+			// XXXX eventually just exit here, and skip default exit code below
+			if( p_branch->Eret )
+			{
+				*p_branch_jump = GenerateBranchAlways( no_target );
+			}
+			else
+			{
+				// Pop here rather than in the exit code, as the trace may carry on from the return
+				if( op_code.op == OP_SPECOP && op_code.spec_op == SpecOp_JR && op_code.rs == N64Reg_RA )
+				{
+					PopReturnAddress();
+				}
+
+				*p_branch_jump = GenerateBranchIfNotEqual32( &gCPUState.TargetPC, p_branch->TargetAddress, no_target );
+			}
+		}
+	}
+	else
+	{
+		if( branch_delay_slot )
+		{
+			SetVar8( &gCPUState.Delay, NO_DELAY );
+		}
+	}
+
+	return exception_handler;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::GenerateGenericR4300( OpCode op_code, CPU_Instruction p_instruction )
+{
+	// XXXX Flush all fp registers before a generic call
+
+	// Call function - SysV, first argument in edi
+	MOVI(EDI_CODE, op_code._u32);
+	CALL( CCodeLabel( reinterpret_cast< const void * >( p_instruction ) ) );
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CJumpLocation CCodeGeneratorX64::ExecuteNativeFunction( CCodeLabel speed_hack, bool check_return )
+{
+	CALL( speed_hack );
+	if( check_return )
+	{
+		TEST( EAX_CODE, EAX_CODE );
+
+		return JELong( CCodeLabel(NULL) );
+	}
+	else
+	{
+		return CJumpLocation(NULL);
+	}
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+void	CCodeGeneratorX64::GenerateCACHE( EN64Reg base, s16 offset, u32 cache_op )
+{
+	u32 dwCache = cache_op & 0x3;
+	u32 dwAction = (cache_op >> 2) & 0x7;
+
+	// For instruction cache invalidation, make sure we let the CPU know so the whole
+	// dynarec system can be invalidated
+	if(dwCache == 0 && (dwAction == 0 || dwAction == 4))
+	{
+		MOV_REG_MEM(EDI_CODE, &gCPUState.CPU[base]._u32_0);
+		MOVI(ESI_CODE, 0x20);
+		ADDI(EDI_CODE, offset);
+		CALL( CCodeLabel( reinterpret_cast< const void * >( CPU_InvalidateICacheRange ) ));
+	}
+	else
+	{
+		// We don't care about data cache etc
+	}
+}
+
+//*****************************************************************************
+//	ecx = base + offset (^ twiddle). The access is then [r14 + rcx], where
+//	r14 is g_pu8RamBase_8000. Writing ecx zero extends into rcx.
+//*****************************************************************************
+void	CCodeGeneratorX64::GenerateAddress( EN64Reg base, s16 offset, u8 twiddle )
+{
+	MOV_REG_MEM(ECX_CODE, &gCPUState.CPU[base]._u32_0);
+	ADDI(ECX_CODE, offset);
+	if (twiddle != 0)
+	{
+		XOR_I8(ECX_CODE, twiddle);
+	}
+}
+
+//*****************************************************************************
+//	Mark the page of RDRAM just stored to through [r14 + rcx] as written.
+//	See Core/DirtyPages.h. Trashes edx and r11.
+//*****************************************************************************
+void	CCodeGeneratorX64::GenerateMarkDirty()
+{
+#ifdef DAEDALUS_ENABLE_DIRTY_PAGES
+	MOV(EDX_CODE, ECX_CODE);
+	SHRI(EDX_CODE, kDirtyPageShift);
+	ANDI(EDX_CODE, kNumDirtyPages - 1);
+	MOVI64(ADDRESS_TEMP_REG, reinterpret_cast< uintptr_t >( gDirtyPages ));
+	MOVI8_MEM_BASE_INDEX(ADDRESS_TEMP_REG, RDX_CODE, 1);
+#endif
+}
+
+//*****************************************************************************
+//	Store eax (sign extended to 64 bits) to rt
+//*****************************************************************************
+void	CCodeGeneratorX64::StoreSignExtended( EN64Reg rt, EIntelReg reg )
+{
+	MOVSXD(reg, reg);
+	MOV64_MEM_REG(&gCPUState.CPU[rt]._u64, reg);
+}
+
+bool CCodeGeneratorX64::GenerateLW( EN64Reg rt, EN64Reg base, s16 offset, bool ram_address )
+{
+	if (CanAccessRamDirectly(base, ram_address))
+	{
+		GenerateAddress(base, offset, 0);
+		MOV_REG_MEM_BASE_INDEX(EAX_CODE, RAM_BASE_REG, RCX_CODE);
+		StoreSignExtended(rt, RAX_CODE);
+		return true;
+	}
+	return false;
+}
+
+bool CCodeGeneratorX64::GenerateSWC1( u32 ft, EN64Reg base, s16 offset, bool ram_address )
+{
+	if (CanAccessRamDirectly(base, ram_address))
+	{
+		GenerateAddress(base, offset, 0);
+		MOV_REG_MEM(EAX_CODE, &gCPUState.FPU[ft]._u32);
+		MOV_MEM_BASE_INDEX_REG(RAM_BASE_REG, RCX_CODE, EAX_CODE);
+		GenerateMarkDirty();
+		return true;
+	}
+
+	return false;
+}
+
+bool CCodeGeneratorX64::GenerateSW( EN64Reg rt, EN64Reg base, s16 offset, bool ram_address )
+{
+	if (CanAccessRamDirectly(base, ram_address))
+	{
+		GenerateAddress(base, offset, 0);
+		MOV_REG_MEM(EAX_CODE, &gCPUState.CPU[rt]._u32_0);
+		MOV_MEM_BASE_INDEX_REG(RAM_BASE_REG, RCX_CODE, EAX_CODE);
+		GenerateMarkDirty();
+		return true;
+	}
+
+	return false;
+}
+
+bool CCodeGeneratorX64::GenerateLB( EN64Reg rt, EN64Reg base, s16 offset, bool ram_address )
+{
+	if (CanAccessRamDirectly(base, ram_address))
+	{
+		GenerateAddress(base, offset, U8_TWIDDLE);
+		MOVSX_REG_MEM_BASE_INDEX(EAX_CODE, RAM_BASE_REG, RCX_CODE, true);
+		StoreSignExtended(rt, RAX_CODE);
+		return true;
+	}
+
+	return false;
+}
+
+bool CCodeGeneratorX64::GenerateLBU( EN64Reg rt, EN64Reg base, s16 offset, bool ram_address )
+{
+	if (CanAccessRamDirectly(base, ram_address))
+	{
+		GenerateAddress(base, offset, U8_TWIDDLE);
+		// movzx into eax clears the top half of rax too
+		MOVZX_REG_MEM_BASE_INDEX(EAX_CODE, RAM_BASE_REG, RCX_CODE, true);
+		MOV64_MEM_REG(&gCPUState.CPU[rt]._u64, RAX_CODE);
+		return true;
+	}
+
+	return false;
+}
+
+bool CCodeGeneratorX64::GenerateLH( EN64Reg rt, EN64Reg base, s16 offset, bool ram_address )
+{
+	if (CanAccessRamDirectly(base, ram_address))
+	{
+		GenerateAddress(base, offset, U16_TWIDDLE);
+		MOVSX_REG_MEM_BASE_INDEX(EAX_CODE, RAM_BASE_REG, RCX_CODE, false);
+		StoreSignExtended(rt, RAX_CODE);
+		return true;
+	}
+
+	return false;
+}
+
+bool CCodeGeneratorX64::GenerateLWC1( u32 ft, EN64Reg base, s16 offset, bool ram_address )
+{
+	if (CanAccessRamDirectly(base, ram_address))
+	{
+		GenerateAddress(base, offset, 0);
+		MOV_REG_MEM_BASE_INDEX(EAX_CODE, RAM_BASE_REG, RCX_CODE);
+		MOV_MEM_REG(&gCPUState.FPU[ft]._u32, EAX_CODE);
+		return true;
+	}
+
+	return false;
+}
+
+//*****************************************************************************
+//	The immediate is sign extended to 64 bits by the store
+//*****************************************************************************
+bool CCodeGeneratorX64::GenerateConstant( EN64Reg rt, s64 value )
+{
+	if (value != s64(s32(value)))
+	{
+		return false;
+	}
+
+	MOVI64_MEM(&gCPUState.CPU[rt]._u64, s32(value));
+	return true;
+}
+
+void CCodeGeneratorX64::GenerateADDIU( EN64Reg rt, EN64Reg rs, s16 immediate )
+{
+	MOV_REG_MEM(EAX_CODE, &gCPUState.CPU[rs]._u32_0);
+	ADDI(EAX_CODE, immediate);
+	StoreSignExtended(rt, RAX_CODE);
+}
+
+void CCodeGeneratorX64::GenerateSLL( EN64Reg rd, EN64Reg rt, u32 sa )
+{
+	MOV_REG_MEM(EAX_CODE, &gCPUState.CPU[rt]._u32_0);
+	SHLI(EAX_CODE, sa);
+	StoreSignExtended(rd, RAX_CODE);
+}
+
+void CCodeGeneratorX64::GenerateSRL( EN64Reg rd, EN64Reg rt, u32 sa )
+{
+	MOV_REG_MEM(EAX_CODE, &gCPUState.CPU[rt]._u32_0);
+	SHRI(EAX_CODE, sa);
+	StoreSignExtended(rd, RAX_CODE);
+}
+
+void CCodeGeneratorX64::GenerateSRA( EN64Reg rd, EN64Reg rt, u32 sa )
+{
+	MOV_REG_MEM(EAX_CODE, &gCPUState.CPU[rt]._u32_0);
+	SARI(EAX_CODE, sa);
+	StoreSignExtended(rd, RAX_CODE);
+}
+
+void	CCodeGeneratorX64::GenerateJAL( u32 address )
+{
+	// The immediate is sign extended to 64 bits by the store
+	MOVI64_MEM(&gCPUState.CPU[N64Reg_RA]._u64, s32(address + 8));
+
+	if( mpIndirectExitMap != NULL )
+	{
+		PushReturnAddress( mpIndirectExitMap->AddReturnCache( address + 8 ) );
+	}
+}
@@ -0,0 +1,105 @@
+/*
+Copyright (C) 2001,2005 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef SYSLINUX_DYNAREC_X64_CODEGENERATORX64_H_
+#define SYSLINUX_DYNAREC_X64_CODEGENERATORX64_H_
+
+#include "DynaRec/CodeGenerator.h"
+#include "AssemblyWriterX64.h"
+#include "DynarecTargetX64.h"
+#include "DynaRec/TraceRecorder.h"
+
+struct SIndirectExitCache;
+
+class CCodeGeneratorX64 : public CCodeGenerator, public CAssemblyWriterX64
+{
+	public:
+		CCodeGeneratorX64( CAssemblyBuffer * p_primary, CAssemblyBuffer * p_secondary );
+
+		virtual void				Initialise( u32 entry_address, u32 exit_address, u32 * hit_counter, const void * p_base, const SRegisterUsageInfo & register_usage );
+		virtual void				Finalise( ExceptionHandlerFn p_exception_handler_fn, const std::vector< CJumpLocation > & exception_handler_jumps );
+
+		virtual void				UpdateRegisterCaching( u32 instruction_idx );
+
+		virtual RegisterSnapshotHandle	GetRegisterSnapshot();
+
+		virtual CCodeLabel			GetEntryPoint() const;
+		virtual CCodeLabel			GetCurrentLocation() const;
+		virtual u32					GetCompiledCodeSize() const;
+
+		virtual	CJumpLocation		GenerateExitCode( u32 exit_address, u32 jump_address, u32 num_instructions, CCodeLabel next_fragment );
+		virtual void				GenerateEretExitCode( u32 num_instructions, CIndirectExitMap * p_map );
+		virtual void				GenerateIndirectExitCode( u32 num_instructions, CIndirectExitMap * p_map, bool is_return );
+
+		virtual void				GenerateBranchHandler( CJumpLocation branch_handler_jump, RegisterSnapshotHandle snapshot );
+
+		virtual CJumpLocation		GenerateOpCode( const STraceEntry& ti, bool branch_delay_slot, const SBranchDetails * p_branch, CJumpLocation * p_branch_jump);
+
+		virtual CJumpLocation		ExecuteNativeFunction( CCodeLabel speed_hack, bool check_return );
+
+	private:
+				void				SetVar( u32 * p_var, u32 value );
+				void				SetVar8( u32 * p_var, u8 value );
+
+				CJumpLocation		GenerateBranchAlways( CCodeLabel target );
+				CJumpLocation		GenerateBranchIfSet( const u32 * p_var, CCodeLabel target );
+				CJumpLocation		GenerateBranchIfNotSet( const u32 * p_var, CCodeLabel target );
+				CJumpLocation		GenerateBranchIfEqual32( const u32 * p_var, u32 value, CCodeLabel target );
+				CJumpLocation		GenerateBranchIfEqual8( const u32 * p_var, u8 value, CCodeLabel target );
+				CJumpLocation		GenerateBranchIfNotEqual32( const u32 * p_var, u32 value, CCodeLabel target );
+				CJumpLocation		GenerateBranchIfNotEqual8( const u32 * p_var, u8 value, CCodeLabel target );
+
+				void				GenerateGenericR4300( OpCode op_code, CPU_Instruction p_instruction );
+
+				void				PushReturnAddress( SIndirectExitCache * p_cache );
+				void				PopReturnAddress();
+				void				IncrementCounter( u32 * p_counter );
+
+				void				GenerateExceptionHander( ExceptionHandlerFn p_exception_handler_fn, const std::vector< CJumpLocation > & exception_handler_jumps );
+	private:
+				CAssemblyBuffer *	mpPrimary;
+				CAssemblyBuffer *	mpSecondary;
+
+	private:
+				void	GenerateAddress( EN64Reg base, s16 offset, u8 twiddle );
+				void	GenerateMarkDirty();
+				void	GenerateCACHE( EN64Reg base, s16 offset, u32 cache_op );
+				bool	GenerateLW(EN64Reg rt, EN64Reg base, s16 offset, bool ram_address );
+				bool	GenerateSW(EN64Reg rt, EN64Reg base, s16 offset, bool ram_address );
+				bool	GenerateSWC1( u32 ft, EN64Reg base, s16 offset, bool ram_address );
+				bool	GenerateLB(EN64Reg rt, EN64Reg base, s16 offset, bool ram_address );
+				bool	GenerateLBU(EN64Reg rt, EN64Reg base, s16 offset, bool ram_address );
+				bool	GenerateLH(EN64Reg rt, EN64Reg base, s16 offset, bool ram_address );
+				bool	GenerateLWC1(u32 ft, EN64Reg base, s16 offset, bool ram_address );
+
+				bool	GenerateConstant( EN64Reg rt, s64 value );
+				void	GenerateADDIU( EN64Reg rt, EN64Reg rs, s16 immediate );
+
+				void	GenerateJAL( u32 address );
+
+				void	GenerateSLL( EN64Reg rd, EN64Reg rt, u32 sa );
+				void	GenerateSRL( EN64Reg rd, EN64Reg rt, u32 sa );
+				void	GenerateSRA( EN64Reg rd, EN64Reg rt, u32 sa );
+
+				void	StoreSignExtended( EN64Reg rt, EIntelReg reg );
+};
+
+#endif // SYSLINUX_DYNAREC_X64_CODEGENERATORX64_H_
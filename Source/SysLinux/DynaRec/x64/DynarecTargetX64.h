@@ -0,0 +1,66 @@
+/*
+Copyright (C) 2001,2005 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef SYSLINUX_DYNAREC_X64_DYNARECTARGETX64_H_
+#define SYSLINUX_DYNAREC_X64_DYNARECTARGETX64_H_
+
+// Intel register codes. Odd ordering is for intel bytecode.
+// Registers 8..15 need a REX prefix (the low 3 bits go in ModRM/SIB)
+enum EIntelReg {
+	INVALID_CODE = 0xFFFFFFFF,
+	RAX_CODE = 0,
+	RCX_CODE = 1,
+	RDX_CODE = 2,
+	RBX_CODE = 3,
+	RSP_CODE = 4,
+	RBP_CODE = 5,
+	RSI_CODE = 6,
+	RDI_CODE = 7,
+	R8_CODE = 8,
+	R9_CODE = 9,
+	R10_CODE = 10,
+	R11_CODE = 11,
+	R12_CODE = 12,
+	R13_CODE = 13,
+	R14_CODE = 14,
+	R15_CODE = 15,
+
+	NUM_X64_REGISTERS = 16,
+};
+
+// 32 bit aliases, the operand size is selected by the instruction
+static const EIntelReg EAX_CODE = RAX_CODE;
+static const EIntelReg ECX_CODE = RCX_CODE;
+static const EIntelReg EDX_CODE = RDX_CODE;
+static const EIntelReg EBX_CODE = RBX_CODE;
+static const EIntelReg ESI_CODE = RSI_CODE;
+static const EIntelReg EDI_CODE = RDI_CODE;
+
+// Registers which _EnterDynaRec sets up for the lifetime of a fragment.
+// These are all callee saved in the SysV ABI, so survive calls out to C.
+static const EIntelReg CPU_STATE_BASE_REG = R15_CODE;	// &gCPUState
+static const EIntelReg RAM_BASE_REG = R14_CODE;			// g_pu8RamBase_8000
+static const EIntelReg MEM_LIMIT_REG = R13_CODE;		// 0x80000000 + gRamSize
+
+// Scratch register used to form addresses which can't be encoded directly
+static const EIntelReg ADDRESS_TEMP_REG = R11_CODE;
+
+#endif // SYSLINUX_DYNAREC_X64_DYNARECTARGETX64_H_
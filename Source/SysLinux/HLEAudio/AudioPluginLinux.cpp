@@ -1,10 +1,274 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
 #include "stdafx.h"
 #include "Plugins/AudioPlugin.h"
+
+#include "AudioSinkLinux.h"
+
 #include "Config/ConfigOptions.h"
+#include "Core/Memory.h"
+#include "Debug/DBGConsole.h"
+#include "HLEAudio/AudioBuffer.h"
+#include "HLEAudio/AudioTaskQueue.h"
+#include "HLEAudio/audiohle.h"
+#include "OSHLE/ultra_rcp.h"
+#include "Utility/FramerateLimiter.h"
+#include "Utility/Thread.h"
 
 EAudioPluginMode gAudioPluginEnabled = APM_DISABLED;
 
+static const u32 kOutputFrequency = 44100;
+static const u32 kAudioBufferSize = 1024 * 1024;	// Circular buffer length. Converts N64 samples out our output rate.
+static const u32 kSinkBufferSize = 512;			// Samples handed to the sink at a time (~12ms)
+
+// How much input we try to keep buffered in the synchronisation code.
+// Setting this too low and we run the risk of skipping.
+// Setting this too high and we run the risk of being very laggy.
+static const u32 kMaxBufferLengthMs = 30;
+
+//
+//	The CPU thread resamples each AI buffer into mAudioBuffer, and the audio
+//	thread drains it into the sink. mAudioBuffer is a single producer, single
+//	consumer ring, so neither side takes a lock.
+//
+class AudioPluginLinux : public CAudioPlugin
+{
+public:
+	AudioPluginLinux();
+	virtual ~AudioPluginLinux();
+
+	virtual bool			StartEmulation();
+	virtual void			StopEmulation();
+
+	virtual void			DacrateChanged(int system_type);
+	virtual void			LenChanged();
+	virtual u32				ReadLength()			{ return 0; }
+	virtual EProcessResult	ProcessAList();
+
+	void					AddBuffer(void * ptr, u32 length);
+
+	void					StopAudio();
+	void					StartAudio();
+
+	static void				AudioSyncFunction(void * arg);
+	static u32 DAEDALUS_THREAD_CALL_TYPE	AudioThread(void * arg);
+
+private:
+	CAudioBuffer			mAudioBuffer;
+	u32						mFrequency;
+	CAudioSink *			mSink;
+	ThreadHandle			mAudioThread;
+	volatile bool			mKeepRunning;	// Should the audio thread keep running?
+
+	volatile u32			mBufferLenMs;
+};
+
+AudioPluginLinux::AudioPluginLinux()
+:	mAudioBuffer( kAudioBufferSize )
+,	mFrequency( 44100 )
+,	mSink( NULL )
+,	mAudioThread( kInvalidThreadHandle )
+,	mKeepRunning( false )
+,	mBufferLenMs( 0 )
+{
+}
+
+AudioPluginLinux::~AudioPluginLinux()
+{
+	StopAudio();
+}
+
+bool AudioPluginLinux::StartEmulation()
+{
+	return true;
+}
+
+void AudioPluginLinux::StopEmulation()
+{
+#ifdef DAEDALUS_ENABLE_AUDIO_TASK_THREAD
+	AudioTask_Stop();
+#endif
+	Audio_Reset();
+	StopAudio();
+}
+
+void AudioPluginLinux::DacrateChanged(int system_type)
+{
+	u32 clock     = (system_type == ST_NTSC) ? VI_NTSC_CLOCK : VI_PAL_CLOCK;
+	u32 dacrate   = Memory_AI_GetRegister(AI_DACRATE_REG);
+	u32 frequency = clock / (dacrate + 1);
+
+	DBGConsole_Msg(0, "Audio frequency: %d", frequency);
+	mFrequency = frequency;
+}
+
+void AudioPluginLinux::LenChanged()
+{
+	if (gAudioPluginEnabled > APM_DISABLED)
+	{
+		u32 address = Memory_AI_GetRegister(AI_DRAM_ADDR_REG) & 0xFFFFFF;
+		u32 length  = Memory_AI_GetRegister(AI_LEN_REG);
+
+		AddBuffer( g_pu8RamBase + address, length );
+	}
+	else
+	{
+		StopAudio();
+	}
+}
+
+EProcessResult AudioPluginLinux::ProcessAList()
+{
+	Memory_SP_SetRegisterBits(SP_STATUS_REG, SP_STATUS_HALT);
+
+	EProcessResult result = PR_NOT_STARTED;
+
+	switch (gAudioPluginEnabled)
+	{
+		case APM_DISABLED:
+			result = PR_COMPLETED;
+			break;
+		case APM_ENABLED_ASYNC:
+#ifdef DAEDALUS_ENABLE_AUDIO_TASK_THREAD
+			if (AudioTask_Start())
+			{
+				AudioTask_Submit();
+				result = PR_STARTED;
+				break;
+			}
+#endif
+			Audio_Ucode();
+			result = PR_COMPLETED;
+			break;
+		case APM_ENABLED_SYNC:
+			Audio_Ucode();
+			result = PR_COMPLETED;
+			break;
+	}
+
+	return result;
+}
+
+void AudioPluginLinux::AddBuffer(void * ptr, u32 length)
+{
+	if (length == 0)
+		return;
+
+	if (mAudioThread == kInvalidThreadHandle)
+		StartAudio();
+
+	u32 num_samples = length / sizeof( Sample );
+
+	// Blocks (once for the whole buffer) if the audio thread has fallen behind
+	mAudioBuffer.AddSamples( reinterpret_cast<const Sample *>(ptr), num_samples, mFrequency, kOutputFrequency );
+
+	u32 remaining_samples = mAudioBuffer.GetNumBufferedSamples();
+	mBufferLenMs = (1000 * remaining_samples) / kOutputFrequency;
+}
+
+u32 AudioPluginLinux::AudioThread(void * arg)
+{
+	AudioPluginLinux * plugin = static_cast<AudioPluginLinux *>(arg);
+	CAudioSink * sink = plugin->mSink;
+
+	Sample buffer[kSinkBufferSize];
+
+	while (plugin->mKeepRunning)
+	{
+		// Drain pads with silence, which keeps a device from underrunning
+		u32 samples_written = plugin->mAudioBuffer.Drain(buffer, kSinkBufferSize);
+
+		u32 remaining_samples = plugin->mAudioBuffer.GetNumBufferedSamples();
+		plugin->mBufferLenMs = (1000 * remaining_samples) / kOutputFrequency;
+
+		if (sink->IsDevice())
+		{
+			sink->Write(buffer, kSinkBufferSize);
+		}
+		else if (samples_written > 0)
+		{
+			sink->Write(buffer, samples_written);
+		}
+		else
+		{
+			ThreadSleepMs(1);
+		}
+	}
+
+	return 0;
+}
+
+void AudioPluginLinux::AudioSyncFunction(void * arg)
+{
+	AudioPluginLinux * plugin = static_cast<AudioPluginLinux *>(arg);
+
+	u32 buffer_len = plugin->mBufferLenMs;	// NB: copy this volatile to a local var so that we have a consistent view for the remainder of this function.
+	if (buffer_len > kMaxBufferLengthMs)
+	{
+		ThreadSleepMs(buffer_len - kMaxBufferLengthMs);
+	}
+}
+
+void AudioPluginLinux::StartAudio()
+{
+	if (mAudioThread != kInvalidThreadHandle)
+		return;
+
+	if (mSink == NULL)
+		mSink = CreateAudioSink(kOutputFrequency);
+
+	// Install the sync function.
+	FramerateLimiter_SetAuxillarySyncFunction(&AudioSyncFunction, this);
+
+	mKeepRunning = true;
+
+	mAudioThread = CreateThread("Audio", &AudioThread, this);
+	if (mAudioThread == kInvalidThreadHandle)
+	{
+		DBGConsole_Msg(0, "Failed to start the audio thread!");
+		mKeepRunning = false;
+		FramerateLimiter_SetAuxillarySyncFunction(NULL, NULL);
+	}
+}
+
+void AudioPluginLinux::StopAudio()
+{
+	if (mAudioThread == kInvalidThreadHandle)
+		return;
+
+	// Tell the thread to stop running.
+	mKeepRunning = false;
+
+	JoinThread(mAudioThread, -1);
+	ReleaseThreadHandle(mAudioThread);
+	mAudioThread = kInvalidThreadHandle;
+
+	// Closing the sink finishes off the wav file, if that's where we were writing
+	delete mSink;
+	mSink = NULL;
+
+	// Remove the sync function.
+	FramerateLimiter_SetAuxillarySyncFunction(NULL, NULL);
+}
+
 CAudioPlugin * CreateAudioPlugin()
 {
-	return NULL;
+	return new AudioPluginLinux();
 }
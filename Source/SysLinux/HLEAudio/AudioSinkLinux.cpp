@@ -0,0 +1,365 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "stdafx.h"
+#include "AudioSinkLinux.h"
+
+#include <dlfcn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Debug/DBGConsole.h"
+
+namespace
+{
+
+const u32	kNumChannels = 2;
+const u32	kDeviceLatencyMs = 50;		// How much the sound server is asked to buffer
+
+template< typename T >
+bool LoadSymbol( void * library, const char * name, T * p_function )
+{
+	*p_function = reinterpret_cast< T >( dlsym( library, name ) );
+	return *p_function != NULL;
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+class CNullAudioSink : public CAudioSink
+{
+public:
+	virtual bool			IsDevice() const		{ return false; }
+	virtual void			Write( const Sample * samples, u32 num_samples ) {}
+};
+
+//*****************************************************************************
+//
+//*****************************************************************************
+class CWavAudioSink : public CAudioSink
+{
+public:
+	static CWavAudioSink *	Create( const char * filename, u32 frequency );
+	virtual ~CWavAudioSink();
+
+	virtual bool			IsDevice() const		{ return false; }
+	virtual void			Write( const Sample * samples, u32 num_samples );
+
+private:
+	explicit CWavAudioSink( FILE * fh ) : mFile( fh ), mDataBytes( 0 ) {}
+
+	void					WriteHeader( u32 frequency );
+	void					WriteU32( u32 value )	{ fwrite( &value, sizeof( value ), 1, mFile ); }
+	void					WriteU16( u16 value )	{ fwrite( &value, sizeof( value ), 1, mFile ); }
+
+	static const u32		kHeaderSize = 44;
+
+	FILE *					mFile;
+	u32						mDataBytes;
+};
+
+CWavAudioSink * CWavAudioSink::Create( const char * filename, u32 frequency )
+{
+	FILE * fh = fopen( filename, "wb" );
+	if( fh == NULL )
+	{
+		DBGConsole_Msg( 0, "Couldn't open %s for audio output", filename );
+		return NULL;
+	}
+
+	CWavAudioSink * sink = new CWavAudioSink( fh );
+	sink->WriteHeader( frequency );
+	return sink;
+}
+
+CWavAudioSink::~CWavAudioSink()
+{
+	// Fill in the sizes, now that we know them
+	fseek( mFile, 4, SEEK_SET );
+	WriteU32( kHeaderSize - 8 + mDataBytes );
+	fseek( mFile, kHeaderSize - 4, SEEK_SET );
+	WriteU32( mDataBytes );
+
+	fclose( mFile );
+}
+
+// Canonical 16 bit PCM header. The host is little endian, as is the file format.
+void CWavAudioSink::WriteHeader( u32 frequency )
+{
+	fwrite( "RIFF", 4, 1, mFile );
+	WriteU32( 0 );
+	fwrite( "WAVE", 4, 1, mFile );
+
+	fwrite( "fmt ", 4, 1, mFile );
+	WriteU32( 16 );
+	WriteU16( 1 );									// PCM
+	WriteU16( kNumChannels );
+	WriteU32( frequency );
+	WriteU32( frequency * sizeof( Sample ) );		// Bytes per second
+	WriteU16( sizeof( Sample ) );					// Bytes per frame
+	WriteU16( 16 );									// Bits per sample
+
+	fwrite( "data", 4, 1, mFile );
+	WriteU32( 0 );
+}
+
+void CWavAudioSink::Write( const Sample * samples, u32 num_samples )
+{
+	mDataBytes += fwrite( samples, sizeof( Sample ), num_samples, mFile ) * sizeof( Sample );
+}
+
+//*****************************************************************************
+//	Just enough of alsa/asoundlib.h for snd_pcm_set_params
+//*****************************************************************************
+class CAlsaAudioSink : public CAudioSink
+{
+public:
+	static CAlsaAudioSink *	Create( u32 frequency );
+	virtual ~CAlsaAudioSink();
+
+	virtual bool			IsDevice() const		{ return true; }
+	virtual void			Write( const Sample * samples, u32 num_samples );
+
+private:
+	CAlsaAudioSink() : mLibrary( NULL ), mPcm( NULL ) {}
+
+	enum
+	{
+		SND_PCM_STREAM_PLAYBACK = 0,
+		SND_PCM_FORMAT_S16_LE = 2,
+		SND_PCM_ACCESS_RW_INTERLEAVED = 3
+	};
+
+	typedef int		(*SndPcmOpen)( void ** pcm, const char * name, int stream, int mode );
+	typedef int		(*SndPcmSetParams)( void * pcm, int format, int access, unsigned channels, unsigned rate, int soft_resample, unsigned latency_us );
+	typedef long	(*SndPcmWritei)( void * pcm, const void * buffer, unsigned long frames );
+	typedef int		(*SndPcmRecover)( void * pcm, int err, int silent );
+	typedef int		(*SndPcmClose)( void * pcm );
+
+	void *					mLibrary;
+	void *					mPcm;
+	SndPcmWritei			mWritei;
+	SndPcmRecover			mRecover;
+	SndPcmClose				mClose;
+};
+
+CAlsaAudioSink * CAlsaAudioSink::Create( u32 frequency )
+{
+	CAlsaAudioSink * sink = new CAlsaAudioSink;
+
+	SndPcmOpen			snd_pcm_open;
+	SndPcmSetParams		snd_pcm_set_params;
+
+	sink->mLibrary = dlopen( "libasound.so.2", RTLD_NOW );
+
+	if( sink->mLibrary == NULL ||
+		!LoadSymbol( sink->mLibrary, "snd_pcm_open", &snd_pcm_open ) ||
+		!LoadSymbol( sink->mLibrary, "snd_pcm_set_params", &snd_pcm_set_params ) ||
+		!LoadSymbol( sink->mLibrary, "snd_pcm_writei", &sink->mWritei ) ||
+		!LoadSymbol( sink->mLibrary, "snd_pcm_recover", &sink->mRecover ) ||
+		!LoadSymbol( sink->mLibrary, "snd_pcm_close", &sink->mClose ) ||
+		snd_pcm_open( &sink->mPcm, "default", SND_PCM_STREAM_PLAYBACK, 0 ) < 0 )
+	{
+		delete sink;
+		return NULL;
+	}
+
+	if( snd_pcm_set_params( sink->mPcm, SND_PCM_FORMAT_S16_LE, SND_PCM_ACCESS_RW_INTERLEAVED,
+							kNumChannels, frequency, 1, kDeviceLatencyMs * 1000 ) < 0 )
+	{
+		delete sink;
+		return NULL;
+	}
+
+	return sink;
+}
+
+CAlsaAudioSink::~CAlsaAudioSink()
+{
+	if( mPcm != NULL )
+		mClose( mPcm );
+	if( mLibrary != NULL )
+		dlclose( mLibrary );
+}
+
+void CAlsaAudioSink::Write( const Sample * samples, u32 num_samples )
+{
+	while( num_samples > 0 )
+	{
+		long frames = mWritei( mPcm, samples, num_samples );
+		if( frames < 0 )
+		{
+			// Underruns and suspends can be recovered from - anything else drops the buffer
+			if( mRecover( mPcm, int( frames ), 1 ) < 0 )
+				return;
+			continue;
+		}
+
+		samples += frames;
+		num_samples -= u32( frames );
+	}
+}
+
+//*****************************************************************************
+//	Just enough of pulse/simple.h
+//*****************************************************************************
+class CPulseAudioSink : public CAudioSink
+{
+public:
+	static CPulseAudioSink *	Create( u32 frequency );
+	virtual ~CPulseAudioSink();
+
+	virtual bool			IsDevice() const		{ return true; }
+	virtual void			Write( const Sample * samples, u32 num_samples );
+
+private:
+	CPulseAudioSink() : mLibrary( NULL ), mStream( NULL ) {}
+
+	enum
+	{
+		PA_STREAM_PLAYBACK = 1,
+		PA_SAMPLE_S16LE = 3
+	};
+
+	struct PaSampleSpec
+	{
+		int		Format;
+		u32		Rate;
+		u8		Channels;
+	};
+
+	struct PaBufferAttr
+	{
+		u32		MaxLength;
+		u32		TLength;
+		u32		PreBuf;
+		u32		MinReq;
+		u32		FragSize;
+	};
+
+	typedef void *	(*PaSimpleNew)( const char * server, const char * name, int dir, const char * dev, const char * stream_name,
+									const PaSampleSpec * spec, const void * channel_map, const PaBufferAttr * attr, int * error );
+	typedef int		(*PaSimpleWrite)( void * stream, const void * data, size_t bytes, int * error );
+	typedef void	(*PaSimpleFree)( void * stream );
+
+	void *					mLibrary;
+	void *					mStream;
+	PaSimpleWrite			mWrite;
+	PaSimpleFree			mFree;
+};
+
+CPulseAudioSink * CPulseAudioSink::Create( u32 frequency )
+{
+	CPulseAudioSink * sink = new CPulseAudioSink;
+
+	PaSimpleNew			pa_simple_new;
+
+	sink->mLibrary = dlopen( "libpulse-simple.so.0", RTLD_NOW );
+
+	if( sink->mLibrary == NULL ||
+		!LoadSymbol( sink->mLibrary, "pa_simple_new", &pa_simple_new ) ||
+		!LoadSymbol( sink->mLibrary, "pa_simple_write", &sink->mWrite ) ||
+		!LoadSymbol( sink->mLibrary, "pa_simple_free", &sink->mFree ) )
+	{
+		delete sink;
+		return NULL;
+	}
+
+	PaSampleSpec	spec;
+	spec.Format   = PA_SAMPLE_S16LE;
+	spec.Rate     = frequency;
+	spec.Channels = kNumChannels;
+
+	// The default target length is a couple of seconds, which is far too laggy
+	PaBufferAttr	attr;
+	attr.MaxLength = u32( ~0 );
+	attr.TLength   = (frequency * kDeviceLatencyMs / 1000) * sizeof( Sample );
+	attr.PreBuf    = u32( ~0 );
+	attr.MinReq    = u32( ~0 );
+	attr.FragSize  = u32( ~0 );
+
+	sink->mStream = pa_simple_new( NULL, "Daedalus", PA_STREAM_PLAYBACK, NULL, "Audio", &spec, NULL, &attr, NULL );
+	if( sink->mStream == NULL )
+	{
+		delete sink;
+		return NULL;
+	}
+
+	return sink;
+}
+
+CPulseAudioSink::~CPulseAudioSink()
+{
+	if( mStream != NULL )
+		mFree( mStream );
+	if( mLibrary != NULL )
+		dlclose( mLibrary );
+}
+
+void CPulseAudioSink::Write( const Sample * samples, u32 num_samples )
+{
+	mWrite( mStream, samples, num_samples * sizeof( Sample ), NULL );
+}
+
+}
+
+//*****************************************************************************
+//
+//*****************************************************************************
+CAudioSink * CreateAudioSink( u32 frequency )
+{
+	const char *	name( getenv( "DAEDALUS_AUDIO_SINK" ) );
+	CAudioSink *	sink( NULL );
+
+	if( name == NULL || strcmp( name, "pulse" ) == 0 )
+	{
+		sink = CPulseAudioSink::Create( frequency );
+		if( sink != NULL )
+		{
+			DBGConsole_Msg( 0, "Audio output: PulseAudio" );
+			return sink;
+		}
+	}
+
+	if( name == NULL || strcmp( name, "alsa" ) == 0 )
+	{
+		sink = CAlsaAudioSink::Create( frequency );
+		if( sink != NULL )
+		{
+			DBGConsole_Msg( 0, "Audio output: ALSA" );
+			return sink;
+		}
+	}
+
+	if( name != NULL && strncmp( name, "wav", 3 ) == 0 )
+	{
+		const char * filename( name[ 3 ] == ':' ? name + 4 : "daedalus.wav" );
+
+		sink = CWavAudioSink::Create( filename, frequency );
+		if( sink != NULL )
+		{
+			DBGConsole_Msg( 0, "Audio output: %s", filename );
+			return sink;
+		}
+	}
+
+	DBGConsole_Msg( 0, "Audio output: null" );
+	return new CNullAudioSink;
+}
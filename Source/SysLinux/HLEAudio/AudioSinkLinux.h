@@ -0,0 +1,55 @@
+/*
+Copyright (C) 2012 StrmnNrmn
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#pragma once
+
+#ifndef SYSLINUX_HLEAUDIO_AUDIOSINKLINUX_H_
+#define SYSLINUX_HLEAUDIO_AUDIOSINKLINUX_H_
+
+//
+//	Where the Linux audio plugin sends its output. The sound servers are
+//	loaded with dlopen, so the build doesn't need their headers and a machine
+//	without them (e.g. a headless build box) still runs, using the null sink.
+//
+//	The sink is picked with the DAEDALUS_AUDIO_SINK environment variable:
+//
+//		pulse			PulseAudio
+//		alsa			ALSA's "default" device
+//		null			Throws the samples away
+//		wav[:file]		Writes the samples to file (daedalus.wav by default)
+//
+//	If it isn't set, the first of pulse, alsa and null which opens is used.
+//
+#include "HLEAudio/AudioBuffer.h"
+
+class CAudioSink
+{
+public:
+	virtual ~CAudioSink() {}
+
+	// Devices block in Write until they have room, which paces the output thread.
+	// The others take the samples straight away, so they are only given real samples.
+	virtual bool			IsDevice() const = 0;
+
+	virtual void			Write( const Sample * samples, u32 num_samples ) = 0;
+};
+
+CAudioSink *	CreateAudioSink( u32 frequency );
+
+#endif // SYSLINUX_HLEAUDIO_AUDIOSINKLINUX_H_
@@ -31,6 +31,53 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #define DAEDALUS_ENDIAN_MODE DAEDALUS_ENDIAN_LITTLE
 
+// The dynarec backend in SysLinux/DynaRec/x64 targets the SysV x86-64 ABI
+#if defined(__x86_64__)
+#define DAEDALUS_ENABLE_DYNAREC
+#endif
+
+// See DynaRec/TraceCompiler.h
+#if defined(__x86_64__)
+#define DAEDALUS_ENABLE_DYNAREC_THREAD
+#endif
+
+// See DynaRec/TraceCache.h
+#if defined(__x86_64__)
+#define DAEDALUS_ENABLE_TRACE_CACHE
+#endif
+
+// See Core/Fastmem.h and SysLinux/Core/FastmemLinux.cpp
+#if defined(__x86_64__)
+#define DAEDALUS_ENABLE_FASTMEM
+#endif
+
+// See HLEGraphics/TnLSSE.h
+#if defined(__SSE2__)
+#define DAEDALUS_ENABLE_SSE_TNL
+#endif
+
+// See HLEGraphics/ConvertSSE.h
+#if defined(__SSE2__)
+#define DAEDALUS_ENABLE_SSE_TEXCONV
+#endif
+
+// See Core/DirtyPages.h
+#define DAEDALUS_ENABLE_DIRTY_PAGES
+
+// See HLEAudio/AudioTaskQueue.h
+#define DAEDALUS_ENABLE_AUDIO_TASK_THREAD
+
+// See HLEGraphics/TextureDecoder.h
+#define DAEDALUS_ENABLE_TEXTURE_DECODE_THREADS
+
+// See SysGL/HLEGraphics/GraphicsPluginGL.cpp
+#define DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+
+// CPU_Go in Core/Interpret.cpp uses computed gotos (a GCC/Clang extension)
+#ifdef __GNUC__
+#define DAEDALUS_THREADED_INTERPRETER
+#endif
+
 #ifdef __GNUC__
 #define DAEDALUS_EXPECT_LIKELY(c) __builtin_expect((c),1)
 #define DAEDALUS_EXPECT_UNLIKELY(c) __builtin_expect((c),0)
@@ -37,6 +37,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Core/Memory.h"
 #include "Debug/DBGConsole.h"
 #include "HLEAudio/AudioBuffer.h"
+#include "HLEAudio/AudioTaskQueue.h"
 #include "HLEAudio/audiohle.h"
 #include "Utility/FramerateLimiter.h"
 #include "Utility/Thread.h"
@@ -120,6 +121,7 @@ bool AudioPluginOSX::StartEmulation()
 
 void AudioPluginOSX::StopEmulation()
 {
+	AudioTask_Stop();
 	Audio_Reset();
 	StopAudio();
 }
@@ -161,9 +163,16 @@ EProcessResult AudioPluginOSX::ProcessAList()
 			result = PR_COMPLETED;
 			break;
 		case APM_ENABLED_ASYNC:
-			DAEDALUS_ERROR("Async audio is unimplemented");
-			Audio_Ucode();
-			result = PR_COMPLETED;
+			if (AudioTask_Start())
+			{
+				AudioTask_Submit();
+				result = PR_STARTED;
+			}
+			else
+			{
+				Audio_Ucode();
+				result = PR_COMPLETED;
+			}
 			break;
 		case APM_ENABLED_SYNC:
 			Audio_Ucode();
@@ -34,6 +34,25 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #define DAEDALUS_ENDIAN_MODE DAEDALUS_ENDIAN_LITTLE
 
+// See HLEGraphics/TnLSSE.h
+#if defined(__SSE2__)
+#define DAEDALUS_ENABLE_SSE_TNL
+#endif
+
+// See HLEGraphics/ConvertSSE.h
+#if defined(__SSE2__)
+#define DAEDALUS_ENABLE_SSE_TEXCONV
+#endif
+
+// See Core/DirtyPages.h
+#define DAEDALUS_ENABLE_DIRTY_PAGES
+
+// See HLEAudio/AudioTaskQueue.h
+#define DAEDALUS_ENABLE_AUDIO_TASK_THREAD
+
+// See HLEGraphics/TextureDecoder.h
+#define DAEDALUS_ENABLE_TEXTURE_DECODE_THREADS
+
 #ifdef __GNUC__
 #define DAEDALUS_EXPECT_LIKELY(c) __builtin_expect((c),1)
 #define DAEDALUS_EXPECT_UNLIKELY(c) __builtin_expect((c),0)
@@ -128,6 +128,8 @@ int main(int argc, char **argv)
 
 //FIXME: All this stuff needs tidying
 
+// The Linux x86-64 build has a real dynarec backend (SysLinux/DynaRec/x64)
+#ifndef DAEDALUS_ENABLE_DYNAREC
 void Dynarec_ClearedCPUStuffToDo()
 {
 }
@@ -143,4 +145,5 @@ void _EnterDynaRec()
 	DAEDALUS_ASSERT(false, "Unimplemented");
 }
 }
+#endif // DAEDALUS_ENABLE_DYNAREC
 
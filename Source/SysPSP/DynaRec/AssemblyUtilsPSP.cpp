@@ -126,5 +126,23 @@ void		ReplaceBranchWithJump( CJumpLocation branch, CCodeLabel target )
 	_DaedalusICacheInvalidate( p_lower, size );
 }
 
+//*****************************************************************************
+//	Return the location a long jump currently targets
+//*****************************************************************************
+CCodeLabel	GetJumpTarget( CJumpLocation jump )
+{
+	// Read through the uncached pointer, as PatchJumpLong writes through it
+	const PspOpCode &	op_code( *reinterpret_cast< const PspOpCode * >( jump.GetWritableU8P() ) );
+	u32					jump_address( reinterpret_cast< u32 >( jump.GetTargetU8P() ) );
+
+	if( op_code.op == OP_J || op_code.op == OP_JAL )
+	{
+		return CCodeLabel( reinterpret_cast< const void * >( ((jump_address + 4) & 0xf0000000) | (op_code.target << 2) ) );
+	}
+
+	// Branch offsets are relative to the delay slot
+	s32		offset( s16( op_code.offset ) );
+	return CCodeLabel( jump.GetTargetU8P() + 4 + offset * 4 );
+}
 
 }
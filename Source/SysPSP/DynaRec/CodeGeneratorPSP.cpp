@@ -1027,7 +1027,7 @@ CJumpLocation CCodeGeneratorPSP::GenerateExitCode( u32 exit_address, u32 jump_ad
 
 		// Check if we're ok to continue, without flushing any registers
 		GetVar( PspReg_V0, &gCPUState.CPUControl[C0_COUNT]._u32 );
-		GetVar( PspReg_A0, (const u32*)&gCPUState.Events[0].mCount );
+		GetVar( PspReg_A0, (const u32*)&gCPUState.EventCounter );
 
 		//
 		//	Pull in any registers which may have been flushed for whatever reason.
@@ -1060,7 +1060,7 @@ CJumpLocation CCodeGeneratorPSP::GenerateExitCode( u32 exit_address, u32 jump_ad
 		//
 		ADDIU( PspReg_A0, PspReg_A0, -s16(num_instructions) );
 		BGTZ( PspReg_A0, mLoopTop, false );
-		SetVar( (u32*)&gCPUState.Events[0].mCount, PspReg_A0 );	// ASSUMES store is done in just a single op.
+		SetVar( (u32*)&gCPUState.EventCounter, PspReg_A0 );	// ASSUMES store is done in just a single op.
 
 		FlushAllRegisters( mRegisterCache, true );
 
@@ -1144,7 +1144,7 @@ void CCodeGeneratorPSP::GenerateEretExitCode( u32 num_instructions, CIndirectExi
 //*****************************************************************************
 // Handle branching back to the interpreter after an indirect jump
 //*****************************************************************************
-void CCodeGeneratorPSP::GenerateIndirectExitCode( u32 num_instructions, CIndirectExitMap * p_map )
+void CCodeGeneratorPSP::GenerateIndirectExitCode( u32 num_instructions, CIndirectExitMap * p_map, bool is_return )
 {
 	FlushAllRegisters( mRegisterCache, false );
 
@@ -1407,6 +1407,7 @@ CJumpLocation	CCodeGeneratorPSP::GenerateOpCode( const STraceEntry& ti, bool bra
 	if( branch_delay_slot ) mPreviousStoreBase = mPreviousLoadBase = N64Reg_R0;	//Invalidate
 
 	mQuickLoad = ti.Usage.Access8000;
+	mRamAddress = (ti.Flags & TEF_RAM_ADDRESS) != 0;		// Unlike mQuickLoad, this doesn't depend on the registers when the trace was recorded
 
 	const EN64Reg	rs = EN64Reg( op_code.rs );
 	const EN64Reg	rt = EN64Reg( op_code.rt );
@@ -1522,7 +1523,7 @@ CJumpLocation	CCodeGeneratorPSP::GenerateOpCode( const STraceEntry& ti, bool bra
 	case OP_LD:			GenerateLD( address, branch_delay_slot, rt, base, s16( op_code.immediate ) );	handled = true; break;
 	case OP_LWC1:		GenerateLWC1( address, branch_delay_slot, ft, base, s16( op_code.immediate ) );	handled = true; break;
 #ifdef ENABLE_LDC1
-	case OP_LDC1:		if( !branch_delay_slot & gMemoryAccessOptimisation & mQuickLoad ) { GenerateLDC1( address, branch_delay_slot, ft, base, s16( op_code.immediate ) );	handled = true; } break;
+	case OP_LDC1:		if( !branch_delay_slot & (mRamAddress | (gMemoryAccessOptimisation & mQuickLoad)) ) { GenerateLDC1( address, branch_delay_slot, ft, base, s16( op_code.immediate ) );	handled = true; } break;
 #endif
 
 #ifdef ENABLE_LWR_LWL
@@ -1536,7 +1537,7 @@ CJumpLocation	CCodeGeneratorPSP::GenerateOpCode( const STraceEntry& ti, bool bra
 	case OP_SD:			GenerateSD( address, branch_delay_slot, rt, base, s16( op_code.immediate ) );	handled = true; break;
 	case OP_SWC1:		GenerateSWC1( address, branch_delay_slot, ft, base, s16( op_code.immediate ) );	handled = true; break;
 #ifdef ENABLE_SDC1
-	case OP_SDC1:		if( !branch_delay_slot & gMemoryAccessOptimisation & mQuickLoad ) { GenerateSDC1( address, branch_delay_slot, ft, base, s16( op_code.immediate ) );	handled = true; } break;
+	case OP_SDC1:		if( !branch_delay_slot & (mRamAddress | (gMemoryAccessOptimisation & mQuickLoad)) ) { GenerateSDC1( address, branch_delay_slot, ft, base, s16( op_code.immediate ) );	handled = true; } break;
 #endif
 
 #ifdef ENABLE_SWR_SWL
@@ -1941,7 +1942,7 @@ void	CCodeGeneratorPSP::GenerateLoad( u32 current_pc,
 		XOR( PspReg_A0, reg_address, PspReg_A3);		//zero two LSB bits in address
 
 		//Dont cache the current pointer to K0 reg because the address is mangled by the XOR
-		if( (n64_base == N64Reg_SP) | (gMemoryAccessOptimisation & mQuickLoad) )
+		if( (n64_base == N64Reg_SP) | mRamAddress | (gMemoryAccessOptimisation & mQuickLoad) )
 		{
 			ADDU( PspReg_A0, PspReg_A0, gMemoryBaseReg );
 			CAssemblyWriterPSP::LoadRegister( psp_dst, OP_LW, PspReg_A0, 0 );
@@ -1953,7 +1954,7 @@ void	CCodeGeneratorPSP::GenerateLoad( u32 current_pc,
 	}
 	else 
 	{
-		if( (n64_base == N64Reg_SP) | (gMemoryAccessOptimisation & mQuickLoad) )
+		if( (n64_base == N64Reg_SP) | mRamAddress | (gMemoryAccessOptimisation & mQuickLoad) )
 		{
 			if( swizzle != 0 )
 			{
@@ -2245,7 +2246,7 @@ void	CCodeGeneratorPSP::GenerateStore( u32 current_pc,
 	EPspReg		reg_base( GetRegisterAndLoadLo( n64_base, PspReg_A0 ) );
 	EPspReg		reg_address( reg_base );
 
-	if( (n64_base == N64Reg_SP) | (gMemoryAccessOptimisation & mQuickLoad) )
+	if( (n64_base == N64Reg_SP) | mRamAddress | (gMemoryAccessOptimisation & mQuickLoad) )
 	{
 		if( swizzle != 0 )
 		{
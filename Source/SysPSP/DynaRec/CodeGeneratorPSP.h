@@ -50,7 +50,7 @@ class CCodeGeneratorPSP : public CCodeGenerator, public CAssemblyWriterPSP
 
 		virtual	CJumpLocation		GenerateExitCode( u32 exit_address, u32 jump_address, u32 num_instructions, CCodeLabel next_fragment );
 		virtual void				GenerateEretExitCode( u32 num_instructions, CIndirectExitMap * p_map );
-		virtual void				GenerateIndirectExitCode( u32 num_instructions, CIndirectExitMap * p_map );
+		virtual void				GenerateIndirectExitCode( u32 num_instructions, CIndirectExitMap * p_map, bool is_return );
 
 		virtual void				GenerateBranchHandler( CJumpLocation branch_handler_jump, RegisterSnapshotHandle snapshot );
 
@@ -313,6 +313,7 @@ private:
 				std::stack<EPspReg>	mAvailableRegisters;
 
 				bool							mQuickLoad;
+				bool							mRamAddress;
 
 				EN64Reg							mPreviousLoadBase;
 				EN64Reg							mPreviousStoreBase;
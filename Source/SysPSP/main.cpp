@@ -43,6 +43,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "Core/Save.h"
 #include "Debug/DBGConsole.h"
 #include "Debug/DebugLog.h"
+#include "DynaRec/FragmentCache.h"
+#include "DynaRec/IndirectExitMap.h"
+#include "DynaRec/TraceOptimiser.h"
 #include "Graphics/GraphicsContext.h"
 #include "HLEGraphics/TextureCache.h"
 #include "Input/InputManager.h"
@@ -413,11 +416,19 @@ static void	DumpDynarecStats( float elapsed_time )
 
 	printf( "Frame: %dms, DynaRec %d%%, Regs cached %d%%, Lookup success %d/%d", u32(elapsed_time * 1000.0f), dynarec_ratio, cached_regs_ratio, gFragmentLookupSuccess, gFragmentLookupFailure );
 
+	const SFragmentInvalidationStats & invalidation( gFragmentCache.GetInvalidationStats() );
+	printf( ", Invalidated %d fragments/%d pages/%d links, %d evicted, %d flushes", invalidation.Fragments, invalidation.Pages, invalidation.LinksUnpatched, invalidation.Evicted, invalidation.Flushes );
+	printf( ", Indirect exits %d inline/%d return/%d lookups (%d failed)", gIndirectExitStats.InlineHits, gIndirectExitStats.ReturnHits, gIndirectExitStats.Lookups, gIndirectExitStats.Failures );
+	printf( ", Optimised %d constants/%d writes/%d loads/%d ram accesses", TraceOptimiser::gStats.ConstantsFolded, TraceOptimiser::gStats.WritesRemoved, TraceOptimiser::gStats.LoadsForwarded, TraceOptimiser::gStats.RamAccesses );
+
 	printf( TERMINAL_RESTORE_CURSOR );
 	fflush( stdout );
 
 	gFragmentLookupSuccess = 0;
 	gFragmentLookupFailure = 0;
+	gFragmentCache.ResetInvalidationStats();
+	gIndirectExitStats.Reset();
+	TraceOptimiser::gStats.Reset();
 }
 #endif
 
@@ -40,6 +40,14 @@ static const u32		NUM_MIPS_REGISTERS( 32 );
 static const u32		INTEL_REG_UNUSED( ~0 );
 // XX this optimisation works very well on the PSP, option to disable it was removed
 static const bool		gDynarecStackOptimisation = true;
+
+//	Accesses through the stack pointer, or through a base the trace optimiser
+//	has shown to point into RDRAM, don't need to go through the memory tables
+static bool CanAccessRamDirectly( EN64Reg base, bool ram_address )
+{
+	return ram_address || (gDynarecStackOptimisation && base == N64Reg_SP);
+}
+
 //*****************************************************************************
 //	XXXX
 //*****************************************************************************
@@ -336,7 +344,7 @@ void CCodeGeneratorX86::GenerateEretExitCode( u32 num_instructions, CIndirectExi
 //*****************************************************************************
 // Handle branching back to the interpreter after an indirect jump
 //*****************************************************************************
-void CCodeGeneratorX86::GenerateIndirectExitCode( u32 num_instructions, CIndirectExitMap * p_map )
+void CCodeGeneratorX86::GenerateIndirectExitCode( u32 num_instructions, CIndirectExitMap * p_map, bool is_return )
 {
 	MOVI(ECX_CODE, num_instructions);
 	CALL( CCodeLabel( CPU_UpdateCounter ) );
@@ -511,6 +519,7 @@ CJumpLocation	CCodeGeneratorX86::GenerateOpCode( const STraceEntry& ti, bool bra
 	//const u32		jump_target( (address&0xF0000000) | (op_code.target<<2) );
 	//const u32		branch_target( address + ( ((s32)(s16)op_code.immediate)<<2 ) + 4);
 	const u32		ft = op_code.ft;
+	const bool		ram_address = (ti.Flags & TEF_RAM_ADDRESS) != 0;
 
 
 	bool handled = false;
@@ -520,34 +529,33 @@ CJumpLocation	CCodeGeneratorX86::GenerateOpCode( const STraceEntry& ti, bool bra
 		case OP_JAL:		GenerateJAL( address ); handled = true; break;
 		case OP_CACHE:		GenerateCACHE( base, op_code.immediate, rt ); handled = true; break;
 			
-		// For LW, SW, SWC1, LB etc, only generate an exception handler if access wasn't done through the stack (handle = false)
-		// This will have to be reworked once we handle accesses other than the stack!
+		// For LW, SW, SWC1, LB etc, only generate an exception handler if access wasn't done directly to RAM (handle = false)
 		case OP_LW:
-			handled = GenerateLW(rt, base, s16(op_code.immediate));
+			handled = GenerateLW(rt, base, s16(op_code.immediate), ram_address);
 			exception = !handled;
 			break;
 		case OP_SW:
-			handled = GenerateSW(rt, base, s16(op_code.immediate));
+			handled = GenerateSW(rt, base, s16(op_code.immediate), ram_address);
 			exception = !handled;
 			break;
 		case OP_SWC1:
-			handled = GenerateSWC1(ft, base, s16(op_code.immediate));
+			handled = GenerateSWC1(ft, base, s16(op_code.immediate), ram_address);
 			exception = !handled;
 			break;
 		case OP_LB:
-			handled = GenerateLB(rt, base, s16(op_code.immediate));
+			handled = GenerateLB(rt, base, s16(op_code.immediate), ram_address);
 			exception = !handled;
 			break;
 		case OP_LBU:
-			 handled = GenerateLBU(rt, base, s16(op_code.immediate));
+			 handled = GenerateLBU(rt, base, s16(op_code.immediate), ram_address);
 			 exception = !handled;
 			break;
 		case OP_LH:
-			handled = GenerateLH(rt, base, s16(op_code.immediate));
+			handled = GenerateLH(rt, base, s16(op_code.immediate), ram_address);
 			exception = !handled;
 			break;
 		case OP_LWC1:
-			handled = GenerateLWC1(ft, base, s16(op_code.immediate));
+			handled = GenerateLWC1(ft, base, s16(op_code.immediate), ram_address);
 			exception = !handled;
 			break;
 		case OP_ADDIU:
@@ -708,9 +716,9 @@ void CCodeGeneratorX86::GenerateLoad(u32 memBase, EN64Reg base, s16 offset, u8 t
 	}
 }
 
-bool CCodeGeneratorX86::GenerateLW( EN64Reg rt, EN64Reg base, s16 offset )
+bool CCodeGeneratorX86::GenerateLW( EN64Reg rt, EN64Reg base, s16 offset, bool ram_address )
 {
-	if (gDynarecStackOptimisation && base == N64Reg_SP)
+	if (CanAccessRamDirectly(base, ram_address))
 	{
 		GenerateLoad((u32)g_pu8RamBase_8000, base, offset, 0, 32);
 
@@ -724,9 +732,9 @@ bool CCodeGeneratorX86::GenerateLW( EN64Reg rt, EN64Reg base, s16 offset )
 }
 
 
-bool CCodeGeneratorX86::GenerateSWC1( u32 ft, EN64Reg base, s16 offset )
+bool CCodeGeneratorX86::GenerateSWC1( u32 ft, EN64Reg base, s16 offset, bool ram_address )
 {
-	if (gDynarecStackOptimisation && base == N64Reg_SP)
+	if (CanAccessRamDirectly(base, ram_address))
 	{
 		MOV_REG_MEM(ECX_CODE, &gCPUState.CPU[base]._u32_0);
 		ADDI(ECX_CODE, (u32)g_pu8RamBase_8000);
@@ -739,9 +747,9 @@ bool CCodeGeneratorX86::GenerateSWC1( u32 ft, EN64Reg base, s16 offset )
 	return false;
 }
 
-bool CCodeGeneratorX86::GenerateSW( EN64Reg rt, EN64Reg base, s16 offset )
+bool CCodeGeneratorX86::GenerateSW( EN64Reg rt, EN64Reg base, s16 offset, bool ram_address )
 {
-	if (gDynarecStackOptimisation && base == N64Reg_SP)
+	if (CanAccessRamDirectly(base, ram_address))
 	{
 		MOV_REG_MEM(ECX_CODE, &gCPUState.CPU[base]._u32_0);
 		ADDI(ECX_CODE, (u32)g_pu8RamBase_8000);
@@ -753,9 +761,9 @@ bool CCodeGeneratorX86::GenerateSW( EN64Reg rt, EN64Reg base, s16 offset )
 	return false;
 }
 
-bool CCodeGeneratorX86::GenerateLB( EN64Reg rt, EN64Reg base, s16 offset )
+bool CCodeGeneratorX86::GenerateLB( EN64Reg rt, EN64Reg base, s16 offset, bool ram_address )
 {
-	if (gDynarecStackOptimisation && base == N64Reg_SP)
+	if (CanAccessRamDirectly(base, ram_address))
 	{
 		GenerateLoad((u32)g_pu8RamBase_8000, base, offset, U8_TWIDDLE, 8);
 		MOVSX(EAX_CODE, EAX_CODE, true);
@@ -769,9 +777,9 @@ bool CCodeGeneratorX86::GenerateLB( EN64Reg rt, EN64Reg base, s16 offset )
 	return false;
 }
 
-bool CCodeGeneratorX86::GenerateLBU( EN64Reg rt, EN64Reg base, s16 offset )
+bool CCodeGeneratorX86::GenerateLBU( EN64Reg rt, EN64Reg base, s16 offset, bool ram_address )
 {
-	if (gDynarecStackOptimisation && base == N64Reg_SP)
+	if (CanAccessRamDirectly(base, ram_address))
 	{
 		GenerateLoad((u32)g_pu8RamBase_8000, base, offset, U8_TWIDDLE, 8);
 		MOVZX(EAX_CODE, EAX_CODE, true);
@@ -785,9 +793,9 @@ bool CCodeGeneratorX86::GenerateLBU( EN64Reg rt, EN64Reg base, s16 offset )
 }
 
 
-bool CCodeGeneratorX86::GenerateLH( EN64Reg rt, EN64Reg base, s16 offset )
+bool CCodeGeneratorX86::GenerateLH( EN64Reg rt, EN64Reg base, s16 offset, bool ram_address )
 {
-	if (gDynarecStackOptimisation && base == N64Reg_SP)
+	if (CanAccessRamDirectly(base, ram_address))
 	{
 		GenerateLoad((u32)g_pu8RamBase_8000, base, offset, U16_TWIDDLE, 16);
 
@@ -837,9 +845,9 @@ void CCodeGeneratorX86::GenerateSRA( EN64Reg rd, EN64Reg rt, u32 sa )
 	MOV_MEM_REG(&gCPUState.CPU[rd]._u32_1, EDX_CODE);
 }
 
-bool CCodeGeneratorX86::GenerateLWC1( u32 ft, EN64Reg base, s16 offset )
+bool CCodeGeneratorX86::GenerateLWC1( u32 ft, EN64Reg base, s16 offset, bool ram_address )
 {
-	if (gDynarecStackOptimisation && base == N64Reg_SP)
+	if (CanAccessRamDirectly(base, ram_address))
 	{
 		GenerateLoad((u32)g_pu8RamBase_8000, base, offset, 0, 32);
 
@@ -51,7 +51,7 @@ class CCodeGeneratorX86 : public CCodeGenerator, public CAssemblyWriterX86
 
 		virtual	CJumpLocation		GenerateExitCode( u32 exit_address, u32 jump_address, u32 num_instructions, CCodeLabel next_fragment );
 		virtual void				GenerateEretExitCode( u32 num_instructions, CIndirectExitMap * p_map );
-		virtual void				GenerateIndirectExitCode( u32 num_instructions, CIndirectExitMap * p_map );
+		virtual void				GenerateIndirectExitCode( u32 num_instructions, CIndirectExitMap * p_map, bool is_return );
 
 		virtual void				GenerateBranchHandler( CJumpLocation branch_handler_jump, RegisterSnapshotHandle snapshot );
 
@@ -84,13 +84,13 @@ class CCodeGeneratorX86 : public CCodeGenerator, public CAssemblyWriterX86
 	private:
 				void	GenerateLoad(u32 memBase, EN64Reg base, s16 offset, u8 twiddle, u8 bits);
 				void	GenerateCACHE( EN64Reg base, s16 offset, u32 cache_op );
-				bool	GenerateLW(EN64Reg rt, EN64Reg base, s16 offset );
-				bool	GenerateSW(EN64Reg rt, EN64Reg base, s16 offset );
-				bool	GenerateSWC1( u32 ft, EN64Reg base, s16 offset );
-				bool	GenerateLB(EN64Reg rt, EN64Reg base, s16 offset );
-				bool	GenerateLBU(EN64Reg rt, EN64Reg base, s16 offset );
-				bool	GenerateLH(EN64Reg rt, EN64Reg base, s16 offset );
-				bool	GenerateLWC1(u32 ft, EN64Reg base, s16 offset );
+				bool	GenerateLW(EN64Reg rt, EN64Reg base, s16 offset, bool ram_address );
+				bool	GenerateSW(EN64Reg rt, EN64Reg base, s16 offset, bool ram_address );
+				bool	GenerateSWC1( u32 ft, EN64Reg base, s16 offset, bool ram_address );
+				bool	GenerateLB(EN64Reg rt, EN64Reg base, s16 offset, bool ram_address );
+				bool	GenerateLBU(EN64Reg rt, EN64Reg base, s16 offset, bool ram_address );
+				bool	GenerateLH(EN64Reg rt, EN64Reg base, s16 offset, bool ram_address );
+				bool	GenerateLWC1(u32 ft, EN64Reg base, s16 offset, bool ram_address );
 
 				void	GenerateADDIU( EN64Reg rt, EN64Reg rs, s16 immediate );
 
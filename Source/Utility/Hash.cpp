@@ -21,6 +21,12 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "stdafx.h"
 #include "Utility/Hash.h"
 
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 //-----------------------------------------------------------------------------
 // MurmurHash2, by Austin Appleby
 // Note - This code makes a few assumptions about how your machine behaves -
@@ -132,3 +138,129 @@ unsigned int murmur2_neutral_hash ( const void * key, int len, unsigned int seed
 
 	return h;
 }
+
+//-----------------------------------------------------------------------------
+// xxHash32, by Yann Collet
+// Used to hash the whole of a texture, so the main loop keeps its four
+// accumulators in one SSE2 register where it can. Both versions give the same
+// results. Reads are in native byte order, so (like murmur2_hash) the results
+// will differ between little-endian and big-endian machines.
+//-----------------------------------------------------------------------------
+
+static const unsigned int XXH_PRIME1 = 2654435761U;
+static const unsigned int XXH_PRIME2 = 2246822519U;
+static const unsigned int XXH_PRIME3 = 3266489917U;
+static const unsigned int XXH_PRIME4 =  668265263U;
+static const unsigned int XXH_PRIME5 =  374761393U;
+
+static inline unsigned int xxh_rotl( unsigned int x, int r )
+{
+	return (x << r) | (x >> (32 - r));
+}
+
+static inline unsigned int xxh_read32( const unsigned char * data )
+{
+	unsigned int k;
+	memcpy( &k, data, sizeof( k ) );
+	return k;
+}
+
+#ifdef __SSE2__
+// SSE2 has no 32 bit multiply, so do the odd and even lanes separately
+static inline __m128i xxh_mullo32( __m128i a, __m128i b )
+{
+	__m128i even = _mm_mul_epu32( a, b );
+	__m128i odd  = _mm_mul_epu32( _mm_srli_epi64( a, 32 ), _mm_srli_epi64( b, 32 ) );
+
+	return _mm_unpacklo_epi32( _mm_shuffle_epi32( even, _MM_SHUFFLE( 0, 0, 2, 0 ) ),
+							   _mm_shuffle_epi32( odd,  _MM_SHUFFLE( 0, 0, 2, 0 ) ) );
+}
+#else
+static inline unsigned int xxh_round( unsigned int acc, unsigned int input )
+{
+	acc += input * XXH_PRIME2;
+	acc  = xxh_rotl( acc, 13 );
+	return acc * XXH_PRIME1;
+}
+#endif
+
+unsigned int xxhash32 ( const void * key, int len, unsigned int seed )
+{
+	const unsigned char * data = (const unsigned char *)key;
+	const unsigned char * end  = data + len;
+
+	unsigned int h;
+
+	if( len >= 16 )
+	{
+		const unsigned char * limit = end - 16;
+		unsigned int v[4];
+
+#ifdef __SSE2__
+		const __m128i prime1 = _mm_set1_epi32( XXH_PRIME1 );
+		const __m128i prime2 = _mm_set1_epi32( XXH_PRIME2 );
+
+		__m128i acc = _mm_setr_epi32( seed + XXH_PRIME1 + XXH_PRIME2, seed + XXH_PRIME2, seed, seed - XXH_PRIME1 );
+
+		do
+		{
+			__m128i input = _mm_loadu_si128( (const __m128i *)data );
+
+			acc = _mm_add_epi32( acc, xxh_mullo32( input, prime2 ) );
+			acc = _mm_or_si128( _mm_slli_epi32( acc, 13 ), _mm_srli_epi32( acc, 19 ) );
+			acc = xxh_mullo32( acc, prime1 );
+
+			data += 16;
+		}
+		while( data <= limit );
+
+		_mm_storeu_si128( (__m128i *)v, acc );
+#else
+		v[0] = seed + XXH_PRIME1 + XXH_PRIME2;
+		v[1] = seed + XXH_PRIME2;
+		v[2] = seed;
+		v[3] = seed - XXH_PRIME1;
+
+		do
+		{
+			v[0] = xxh_round( v[0], xxh_read32( data +  0 ) );
+			v[1] = xxh_round( v[1], xxh_read32( data +  4 ) );
+			v[2] = xxh_round( v[2], xxh_read32( data +  8 ) );
+			v[3] = xxh_round( v[3], xxh_read32( data + 12 ) );
+
+			data += 16;
+		}
+		while( data <= limit );
+#endif
+
+		h = xxh_rotl( v[0], 1 ) + xxh_rotl( v[1], 7 ) + xxh_rotl( v[2], 12 ) + xxh_rotl( v[3], 18 );
+	}
+	else
+	{
+		h = seed + XXH_PRIME5;
+	}
+
+	h += (unsigned int)len;
+
+	while( data + 4 <= end )
+	{
+		h += xxh_read32( data ) * XXH_PRIME3;
+		h  = xxh_rotl( h, 17 ) * XXH_PRIME4;
+		data += 4;
+	}
+
+	while( data < end )
+	{
+		h += (*data) * XXH_PRIME5;
+		h  = xxh_rotl( h, 11 ) * XXH_PRIME1;
+		data++;
+	}
+
+	h ^= h >> 15;
+	h *= XXH_PRIME2;
+	h ^= h >> 13;
+	h *= XXH_PRIME3;
+	h ^= h >> 16;
+
+	return h;
+}
@@ -220,6 +220,10 @@ bool IPreferences::OpenPreferencesFile( const char * filename )
 		{
 			preferences.DynarecDoublesOptimisation = property->GetBooleanValue( false );
 		}
+		if( section->FindProperty( "DynarecTraceCache", &property ) )
+		{
+			preferences.DynarecTraceCache = property->GetBooleanValue( false );
+		}
 		if( section->FindProperty( "DoubleDisplayEnabled", &property ) )
 		{
 			preferences.DoubleDisplayEnabled = property->GetBooleanValue( true );
@@ -244,6 +248,10 @@ bool IPreferences::OpenPreferencesFile( const char * filename )
 		{
             preferences.FogEnabled = property->GetBooleanValue( false );
 		}
+		if( section->FindProperty( "DisplayListThread", &property ) )
+		{
+			preferences.DisplayListThread = property->GetBooleanValue( false );
+		}
 		if( section->FindProperty( "CheckTextureHashFrequency", &property ) )
 		{
 			preferences.CheckTextureHashFrequency = GetTextureHashFrequencyFromFrames( atoi( property->GetValue() ) );
@@ -304,12 +312,14 @@ void IPreferences::OutputSectionDetails( const RomID & id, const SRomPreferences
 	fprintf(fh, "DynarecEnabled=%d\n",             preferences.DynarecEnabled);
 	fprintf(fh, "DynarecLoopOptimisation=%d\n",    preferences.DynarecLoopOptimisation);
 	fprintf(fh, "DynarecDoublesOptimisation=%d\n", preferences.DynarecDoublesOptimisation);
+	fprintf(fh, "DynarecTraceCache=%d\n",          preferences.DynarecTraceCache);
 	fprintf(fh, "DoubleDisplayEnabled=%d\n",       preferences.DoubleDisplayEnabled);
 	fprintf(fh, "CleanSceneEnabled=%d\n",          preferences.CleanSceneEnabled);
 	fprintf(fh, "ClearDepthFrameBuffer=%d\n",	   preferences.ClearDepthFrameBuffer);
 	fprintf(fh, "AudioRateMatch=%d\n",             preferences.AudioRateMatch);
 	fprintf(fh, "VideoRateMatch=%d\n",             preferences.VideoRateMatch);
 	fprintf(fh, "FogEnabled=%d\n",                 preferences.FogEnabled);
+	fprintf(fh, "DisplayListThread=%d\n",          preferences.DisplayListThread);
 	fprintf(fh, "CheckTextureHashFrequency=%d\n",  GetTexureHashFrequencyAsFrames( preferences.CheckTextureHashFrequency ) );
 	fprintf(fh, "Frameskip=%d\n",                  GetFrameskipValueAsInt( preferences.Frameskip ) );
 	fprintf(fh, "AudioEnabled=%d\n",               preferences.AudioEnabled);
@@ -430,12 +440,14 @@ SRomPreferences::SRomPreferences()
 	,	DynarecEnabled( true )
 	,	DynarecLoopOptimisation( false )
 	,	DynarecDoublesOptimisation( false )
+	,	DynarecTraceCache( false )
 	,	DoubleDisplayEnabled( true )
 	,	CleanSceneEnabled( false )
 	,	ClearDepthFrameBuffer( false )
 	,	AudioRateMatch( false )
 	,	VideoRateMatch( false )
 	,	FogEnabled( false )
+	,	DisplayListThread( false )
 	,   MemoryAccessOptimisation( false )
 	,	CheatsEnabled( false )
 //	,	AudioAdaptFrequency( false )
@@ -455,12 +467,14 @@ void SRomPreferences::Reset()
 	DynarecEnabled             = true;
 	DynarecLoopOptimisation    = false;
 	DynarecDoublesOptimisation = false;
+	DynarecTraceCache          = false;
 	DoubleDisplayEnabled       = true;
 	CleanSceneEnabled          = false;
 	ClearDepthFrameBuffer	   = false;
 	AudioRateMatch             = false;
 	VideoRateMatch             = false;
 	FogEnabled                 = false;
+	DisplayListThread          = false;
 	MemoryAccessOptimisation   = false;
 	CheckTextureHashFrequency  = kDefaultTextureHashFrequency;
 	Frameskip                  = FV_DISABLED;
@@ -478,12 +492,18 @@ void SRomPreferences::Apply() const
 	gDynarecEnabled             = g_ROM.settings.DynarecSupported && DynarecEnabled;
 	gDynarecLoopOptimisation	= DynarecLoopOptimisation;	// && g_ROM.settings.DynarecLoopOptimisation;
 	gDynarecDoublesOptimisation	= g_ROM.settings.DynarecDoublesOptimisation || DynarecDoublesOptimisation;
+#ifdef DAEDALUS_ENABLE_TRACE_CACHE
+	gDynarecTraceCacheEnabled	= DynarecTraceCache;
+#endif
 	gDoubleDisplayEnabled       = g_ROM.settings.DoubleDisplayEnabled && DoubleDisplayEnabled; // I don't know why DD won't disabled if we set ||
 	gCleanSceneEnabled          = g_ROM.settings.CleanSceneEnabled || CleanSceneEnabled;
 	gClearDepthFrameBuffer      = g_ROM.settings.ClearDepthFrameBuffer || ClearDepthFrameBuffer;
 	gAudioRateMatch             = g_ROM.settings.AudioRateMatch || AudioRateMatch;
 	gVideoRateMatch             = g_ROM.settings.VideoRateMatch || VideoRateMatch;
 	gFogEnabled                 = g_ROM.settings.FogEnabled || FogEnabled;
+#ifdef DAEDALUS_ENABLE_DISPLAYLIST_THREAD
+	gDisplayListThreadEnabled   = DisplayListThread;
+#endif
 	gCheckTextureHashFrequency  = GetTexureHashFrequencyAsFrames( CheckTextureHashFrequency );
 	gMemoryAccessOptimisation   = g_ROM.settings.MemoryAccessOptimisation || MemoryAccessOptimisation;
 	gFrameskipValue             = Frameskip;
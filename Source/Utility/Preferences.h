@@ -138,12 +138,14 @@ struct SRomPreferences
 	bool						DynarecEnabled;				// Requires DynarceSupported in RomSettings
 	bool						DynarecLoopOptimisation;
 	bool						DynarecDoublesOptimisation;
+	bool						DynarecTraceCache;			// Save traces when the rom is closed and reuse them next time
 	bool						DoubleDisplayEnabled;
 	bool						CleanSceneEnabled;
 	bool						ClearDepthFrameBuffer;
 	bool						AudioRateMatch;
 	bool						VideoRateMatch;
 	bool						FogEnabled;
+	bool						DisplayListThread;			// Process display lists on a worker thread
 	bool                        MemoryAccessOptimisation;
 	bool						CheatsEnabled;
 //	bool						AudioAdaptFrequency;
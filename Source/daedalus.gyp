@@ -28,11 +28,14 @@
         },
         'sources': [
           'Config/ConfigOptions.cpp',
+          'Core/CachedInterpret.cpp',
           'Core/Cheats.cpp',
           'Core/CPU.cpp',
+          'Core/DirtyPages.cpp',
           'Core/DMA.cpp',
           'Core/Dynamo.cpp',
           'Core/FlashMem.cpp',
+          'Core/IdleLoop.cpp',
           'Core/Interpret.cpp',
           'Core/Interrupts.cpp',
           'Core/JpegTask.cpp',
@@ -54,8 +57,12 @@
           'DynaRec/BranchType.cpp',
           'DynaRec/Fragment.cpp',
           'DynaRec/FragmentCache.cpp',
+          'DynaRec/HotTraceTable.cpp',
           'DynaRec/IndirectExitMap.cpp',
           'DynaRec/StaticAnalysis.cpp',
+          'DynaRec/TraceCache.cpp',
+          'DynaRec/TraceCompiler.cpp',
+          'DynaRec/TraceOptimiser.cpp',
           'DynaRec/TraceRecorder.cpp',
           'Graphics/ColourValue.cpp',
           'Graphics/PngUtil.cpp',
@@ -66,10 +73,12 @@
           'HLEAudio/ABI3mp3.cpp',
           'HLEAudio/AudioBuffer.cpp',
           'HLEAudio/AudioHLEProcessor.cpp',
+          'HLEAudio/AudioTaskQueue.cpp',
           'HLEAudio/HLEMain.cpp',
           'HLEGraphics/BaseRenderer.cpp',
           'HLEGraphics/CachedTexture.cpp',
           'HLEGraphics/ConvertImage.cpp',
+          'HLEGraphics/ConvertSSE.cpp',
           'HLEGraphics/ConvertTile.cpp',
           'HLEGraphics/DLDebug.cpp',
           'HLEGraphics/DLParser.cpp',
@@ -78,7 +87,9 @@
           'HLEGraphics/RDPStateManager.cpp',
           'HLEGraphics/TextureCache.cpp',
           'HLEGraphics/TextureCacheWebDebug.cpp',
+          'HLEGraphics/TextureDecoder.cpp',
           'HLEGraphics/TextureInfo.cpp',
+          'HLEGraphics/TnLSSE.cpp',
           'HLEGraphics/uCodes/Ucode.cpp',
           'Interface/RomDB.cpp',
           'Math/Matrix4x4.cpp',
@@ -144,20 +155,30 @@
             ],
           }],
           ['OS=="linux"', {
+            'link_settings': {
+              'libraries': [
+                '-ldl',
+              ],
+            },
             'sources': [
               # FIXME - we should move these to a common SysPosix dir...
               'SysOSX/Debug/DaedalusAssertOSX.cpp',
               'SysOSX/Debug/DebugConsoleOSX.cpp',
               'SysOSX/Debug/WebDebug.cpp',
               'SysOSX/Debug/WebDebugTemplate.cpp',
-              'SysOSX/DynaRec/CodeBufferManagerOSX.cpp',
               'SysOSX/HLEGraphics/DisplayListDebugger.cpp',
               'SysPosix/Utility/CondPosix.cpp',
               'SysPosix/Utility/IOPosix.cpp',
               'SysPosix/Utility/ThreadPosix.cpp',
               'SysPosix/Utility/TimingPosix.cpp',
 
+              'SysLinux/Core/FastmemLinux.cpp',
+              'SysLinux/DynaRec/x64/AssemblyWriterX64.cpp',
+              'SysLinux/DynaRec/x64/CodeBufferManagerX64.cpp',
+              'SysLinux/DynaRec/x64/CodeGeneratorX64.cpp',
+              'SysLinux/DynaRec/x64/DynaRecStubsX64.S',
               'SysLinux/HLEAudio/AudioPluginLinux.cpp',
+              'SysLinux/HLEAudio/AudioSinkLinux.cpp',
             ],
           }],
         ],
@@ -231,7 +252,12 @@
         'include_dirs': [
           '.',
         ],
+        'defines': [
+          'DAEDALUS_ACCURATE_TMEM',
+        ],
         'sources': [
+          'HLEGraphics/ConvertSSE_test.cpp',
+          'SysGL/HLEGraphics/ShaderCache_test.cpp',
           'Utility/FastMemcpy_test.cpp',
         ],
       }